@@ -0,0 +1,7 @@
+#include "base.hlsl"
+
+// Points have no surface to light, they are drawn with the color they were scanned with
+float4 main(VertexShaderOutput input) : SV_TARGET
+{
+	return float4(input.color, 1.0);
+}
@@ -1,8 +1,21 @@
 #include "base.hlsl"
 
-// register slots (uniforms?)
-//Texture2D objTexture : TEXTURE: register(t0);
-//SamplerState objSamplerState : SAMPLER: register(s0);
+// register slots, bound by the renderer
+Texture2D objTexture : TEXTURE: register(t0);
+SamplerState objSamplerState : SAMPLER: register(s0);
+
+// Meshes have no texture coordinates, so the texture is projected along the three world axes
+// and blended by how much the surface faces each one (triplanar mapping)
+float3 sampleTriplanar(float3 position, float3 normal)
+{
+	float3 weights = abs(normal);
+	weights = weights / max(weights.x + weights.y + weights.z, 0.0001);
+
+	float3 x = objTexture.Sample(objSamplerState, position.zy).rgb;
+	float3 y = objTexture.Sample(objSamplerState, position.xz).rgb;
+	float3 z = objTexture.Sample(objSamplerState, position.xy).rgb;
+	return x * weights.x + y * weights.y + z * weights.z;
+}
 
 float4 main(VertexShaderOutput input) : SV_TARGET
 {
@@ -16,8 +29,10 @@ float4 main(VertexShaderOutput input) : SV_TARGET
 
 	float3 lightValue = float3(0.8, 0.78, 0.76);
 
+	float3 albedo = sampleTriplanar(input.worldPos.xyz, normalize(input.normal));
+
 	// Maintain the current color (alpha 1)
-	return float4(lightValue * lambert, 1.0);
+	return float4(albedo * lightValue * lambert, 1.0);
 
 	//return float4(1.0, 1.0, 1.0, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,215 @@
+// Benchmarks of keyframe sampling and CPU skinning
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <cmath>
+
+#include "AnimationSystem.h"
+#include "JobSystem.h"
+
+using namespace std;
+
+namespace
+{
+	const size_t CHARACTER_JOINTS = 32;
+	const size_t CHARACTER_COUNT = 8;
+	const float CLIP_SECONDS = 2.0f;
+
+	// A grid bent along x by a chain of joints, every vertex weighted by the four nearest joints
+	shared_ptr<SkinnedMesh> generateCharacter(size_t targetVertices)
+	{
+		MeshResourcePtr grid = generateGridMesh(targetVertices);
+
+		auto mesh = make_shared<SkinnedMesh>();
+		mesh->vertices = grid->vertices;
+		mesh->indices = grid->indices;
+
+		float start = grid->boundsMin.x;
+		float segment = (grid->boundsMax.x - grid->boundsMin.x) / float(CHARACTER_JOINTS - 1);
+
+		Skeleton& skeleton = mesh->skeleton;
+		for (size_t joint = 0; joint < CHARACTER_JOINTS; joint++)
+		{
+			JointTransform bind;
+			bind.translation = { joint == 0 ? start : segment, 0.0f, 0.0f };
+			skeleton.parents.push_back(int(joint) - 1);
+			skeleton.bindPose.push_back(bind);
+
+			// joints are only translated in the bind pose, their inverse is the opposite translation
+			glm::mat4x4 inverseBind(1.0f);
+			inverseBind[3] = glm::vec4(-(start + segment * joint), 0.0f, 0.0f, 1.0f);
+			skeleton.inverseBindMatrices.push_back(inverseBind);
+		}
+
+		for (const Vertex& vertex : mesh->vertices)
+		{
+			float position = (vertex.position.x - start) / segment;
+			int nearest = int(std::floor(position));
+
+			SkinWeights skin;
+			float total = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				int joint = std::min(std::max(nearest - 1 + i, 0), int(CHARACTER_JOINTS) - 1);
+				float distance = std::abs(position - float(nearest - 1 + i));
+				skin.joints[i] = uint16_t(joint);
+				skin.weights[i] = std::max(2.0f - distance, 0.0f);
+				total += skin.weights[i];
+			}
+			for (float& weight : skin.weights)
+			{
+				weight /= total;
+			}
+			mesh->weights.push_back(skin);
+		}
+		return mesh;
+	}
+
+	// Every joint bends back and forth around z, a little behind its parent
+	AnimationClip generateWaveClip(const Skeleton& skeleton)
+	{
+		AnimationClip clip;
+		clip.duration = CLIP_SECONDS;
+		for (size_t joint = 0; joint < skeleton.size(); joint++)
+		{
+			TransformTrack track;
+			for (int key = 0; key <= 8; key++)
+			{
+				float time = CLIP_SECONDS * key / 8.0f;
+				float angle = 0.2f * std::sin(6.2831853f * time / CLIP_SECONDS + 0.3f * joint);
+				track.rotations.push_back({ time, glm::angleAxis(angle, glm::vec3(0.0f, 0.0f, 1.0f)) });
+			}
+			clip.tracks.push_back(track);
+		}
+		return clip;
+	}
+
+	// Straightforward skinning through glm, to check and compare the SIMD version with
+	void skinReference(const SkinnedMesh& mesh, const glm::mat4x4* palette, Vertex* out)
+	{
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+		{
+			const SkinWeights& skin = mesh.weights[i];
+			glm::vec4 position(0.0f);
+			glm::vec4 normal(0.0f);
+			for (int influence = 0; influence < 4; influence++)
+			{
+				const glm::mat4x4& matrix = palette[skin.joints[influence]];
+				position += matrix * glm::vec4(mesh.vertices[i].position, 1.0f) * skin.weights[influence];
+				normal += matrix * glm::vec4(mesh.vertices[i].normal, 0.0f) * skin.weights[influence];
+			}
+			out[i].position = glm::vec3(position);
+			out[i].normal = glm::normalize(glm::vec3(normal));
+			out[i].color = mesh.vertices[i].color;
+		}
+	}
+}
+
+BENCHMARK("animation.skinning", context)
+{
+	// --vertices is the total over every character
+	size_t verticesPerCharacter = std::max<size_t>(context.getConfig().meshVertices / CHARACTER_COUNT, 4);
+	shared_ptr<const SkinnedMesh> character = generateCharacter(verticesPerCharacter);
+	auto clip = make_shared<const SampledClip>(generateWaveClip(character->skeleton), 30.0f, &character->skeleton.bindPose);
+
+	AnimationSystem animation;
+	vector<MeshResourcePtr> targets;
+	for (size_t i = 0; i < CHARACTER_COUNT; i++)
+	{
+		targets.push_back(make_shared<MeshResource>());
+		SkinnedInstance& instance = animation.addSkinned(character, clip, targets.back());
+		instance.time = CLIP_SECONDS * i / CHARACTER_COUNT;
+	}
+
+	double vertices = double(character->vertices.size() * CHARACTER_COUNT);
+	double bytes = vertices * sizeof(Vertex);
+	context.setParam("characters", double(CHARACTER_COUNT));
+	context.setParam("joints", double(CHARACTER_JOINTS));
+	context.setParam("vertices", vertices);
+
+	// a frame: sample every clip, compute the palettes, skin every vertex
+	context.setParam("threads", 1);
+	context.measure("frame", [&]() {
+		animation.update(1.0f / 60.0f);
+		doNotOptimize(targets[0]->vertices.data());
+	}, vertices, bytes);
+	context.expectNoAllocations();
+
+	JobSystem& jobs = JobSystem::getDefault();
+	context.setParam("threads", jobs.getThreadCount());
+	context.measure("frame.parallel", [&]() {
+		animation.update(1.0f / 60.0f, &jobs);
+		doNotOptimize(targets[0]->vertices.data());
+	}, vertices, bytes);
+
+	// the skinning alone, against the plain version
+	const SkinnedInstance& first = *animation.getSkinnedInstances()[0];
+	vector<Vertex> reference(character->vertices.size());
+	context.setParam("threads", 1);
+	context.measure("reference", [&]() {
+		skinReference(*character, first.palette.data(), reference.data());
+		doNotOptimize(reference.data());
+	}, double(reference.size()), double(reference.size() * sizeof(Vertex)));
+
+	context.measure("simd", [&]() {
+		glm::vec3 boundsMin, boundsMax;
+		skinVertices(*character, first.palette.data(), 0, character->vertices.size(), targets[0]->vertices.data(), boundsMin, boundsMax);
+		doNotOptimize(targets[0]->vertices.data());
+	}, double(reference.size()), double(reference.size() * sizeof(Vertex)));
+
+	for (size_t i = 0; i < reference.size(); i++)
+	{
+		const Vertex& skinned = targets[0]->vertices[i];
+		if (glm::length(skinned.position - reference[i].position) > 1e-4f || glm::dot(skinned.normal, reference[i].normal) < 0.999f)
+		{
+			context.fail("SIMD skinning differs from the reference");
+			break;
+		}
+	}
+}
+
+BENCHMARK("animation.objects", context)
+{
+	// a few clips shared by many objects, like a crowd of props
+	size_t objectCount = context.getConfig().sceneObjects;
+	ScenePtr scene = generateScene(objectCount, generateGridMesh(64));
+
+	vector<shared_ptr<const SampledClip>> clips;
+	for (int variant = 0; variant < 4; variant++)
+	{
+		AnimationClip clip;
+		clip.duration = CLIP_SECONDS;
+		TransformTrack track;
+		for (int key = 0; key <= 8; key++)
+		{
+			float time = CLIP_SECONDS * key / 8.0f;
+			float phase = 6.2831853f * time / CLIP_SECONDS + variant;
+			track.positions.push_back({ time, glm::vec3(0.0f, 0.5f * std::sin(phase), 0.0f) });
+			track.rotations.push_back({ time, glm::angleAxis(phase, glm::vec3(0.0f, 1.0f, 0.0f)) });
+		}
+		clip.tracks.push_back(track);
+		clips.push_back(make_shared<const SampledClip>(clip));
+	}
+
+	AnimationSystem animation;
+	size_t index = 0;
+	for (const SceneObjectPtr& object : *scene)
+	{
+		animation.play(object, clips[index % clips.size()], 0.5f + 0.1f * (index % 10));
+		index++;
+	}
+
+	context.setParam("objects", double(objectCount));
+	context.setParam("threads", 1);
+	context.measure("", [&]() {
+		animation.update(1.0f / 60.0f);
+	}, double(objectCount));
+	context.expectNoAllocations();
+
+	JobSystem& jobs = JobSystem::getDefault();
+	context.setParam("threads", jobs.getThreadCount());
+	context.measure("parallel", [&]() {
+		animation.update(1.0f / 60.0f, &jobs);
+	}, double(objectCount));
+}
@@ -0,0 +1,116 @@
+#include "Benchmark.h"
+#include "MemoryStats.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+void printUsage()
+{
+	cout << "Usage: ModelViewerBench [options]\n"
+		<< "  --vertices N      vertices in synthetic meshes (default 100000)\n"
+		<< "  --objects N       objects in synthetic scenes (default 10000)\n"
+		<< "  --samples N       timed samples per measurement (default 15)\n"
+		<< "  --min-time MS     minimum duration of a sample in milliseconds (default 10)\n"
+		<< "  --filter TEXT     only run benchmarks whose name contains TEXT\n"
+		<< "  --json PATH       write results as JSON to PATH\n"
+		<< "  --memory          print the tracked memory usage after the run\n"
+		<< "  --list            list benchmark names and exit\n";
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkConfig config;
+	string jsonPath;
+	bool printMemory = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--list")
+		{
+			for (auto& name : listBenchmarks())
+			{
+				cout << name << endl;
+			}
+			return 0;
+		}
+		else if (arg == "--help" || arg == "-h")
+		{
+			printUsage();
+			return 0;
+		}
+		else if (arg == "--vertices" && hasValue)
+		{
+			config.meshVertices = strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--objects" && hasValue)
+		{
+			config.sceneObjects = strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--samples" && hasValue)
+		{
+			config.samples = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+		}
+		else if (arg == "--min-time" && hasValue)
+		{
+			config.minSampleSeconds = atof(argv[++i]) / 1000.0;
+		}
+		else if (arg == "--filter" && hasValue)
+		{
+			config.filter = argv[++i];
+		}
+		else if (arg == "--memory")
+		{
+			printMemory = true;
+		}
+		else if (arg == "--json" && hasValue)
+		{
+			jsonPath = argv[++i];
+		}
+		else
+		{
+			cerr << "Unknown argument " << arg << endl;
+			printUsage();
+			return 1;
+		}
+	}
+
+	if (config.samples == 0)
+	{
+		config.samples = 1;
+	}
+
+	auto results = runBenchmarks(config, cout);
+
+	if (printMemory)
+	{
+		MemoryStats::dump(cout);
+	}
+
+	if (!jsonPath.empty())
+	{
+		ofstream out(jsonPath);
+		if (!out)
+		{
+			cerr << "Could not open " << jsonPath << " for writing" << endl;
+			return 1;
+		}
+		writeBenchmarkJson(out, config, results);
+	}
+
+	for (auto& result : results)
+	{
+		if (!result.failure.empty())
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,336 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+
+#include "MemoryStats.h"
+
+using namespace std;
+
+typedef chrono::steady_clock BenchClock;
+
+namespace
+{
+	struct RegisteredBenchmark
+	{
+		string name;
+		BenchmarkFunction function;
+	};
+
+	// function local static so registration order across translation units doesn't matter
+	vector<RegisteredBenchmark>& getRegistry()
+	{
+		static vector<RegisteredBenchmark> registry;
+		return registry;
+	}
+
+	double median(vector<double> values)
+	{
+		if (values.empty())
+		{
+			return 0;
+		}
+
+		sort(values.begin(), values.end());
+		size_t mid = values.size() / 2;
+		if (values.size() % 2 == 0)
+		{
+			return (values[mid - 1] + values[mid]) / 2.0;
+		}
+		return values[mid];
+	}
+
+	// Returns the seconds taken by a number of iterations, excluding the setup calls.
+	// Heap allocations made by the iterations are added to allocations.
+	double timeIterations(size_t iterations, const function<void()>* setup, const function<void()>& iteration,
+		size_t& allocations)
+	{
+		if (!setup)
+		{
+			size_t startAllocations = MemoryStats::getHeapAllocationCount();
+			auto start = BenchClock::now();
+			for (size_t i = 0; i < iterations; i++)
+			{
+				iteration();
+			}
+			double seconds = chrono::duration<double>(BenchClock::now() - start).count();
+			allocations += MemoryStats::getHeapAllocationCount() - startAllocations;
+			return seconds;
+		}
+
+		double total = 0;
+		for (size_t i = 0; i < iterations; i++)
+		{
+			(*setup)();
+			size_t startAllocations = MemoryStats::getHeapAllocationCount();
+			auto start = BenchClock::now();
+			iteration();
+			total += chrono::duration<double>(BenchClock::now() - start).count();
+			allocations += MemoryStats::getHeapAllocationCount() - startAllocations;
+		}
+		return total;
+	}
+
+	void writeJsonString(ostream& os, const string& value)
+	{
+		os << '"';
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+			{
+				os << '\\';
+			}
+			os << c;
+		}
+		os << '"';
+	}
+}
+
+bool registerBenchmark(const std::string& name, BenchmarkFunction function)
+{
+	getRegistry().push_back({ name, function });
+	return true;
+}
+
+std::vector<std::string> listBenchmarks()
+{
+	vector<string> names;
+	for (auto& benchmark : getRegistry())
+	{
+		names.push_back(benchmark.name);
+	}
+	sort(names.begin(), names.end());
+	return names;
+}
+
+void BenchmarkContext::measure(const std::string& suffix, const std::function<void()>& iteration,
+	double itemsPerIteration, double bytesPerIteration)
+{
+	// Calibrate: double the iteration count until a sample lasts long enough.
+	// This also serves as the warmup run.
+	size_t iterations = 1;
+	size_t allocations = 0;
+	while (timeIterations(iterations, nullptr, iteration, allocations) < config.minSampleSeconds && iterations < (size_t(1) << 30))
+	{
+		iterations *= 2;
+	}
+
+	allocations = 0;
+	vector<double> samplesNs;
+	for (unsigned i = 0; i < config.samples; i++)
+	{
+		double seconds = timeIterations(iterations, nullptr, iteration, allocations);
+		samplesNs.push_back(seconds * 1e9 / iterations);
+	}
+
+	double allocationsPerIteration = static_cast<double>(allocations) / (double(iterations) * config.samples);
+	addResult(suffix, samplesNs, iterations, allocationsPerIteration, itemsPerIteration, bytesPerIteration);
+}
+
+void BenchmarkContext::measureWithSetup(const std::string& suffix, const std::function<void()>& setup,
+	const std::function<void()>& iteration, double itemsPerIteration, double bytesPerIteration)
+{
+	size_t iterations = 1;
+	size_t allocations = 0;
+	while (timeIterations(iterations, &setup, iteration, allocations) < config.minSampleSeconds && iterations < (size_t(1) << 20))
+	{
+		iterations *= 2;
+	}
+
+	allocations = 0;
+	vector<double> samplesNs;
+	for (unsigned i = 0; i < config.samples; i++)
+	{
+		double seconds = timeIterations(iterations, &setup, iteration, allocations);
+		samplesNs.push_back(seconds * 1e9 / iterations);
+	}
+
+	double allocationsPerIteration = static_cast<double>(allocations) / (double(iterations) * config.samples);
+	addResult(suffix, samplesNs, iterations, allocationsPerIteration, itemsPerIteration, bytesPerIteration);
+}
+
+void BenchmarkContext::fail(const std::string& message)
+{
+	if (!results.empty())
+	{
+		results.back().failure = message;
+	}
+}
+
+void BenchmarkContext::expectNoAllocations()
+{
+	if (!results.empty() && results.back().allocationsPerIteration > 0)
+	{
+		fail("expected no heap allocations, got " + to_string(results.back().allocationsPerIteration) + " per iteration");
+	}
+}
+
+void BenchmarkContext::addResult(const std::string& suffix, std::vector<double>& samplesNs, size_t iterations,
+	double allocationsPerIteration, double itemsPerIteration, double bytesPerIteration)
+{
+	BenchmarkResult result;
+	result.name = suffix.empty() ? name : name + "/" + suffix;
+	result.params = params;
+	result.samples = static_cast<unsigned>(samplesNs.size());
+	result.iterationsPerSample = iterations;
+	result.itemsPerIteration = itemsPerIteration;
+	result.bytesPerIteration = bytesPerIteration;
+	result.allocationsPerIteration = allocationsPerIteration;
+
+	if (!samplesNs.empty())
+	{
+		result.minNs = *min_element(samplesNs.begin(), samplesNs.end());
+		result.medianNs = median(samplesNs);
+
+		double sum = 0;
+		for (double s : samplesNs)
+		{
+			sum += s;
+		}
+		result.meanNs = sum / samplesNs.size();
+
+		double variance = 0;
+		for (double s : samplesNs)
+		{
+			variance += (s - result.meanNs) * (s - result.meanNs);
+		}
+		result.stddevNs = samplesNs.size() > 1 ? sqrt(variance / (samplesNs.size() - 1)) : 0.0;
+
+		vector<double> deviations;
+		for (double s : samplesNs)
+		{
+			deviations.push_back(fabs(s - result.medianNs));
+		}
+		result.madNs = median(deviations);
+
+		for (double s : samplesNs)
+		{
+			if (fabs(s - result.medianNs) > 3.0 * result.madNs && result.madNs > 0)
+			{
+				result.outliers++;
+			}
+		}
+	}
+
+	results.push_back(result);
+}
+
+std::vector<BenchmarkResult> runBenchmarks(const BenchmarkConfig& config, std::ostream& log)
+{
+	auto registry = getRegistry();
+	sort(registry.begin(), registry.end(), [](const RegisteredBenchmark& a, const RegisteredBenchmark& b) {
+		return a.name < b.name;
+	});
+
+	vector<BenchmarkResult> allResults;
+	for (auto& benchmark : registry)
+	{
+		if (!config.filter.empty() && benchmark.name.find(config.filter) == string::npos)
+		{
+			continue;
+		}
+
+		BenchmarkContext context(config, benchmark.name);
+		benchmark.function(context);
+
+		for (auto& result : context.getResults())
+		{
+			log << left << setw(48) << result.name
+				<< right << setw(14) << fixed << setprecision(1) << result.medianNs << " ns"
+				<< "  +/- " << setw(5) << setprecision(1)
+				<< (result.medianNs > 0 ? 100.0 * result.madNs / result.medianNs : 0.0) << "%";
+			if (result.itemsPerIteration > 0 && result.medianNs > 0)
+			{
+				log << "  " << setprecision(2) << result.itemsPerIteration / result.medianNs * 1e3 << " M items/s";
+			}
+			if (result.bytesPerIteration > 0 && result.medianNs > 0)
+			{
+				log << "  " << setprecision(1) << result.bytesPerIteration / result.medianNs * 1e3 << " MB/s";
+			}
+			if (result.allocationsPerIteration > 0)
+			{
+				log << "  " << setprecision(2) << result.allocationsPerIteration << " allocs/iter";
+			}
+			log << endl;
+
+			if (!result.failure.empty())
+			{
+				log << "  FAILED: " << result.failure << endl;
+			}
+
+			allResults.push_back(result);
+		}
+	}
+
+	return allResults;
+}
+
+void writeBenchmarkJson(std::ostream& os, const BenchmarkConfig& config, const std::vector<BenchmarkResult>& results)
+{
+	time_t now = time(nullptr);
+	char timestamp[32];
+	strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	os << setprecision(17);
+	os << "{\n";
+	os << "  \"context\": {\n";
+	os << "    \"date\": "; writeJsonString(os, timestamp); os << ",\n";
+#if defined(_MSC_VER)
+	os << "    \"compiler\": \"msvc " << _MSC_VER << "\",\n";
+#elif defined(__clang__)
+	os << "    \"compiler\": \"clang " << __clang_major__ << "." << __clang_minor__ << "\",\n";
+#elif defined(__GNUC__)
+	os << "    \"compiler\": \"gcc " << __GNUC__ << "." << __GNUC_MINOR__ << "\",\n";
+#endif
+#ifdef NDEBUG
+	os << "    \"build\": \"release\",\n";
+#else
+	os << "    \"build\": \"debug\",\n";
+#endif
+	os << "    \"mesh_vertices\": " << config.meshVertices << ",\n";
+	os << "    \"scene_objects\": " << config.sceneObjects << ",\n";
+	os << "    \"samples\": " << config.samples << ",\n";
+	os << "    \"min_sample_seconds\": " << config.minSampleSeconds << "\n";
+	os << "  },\n";
+	os << "  \"benchmarks\": [\n";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		auto& r = results[i];
+		os << "    {\n";
+		os << "      \"name\": "; writeJsonString(os, r.name); os << ",\n";
+		os << "      \"params\": {";
+		bool first = true;
+		for (auto& param : r.params)
+		{
+			os << (first ? "" : ", ");
+			writeJsonString(os, param.first);
+			os << ": " << param.second;
+			first = false;
+		}
+		os << "},\n";
+		os << "      \"samples\": " << r.samples << ",\n";
+		os << "      \"iterations_per_sample\": " << r.iterationsPerSample << ",\n";
+		os << "      \"min_ns\": " << r.minNs << ",\n";
+		os << "      \"median_ns\": " << r.medianNs << ",\n";
+		os << "      \"mean_ns\": " << r.meanNs << ",\n";
+		os << "      \"stddev_ns\": " << r.stddevNs << ",\n";
+		os << "      \"mad_ns\": " << r.madNs << ",\n";
+		os << "      \"outliers\": " << r.outliers << ",\n";
+		os << "      \"items_per_iteration\": " << r.itemsPerIteration << ",\n";
+		os << "      \"bytes_per_iteration\": " << r.bytesPerIteration << ",\n";
+		os << "      \"allocations_per_iteration\": " << r.allocationsPerIteration;
+		if (!r.failure.empty())
+		{
+			os << ",\n      \"failure\": ";
+			writeJsonString(os, r.failure);
+		}
+		os << "\n";
+		os << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+
+	os << "  ]\n";
+	os << "}\n";
+}
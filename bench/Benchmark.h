@@ -0,0 +1,141 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Prevents the compiler from optimizing away a value computed in a benchmark loop
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(_MSC_VER)
+	volatile const char* sink = reinterpret_cast<volatile const char*>(&value);
+	(void)*sink;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+// Settings shared by every benchmark. Filled from the command line.
+struct BenchmarkConfig
+{
+	// Size of the synthetic meshes, in vertices
+	size_t meshVertices = 100000;
+
+	// Number of objects in the synthetic scenes
+	size_t sceneObjects = 10000;
+
+	// Number of timed samples taken per measurement
+	unsigned samples = 15;
+
+	// Minimum duration of each sample. The iteration count is scaled up until it is reached.
+	double minSampleSeconds = 0.01;
+
+	// Only benchmarks whose name contains this string are run
+	std::string filter;
+};
+
+// Statistics of a single measurement. Times are per iteration, in nanoseconds.
+struct BenchmarkResult
+{
+	std::string name;
+	std::map<std::string, double> params;
+
+	unsigned samples = 0;
+	size_t iterationsPerSample = 0;
+
+	double minNs = 0;
+	double medianNs = 0;
+	double meanNs = 0;
+	double stddevNs = 0;
+
+	// Median absolute deviation, a spread estimate that ignores outliers
+	double madNs = 0;
+
+	// Samples further than 3 MADs from the median (usually preemption or frequency changes)
+	unsigned outliers = 0;
+
+	// Work done per iteration, used to derive throughput
+	double itemsPerIteration = 0;
+	double bytesPerIteration = 0;
+
+	// Heap allocations made per iteration during the timed samples (setup excluded)
+	double allocationsPerIteration = 0;
+
+	// Set when the benchmark found its result invalid (eg. an expected property didn't hold)
+	std::string failure;
+};
+
+// Passed to each benchmark function. The function does its setup, then calls measure()
+// once per configuration it wants to time.
+class BenchmarkContext
+{
+public:
+	explicit BenchmarkContext(const BenchmarkConfig& config, const std::string& name) :
+		config{ config }, name{ name } {}
+
+	const BenchmarkConfig& getConfig() const { return config; }
+
+	// Sets a parameter that will be attached to the following measurements (eg. object count)
+	void setParam(const std::string& key, double value) { params[key] = value; }
+
+	// Times the given function. It is called repeatedly; every call is one iteration.
+	// Items and bytes are the work performed by one iteration, and are used for throughput.
+	// The suffix is appended to the benchmark name to tell several measurements apart.
+	void measure(const std::string& suffix, const std::function<void()>& iteration,
+		double itemsPerIteration = 0, double bytesPerIteration = 0);
+
+	// Same as measure(), but calls setup before every iteration without timing it.
+	// Use when each iteration destroys its input (eg. parsing into a fresh vector).
+	void measureWithSetup(const std::string& suffix, const std::function<void()>& setup,
+		const std::function<void()>& iteration, double itemsPerIteration = 0, double bytesPerIteration = 0);
+
+	// Marks the last measurement as failed. The benchmark executable then exits with an error.
+	void fail(const std::string& message);
+
+	// Fails the last measurement if it made any heap allocation
+	void expectNoAllocations();
+
+	const std::vector<BenchmarkResult>& getResults() const { return results; }
+
+private:
+	// Converts raw sample times into a result
+	void addResult(const std::string& suffix, std::vector<double>& samplesNs, size_t iterations,
+		double allocationsPerIteration, double itemsPerIteration, double bytesPerIteration);
+
+	const BenchmarkConfig& config;
+	std::string name;
+	std::map<std::string, double> params;
+	std::vector<BenchmarkResult> results;
+};
+
+typedef std::function<void(BenchmarkContext&)> BenchmarkFunction;
+
+// Registers a benchmark. Returns a dummy value so it can be used in a static initializer.
+bool registerBenchmark(const std::string& name, BenchmarkFunction function);
+
+// Runs all registered benchmarks that match the config filter
+std::vector<BenchmarkResult> runBenchmarks(const BenchmarkConfig& config, std::ostream& log);
+
+// Returns the names of all registered benchmarks
+std::vector<std::string> listBenchmarks();
+
+// Writes results as a JSON document meant to be diffed between builds
+void writeBenchmarkJson(std::ostream& os, const BenchmarkConfig& config, const std::vector<BenchmarkResult>& results);
+
+#define BENCHMARK_CONCAT_INNER(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_INNER(a, b)
+
+// Declares and registers a benchmark function: BENCHMARK("group.name", context) { ... }
+#define BENCHMARK(name, context) \
+	static void BENCHMARK_CONCAT(benchmarkFn_, __LINE__)(BenchmarkContext& context); \
+	static bool BENCHMARK_CONCAT(benchmarkReg_, __LINE__) = registerBenchmark(name, &BENCHMARK_CONCAT(benchmarkFn_, __LINE__)); \
+	static void BENCHMARK_CONCAT(benchmarkFn_, __LINE__)(BenchmarkContext& context)
@@ -0,0 +1,231 @@
+// Benchmarks of the compressed mesh encoding: size and decode speed, and the CPU residency of meshes built on it
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+#include "JobSystem.h"
+#include "MeshCodec.h"
+#include "ObjLoader.h"
+#include "OcclusionCuller.h"
+
+using namespace std;
+
+namespace
+{
+	// Returns an empty string if the decoded mesh matches the source within the quantization error
+	string checkDecoded(const vector<Vertex>& vertices, const vector<unsigned>& indices,
+		const vector<Vertex>& decodedVertices, const vector<unsigned>& decodedIndices, const MeshCodecHeader& header)
+	{
+		if (decodedVertices.size() != vertices.size() || decodedIndices.size() != indices.size())
+		{
+			return "decoded mesh has a different size";
+		}
+
+		glm::vec3 tolerance = (header.boundsMax - header.boundsMin) * (1.0f / float((1u << header.positionBits) - 1));
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			glm::vec3 error = glm::abs(decodedVertices[i].position - vertices[i].position);
+			if (error.x > tolerance.x || error.y > tolerance.y || error.z > tolerance.z)
+			{
+				return "decoded position out of tolerance";
+			}
+
+			float normalLength = glm::length(vertices[i].normal);
+			if (normalLength > 0 && glm::dot(decodedVertices[i].normal, vertices[i].normal / normalLength) < 0.99f)
+			{
+				return "decoded normal out of tolerance";
+			}
+		}
+
+		// triangles may be rotated
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			bool same = false;
+			for (size_t rotation = 0; rotation < 3 && !same; rotation++)
+			{
+				same = decodedIndices[t] == indices[t + rotation]
+					&& decodedIndices[t + 1] == indices[t + (rotation + 1) % 3]
+					&& decodedIndices[t + 2] == indices[t + (rotation + 2) % 3];
+			}
+			if (!same)
+			{
+				return "decoded triangle differs";
+			}
+		}
+
+		return "";
+	}
+
+	// Measures encoding and single and multithreaded decoding of a mesh.
+	// Throughput is in decoded bytes, so it compares with reading the raw data.
+	void measureCodec(BenchmarkContext& context, const string& prefix, const vector<Vertex>& vertices, const vector<unsigned>& indices)
+	{
+		vector<uint8_t> encoded = encodeMesh(vertices, indices);
+		MeshCodecHeader header;
+		readMeshCodecHeader(encoded.data(), encoded.size(), header);
+
+		// the bytes of each stream, chunk table included in neither
+		size_t vertexBytes = 0;
+		size_t indexBytes = 0;
+		const MeshCodecChunk* chunks = reinterpret_cast<const MeshCodecChunk*>(encoded.data() + sizeof(MeshCodecHeader));
+		for (uint32_t i = 0; i < header.vertexChunkCount + header.indexChunkCount; i++)
+		{
+			(i < header.vertexChunkCount ? vertexBytes : indexBytes) += chunks[i].bytes;
+		}
+
+		double rawBytes = double(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned));
+		double triangles = double(indices.size() / 3);
+		JobSystem& jobs = JobSystem::getDefault();
+
+		context.setParam("vertices", double(vertices.size()));
+		context.setParam("triangles", triangles);
+		context.setParam("rawBytes", rawBytes);
+		context.setParam("encodedBytes", double(encoded.size()));
+		context.setParam("ratio", rawBytes / double(encoded.size()));
+		context.setParam("bytesPerVertex", double(vertexBytes) / double(vertices.size()));
+		context.setParam("bytesPerTriangle", double(indexBytes) / triangles);
+		context.setParam("threads", 1);
+
+		context.measure(prefix + "encode", [&]() {
+			doNotOptimize(encodeMesh(vertices, indices).data());
+		}, triangles, rawBytes);
+
+		vector<Vertex> decodedVertices;
+		vector<unsigned> decodedIndices;
+		context.measure(prefix + "decode", [&]() {
+			decodeMesh(encoded.data(), encoded.size(), decodedVertices, decodedIndices);
+			doNotOptimize(decodedIndices.data());
+		}, triangles, rawBytes);
+
+		string failure = checkDecoded(vertices, indices, decodedVertices, decodedIndices, header);
+		if (!failure.empty())
+		{
+			context.fail(failure);
+		}
+
+		context.setParam("threads", jobs.getThreadCount());
+		context.measure(prefix + "decode.parallel", [&]() {
+			decodeMesh(encoded.data(), encoded.size(), decodedVertices, decodedIndices, &jobs);
+			doNotOptimize(decodedIndices.data());
+		}, triangles, rawBytes);
+
+		failure = checkDecoded(vertices, indices, decodedVertices, decodedIndices, header);
+		if (!failure.empty())
+		{
+			context.fail(failure);
+		}
+	}
+}
+
+BENCHMARK("codec.mesh", context)
+{
+	// the synthetic grid stands in for a large scan, size it with --vertices
+	MeshResourcePtr mesh = generateGridMesh(context.getConfig().meshVertices);
+	measureCodec(context, "grid.", mesh->vertices, mesh->indices);
+
+	// the viewer's own model, when run from the repository root
+	filesystem::path teapotPath = filesystem::path("assets") / "models" / "teapot.obj";
+	ifstream teapotFile(teapotPath);
+	if (teapotFile)
+	{
+		vector<Vertex> vertices;
+		vector<unsigned> indices;
+		parseObj(teapotFile, vertices, indices);
+		normalizeVertexNormals(vertices);
+		measureCodec(context, "teapot.", vertices, indices);
+	}
+}
+
+BENCHMARK("mesh.residency", context)
+{
+	MeshResourcePtr source = generateGridMesh(context.getConfig().meshVertices);
+	auto copyMesh = [&](MeshResidency residency) {
+		MeshResourcePtr mesh(new MeshResource());
+		mesh->vertices = source->vertices;
+		mesh->indices = source->indices;
+		mesh->computeBounds();
+		mesh->setResidency(residency);
+		return mesh;
+	};
+
+	// what each residency keeps of the same mesh
+	MeshResourcePtr full = copyMesh(MeshResidency::Full);
+	MeshResourcePtr positions = copyMesh(MeshResidency::Positions);
+	MeshResourcePtr compressed = copyMesh(MeshResidency::Compressed);
+	MeshResourcePtr none = copyMesh(MeshResidency::None);
+	double triangles = double(source->indices.size() / 3);
+	double fullBytes = double(full->getCpuBytes());
+	context.setParam("vertices", double(source->vertices.size()));
+	context.setParam("fullBytes", fullBytes);
+	context.setParam("positionsBytes", double(positions->getCpuBytes()));
+	context.setParam("compressedBytes", double(compressed->getCpuBytes()));
+	context.setParam("noneBytes", double(none->getCpuBytes()));
+	context.setParam("threads", 1);
+
+	// dropping to a compressed copy after upload, and getting the data back on demand
+	MeshResourcePtr mesh;
+	context.measureWithSetup("compress", [&]() {
+		mesh = copyMesh(MeshResidency::Full);
+	}, [&]() {
+		mesh->setResidency(MeshResidency::Compressed);
+	}, triangles, fullBytes);
+
+	vector<Vertex> vertices;
+	vector<unsigned> indices;
+	context.measure("read.compressed", [&]() {
+		compressed->readCpuData(vertices, indices);
+		doNotOptimize(indices.data());
+	}, triangles, fullBytes);
+
+	MeshCodecHeader header;
+	readMeshCodecHeader(compressed->compressed.data(), compressed->compressed.size(), header);
+	string failure = checkDecoded(source->vertices, source->indices, vertices, indices, header);
+	if (!failure.empty())
+	{
+		context.fail(failure);
+	}
+
+	JobSystem& jobs = JobSystem::getDefault();
+	context.setParam("threads", jobs.getThreadCount());
+	context.measure("read.compressed.parallel", [&]() {
+		compressed->readCpuData(vertices, indices, &jobs);
+		doNotOptimize(indices.data());
+	}, triangles, fullBytes);
+
+	// the positions alone still work as an occluder, meshes without CPU data are skipped
+	OcclusionOptions occlusionOptions;
+	occlusionOptions.maxOccluderTriangles = source->indices.size();
+	OcclusionCuller occlusion(occlusionOptions);
+	occlusion.beginFrame(glm::mat4x4(1.0f));
+	if (!occlusion.addOccluder(*positions, glm::mat4x4(1.0f)))
+	{
+		context.fail("a mesh keeping its positions can't be an occluder");
+	}
+	if (occlusion.addOccluder(*none, glm::mat4x4(1.0f)) || occlusion.addOccluder(*compressed, glm::mat4x4(1.0f)))
+	{
+		context.fail("a mesh without CPU positions was used as an occluder");
+	}
+	occlusion.endFrame();
+
+	PositionView view = positions->getCpuPositions();
+	bool same = view.size() == source->vertices.size() && positions->indices == source->indices;
+	for (size_t i = 0; same && i < view.size(); i++)
+	{
+		same = view[i] == source->vertices[i].position;
+	}
+	if (!same)
+	{
+		context.fail("the kept positions differ from the vertices");
+	}
+
+	// a compressed mesh can be decoded back for good
+	compressed->setResidency(MeshResidency::Full);
+	if (compressed->vertices.size() != source->vertices.size() || !compressed->compressed.empty() || none->readCpuData(vertices, indices))
+	{
+		context.fail("residency changes lost or kept the wrong data");
+	}
+}
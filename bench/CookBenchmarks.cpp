@@ -0,0 +1,129 @@
+// Benchmarks of the offline asset cooker: full builds, no-op rebuilds and rebuilds after a change
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include "AssetCooker.h"
+#include "JobSystem.h"
+
+using namespace std;
+
+namespace
+{
+	const size_t COOK_MODELS = 32;
+}
+
+BENCHMARK("assets.cook", context)
+{
+	auto& config = context.getConfig();
+	auto directory = filesystem::temp_directory_path() / "modelviewer-bench-cook";
+	auto sourceDirectory = directory / "source";
+	auto outputDirectory = directory / "cooked";
+	std::error_code error;
+	filesystem::remove_all(directory, error);
+
+	// a small tree of models of different sizes, summing to about the configured mesh size
+	uint64_t sourceBytes = 0;
+	for (size_t i = 0; i < COOK_MODELS; i++)
+	{
+		auto path = sourceDirectory / ("set" + to_string(i % 4)) / ("model" + to_string(i) + ".obj");
+		filesystem::create_directories(path.parent_path());
+		string text = generateGridObj(config.meshVertices * (1 + i % 4) / (COOK_MODELS * 5 / 2));
+		ofstream file(path, ios::binary);
+		file << text;
+		sourceBytes += text.size();
+	}
+
+	CookOptions options;
+	context.setParam("models", double(COOK_MODELS));
+	context.setParam("sourceBytes", double(sourceBytes));
+	context.setParam("threads", JobSystem::getDefault().getThreadCount());
+
+	CookStats full = AssetCooker(options).run(sourceDirectory, outputDirectory);
+	context.setParam("outputBytes", double(full.outputBytes));
+
+	CookOptions forced = options;
+	forced.force = true;
+	context.measure("full", [&]() {
+		AssetCooker(forced).run(sourceDirectory, outputDirectory);
+	}, double(COOK_MODELS), double(sourceBytes));
+
+	CookOptions singleThread = forced;
+	singleThread.threads = 1;
+	context.setParam("threads", 1);
+	context.measure("full.single", [&]() {
+		AssetCooker(singleThread).run(sourceDirectory, outputDirectory);
+	}, double(COOK_MODELS), double(sourceBytes));
+
+	// nothing changed: only the directory walk and the manifest
+	context.setParam("threads", JobSystem::getDefault().getThreadCount());
+	CookStats noop;
+	context.measure("noop", [&]() {
+		noop = AssetCooker(options).run(sourceDirectory, outputDirectory);
+	}, double(COOK_MODELS), 0);
+
+	// one model rewritten with other content, the rest untouched
+	auto changedPath = sourceDirectory / "set1" / "model1.obj";
+	string original = generateGridObj(config.meshVertices / 80);
+	string edited = generateGridObj(config.meshVertices / 80 + 100);
+	bool editedTurn = true;
+	CookStats incremental;
+	context.measureWithSetup("one.changed", [&]() {
+		ofstream file(changedPath, ios::binary);
+		file << (editedTurn ? edited : original);
+		editedTurn = !editedTurn;
+	}, [&]() {
+		incremental = AssetCooker(options).run(sourceDirectory, outputDirectory);
+	}, 1, double(edited.size()));
+
+	// the same content written again: hashed, but not cooked
+	CookStats touched;
+	context.measureWithSetup("one.touched", [&]() {
+		string text = editedTurn ? original : edited;
+		ofstream file(changedPath, ios::binary);
+		file << text;
+	}, [&]() {
+		touched = AssetCooker(options).run(sourceDirectory, outputDirectory);
+	}, 1, 0);
+
+	if (full.cooked != COOK_MODELS || full.failed != 0)
+	{
+		context.fail("cooked " + to_string(full.cooked) + " of " + to_string(COOK_MODELS) + " models");
+	}
+	else if (noop.cooked != 0 || noop.hashed != 0 || noop.upToDate != COOK_MODELS)
+	{
+		context.fail("a no-op rebuild cooked " + to_string(noop.cooked) + " and hashed " + to_string(noop.hashed) + " models");
+	}
+	else if (incremental.cooked != 1)
+	{
+		context.fail("changing one model cooked " + to_string(incremental.cooked));
+	}
+	else if (touched.cooked != 0)
+	{
+		context.fail("rewriting a model with the same content cooked " + to_string(touched.cooked));
+	}
+
+	// removing a source removes its output
+	filesystem::remove(changedPath);
+	CookStats removed = AssetCooker(options).run(sourceDirectory, outputDirectory);
+	if (removed.removed != 1 || filesystem::exists(outputDirectory / getCookedModelPath("set1/model1.obj")))
+	{
+		context.fail("the output of a deleted source was kept");
+	}
+
+	// a malformed model fails on its own, the others still cook
+	{
+		ofstream file(sourceDirectory / "set0" / "broken.obj", ios::binary);
+		file << "v 0 0 0\nv 1 0 0\nf 1 2 7\n";
+	}
+	CookStats broken = AssetCooker(forced).run(sourceDirectory, outputDirectory);
+	if (broken.failed != 1 || broken.cooked != COOK_MODELS - 1)
+	{
+		context.fail("with one malformed model " + to_string(broken.failed) + " failed and " + to_string(broken.cooked) + " cooked");
+	}
+
+	filesystem::remove_all(directory, error);
+}
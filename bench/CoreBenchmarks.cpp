@@ -0,0 +1,192 @@
+// Benchmarks of the engine's CPU hot paths: model loading, transforms, camera, input and scene iteration.
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <sstream>
+
+#include "ObjLoader.h"
+#include "Scene.h"
+#include "Camera.h"
+#include "InputManager.h"
+
+using namespace std;
+
+BENCHMARK("obj.parse", context)
+{
+	auto& config = context.getConfig();
+	string text = generateGridObj(config.meshVertices);
+
+	vector<Vertex> vertices;
+	vector<unsigned> indices;
+
+	context.setParam("vertices", static_cast<double>(config.meshVertices));
+	context.measureWithSetup("",
+		[&]() {
+			vertices = vector<Vertex>();
+			indices = vector<unsigned>();
+		},
+		[&]() {
+			istringstream stream(text);
+			parseObj(stream, vertices, indices);
+			doNotOptimize(indices.data());
+		},
+		static_cast<double>(config.meshVertices), static_cast<double>(text.size()));
+}
+
+BENCHMARK("obj.normalizeNormals", context)
+{
+	auto& config = context.getConfig();
+	string text = generateGridObj(config.meshVertices);
+
+	vector<Vertex> parsed;
+	vector<unsigned> indices;
+	istringstream stream(text);
+	parseObj(stream, parsed, indices);
+
+	vector<Vertex> vertices;
+	context.setParam("vertices", static_cast<double>(parsed.size()));
+	context.measureWithSetup("",
+		[&]() { vertices = parsed; },
+		[&]() {
+			normalizeVertexNormals(vertices);
+			doNotOptimize(vertices.data());
+		},
+		static_cast<double>(parsed.size()));
+}
+
+BENCHMARK("scene.modelMatrix", context)
+{
+	auto& config = context.getConfig();
+	auto mesh = generateGridMesh(16);
+	auto scene = generateScene(config.sceneObjects, mesh);
+	double objects = static_cast<double>(config.sceneObjects);
+
+	context.setParam("objects", objects);
+
+	// every object moved this frame, so every matrix is rebuilt
+	context.measure("dirty", [&]() {
+		for (auto& object : *scene)
+		{
+			object->move({ 0.0f, 0.001f, 0.0f });
+			doNotOptimize(object->getModelMatrix());
+		}
+	}, objects);
+
+	// nothing moved, the cached matrices are returned
+	context.measure("cached", [&]() {
+		for (auto& object : *scene)
+		{
+			doNotOptimize(object->getModelMatrix());
+		}
+	}, objects);
+}
+
+BENCHMARK("scene.rotation", context)
+{
+	auto& config = context.getConfig();
+	auto mesh = generateGridMesh(16);
+	auto scene = generateScene(config.sceneObjects, mesh);
+	double objects = static_cast<double>(config.sceneObjects);
+
+	context.setParam("objects", objects);
+
+	context.measure("setRotation", [&]() {
+		for (auto& object : *scene)
+		{
+			object->setRotation(10.0f, 20.0f, 30.0f);
+		}
+	}, objects);
+
+	context.measure("addRotation", [&]() {
+		for (auto& object : *scene)
+		{
+			object->addRotation(glm::vec3(0.1f, 0.2f, 0.3f));
+		}
+	}, objects);
+
+	context.measure("rotateAround", [&]() {
+		for (auto& object : *scene)
+		{
+			object->rotateAround({ 0.0f, 1.0f, 0.0f }, 0.5f);
+		}
+	}, objects);
+
+	context.measure("getRotation", [&]() {
+		for (auto& object : *scene)
+		{
+			doNotOptimize(object->getRotation());
+		}
+	}, objects);
+}
+
+BENCHMARK("camera.viewProjection", context)
+{
+	Camera camera;
+	camera.setFov(45.0f);
+	camera.setAspectRatio(1280u, 720u);
+	camera.setClipRange(0.1f, 50.0f);
+	camera.setRotation(15.0f, 30.0f, 0.0f);
+
+	context.measure("", [&]() {
+		camera.move({ 0.0f, 0.0f, 0.001f });
+		doNotOptimize(camera.getViewProjectionMatrix());
+	}, 1);
+}
+
+BENCHMARK("input.lookup", context)
+{
+	InputManager input;
+	input.notifyKeyStateChange(xwin::Key::W, xwin::ButtonState::Pressed);
+	input.notifyKeyStateChange(xwin::Key::D, xwin::ButtonState::Pressed);
+	input.notifyMouseButtonChange(xwin::MouseInput::Right, xwin::ButtonState::Pressed);
+	input.notifyMouseRawInput(3, -2);
+	input.processEvents();
+
+	// the same queries ViewerController::update makes every frame
+	const xwin::Key keys[] = { xwin::Key::Q, xwin::Key::E, xwin::Key::W, xwin::Key::A, xwin::Key::S, xwin::Key::D };
+
+	context.measure("isDown(key)", [&]() {
+		for (auto key : keys)
+		{
+			doNotOptimize(input.isDown(key));
+		}
+	}, 6);
+
+	context.measure("isDown(mouse)", [&]() {
+		doNotOptimize(input.isDown(xwin::MouseInput::Left));
+		doNotOptimize(input.isDown(xwin::MouseInput::Right));
+	}, 2);
+
+	context.measure("getAxis", [&]() {
+		doNotOptimize(input.getAxis(InputAxis::MOUSE_X));
+		doNotOptimize(input.getAxis(InputAxis::MOUSE_Y));
+	}, 2);
+}
+
+BENCHMARK("scene.iterate", context)
+{
+	auto& config = context.getConfig();
+	auto mesh = generateGridMesh(16);
+	auto scene = generateScene(config.sceneObjects, mesh);
+	double objects = static_cast<double>(config.sceneObjects);
+
+	context.setParam("objects", objects);
+
+	// mirrors the renderer loop: read the mesh and the model matrix of every object
+	context.measure("", [&]() {
+		size_t indexCount = 0;
+		for (auto& sceneObject : *scene)
+		{
+			MeshResourcePtr mesh = sceneObject->mesh;
+			if (mesh == nullptr)
+			{
+				continue;
+			}
+
+			indexCount += mesh->indices.size();
+			doNotOptimize(sceneObject->getModelMatrix());
+		}
+		doNotOptimize(indexCount);
+	}, objects);
+}
@@ -0,0 +1,125 @@
+// Benchmarks of editing meshes in place: small edits on a large mesh, against recreating everything
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "MeshEditor.h"
+#include "ObjLoader.h"
+
+using namespace std;
+
+namespace
+{
+	// Recomputes every normal from scratch, the way the loaders do
+	void computeAllNormals(MeshResource& mesh)
+	{
+		for (Vertex& vertex : mesh.vertices)
+		{
+			vertex.normal = glm::vec3(0.0f);
+		}
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			Vertex& a = mesh.vertices[mesh.indices[i]];
+			Vertex& b = mesh.vertices[mesh.indices[i + 1]];
+			Vertex& c = mesh.vertices[mesh.indices[i + 2]];
+			glm::vec3 normal = computeFaceNormal(a.position, b.position, c.position);
+			a.normal += normal;
+			b.normal += normal;
+			c.normal += normal;
+		}
+		normalizeVertexNormals(mesh.vertices);
+	}
+
+	bool sameVertices(const vector<Vertex>& a, const vector<Vertex>& b)
+	{
+		return a.size() == b.size() && equal(a.begin(), a.end(), b.begin(), [](const Vertex& x, const Vertex& y) {
+			return x.position == y.position && x.normal == y.normal && x.color == y.color;
+		});
+	}
+}
+
+BENCHMARK("mesh.edit", context)
+{
+	MeshResourcePtr mesh = generateGridMesh(context.getConfig().meshVertices);
+	size_t side = static_cast<size_t>(std::sqrt(double(mesh->vertices.size())));
+	size_t fullBytes = mesh->vertices.size() * sizeof(Vertex);
+
+	MeshEditor editor(mesh);
+
+	// stands in for the vertex buffer, the dirty ranges are copied into it
+	vector<Vertex> uploaded = mesh->vertices;
+	auto upload = [&](const vector<VertexRange>& ranges) {
+		for (const VertexRange& range : ranges)
+		{
+			std::memcpy(&uploaded[range.first], &mesh->vertices[range.first], range.count * sizeof(Vertex));
+		}
+	};
+
+	// pushes a square patch in the middle of the grid up or down, one range per row
+	float direction = 0.01f;
+	auto editPatch = [&](size_t patchSide, bool tracked = true) {
+		size_t first = (side - patchSide) / 2;
+		for (size_t y = first; y < first + patchSide; y++)
+		{
+			size_t start = y * side + first;
+			Vertex* row = tracked ? editor.edit(start, patchSide) : &mesh->vertices[start];
+			for (size_t x = 0; x < patchSide; x++)
+			{
+				row[x].position.y += direction;
+			}
+		}
+		direction = -direction;
+	};
+
+	context.setParam("vertices", double(mesh->vertices.size()));
+	context.setParam("fullBytes", double(fullBytes));
+
+	for (size_t patchSide : { size_t(1), size_t(4), size_t(16), size_t(64) })
+	{
+		patchSide = std::min(patchSide, side);
+
+		// one frame first, to report what a frame uploads
+		editPatch(patchSide);
+		upload(editor.commit());
+		const MeshEditStats& stats = editor.getLastStats();
+		context.setParam("uploadBytes", double(stats.uploadBytes));
+		context.setParam("ranges", double(stats.ranges));
+		context.setParam("normalVertices", double(stats.normalVertices));
+
+		context.measure("patch" + to_string(patchSide * patchSide), [&]() {
+			editPatch(patchSide);
+			upload(editor.commit());
+		}, double(patchSide * patchSide), double(stats.uploadBytes));
+	}
+
+	// the same edit without an editor: every normal recomputed and the whole buffer uploaded
+	size_t patchSide = std::min<size_t>(16, side);
+	context.setParam("uploadBytes", double(fullBytes));
+	context.setParam("ranges", 1);
+	context.setParam("normalVertices", double(mesh->vertices.size()));
+	context.measure("full", [&]() {
+		editPatch(patchSide, false);
+		computeAllNormals(*mesh);
+		std::memcpy(uploaded.data(), mesh->vertices.data(), fullBytes);
+	}, double(patchSide * patchSide), double(fullBytes));
+
+	// incremental normals must match a full recomputation exactly, and the ranges must cover every change
+	editPatch(patchSide);
+	upload(editor.commit());
+	MeshResource reference;
+	reference.vertices = mesh->vertices;
+	reference.indices = mesh->indices;
+	computeAllNormals(reference);
+	if (!sameVertices(reference.vertices, mesh->vertices))
+	{
+		context.fail("incremental normals differ from a full recomputation");
+	}
+	else if (!sameVertices(uploaded, mesh->vertices))
+	{
+		context.fail("the dirty ranges missed changed vertices");
+	}
+}
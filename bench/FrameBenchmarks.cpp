@@ -0,0 +1,381 @@
+// Benchmarks of the per frame work done before submitting draws
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include "Camera.h"
+#include "FrameAllocator.h"
+#include "Frustum.h"
+#include "MemoryStats.h"
+#include "MultiViewQueue.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+#include "RenderStats.h"
+
+using namespace std;
+
+namespace
+{
+	// Camera placed so that roughly half of the generated scene is visible
+	void setupCamera(Camera& camera, size_t objectCount)
+	{
+		float side = sqrt(static_cast<float>(objectCount)) * 2.0f;
+		camera.setFov(45.0f);
+		camera.setAspectRatio(1280u, 720u);
+		camera.setClipRange(0.1f, side);
+		camera.setPosition(side * 0.5f, 5.0f, -2.0f);
+		camera.setRotation(15.0f, 0.0f, 0.0f);
+	}
+
+	// A unit cube from 0 to 1, scaled into walls
+	MeshResourcePtr generateBoxMesh()
+	{
+		MeshResourcePtr mesh(new MeshResource());
+		for (int corner = 0; corner < 8; corner++)
+		{
+			Vertex vertex = {};
+			vertex.position = glm::vec3(float(corner & 1), float((corner >> 1) & 1), float((corner >> 2) & 1));
+			mesh->vertices.push_back(vertex);
+		}
+		mesh->indices = {
+			0, 2, 3, 0, 3, 1, 4, 5, 7, 4, 7, 6, 0, 1, 5, 0, 5, 4,
+			2, 6, 7, 2, 7, 3, 0, 4, 6, 0, 6, 2, 1, 3, 7, 1, 7, 5,
+		};
+		mesh->computeBounds();
+		return mesh;
+	}
+
+	// Adds rows of walls across the scene, every one with a doorway in front of the camera
+	void addWalls(Scene& scene, float side, float firstWall, float spacing)
+	{
+		auto box = generateBoxMesh();
+		float door = side * 0.5f;
+		for (float z = firstWall; z < side; z += spacing)
+		{
+			auto left = scene.createObject(box);
+			left->setPosition(-10.0f, 0.0f, z);
+			left->setScale(door - 2.0f + 10.0f, 15.0f, 1.0f);
+
+			auto right = scene.createObject(box);
+			right->setPosition(door + 2.0f, 0.0f, z);
+			right->setScale(side - door + 8.0f, 15.0f, 1.0f);
+
+			auto lintel = scene.createObject(box);
+			lintel->setPosition(door - 2.0f, 6.0f, z);
+			lintel->setScale(4.0f, 9.0f, 1.0f);
+		}
+	}
+}
+
+BENCHMARK("frame.renderQueue", context)
+{
+	auto& config = context.getConfig();
+	auto meshA = generateGridMesh(16);
+	auto meshB = generateGridMesh(16);
+	auto scene = generateScene(config.sceneObjects, meshA);
+
+	// alternate meshes so sorting has work to do
+	bool useA = true;
+	for (auto& object : *scene)
+	{
+		object->mesh = useA ? meshA : meshB;
+		useA = !useA;
+	}
+
+	Camera camera;
+	setupCamera(camera, config.sceneObjects);
+	auto viewProjection = camera.getViewProjectionMatrix();
+
+	double objects = static_cast<double>(config.sceneObjects);
+	context.setParam("objects", objects);
+
+	// the render queue on the general heap, as a std::vector would be
+	context.measure("heap", [&]() {
+		RenderQueue queue(nullptr);
+		queue.build(*scene, viewProjection);
+		doNotOptimize(queue.getItems().data());
+	}, objects);
+
+	// the same queue in a frame arena, like Renderer::render
+	FrameArena frameArena;
+	context.measure("arena", [&]() {
+		frameArena.beginFrame();
+		RenderQueue queue(&frameArena.current());
+		queue.build(*scene, viewProjection);
+		doNotOptimize(queue.getItems().data());
+	}, objects);
+
+	// once the arena has grown to fit a frame, a frame must not touch the heap
+	context.expectNoAllocations();
+}
+
+BENCHMARK("frame.occlusion", context)
+{
+	// an interior: objects on the floor of rooms separated by walls with doorways
+	auto& config = context.getConfig();
+	auto scene = generateScene(config.sceneObjects, generateGridMesh(16));
+	float side = sqrt(static_cast<float>(config.sceneObjects)) * 2.0f;
+	const float firstWall = 20.0f;
+	addWalls(*scene, side, firstWall, 40.0f);
+
+	Camera camera;
+	setupCamera(camera, config.sceneObjects);
+	auto viewProjection = camera.getViewProjectionMatrix();
+	context.setParam("objects", double(scene->size()));
+
+	// one frame first, params are recorded with the measurements. On the heap, to outlive the arena frames.
+	OcclusionCuller occlusion;
+	RenderQueue frustumQueue(nullptr);
+	frustumQueue.build(*scene, viewProjection);
+	RenderQueue occlusionQueue(nullptr);
+	occlusionQueue.build(*scene, viewProjection, &occlusion);
+
+	auto& stats = occlusion.getStats();
+	context.setParam("frustumDraws", double(frustumQueue.getItems().size()));
+	context.setParam("occlusionDraws", double(occlusionQueue.getItems().size()));
+	context.setParam("occluders", double(stats.occluders));
+	context.setParam("rejectedPercent", stats.getRejectedShare() * 100.0);
+	context.setParam("rasterizeMs", stats.rasterizeSeconds * 1000.0);
+	context.setParam("testMs", stats.testSeconds * 1000.0);
+
+	FrameArena frameArena;
+	context.measure("frustum", [&]() {
+		frameArena.beginFrame();
+		RenderQueue queue(&frameArena.current());
+		queue.build(*scene, viewProjection);
+		doNotOptimize(queue.getItems().data());
+	}, double(scene->size()));
+
+	context.measure("occlusion", [&]() {
+		frameArena.beginFrame();
+		RenderQueue queue(&frameArena.current());
+		queue.build(*scene, viewProjection, &occlusion);
+		doNotOptimize(queue.getItems().data());
+	}, double(scene->size()));
+	context.expectNoAllocations();
+
+	// everything in front of the first wall is in plain sight, and most of what is behind it is hidden
+	size_t inFront = 0, inFrontKept = 0;
+	for (const DrawItem& item : frustumQueue.getItems())
+	{
+		glm::vec3 worldMin, worldMax;
+		transformBounds(item.mesh->boundsMin, item.mesh->boundsMax, *item.model, worldMin, worldMax);
+		if (worldMax.z >= firstWall)
+		{
+			continue;
+		}
+		inFront++;
+		for (const DrawItem& kept : occlusionQueue.getItems())
+		{
+			if (kept.model == item.model)
+			{
+				inFrontKept++;
+				break;
+			}
+		}
+	}
+	if (inFront == 0 || inFrontKept != inFront)
+	{
+		context.fail("objects in front of the occluders were culled");
+	}
+	if (stats.getRejectedShare() < 0.5)
+	{
+		context.fail("less than half of the objects behind the walls were culled");
+	}
+}
+
+BENCHMARK("frame.stats", context)
+{
+	auto& config = context.getConfig();
+	auto scene = generateScene(config.sceneObjects, generateGridMesh(16));
+
+	Camera camera;
+	setupCamera(camera, config.sceneObjects);
+	auto viewProjection = camera.getViewProjectionMatrix();
+
+	FrameArena frameArena;
+	RenderStats::reset();
+
+	// the counting done by Renderer::render, without the draws
+	auto countFrame = [&]() {
+		frameArena.beginFrame();
+		RenderStats::beginFrame();
+
+		RenderQueue queue(&frameArena.current());
+		queue.build(*scene, viewProjection);
+		RenderStats::add(RenderCounter::ObjectsCulled, queue.getCulledCount());
+
+		uint64_t draws = 0;
+		uint64_t triangles = 0;
+		uint64_t stateChanges = 6;
+		const MeshResource* boundMesh = nullptr;
+		for (const DrawItem& item : queue.getItems())
+		{
+			if (item.mesh != boundMesh)
+			{
+				boundMesh = item.mesh;
+				stateChanges += 2;
+			}
+			draws++;
+			triangles += item.mesh->indices.size() / 3;
+		}
+
+		RenderStats::add(RenderCounter::Draws, draws);
+		RenderStats::add(RenderCounter::Triangles, triangles);
+		RenderStats::add(RenderCounter::StateChanges, stateChanges);
+		RenderStats::add(RenderCounter::ConstantBufferUpdates, draws);
+		RenderStats::add(RenderCounter::ConstantBufferBytes, draws * 128);
+		return RenderStats::endFrame();
+	};
+
+	// one frame first, params are recorded with the measurements
+	FrameRenderStats frame = countFrame();
+	size_t objects = scene->size();
+	context.setParam("objects", double(objects));
+	context.setParam("draws", double(frame.get(RenderCounter::Draws)));
+	context.setParam("triangles", double(frame.get(RenderCounter::Triangles)));
+
+	context.measure("queue", [&]() {
+		frameArena.beginFrame();
+		RenderQueue queue(&frameArena.current());
+		queue.build(*scene, viewProjection);
+		doNotOptimize(queue.getItems().data());
+	}, double(objects));
+
+	context.measure("counted", [&]() {
+		FrameRenderStats stats = countFrame();
+		doNotOptimize(stats);
+	}, double(objects));
+
+	// counting and finishing a frame must not touch the heap
+	context.expectNoAllocations();
+
+	FrameRenderStats last = RenderStats::getLastFrame();
+	if (last.get(RenderCounter::Draws) + last.get(RenderCounter::ObjectsCulled) != objects)
+	{
+		context.fail("draws and culled objects don't add up to the scene");
+	}
+	if (RenderStats::getHistory().size() != min<size_t>(last.frame + 1, 600))
+	{
+		context.fail("the history doesn't hold the last frames");
+	}
+	RenderStats::reset();
+}
+
+BENCHMARK("frame.multiview", context)
+{
+	auto& config = context.getConfig();
+	auto meshA = generateGridMesh(16);
+	auto meshB = generateGridMesh(16);
+	auto scene = generateScene(config.sceneObjects, meshA);
+	bool useA = true;
+	for (auto& object : *scene)
+	{
+		object->mesh = useA ? meshA : meshB;
+		useA = !useA;
+	}
+
+	// a wall of screens: the same camera turned a little further for each view, overlapping its neighbours
+	Camera camera;
+	setupCamera(camera, config.sceneObjects);
+	vector<glm::mat4x4> viewProjections;
+	for (size_t view = 0; view < 16; view++)
+	{
+		camera.setRotation(15.0f, -60.0f + 8.0f * view, 0.0f);
+		viewProjections.push_back(camera.getViewProjectionMatrix());
+	}
+
+	double objects = static_cast<double>(scene->size());
+	FrameArena frameArena;
+	for (size_t views : { 1, 2, 4, 8, 16 })
+	{
+		// one frame first, params are recorded with the measurements
+		MultiViewQueue shared(nullptr);
+		shared.build(*scene, viewProjections.data(), views);
+		size_t draws = 0;
+		for (size_t view = 0; view < views; view++)
+		{
+			draws += shared.getViewItemCount(view);
+		}
+		context.setParam("views", double(views));
+		context.setParam("objects", objects);
+		context.setParam("draws", double(draws));
+
+		// one RenderQueue per view, as rendering each view on its own would
+		string suffix = to_string(views);
+		context.measure("separate/" + suffix, [&]() {
+			frameArena.beginFrame();
+			for (size_t view = 0; view < views; view++)
+			{
+				RenderQueue queue(&frameArena.current());
+				queue.build(*scene, viewProjections[view]);
+				doNotOptimize(queue.getItems().data());
+			}
+		}, objects * views);
+
+		context.measure("shared/" + suffix, [&]() {
+			frameArena.beginFrame();
+			MultiViewQueue queue(&frameArena.current());
+			queue.build(*scene, viewProjections.data(), views);
+			doNotOptimize(queue.getItems().data());
+		}, objects * views);
+		context.expectNoAllocations();
+
+		// every view must draw what its own queue would, in the same mesh order
+		for (size_t view = 0; view < views; view++)
+		{
+			RenderQueue single(nullptr);
+			single.build(*scene, viewProjections[view]);
+
+			bool same = single.getItems().size() == shared.getViewItemCount(view) && single.getCulledCount() == shared.getCulledCount(view);
+			const uint32_t* indices = shared.getViewItems(view);
+			for (size_t i = 0; same && i < single.getItems().size(); i++)
+			{
+				same = single.getItems()[i].mesh == shared.getItems()[indices[i]].draw.mesh;
+			}
+			if (!same)
+			{
+				context.fail("view " + to_string(view) + " of " + suffix + " differs from its own render queue");
+				break;
+			}
+		}
+	}
+}
+
+BENCHMARK("frame.arena", context)
+{
+	LinearArena arena;
+
+	// many small transient allocations, like per object temporary matrices
+	context.measure("allocate", [&]() {
+		arena.reset();
+		for (int i = 0; i < 256; i++)
+		{
+			doNotOptimize(arena.allocate(sizeof(glm::mat4x4), alignof(glm::mat4x4)));
+		}
+	}, 256);
+	context.expectNoAllocations();
+
+	context.measure("heap", [&]() {
+		for (int i = 0; i < 256; i++)
+		{
+			auto matrix = make_unique<glm::mat4x4>(1.0f);
+			doNotOptimize(matrix.get());
+		}
+	}, 256);
+
+	// the zero allocation checks above only hold if the hooks also see over-aligned types,
+	// like the cache line aligned rings of the input manager and the logger
+	struct alignas(64) CacheLine { char bytes[64]; };
+	context.measure("heapAligned", [&]() {
+		for (int i = 0; i < 256; i++)
+		{
+			auto line = make_unique<CacheLine>();
+			doNotOptimize(line.get());
+		}
+	}, 256);
+	if (!context.getResults().empty() && context.getResults().back().allocationsPerIteration < 256)
+	{
+		context.fail("over-aligned allocations are not counted by the allocation hooks");
+	}
+}
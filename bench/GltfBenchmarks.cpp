@@ -0,0 +1,117 @@
+// Benchmarks of loading the same mesh from OBJ and from GLB, up to the point where it would be uploaded
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "GltfLoader.h"
+#include "ObjLoader.h"
+
+using namespace std;
+
+namespace
+{
+	// Stands in for the GPU buffers, so every path ends with the same copy
+	struct UploadTarget
+	{
+		vector<uint8_t> vertices;
+		vector<uint8_t> indices;
+
+		void upload(const Vertex* vertexData, size_t vertexCount, const unsigned* indexData, size_t indexCount)
+		{
+			vertices.resize(vertexCount * sizeof(Vertex));
+			indices.resize(indexCount * sizeof(unsigned));
+			memcpy(vertices.data(), vertexData, vertices.size());
+			memcpy(indices.data(), indexData, indices.size());
+		}
+	};
+}
+
+BENCHMARK("gltf.load", context)
+{
+	auto& config = context.getConfig();
+	auto directory = filesystem::temp_directory_path();
+	auto objPath = directory / "modelviewer-bench.obj";
+	auto glbPath = directory / "modelviewer-bench.glb";
+	auto separatePath = directory / "modelviewer-bench-separate.glb";
+
+	{
+		ofstream obj(objPath);
+		obj << generateGridObj(config.meshVertices);
+	}
+	MeshResourcePtr mesh = generateGridMesh(config.meshVertices);
+	writeGlb(glbPath, mesh->vertices, mesh->indices, GlbLayout::Engine);
+	writeGlb(separatePath, mesh->vertices, mesh->indices, GlbLayout::Separate);
+
+	double vertices = double(mesh->vertices.size());
+	context.setParam("vertices", vertices);
+	context.setParam("triangles", double(mesh->indices.size() / 3));
+	context.setParam("objBytes", double(filesystem::file_size(objPath)));
+	context.setParam("glbBytes", double(filesystem::file_size(glbPath)));
+	context.setParam("separateGlbBytes", double(filesystem::file_size(separatePath)));
+
+	// the files were just written, so every variant reads from the page cache
+	UploadTarget target;
+
+	// what ResourceManager::loadModel does for an OBJ
+	context.measure("obj", [&]() {
+		ifstream file(objPath);
+		vector<Vertex> objVertices;
+		vector<unsigned> objIndices;
+		parseObj(file, objVertices, objIndices);
+		normalizeVertexNormals(objVertices);
+		target.upload(objVertices.data(), objVertices.size(), objIndices.data(), objIndices.size());
+	}, vertices, double(filesystem::file_size(objPath)));
+
+	// engine layout, the buffer views go to the upload as they are
+	bool mapped = true;
+	context.measure("glb", [&]() {
+		GltfFile file(glbPath);
+		for (const GltfMesh& gltfMesh : file.getMeshes())
+		{
+			for (const GltfPrimitive& primitive : gltfMesh.primitives)
+			{
+				mapped = mapped && primitive.verticesMapped && primitive.indicesMapped;
+				target.upload(primitive.vertices, primitive.vertexCount, primitive.indices, primitive.indexCount);
+			}
+		}
+	}, vertices, double(filesystem::file_size(glbPath)));
+
+	if (!mapped)
+	{
+		context.fail("engine layout GLB was converted instead of uploaded from the file");
+	}
+
+	// a typical exporter's layout: separate attributes and 16 bit indices need converting
+	context.measure("glb.converted", [&]() {
+		GltfFile file(separatePath);
+		for (const GltfMesh& gltfMesh : file.getMeshes())
+		{
+			for (const GltfPrimitive& primitive : gltfMesh.primitives)
+			{
+				target.upload(primitive.vertices, primitive.vertexCount, primitive.indices, primitive.indexCount);
+			}
+		}
+	}, vertices, double(filesystem::file_size(separatePath)));
+
+	// both files must hold the same triangles, in glTF's mirrored convention
+	GltfFile check(glbPath);
+	const GltfPrimitive& primitive = check.getMeshes()[0].primitives[0];
+	for (size_t i = 0; i < mesh->vertices.size(); i++)
+	{
+		glm::vec3 position = primitive.vertices[i].position;
+		if (position.x != mesh->vertices[i].position.x || position.y != mesh->vertices[i].position.y || position.z != -mesh->vertices[i].position.z)
+		{
+			context.fail("GLB positions differ from the source mesh");
+			break;
+		}
+	}
+
+	error_code error;
+	filesystem::remove(objPath, error);
+	filesystem::remove(glbPath, error);
+	filesystem::remove(separatePath, error);
+}
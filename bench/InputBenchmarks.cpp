@@ -0,0 +1,196 @@
+// Benchmarks of the input pipeline between the event loop and the update
+
+#include "Benchmark.h"
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+#include "Camera.h"
+#include "InputManager.h"
+#include "InputRecording.h"
+#include "Scene.h"
+#include "SpscRing.h"
+#include "ViewerController.h"
+
+using namespace std;
+
+BENCHMARK("input.ring", context)
+{
+	const size_t eventsPerIteration = 100000;
+	SpscRing<InputEvent, 1024> ring;
+
+	// producer and consumer on separate threads, as with a dedicated event pump thread
+	context.measure("crossThread", [&]() {
+		thread producer([&]() {
+			InputEvent event;
+			event.type = InputEventType::MouseRaw;
+			for (size_t i = 0; i < eventsPerIteration; i++)
+			{
+				event.deltaX = static_cast<int>(i);
+				while (!ring.push(event))
+				{
+					this_thread::yield();
+				}
+			}
+		});
+
+		size_t received = 0;
+		InputEvent event;
+		while (received < eventsPerIteration)
+		{
+			if (ring.pop(event))
+			{
+				received++;
+			}
+			else
+			{
+				this_thread::yield();
+			}
+		}
+		producer.join();
+		doNotOptimize(event);
+	}, static_cast<double>(eventsPerIteration));
+}
+
+BENCHMARK("input.events", context)
+{
+	InputManager input;
+
+	// a frame's worth of typical events: mouse movement and a few key changes
+	context.measure("postAndProcess", [&]() {
+		for (int i = 0; i < 16; i++)
+		{
+			input.notifyMouseRawInput(1, -1);
+		}
+		input.notifyKeyStateChange(xwin::Key::W, xwin::ButtonState::Pressed);
+		input.notifyKeyStateChange(xwin::Key::W, xwin::ButtonState::Released);
+		input.processEvents();
+		input.notifyUpdateFinished();
+	}, 18);
+	context.expectNoAllocations();
+}
+
+BENCHMARK("input.latency", context)
+{
+	InputManager input;
+
+	// Time from an event being posted to it being visible to the update, when nothing else is queued.
+	// This is the latency the pipeline itself adds on top of waiting for the next update.
+	context.measure("applyQueued", [&]() {
+		input.notifyMouseRawInput(2, 1);
+		input.notifyKeyStateChange(xwin::Key::A, xwin::ButtonState::Pressed);
+		input.processEvents();
+		doNotOptimize(input.getLatencyStats());
+		input.notifyKeyStateChange(xwin::Key::A, xwin::ButtonState::Released);
+		input.processEvents();
+		input.notifyUpdateFinished();
+	}, 3);
+}
+
+namespace
+{
+	// A flythrough: strafing and flying forward while turning the camera, then spinning the object.
+	// Frame times jitter like a real session.
+	void postScriptedInput(InputManager& input, size_t frame)
+	{
+		if (frame % 120 == 0)
+		{
+			bool turning = (frame / 120) % 2 == 0;
+			input.notifyKeyStateChange(xwin::Key::W, turning ? xwin::ButtonState::Pressed : xwin::ButtonState::Released);
+			input.notifyKeyStateChange(xwin::Key::D, turning ? xwin::ButtonState::Pressed : xwin::ButtonState::Released);
+			input.notifyMouseButtonChange(xwin::MouseInput::Right, turning ? xwin::ButtonState::Pressed : xwin::ButtonState::Released);
+			input.notifyMouseButtonChange(xwin::MouseInput::Left, turning ? xwin::ButtonState::Released : xwin::ButtonState::Pressed);
+		}
+		for (size_t i = 0; i < 4; i++)
+		{
+			input.notifyMouseRawInput(int((frame + i) % 7) - 3, int((frame * 3 + i) % 5) - 2);
+		}
+	}
+
+	float getScriptedDelta(size_t frame)
+	{
+		return 1.0f / 60.0f + float(frame % 5) * 0.0007f;
+	}
+
+	struct ReplayScene
+	{
+		Camera camera;
+		Scene scene;
+		InputManager input;
+		ViewerController controller;
+
+		ReplayScene()
+		{
+			auto object = scene.createObject(nullptr);
+			object->setPosition(0.0f, -0.3f, 2.5f);
+			object->setScale(0.3f);
+		}
+
+		void update(float deltaSeconds, std::vector<InputEvent>* applied = nullptr)
+		{
+			input.processEvents(applied);
+			controller.update(camera, scene, input, deltaSeconds);
+			input.notifyUpdateFinished();
+		}
+	};
+}
+
+BENCHMARK("input.replay", context)
+{
+	const size_t frames = 3600;
+
+	// a live session, recorded as it runs
+	std::stringstream recording;
+	uint64_t liveHash;
+	{
+		ReplayScene live;
+		InputRecorder recorder(recording);
+		std::vector<InputEvent> applied;
+		for (size_t frame = 0; frame < frames; frame++)
+		{
+			postScriptedInput(live.input, frame);
+			applied.clear();
+			live.update(getScriptedDelta(frame), &applied);
+			recorder.writeFrame(getScriptedDelta(frame), applied);
+		}
+		liveHash = hashTransforms(live.camera, live.scene);
+	}
+	const std::string bytes = recording.str();
+
+	auto replay = [&](const InputReplayOptions& options) {
+		std::istringstream in(bytes);
+		InputReplayer replayer(in, options);
+		ReplayScene scene;
+		float deltaSeconds = 0;
+		while (replayer.nextFrame(scene.input, deltaSeconds))
+		{
+			scene.update(deltaSeconds);
+		}
+		return hashTransforms(scene.camera, scene.scene);
+	};
+
+	context.setParam("frames", double(frames));
+	context.setParam("bytesPerFrame", double(bytes.size()) / frames);
+
+	uint64_t replayHash = 0;
+	context.measure("recorded", [&]() {
+		replayHash = replay({});
+	}, double(frames), double(bytes.size()));
+
+	InputReplayOptions fixed;
+	fixed.fixedDeltaSeconds = 1.0f / 60.0f;
+	uint64_t fixedHash = 0;
+	context.measure("fixedStep", [&]() {
+		fixedHash = replay(fixed);
+	}, double(frames), double(bytes.size()));
+
+	if (replayHash != liveHash)
+	{
+		context.fail("replaying the recording didn't give the transforms of the live session");
+	}
+	if (fixedHash != replay(fixed) || fixedHash == replayHash)
+	{
+		context.fail("fixed step replays aren't repeatable");
+	}
+}
@@ -0,0 +1,98 @@
+// Benchmarks of the out-of-core LOD pipeline: building the file and streaming it for a moving camera
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+
+#include "Camera.h"
+#include "LodBuilder.h"
+#include "LodStreamer.h"
+
+using namespace std;
+
+BENCHMARK("lod.stream", context)
+{
+	auto& config = context.getConfig();
+	auto path = filesystem::temp_directory_path() / "modelviewer-bench.mvlod";
+
+	// small leaves, so even the default mesh size gets a few levels
+	LodBuildOptions buildOptions;
+	buildOptions.leafTriangles = 8192;
+	buildOptions.clusterResolution = 16;
+
+	auto buildStart = chrono::steady_clock::now();
+	LodBuildStats buildStats = buildLodFile(make_unique<istringstream>(generateGridObj(config.meshVertices)), path, buildOptions);
+	double buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - buildStart).count();
+
+	// a budget of a quarter of the file forces eviction as the camera moves
+	LodStreamerOptions options;
+	options.residentBudget = static_cast<size_t>(buildStats.outputBytes / 4);
+	options.loadBytesPerFrame = options.residentBudget / 8;
+
+	// stands in for the GPU upload, the data itself isn't kept
+	LodStreamer streamer(path, [](const Vertex*, size_t, const unsigned*, size_t) {
+		return make_shared<MeshResource>();
+	}, options);
+
+	// fly low over the grid (x and z in 0..1, z negated) looking down, back and forth along x
+	Camera camera;
+	camera.setFov(60.0f);
+	camera.setAspectRatio(1280u, 720u);
+	camera.setClipRange(0.01f, 10.0f);
+	camera.setRotation(35.0f, 0.0f, 0.0f);
+
+	const float frameSeconds = 1.0f / 60.0f;
+	const float speed = 0.25f;
+	float projectionScale = LodStreamer::getProjectionScale(60.0f, 720);
+	float x = 0.0f;
+	float direction = 1.0f;
+	size_t peakResident = 0;
+
+	context.setParam("sourceTriangles", static_cast<double>(buildStats.sourceTriangles));
+	context.setParam("nodes", static_cast<double>(buildStats.nodes));
+	context.setParam("levels", static_cast<double>(buildStats.levels));
+	context.setParam("fileBytes", static_cast<double>(buildStats.outputBytes));
+	context.setParam("buildSeconds", buildSeconds);
+
+	context.measure("flythrough", [&]() {
+		x += direction * speed * frameSeconds;
+		if (x > 1.0f || x < 0.0f)
+		{
+			direction = -direction;
+		}
+
+		camera.setPosition(x, 0.15f, -1.2f);
+		streamer.update(camera.getPosition(), camera.getViewProjectionMatrix(), projectionScale, frameSeconds);
+		peakResident = max(peakResident, streamer.getStats().residentBytes);
+		doNotOptimize(streamer.getVisible().data());
+	}, 1);
+
+	auto& stats = streamer.getStats();
+	context.setParam("peakResidentBytes", static_cast<double>(peakResident));
+	context.setParam("processResidentBytes", static_cast<double>(stats.processResidentBytes));
+	context.setParam("ioBytesPerSecondAtSpeed", streamer.estimateIoRate(speed));
+	context.setParam("visibleTriangles", static_cast<double>(stats.visibleTriangles));
+	context.measure("select", [&]() {
+		streamer.update(camera.getPosition(), camera.getViewProjectionMatrix(), projectionScale, frameSeconds);
+		doNotOptimize(streamer.getVisible().data());
+	}, 1);
+
+	if (buildStats.nodes < 2)
+	{
+		context.fail("LOD file has a single node");
+	}
+	else if (peakResident > options.residentBudget)
+	{
+		context.fail("resident node data went over the budget");
+	}
+	else if (streamer.getVisible().empty())
+	{
+		context.fail("nothing visible from the camera");
+	}
+
+	std::error_code error;
+	filesystem::remove(path, error);
+}
@@ -0,0 +1,64 @@
+// Benchmarks of logging on the hot path
+
+#include "Benchmark.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include "Logger.h"
+
+using namespace std;
+
+namespace
+{
+	// Log calls per iteration, a burst that fits in a thread's ring
+	const int BURST = 256;
+}
+
+BENCHMARK("log.write", context)
+{
+	auto path = filesystem::temp_directory_path() / "modelviewer-bench.log";
+	error_code error;
+	filesystem::remove(path, error);
+
+	// to a file only, the console would drown the results
+	LoggerOptions options;
+	options.console = false;
+	options.file = path;
+	Logger::start(options);
+
+	glm::vec3 position(1.0f, 2.0f, 3.0f);
+	string name = "teapot.obj";
+	size_t droppedBefore = Logger::getDroppedCount();
+
+	// the calling thread only stores the arguments, the writer formats them while the next burst is timed
+	context.measureWithSetup("async", []() {
+		Logger::flush();
+	}, [&]() {
+		for (int i = 0; i < BURST; i++)
+		{
+			LOG_INFO("Object {} of {} at {} took {} ms", i, name, position, 0.25);
+		}
+	}, BURST);
+	context.expectNoAllocations();
+
+	if (Logger::getDroppedCount() != droppedBefore)
+	{
+		context.fail("records were dropped");
+	}
+
+	// what the code did before: format on the calling thread and flush every line
+	ofstream file(path, ios::app);
+	context.measure("ostream.endl", [&]() {
+		for (int i = 0; i < BURST; i++)
+		{
+			file << "Object " << i << " of " << name << " at [" << position.x << ", " << position.y << ", " << position.z
+				<< "] took " << 0.25 << " ms" << endl;
+		}
+	}, BURST);
+	file.close();
+
+	Logger::flush();
+	Logger::start(LoggerOptions());
+	filesystem::remove(path, error);
+}
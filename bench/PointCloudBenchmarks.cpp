@@ -0,0 +1,230 @@
+// Benchmarks of point clouds: building the octree and selecting its nodes for a moving camera
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <unordered_set>
+
+#include "Camera.h"
+#include "JobSystem.h"
+#include "LodStreamer.h"
+#include "PointCloudStreamer.h"
+#include "PointOctree.h"
+
+using namespace std;
+
+namespace
+{
+	// Random points on a wavy terrain (x and z in 0..1, z negated), the way an aerial scan samples it
+	vector<Vertex> generateTerrainPoints(size_t count, unsigned seed = 1234)
+	{
+		mt19937 random(seed);
+		uniform_real_distribution<float> unit(0.0f, 1.0f);
+		vector<Vertex> points;
+		points.reserve(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			float x = unit(random);
+			float z = unit(random);
+			float y = 0.05f * sin(x * 12.0f) * cos(z * 9.0f) + 0.002f * unit(random);
+			points.push_back(Vertex({ x, y, -z }, { x, 0.5f + y * 5.0f, z }));
+		}
+		return points;
+	}
+
+	// Returns an empty string if every point is in exactly one node, inside its cube, and inner nodes keep one point per cell
+	string checkOctree(const PointOctree& octree, size_t sourcePoints, unsigned gridResolution)
+	{
+		size_t total = 0;
+		for (const PointNode& node : octree.getNodes())
+		{
+			total += node.pointCount;
+			bool leaf = all_of(begin(node.children), end(node.children), [](uint32_t child) { return child == POINT_NO_NODE; });
+			unordered_set<uint64_t> cells;
+			const Vertex* points = octree.getPoints(node);
+			float cellScale = gridResolution / (node.boundsMax.x - node.boundsMin.x);
+			for (size_t i = 0; i < node.pointCount; i++)
+			{
+				uint64_t key = 0;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float position = points[i].position[axis];
+					if (position < node.boundsMin[axis] || position > node.boundsMax[axis])
+					{
+						return "a point is outside its node";
+					}
+					key = key * gridResolution + min(unsigned((position - node.boundsMin[axis]) * cellScale), gridResolution - 1);
+				}
+
+				if (!leaf && !cells.insert(key).second)
+				{
+					return "an inner node keeps two points in one cell";
+				}
+			}
+		}
+		return total == sourcePoints ? "" : "the nodes hold " + to_string(total) + " of " + to_string(sourcePoints) + " points";
+	}
+}
+
+BENCHMARK("pointcloud.octree", context)
+{
+	size_t pointCount = context.getConfig().meshVertices * 10;
+	vector<Vertex> source = generateTerrainPoints(pointCount);
+
+	PointOctreeOptions options;
+	JobSystem& jobs = JobSystem::getDefault();
+	PointOctree octree(source, options, &jobs);
+	auto& stats = octree.getStats();
+	context.setParam("points", double(pointCount));
+	context.setParam("nodes", double(stats.nodes));
+	context.setParam("depth", double(stats.depth));
+	context.setParam("largestNode", double(stats.largestNode));
+	context.setParam("threads", jobs.getThreadCount());
+
+	string error = checkOctree(octree, pointCount, options.gridResolution);
+	if (!error.empty())
+	{
+		context.fail(error);
+	}
+
+	vector<Vertex> points;
+	context.measureWithSetup("build", [&]() {
+		points = source;
+	}, [&]() {
+		octree = PointOctree(std::move(points), options, &jobs);
+	}, double(pointCount), double(pointCount * sizeof(Vertex)));
+
+	context.setParam("threads", 1);
+	context.measureWithSetup("build.single", [&]() {
+		points = source;
+	}, [&]() {
+		octree = PointOctree(std::move(points), options);
+	}, double(pointCount), double(pointCount * sizeof(Vertex)));
+
+	// a scan exported as OBJ positions with colors and no faces reads back as the same points
+	auto path = filesystem::temp_directory_path() / "modelviewer-bench-points.obj";
+	{
+		ofstream file(path);
+		for (size_t i = 0; i < 1000; i++)
+		{
+			const Vertex& point = source[i];
+			file << "v " << point.position.x << " " << point.position.y << " " << -point.position.z << " "
+				<< int(point.color.x * 255) << " " << int(point.color.y * 255) << " " << int(point.color.z * 255) << "\n";
+		}
+	}
+	vector<Vertex> read = readPointCloud(path);
+	if (read.size() != 1000 || abs(read[10].color.y - int(source[10].color.y * 255) / 255.0f) > 1e-5f)
+	{
+		context.fail("the points of an OBJ file without faces were not read back");
+	}
+	std::error_code removeError;
+	filesystem::remove(path, removeError);
+}
+
+BENCHMARK("pointcloud.select", context)
+{
+	size_t pointCount = context.getConfig().meshVertices * 10;
+	auto octree = make_shared<PointOctree>(generateTerrainPoints(pointCount), PointOctreeOptions(), &JobSystem::getDefault());
+
+	// a budget of a tenth of the cloud, so the selection has to choose
+	PointCloudStreamerOptions options;
+	options.pointBudget = pointCount / 10;
+	options.residentBudget = pointCount / 4 * sizeof(Vertex);
+	options.maxPointSpacing = 1.0f;
+
+	// stands in for the GPU upload, the data itself isn't kept
+	PointCloudStreamer streamer(octree, [](const Vertex*, size_t) {
+		return make_shared<MeshResource>();
+	}, options);
+
+	// fly low over the terrain looking down, back and forth along x
+	Camera camera;
+	camera.setFov(60.0f);
+	camera.setAspectRatio(1280u, 720u);
+	camera.setClipRange(0.01f, 10.0f);
+	camera.setRotation(35.0f, 0.0f, 0.0f);
+	camera.setPosition(0.0f, 0.15f, -1.2f);
+
+	const float frameSeconds = 1.0f / 60.0f;
+	const float speed = 0.25f;
+	float projectionScale = LodStreamer::getProjectionScale(60.0f, 720);
+	float x = 0.0f;
+	float direction = 1.0f;
+	size_t peakVisible = 0;
+	size_t peakResident = 0;
+
+	// settle first, so the steady selection is measured without loads
+	for (int i = 0; i < 100 && (i == 0 || streamer.getStats().loadsThisFrame > 0); i++)
+	{
+		streamer.update(camera.getPosition(), camera.getViewProjectionMatrix(), projectionScale, frameSeconds);
+	}
+
+	auto& stats = streamer.getStats();
+	context.setParam("points", double(pointCount));
+	context.setParam("pointBudget", double(options.pointBudget));
+	context.setParam("visiblePoints", double(stats.visiblePoints));
+	context.setParam("visibleNodes", double(stats.visibleNodes));
+
+	// items are the points selected, so the rate is points selected per second
+	context.measure("select", [&]() {
+		streamer.update(camera.getPosition(), camera.getViewProjectionMatrix(), projectionScale, frameSeconds);
+		doNotOptimize(streamer.getVisible().data());
+	}, double(stats.visiblePoints));
+
+	context.measure("flythrough", [&]() {
+		x += direction * speed * frameSeconds;
+		if (x > 1.0f || x < 0.0f)
+		{
+			direction = -direction;
+		}
+
+		camera.setPosition(x, 0.15f, -1.2f);
+		streamer.update(camera.getPosition(), camera.getViewProjectionMatrix(), projectionScale, frameSeconds);
+		peakVisible = max(peakVisible, stats.visiblePoints);
+		peakResident = max(peakResident, stats.residentBytes);
+		doNotOptimize(streamer.getVisible().data());
+	}, double(stats.visiblePoints));
+	context.setParam("peakResidentBytes", double(peakResident));
+
+	if (octree->getNodes().size() < 2)
+	{
+		context.fail("the octree has a single node");
+	}
+	else if (peakVisible > options.pointBudget)
+	{
+		context.fail("drew " + to_string(peakVisible) + " points, over the budget of " + to_string(options.pointBudget));
+	}
+	else if (peakResident > options.residentBudget)
+	{
+		context.fail("resident node data went over the budget");
+	}
+	else if (streamer.getVisible().empty())
+	{
+		context.fail("nothing visible from the camera");
+	}
+
+	// a budget below the root's size draws that many of the root's points and nothing else
+	PointCloudStreamerOptions rootOptions;
+	rootOptions.pointBudget = octree->getNodes()[octree->getRoot()].pointCount / 2;
+	PointCloudStreamer rootStreamer(octree, [](const Vertex*, size_t) {
+		return make_shared<MeshResource>();
+	}, rootOptions);
+	rootStreamer.update(camera.getPosition(), camera.getViewProjectionMatrix(), projectionScale, frameSeconds);
+
+	context.setParam("pointBudget", double(rootOptions.pointBudget));
+	context.measure("select.belowRoot", [&]() {
+		rootStreamer.update(camera.getPosition(), camera.getViewProjectionMatrix(), projectionScale, frameSeconds);
+		doNotOptimize(rootStreamer.getVisible().data());
+	}, double(rootOptions.pointBudget));
+
+	auto& rootStats = rootStreamer.getStats();
+	if (rootStreamer.getVisible().size() != 1 || rootStats.visiblePoints != rootOptions.pointBudget)
+	{
+		context.fail("a budget of " + to_string(rootOptions.pointBudget) + " points, below the root's size, drew "
+			+ to_string(rootStats.visiblePoints) + " points in " + to_string(rootStreamer.getVisible().size()) + " nodes");
+	}
+}
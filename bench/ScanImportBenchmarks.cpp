@@ -0,0 +1,87 @@
+// Benchmarks of importing binary STL and PLY files, including the vertex welding
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <filesystem>
+
+#include "JobSystem.h"
+#include "ScanImport.h"
+
+using namespace std;
+
+BENCHMARK("import.scan", context)
+{
+	auto& config = context.getConfig();
+	auto directory = filesystem::temp_directory_path();
+	auto stlPath = directory / "modelviewer-bench.stl";
+	auto plyPath = directory / "modelviewer-bench.ply";
+
+	MeshResourcePtr mesh = generateGridMesh(config.meshVertices);
+	writeStl(stlPath, mesh->vertices, mesh->indices);
+	writePly(plyPath, mesh->vertices, mesh->indices);
+
+	double triangles = double(mesh->indices.size() / 3);
+	context.setParam("triangles", triangles);
+	context.setParam("stlBytes", double(filesystem::file_size(stlPath)));
+	context.setParam("plyBytes", double(filesystem::file_size(plyPath)));
+
+	vector<Vertex> vertices;
+	vector<unsigned> indices;
+	ScanImportStats stats;
+
+	ScanImportOptions serial;
+	context.measure("stl", [&]() {
+		stats = importStl(stlPath, vertices, indices, serial);
+	}, triangles, double(filesystem::file_size(stlPath)));
+
+	context.setParam("stl.sourceVertices", double(stats.sourceVertices));
+	context.setParam("stl.vertices", double(stats.vertices));
+	context.setParam("stl.vertexReduction", stats.getVertexReduction());
+	context.setParam("stl.weldShare", stats.weldSeconds / (stats.readSeconds + stats.weldSeconds));
+
+	// a grid has no coincident vertices of its own, welding the corners must give the source mesh back
+	bool matches = stats.vertices == mesh->vertices.size() && indices.size() == mesh->indices.size();
+	for (size_t i = 0; matches && i < indices.size(); i++)
+	{
+		matches = vertices[indices[i]].position == mesh->vertices[mesh->indices[i]].position;
+	}
+	if (!matches)
+	{
+		context.fail("welded STL doesn't match the source mesh");
+	}
+	vector<unsigned> serialIndices = indices;
+
+	ScanImportOptions parallel;
+	parallel.jobs = &JobSystem::getDefault();
+	context.measure("stl.parallel", [&]() {
+		stats = importStl(stlPath, vertices, indices, parallel);
+	}, triangles, double(filesystem::file_size(stlPath)));
+
+	context.setParam("stl.parallel.trianglesPerSecond", stats.getTrianglesPerSecond());
+	if (indices != serialIndices)
+	{
+		context.fail("parallel welding gave a different mesh");
+	}
+
+	// the cost of the triangle soup without welding, for comparison
+	ScanImportOptions unwelded = parallel;
+	unwelded.weld = false;
+	context.measure("stl.unwelded", [&]() {
+		stats = importStl(stlPath, vertices, indices, unwelded);
+	}, triangles, double(filesystem::file_size(stlPath)));
+
+	context.measure("ply.parallel", [&]() {
+		stats = importPly(plyPath, vertices, indices, parallel);
+	}, triangles, double(filesystem::file_size(plyPath)));
+
+	// PLY vertices are already shared, they must come back in their order
+	if (stats.vertices != mesh->vertices.size() || indices != mesh->indices)
+	{
+		context.fail("PLY import doesn't match the source mesh");
+	}
+
+	error_code error;
+	filesystem::remove(stlPath, error);
+	filesystem::remove(plyPath, error);
+}
@@ -0,0 +1,221 @@
+// Benchmarks of large scenes: building them in code or from a mapped scene file, and how a frame scales with them
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <cstring>
+#include <filesystem>
+#include <random>
+
+#include "Camera.h"
+#include "FrameAllocator.h"
+#include "JobSystem.h"
+#include "RenderQueue.h"
+#include "SceneFile.h"
+#include "StressScene.h"
+
+using namespace std;
+
+namespace
+{
+	// Groups of ten objects, a parent with nine children around it, spread over a grid
+	void generateSceneFile(SceneFileWriter& writer, size_t count, uint32_t meshCount)
+	{
+		mt19937 random(1234);
+		uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+		uniform_real_distribution<float> scale(0.5f, 1.5f);
+		size_t side = static_cast<size_t>(ceil(sqrt(static_cast<double>(count / 10 + 1))));
+
+		uint32_t parent = SCENE_NO_INDEX;
+		for (size_t i = 0; i < count; i++)
+		{
+			// names repeat, the writer keeps each once
+			uint32_t mesh = writer.addMesh("mesh" + to_string(i % meshCount) + ".obj");
+			glm::quat rotation = glm::angleAxis(angle(random), glm::vec3(0.0f, 1.0f, 0.0f));
+			glm::vec3 size(scale(random));
+
+			if (i % 10 == 0)
+			{
+				size_t group = i / 10;
+				glm::vec3 position(float(group % side) * 10.0f, 0.0f, float(group / side) * 10.0f);
+				parent = writer.addObject(position, rotation, size, mesh);
+			}
+			else
+			{
+				float around = float(i % 10) * 0.698f;
+				glm::vec3 position(std::cos(around) * 3.0f, 1.5f, std::sin(around) * 3.0f);
+				writer.addObject(position, rotation, size, mesh, parent);
+			}
+		}
+	}
+}
+
+BENCHMARK("scene.load", context)
+{
+	const size_t objectCount = 100000;
+	const uint32_t meshCount = 16;
+	auto path = filesystem::temp_directory_path() / "modelviewer-bench.mvscene";
+
+	SceneFileWriter writer;
+	generateSceneFile(writer, objectCount, meshCount);
+	writer.write(path);
+
+	vector<MeshResourcePtr> meshes;
+	for (uint32_t i = 0; i < meshCount; i++)
+	{
+		meshes.push_back(generateGridMesh(64));
+	}
+
+	// the same objects as code would place them, one createObject() call at a time
+	vector<SceneFileObject> source;
+	{
+		SceneFile file(path);
+		source.assign(file.getObjects(), file.getObjects() + file.getObjectCount());
+	}
+
+	context.setParam("objects", double(objectCount));
+	context.setParam("meshes", double(writer.getMeshCount()));
+	context.setParam("fileBytes", double(filesystem::file_size(path)));
+
+	context.measure("procedural", [&]() {
+		Scene scene;
+		for (const SceneFileObject& object : source)
+		{
+			auto created = scene.createObject(object.mesh != SCENE_NO_INDEX ? meshes[object.mesh] : nullptr);
+			created->setPosition(object.position);
+			created->setRotation(glm::quat(object.rotation[3], object.rotation[0], object.rotation[1], object.rotation[2]));
+			created->setScale(object.scale.x, object.scale.y, object.scale.z);
+		}
+		doNotOptimize(scene.size());
+	}, double(objectCount));
+
+	context.measure("mappedFile", [&]() {
+		Scene scene;
+		SceneFile file(path);
+		file.instantiate(scene, meshes);
+		doNotOptimize(scene.size());
+	}, double(objectCount), double(filesystem::file_size(path)));
+
+	// both ways must give the same scene
+	Scene procedural;
+	for (const SceneFileObject& object : source)
+	{
+		auto created = procedural.createObject(meshes[object.mesh]);
+		created->setTransform(object.position, glm::quat(object.rotation[3], object.rotation[0], object.rotation[1], object.rotation[2]), object.scale);
+	}
+	Scene loaded;
+	SceneFile(path).instantiate(loaded, meshes);
+
+	bool same = loaded.size() == procedural.size();
+	for (size_t i = 0; same && i < loaded.size(); i += 97)
+	{
+		auto& a = *(loaded.begin() + i);
+		auto& b = *(procedural.begin() + i);
+		same = a->mesh == b->mesh && a->getModelMatrix() == b->getModelMatrix();
+	}
+	if (!same)
+	{
+		context.fail("the loaded scene differs from the one built in code");
+	}
+	if (writer.getMeshCount() != meshCount)
+	{
+		context.fail("mesh names weren't deduplicated");
+	}
+
+	filesystem::remove(path);
+}
+
+BENCHMARK("scene.scaling", context)
+{
+	// ten and a hundred times the configured scene, 10k, 100k and 1M objects by default
+	size_t baseObjects = context.getConfig().sceneObjects;
+	JobSystem& jobs = JobSystem::getDefault();
+
+	for (size_t objects : { baseObjects, baseObjects * 10, baseObjects * 100 })
+	{
+		StressSceneOptions options;
+		options.objects = objects;
+
+		Scene scene;
+		AnimationSystem animation;
+		StressScene stress = generateStressScene(scene, options, &animation);
+
+		// closer than the suggested view, so the edges of the layers fall outside it and are culled
+		Camera camera;
+		camera.setFov(45.0f);
+		camera.setAspectRatio(1280u, 720u);
+		camera.setClipRange(0.1f, stress.viewDistance);
+		glm::vec3 center = (stress.boundsMin + stress.boundsMax) * 0.5f;
+		camera.setPosition(center.x, center.y, (stress.viewPosition.z + stress.boundsMin.z) * 0.5f);
+		auto viewProjection = camera.getViewProjectionMatrix();
+
+		// what Renderer::render does per draw, without the device: bind on mesh changes, fill the constant buffer
+		glm::mat4x4 constants[2] = { viewProjection, glm::mat4x4(1.0f) };
+		glm::mat4x4 mapped[2];
+		auto submit = [&](const RenderQueue& queue) {
+			const MeshResource* boundMesh = nullptr;
+			size_t binds = 0;
+			for (const DrawItem& item : queue.getItems())
+			{
+				if (item.mesh != boundMesh)
+				{
+					boundMesh = item.mesh;
+					binds++;
+				}
+				constants[1] = *item.model;
+				memcpy(mapped, constants, sizeof(constants));
+				doNotOptimize(mapped);
+			}
+			return binds;
+		};
+
+		// one frame first, params are recorded with the measurements. On the heap, to outlive the arena frames.
+		animation.update(1.0f / 60.0f, &jobs);
+		RenderQueue firstFrame(nullptr);
+		firstFrame.build(scene, viewProjection);
+		size_t binds = submit(firstFrame);
+
+		context.setParam("objects", double(objects));
+		context.setParam("meshes", double(stress.meshes.size()));
+		context.setParam("animated", double(stress.animatedObjects));
+		context.setParam("draws", double(firstFrame.getItems().size()));
+		context.setParam("meshBinds", double(binds));
+		context.setParam("threads", jobs.getThreadCount());
+
+		string count = to_string(objects);
+		context.measure("update/" + count, [&]() {
+			animation.update(1.0f / 60.0f, &jobs);
+		}, double(stress.animatedObjects));
+
+		// the transforms are clean here, only culling and sorting are measured
+		FrameArena frameArena;
+		context.measure("cull/" + count, [&]() {
+			frameArena.beginFrame();
+			RenderQueue queue(&frameArena.current());
+			queue.build(scene, viewProjection);
+			doNotOptimize(queue.getItems().data());
+		}, double(objects));
+
+		context.measure("submit/" + count, [&]() {
+			doNotOptimize(submit(firstFrame));
+		}, double(firstFrame.getItems().size()));
+
+		// all three in order, with the matrices of the animated objects rebuilt by the cull
+		context.measure("frame/" + count, [&]() {
+			animation.update(1.0f / 60.0f, &jobs);
+			frameArena.beginFrame();
+			RenderQueue queue(&frameArena.current());
+			queue.build(scene, viewProjection);
+			doNotOptimize(submit(queue));
+		}, double(objects));
+
+		if (firstFrame.getItems().empty() || firstFrame.getItems().size() + firstFrame.getCulledCount() != objects)
+		{
+			context.fail("the view must keep some of the " + count + " objects and cull the rest");
+		}
+		if (stress.animatedObjects == 0)
+		{
+			context.fail("no object of the " + count + " object scene is animated");
+		}
+	}
+}
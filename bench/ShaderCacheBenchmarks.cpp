@@ -0,0 +1,104 @@
+// Benchmarks of the compiled shader cache, using a stand-in compiler so they run without D3D
+
+#include "Benchmark.h"
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "ShaderCache.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace
+{
+	void writeText(const fs::path& path, const string& text)
+	{
+		ofstream file(path, ios::binary | ios::trunc);
+		file << text;
+	}
+
+	// Pretends to compile by hashing the sources, and takes a fixed time like a real compiler
+	vector<char> standInCompile(const ShaderCompileRequest& request, chrono::microseconds cost)
+	{
+		this_thread::sleep_for(cost);
+		auto key = computeShaderKey(request, collectShaderSources(request.path)).toHex();
+		return vector<char>(key.begin(), key.end());
+	}
+}
+
+BENCHMARK("shader.cache", context)
+{
+	fs::path root = fs::temp_directory_path() / "modelviewer_shader_bench";
+	fs::remove_all(root);
+	fs::create_directories(root / "shaders");
+
+	writeText(root / "shaders" / "base.hlsl", "cbuffer VSBuffer : register(b0) { float4x4 model; };\n");
+	writeText(root / "shaders" / "vs.hlsl", "#include \"base.hlsl\"\nfloat4 main() : SV_POSITION { return 0; }\n");
+
+	ShaderCompileRequest request;
+	request.path = root / "shaders" / "vs.hlsl";
+	request.target = "vs_5_0";
+	request.compilerId = "stand-in";
+
+	const chrono::microseconds compileCost(2000);
+	auto compiler = [&](const ShaderCompileRequest& r) { return standInCompile(r, compileCost); };
+
+	// every iteration starts with an empty cache
+	context.measureWithSetup("miss",
+		[&]() { fs::remove_all(root / "cache"); },
+		[&]() {
+			ShaderCache cache(root / "cache");
+			doNotOptimize(cache.getOrCompile(request, compiler).size());
+		});
+
+	ShaderCache cache(root / "cache");
+	auto expected = cache.getOrCompile(request, compiler);
+	context.measure("hit", [&]() {
+		doNotOptimize(cache.getOrCompile(request, compiler).size());
+	});
+
+	// editing an included file must invalidate the entry
+	writeText(root / "shaders" / "base.hlsl", "cbuffer VSBuffer : register(b0) { float4x4 model; float4x4 vp; };\n");
+	size_t missesBefore = cache.getMissCount();
+	auto changed = cache.getOrCompile(request, compiler);
+	if (cache.getMissCount() != missesBefore + 1 || changed == expected)
+	{
+		context.fail("changing an included file did not invalidate the cache entry");
+	}
+
+	// a damaged entry must be ignored and rebuilt
+	auto key = computeShaderKey(request, collectShaderSources(request.path));
+	writeText(cache.getEntryPath(key), "garbage");
+	vector<char> bytecode;
+	if (cache.load(key, bytecode))
+	{
+		context.fail("a damaged cache entry was loaded");
+	}
+
+	// several launches compiling the same shader at once must all end up with the same valid entry
+	fs::remove_all(root / "cache");
+	vector<vector<char>> results(8);
+	vector<thread> launches;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		launches.emplace_back([&, i]() {
+			ShaderCache launchCache(root / "cache");
+			results[i] = launchCache.getOrCompile(request, compiler);
+		});
+	}
+	for (auto& launch : launches)
+	{
+		launch.join();
+	}
+	for (auto& result : results)
+	{
+		if (result != results[0] || !cache.load(key, bytecode) || bytecode != result)
+		{
+			context.fail("concurrent compiles left an inconsistent cache entry");
+		}
+	}
+
+	fs::remove_all(root);
+}
@@ -0,0 +1,116 @@
+// Benchmarks of progressive model loading
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <cstring>
+#include <sstream>
+
+#include "ObjLoader.h"
+#include "ObjStreamLoader.h"
+
+using namespace std;
+
+namespace
+{
+	// Keeps the streamed mesh in memory, standing in for the GPU buffers
+	class VectorMeshSink : public MeshStreamSink
+	{
+	public:
+		void appendVertices(const Vertex* data, size_t count) override
+		{
+			vertices.insert(vertices.end(), data, data + count);
+		}
+
+		void updateVertices(size_t first, const Vertex* data, size_t count) override
+		{
+			std::copy(data, data + count, vertices.begin() + first);
+			updatedVertices += count;
+		}
+
+		void appendIndices(const unsigned* data, size_t count) override
+		{
+			indices.insert(indices.end(), data, data + count);
+		}
+
+		vector<Vertex> vertices;
+		vector<unsigned> indices;
+		size_t updatedVertices = 0;
+	};
+
+	// Streams the whole text, returns the loader stats
+	ObjStreamStats streamAll(const string& text, const ObjStreamOptions& options, MeshStreamSink& sink)
+	{
+		ObjStreamLoader loader(make_unique<istringstream>(text), text.size(), options);
+		while (loader.step(sink))
+		{
+		}
+		return loader.getStats();
+	}
+
+	bool sameMesh(const vector<Vertex>& a, const vector<Vertex>& b)
+	{
+		if (a.size() != b.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if (a[i].position != b[i].position || a[i].normal != b[i].normal || a[i].color != b[i].color)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+BENCHMARK("obj.stream", context)
+{
+	auto& config = context.getConfig();
+	string text = generateGridObj(config.meshVertices);
+
+	vector<Vertex> expectedVertices;
+	vector<unsigned> expectedIndices;
+	{
+		istringstream stream(text);
+		parseObj(stream, expectedVertices, expectedIndices);
+	}
+
+	ObjStreamOptions unbounded;
+	unbounded.batchBytes = 256 * 1024;
+
+	// small enough to force most of the grid through the spill file
+	ObjStreamOptions capped = unbounded;
+	capped.memoryLimit = 4 * 1024 * 1024;
+
+	context.setParam("vertices", static_cast<double>(expectedVertices.size()));
+
+	for (auto& variant : { make_pair(string("unbounded"), unbounded), make_pair(string("capped"), capped) })
+	{
+		const ObjStreamOptions& options = variant.second;
+
+		VectorMeshSink checkSink;
+		ObjStreamStats stats = streamAll(text, options, checkSink);
+
+		VectorMeshSink sink;
+		context.setParam("peakBytes", static_cast<double>(stats.peakMemory));
+		context.setParam("pagesSpilled", static_cast<double>(stats.pagesSpilled));
+		context.measureWithSetup(variant.first,
+			[&]() { sink = VectorMeshSink(); },
+			[&]() {
+				streamAll(text, options, sink);
+				doNotOptimize(sink.indices.data());
+			},
+			static_cast<double>(expectedVertices.size()), static_cast<double>(text.size()));
+
+		if (!sameMesh(checkSink.vertices, expectedVertices) || checkSink.indices != expectedIndices)
+		{
+			context.fail("streamed mesh differs from parseObj()");
+		}
+		else if (stats.peakMemory > options.memoryLimit)
+		{
+			context.fail("loader used " + to_string(stats.peakMemory) + " bytes, over its limit of " + to_string(options.memoryLimit));
+		}
+	}
+}
@@ -0,0 +1,79 @@
+#include "SyntheticData.h"
+#include "ObjLoader.h"
+
+#include <cmath>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+std::string generateGridObj(size_t targetVertices)
+{
+	size_t side = static_cast<size_t>(ceil(sqrt(static_cast<double>(targetVertices))));
+	if (side < 2)
+	{
+		side = 2;
+	}
+
+	ostringstream os;
+	os << "# synthetic grid " << side << "x" << side << "\n";
+
+	for (size_t y = 0; y < side; y++)
+	{
+		for (size_t x = 0; x < side; x++)
+		{
+			float fx = static_cast<float>(x) / (side - 1);
+			float fy = static_cast<float>(y) / (side - 1);
+			float height = 0.1f * sin(fx * 12.0f) * cos(fy * 9.0f);
+			os << "v " << fx << " " << height << " " << fy << "\n";
+		}
+	}
+
+	// obj indices are 1 based
+	for (size_t y = 0; y + 1 < side; y++)
+	{
+		for (size_t x = 0; x + 1 < side; x++)
+		{
+			size_t i0 = y * side + x + 1;
+			size_t i1 = i0 + 1;
+			size_t i2 = i0 + side;
+			size_t i3 = i2 + 1;
+			os << "f " << i0 << " " << i1 << " " << i3 << "\n";
+			os << "f " << i0 << " " << i3 << " " << i2 << "\n";
+		}
+	}
+
+	return os.str();
+}
+
+MeshResourcePtr generateGridMesh(size_t targetVertices)
+{
+	istringstream stream(generateGridObj(targetVertices));
+
+	MeshResourcePtr mesh(new MeshResource());
+	parseObj(stream, mesh->vertices, mesh->indices);
+	normalizeVertexNormals(mesh->vertices);
+	mesh->computeBounds();
+	mesh->updateMemoryStats();
+	return mesh;
+}
+
+ScenePtr generateScene(size_t objectCount, const MeshResourcePtr& mesh, unsigned seed)
+{
+	mt19937 random(seed);
+	uniform_real_distribution<float> angle(0.0f, 360.0f);
+	uniform_real_distribution<float> scale(0.5f, 1.5f);
+
+	size_t side = static_cast<size_t>(ceil(sqrt(static_cast<double>(objectCount))));
+
+	ScenePtr scene(new Scene());
+	for (size_t i = 0; i < objectCount; i++)
+	{
+		auto object = scene->createObject(mesh);
+		object->setPosition(static_cast<float>(i % side) * 2.0f, 0.0f, static_cast<float>(i / side) * 2.0f);
+		object->setRotation(angle(random), angle(random), angle(random));
+		object->setScale(scale(random));
+	}
+
+	return scene;
+}
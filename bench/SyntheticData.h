@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+#include "Assets.h"
+#include "Scene.h"
+
+// Generates the text of an OBJ file containing a wavy grid with roughly the given number of vertices.
+// Two triangles are emitted per grid cell, so the face count is about twice the vertex count.
+std::string generateGridObj(size_t targetVertices);
+
+// Generates a mesh resource (CPU data only, no primitive buffers) of roughly the given number of vertices
+MeshResourcePtr generateGridMesh(size_t targetVertices);
+
+// Generates a scene where every object shares the given mesh.
+// Objects are laid out on a grid with pseudo random rotations and scales.
+// The same seed always produces the same scene.
+ScenePtr generateScene(size_t objectCount, const MeshResourcePtr& mesh, unsigned seed = 1234);
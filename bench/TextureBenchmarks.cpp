@@ -0,0 +1,199 @@
+// Benchmarks of the texture pipeline: mip generation, block compression and the texture cache
+
+#include "Benchmark.h"
+
+#include <cmath>
+#include <filesystem>
+
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include "MipChain.h"
+#include "PngWriter.h"
+#include "TextureCache.h"
+
+using namespace std;
+
+namespace
+{
+	const unsigned TEXTURE_SIZE = 1024;
+
+	// Smooth gradients with sharp shapes and a little noise, like a painted texture
+	Image generateTexture(unsigned size)
+	{
+		Image image;
+		image.width = image.height = size;
+		image.pixels.resize(size_t(size) * size * 4);
+		uint32_t noise = 1234;
+		for (unsigned y = 0; y < size; y++)
+		{
+			for (unsigned x = 0; x < size; x++)
+			{
+				noise = noise * 1664525u + 1013904223u;
+				float u = float(x) / size, v = float(y) / size;
+				bool stripe = (x / 37 + y / 53) % 5 == 0;
+				float r = 0.5f + 0.5f * sin(u * 12.0f + v * 3.0f);
+				float g = stripe ? 0.9f : 0.3f + 0.4f * v;
+				float b = 0.5f + 0.5f * cos(v * 9.0f);
+
+				uint8_t* pixel = &image.pixels[(size_t(y) * size + x) * 4];
+				int grain = int(noise >> 28) - 8;
+				pixel[0] = uint8_t(min(255, max(0, int(r * 255) + grain)));
+				pixel[1] = uint8_t(min(255, max(0, int(g * 255) + grain)));
+				pixel[2] = uint8_t(min(255, max(0, int(b * 255) + grain)));
+				pixel[3] = uint8_t(255 * u);
+			}
+		}
+		return image;
+	}
+
+	// Peak signal to noise ratio over the given channels, in dB
+	double computePsnr(const vector<uint8_t>& a, const vector<uint8_t>& b, int channels)
+	{
+		double error = 0;
+		size_t count = 0;
+		for (size_t i = 0; i < a.size(); i += 4)
+		{
+			for (int c = 0; c < channels; c++)
+			{
+				double difference = double(a[i + c]) - double(b[i + c]);
+				error += difference * difference;
+				count++;
+			}
+		}
+		double mean = error / double(count);
+		return mean > 0 ? 10.0 * log10(255.0 * 255.0 / mean) : 99.0;
+	}
+}
+
+BENCHMARK("texture.mips", context)
+{
+	Image image = generateTexture(TEXTURE_SIZE);
+	double texels = double(image.width) * image.height;
+	context.setParam("size", TEXTURE_SIZE);
+
+	MipOptions box;
+	box.filter = MipFilter::Box;
+	context.measure("box", [&]() {
+		doNotOptimize(generateMipChain(image, box));
+	}, texels);
+
+	MipOptions kaiser;
+	context.measure("kaiser", [&]() {
+		doNotOptimize(generateMipChain(image, kaiser));
+	}, texels);
+
+	vector<Image> levels;
+	context.measure("kaiser.parallel", [&]() {
+		levels = generateMipChain(image, kaiser, &JobSystem::getDefault());
+	}, texels);
+
+	if (levels.size() != getMipCount(image.width, image.height) || levels.back().width != 1 || levels.back().height != 1)
+	{
+		context.fail("mip chain doesn't end at 1x1");
+	}
+
+	// filtering in linear light keeps a half black, half white texture from darkening:
+	// the average is 50% linear, which is 188 in sRGB and not 128
+	Image checker;
+	checker.width = checker.height = 2;
+	checker.pixels = { 0, 0, 0, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0, 0, 0, 255 };
+	vector<Image> checkerLevels = generateMipChain(checker, box);
+	if (abs(int(checkerLevels[1].pixels[0]) - 188) > 1)
+	{
+		context.fail("mips are not averaged in linear light");
+	}
+}
+
+BENCHMARK("texture.encode", context)
+{
+	Image image = generateTexture(TEXTURE_SIZE);
+	double texels = double(image.width) * image.height;
+	double sourceBytes = double(image.pixels.size());
+	context.setParam("size", TEXTURE_SIZE);
+
+	struct Variant
+	{
+		const char* name;
+		BlockFormat format;
+		int channels;
+		double minimumPsnr;
+	};
+	const Variant variants[] = {
+		{ "bc1", BlockFormat::BC1, 3, 30.0 },
+		{ "bc3", BlockFormat::BC3, 4, 30.0 },
+		{ "bc5", BlockFormat::BC5, 2, 35.0 },
+		{ "bc7", BlockFormat::BC7, 4, 35.0 },
+	};
+
+	vector<uint8_t> decoded(image.pixels.size());
+	for (const Variant& variant : variants)
+	{
+		// quality first, params are recorded with the measurement
+		vector<uint8_t> blocks(getCompressedSize(variant.format, image.width, image.height));
+		compressImage(variant.format, image.pixels.data(), image.width, image.height, blocks.data(), &JobSystem::getDefault());
+		decompressImage(variant.format, blocks.data(), image.width, image.height, decoded.data());
+		double psnr = computePsnr(image.pixels, decoded, variant.channels);
+		context.setParam(string(variant.name) + ".psnr", psnr);
+		context.setParam(string(variant.name) + ".ratio", sourceBytes / double(blocks.size()));
+
+		context.measure(string(variant.name) + ".parallel", [&]() {
+			compressImage(variant.format, image.pixels.data(), image.width, image.height, blocks.data(), &JobSystem::getDefault());
+		}, texels, sourceBytes);
+
+		if (psnr < variant.minimumPsnr)
+		{
+			context.fail(string(variant.name) + " quality is too low");
+		}
+	}
+
+	// one thread, to compare with the parallel encode
+	vector<uint8_t> blocks(getCompressedSize(BlockFormat::BC7, image.width, image.height));
+	context.measure("bc7", [&]() {
+		compressImage(BlockFormat::BC7, image.pixels.data(), image.width, image.height, blocks.data());
+	}, texels, sourceBytes);
+}
+
+BENCHMARK("texture.cache", context)
+{
+	auto directory = filesystem::temp_directory_path() / "modelviewer-bench-textures";
+	auto imagePath = filesystem::temp_directory_path() / "modelviewer-bench-texture.png";
+	error_code error;
+	filesystem::remove_all(directory, error);
+
+	Image image = generateTexture(TEXTURE_SIZE);
+	writePng(imagePath, image.pixels.data(), image.width, image.height);
+
+	TextureCache cache(directory);
+	TextureSettings settings;
+	TextureStats stats;
+	double texels = double(image.width) * image.height;
+
+	// one miss first, params are recorded with the measurements
+	CompressedTexture texture = cache.getOrCompress(imagePath, settings, &JobSystem::getDefault(), &stats);
+	context.setParam("encodeTexelsPerSecond", stats.getEncodeTexelsPerSecond());
+	context.setParam("mipShare", stats.mipSeconds / (stats.decodeSeconds + stats.mipSeconds + stats.encodeSeconds));
+
+	// what the GPU holds for the texture with and without compression
+	context.setParam("gpuBytes", double(texture.data.size()));
+	context.setParam("uncompressedGpuBytes", double(texture.getUncompressedBytes()));
+	context.setParam("gpuMemorySaved", 1.0 - double(texture.data.size()) / double(texture.getUncompressedBytes()));
+
+	// decode, mips and BC7 for every level
+	context.measureWithSetup("miss", [&]() {
+		filesystem::remove_all(directory, error);
+	}, [&]() {
+		doNotOptimize(cache.getOrCompress(imagePath, settings, &JobSystem::getDefault(), &stats));
+	}, texels);
+
+	context.measure("hit", [&]() {
+		texture = cache.getOrCompress(imagePath, settings, &JobSystem::getDefault(), &stats);
+	}, texels);
+
+	if (!stats.cacheHit)
+	{
+		context.fail("second load wasn't served from the cache");
+	}
+
+	filesystem::remove_all(directory, error);
+	filesystem::remove(imagePath, error);
+}
@@ -0,0 +1,93 @@
+// Benchmarks of the headless thumbnail pipeline
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "PngWriter.h"
+#include "SoftwareRasterizer.h"
+#include "ThumbnailPipeline.h"
+
+using namespace std;
+
+BENCHMARK("thumbnail.pipeline", context)
+{
+	auto& config = context.getConfig();
+
+	// a small library of models, each a tenth of the configured mesh size
+	const size_t modelCount = 8;
+	auto directory = filesystem::temp_directory_path() / "modelviewer-bench-thumbnails";
+	filesystem::create_directories(directory);
+
+	vector<filesystem::path> models;
+	string text = generateGridObj(max<size_t>(config.meshVertices / 10, 4));
+	for (size_t i = 0; i < modelCount; i++)
+	{
+		models.push_back(directory / ("model" + to_string(i) + ".obj"));
+		ofstream(models.back()) << text;
+	}
+
+	ThumbnailOptions options;
+	options.width = options.height = 128;
+	options.views = parseThumbnailViews("three-quarter,turntable:4");
+	options.writeFiles = false;
+
+	// the stages on their own, for one view of one model
+	{
+		MeshResourcePtr mesh = generateGridMesh(max<size_t>(config.meshVertices / 10, 4));
+		SoftwareRasterizer rasterizer(options.width, options.height);
+		glm::mat4x4 viewProjection(1.0f);
+		viewProjection[3] = glm::vec4(-0.5f, 0.0f, 0.5f, 1.0f);
+
+		context.setParam("triangles", double(mesh->indices.size() / 3));
+		context.measure("rasterize", [&]() {
+			rasterizer.clear(options.background);
+			rasterizer.draw(*mesh, glm::mat4x4(1.0f), viewProjection);
+			doNotOptimize(rasterizer.getPixels());
+		}, 1);
+
+		if (rasterizer.getDrawnTriangles() == 0)
+		{
+			context.fail("the mesh covered no pixels");
+		}
+
+		context.measure("encode", [&]() {
+			doNotOptimize(encodePng(rasterizer.getPixels(), options.width, options.height).data());
+		}, 1, double(options.width) * options.height * 4);
+	}
+
+	for (unsigned threads : { 1u, max(thread::hardware_concurrency(), 1u) })
+	{
+		options.threads = threads;
+		ThumbnailPipeline pipeline(options);
+		ThumbnailStats stats;
+
+		context.setParam("threads", threads);
+		context.setParam("models", double(modelCount));
+		context.measure("batch.threads" + to_string(threads), [&]() {
+			stats = pipeline.run(models);
+		}, double(modelCount * options.views.size()));
+
+		for (size_t stage = 0; stage < static_cast<size_t>(ThumbnailStage::Count); stage++)
+		{
+			auto value = static_cast<ThumbnailStage>(stage);
+			context.setParam(string("utilization.") + getThumbnailStageName(value), stats.getUtilization(value));
+		}
+
+		if (stats.images != modelCount * options.views.size() || stats.failedModels != 0)
+		{
+			context.fail("pipeline didn't produce every image");
+		}
+
+		if (threads == 1 && thread::hardware_concurrency() <= 1)
+		{
+			break;
+		}
+	}
+
+	std::error_code error;
+	filesystem::remove_all(directory, error);
+}
@@ -0,0 +1,147 @@
+// Benchmarks of the geometry upload path: loading meshes into staging memory on the headless backend
+
+#include "Benchmark.h"
+#include "SyntheticData.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+#include "GeometryUpload.h"
+#include "JobSystem.h"
+#include "MeshCodec.h"
+#include "ObjLoader.h"
+
+using namespace std;
+
+namespace
+{
+	// The headless buffers must hold exactly what the vector based loaders produce
+	string checkUploaded(const MeshResource& mesh, const vector<Vertex>& vertices, const vector<unsigned>& indices)
+	{
+		auto buffers = static_cast<const HeadlessPrimitiveBuffers*>(mesh.primitiveBuffers.get());
+		if (buffers->vertexCount != vertices.size() || buffers->indexCount != indices.size())
+		{
+			return "uploaded " + to_string(buffers->vertexCount) + " vertices and " + to_string(buffers->indexCount)
+				+ " indices, expected " + to_string(vertices.size()) + " and " + to_string(indices.size());
+		}
+		if (!equal(indices.begin(), indices.end(), buffers->indices))
+		{
+			return "uploaded indices differ";
+		}
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const Vertex& vertex = buffers->vertices[i];
+			if (vertex.position != vertices[i].position || vertex.normal != vertices[i].normal || vertex.color != vertices[i].color)
+			{
+				return "uploaded vertex " + to_string(i) + " differs";
+			}
+		}
+		return "";
+	}
+}
+
+BENCHMARK("mesh.upload", context)
+{
+	auto& config = context.getConfig();
+	auto directory = filesystem::temp_directory_path();
+	auto objPath = directory / "modelviewer-bench-upload.obj";
+	auto meshPath = directory / "modelviewer-bench-upload.mvmesh";
+
+	string text = generateGridObj(config.meshVertices);
+	{
+		ofstream file(objPath, ios::binary);
+		file << text;
+	}
+
+	vector<Vertex> vertices;
+	vector<unsigned> indices;
+	{
+		istringstream stream(text);
+		parseObj(stream, vertices, indices);
+		normalizeVertexNormals(vertices);
+	}
+	writeMeshFile(meshPath, vertices, indices);
+
+	// the codec quantizes and may rotate triangles, its own decoder gives the expected mesh
+	vector<Vertex> decodedVertices;
+	vector<unsigned> decodedIndices;
+	readMeshFile(meshPath, decodedVertices, decodedIndices);
+
+	double loadedBytes = double(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned));
+	context.setParam("vertices", double(vertices.size()));
+	context.setParam("loadedBytes", loadedBytes);
+
+	HeadlessUploader uploader;
+	JobSystem& jobs = JobSystem::getDefault();
+
+	// Counts one load apart from the timing, the counters are the point of the comparison
+	auto countCopies = [&](const function<MeshResourcePtr()>& load) {
+		UploadStats::reset();
+		MeshResourcePtr mesh = load();
+		context.setParam("copiesPerByte", UploadStats::getCopiesPerLoadedByte());
+		context.setParam("stagingAllocations", double(UploadStats::get(UploadCounter::StagingAllocations)));
+		return mesh;
+	};
+
+	// the way meshes were loaded before: parsed into growing vectors, then copied into upload memory
+	auto loadVectors = [&]() {
+		ifstream file(objPath);
+		MeshResourcePtr mesh(new MeshResource());
+		parseObj(file, mesh->vertices, mesh->indices);
+		normalizeVertexNormals(mesh->vertices);
+		mesh->primitiveBuffers = uploader.upload(mesh->vertices.data(), mesh->vertices.size(), mesh->indices.data(), mesh->indices.size());
+		mesh->computeBounds();
+		return mesh;
+	};
+	countCopies(loadVectors);
+	context.measure("obj.vectors", [&]() {
+		doNotOptimize(loadVectors().get());
+	}, double(vertices.size()), double(text.size()));
+
+	struct Variant
+	{
+		string name;
+		filesystem::path path;
+		MeshResidency residency;
+		double expectedCopies;
+		const vector<Vertex>& vertices;
+		const vector<unsigned>& indices;
+	};
+	for (const Variant& variant : {
+		Variant{ "obj.staging", objPath, MeshResidency::None, 0.0, vertices, indices },
+		Variant{ "obj.staging.full", objPath, MeshResidency::Full, 1.0, vertices, indices },
+		Variant{ "mvmesh.staging", meshPath, MeshResidency::None, 0.0, decodedVertices, decodedIndices } })
+	{
+		auto load = [&]() {
+			return loadMeshFile(variant.path, uploader, variant.residency, &jobs);
+		};
+
+		MeshResourcePtr mesh = countCopies(load);
+		double copies = UploadStats::getCopiesPerLoadedByte();
+		uint64_t stagingAllocations = UploadStats::get(UploadCounter::StagingAllocations);
+		context.measure(variant.name, [&]() {
+			doNotOptimize(load().get());
+		}, double(vertices.size()), double(filesystem::file_size(variant.path)));
+
+		string failure = checkUploaded(*mesh, variant.vertices, variant.indices);
+		if (!failure.empty())
+		{
+			context.fail(variant.name + ": " + failure);
+		}
+		else if (copies != variant.expectedCopies)
+		{
+			context.fail(variant.name + ": copied " + to_string(copies) + " bytes per loaded byte, expected " + to_string(variant.expectedCopies));
+		}
+		else if (stagingAllocations != 1)
+		{
+			context.fail(variant.name + ": " + to_string(stagingAllocations) + " staging allocations for a single mesh");
+		}
+	}
+
+	std::error_code error;
+	filesystem::remove(objPath, error);
+	filesystem::remove(meshPath, error);
+}
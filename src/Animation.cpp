@@ -0,0 +1,275 @@
+#include "Animation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANIMATION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Index of the last keyframe at or before a time, or 0
+	template <typename T>
+	size_t findKeyframe(const std::vector<Keyframe<T>>& keyframes, float time)
+	{
+		auto it = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+			[](float value, const Keyframe<T>& keyframe) { return value < keyframe.time; });
+		return it == keyframes.begin() ? 0 : static_cast<size_t>(it - keyframes.begin()) - 1;
+	}
+
+	glm::vec3 sampleKeyframes(const std::vector<Keyframe<glm::vec3>>& keyframes, float time, const glm::vec3& fallback)
+	{
+		if (keyframes.empty())
+		{
+			return fallback;
+		}
+
+		size_t index = findKeyframe(keyframes, time);
+		if (index + 1 >= keyframes.size() || time <= keyframes[index].time)
+		{
+			return keyframes[index].value;
+		}
+
+		const auto& a = keyframes[index];
+		const auto& b = keyframes[index + 1];
+		float t = (time - a.time) / (b.time - a.time);
+		return a.value + (b.value - a.value) * t;
+	}
+
+	glm::quat sampleKeyframes(const std::vector<Keyframe<glm::quat>>& keyframes, float time, const glm::quat& fallback)
+	{
+		if (keyframes.empty())
+		{
+			return fallback;
+		}
+
+		size_t index = findKeyframe(keyframes, time);
+		if (index + 1 >= keyframes.size() || time <= keyframes[index].time)
+		{
+			return keyframes[index].value;
+		}
+
+		const auto& a = keyframes[index];
+		const auto& b = keyframes[index + 1];
+		return glm::slerp(a.value, b.value, (time - a.time) / (b.time - a.time));
+	}
+}
+
+glm::mat4x4 JointTransform::toMatrix() const
+{
+	glm::mat4x4 matrix = glm::toMat4(rotation);
+	matrix[0] = matrix[0] * scale.x;
+	matrix[1] = matrix[1] * scale.y;
+	matrix[2] = matrix[2] * scale.z;
+	matrix[3] = glm::vec4(translation, 1.0f);
+	return matrix;
+}
+
+SampledClip::SampledClip(const AnimationClip& clip, float sampleRate, const std::vector<JointTransform>* defaults) :
+	trackCount{ clip.tracks.size() }, sampleRate{ sampleRate }, duration{ std::max(clip.duration, 0.0f) }
+{
+	if (sampleRate <= 0)
+	{
+		throw std::runtime_error("Animation sample rate must be positive");
+	}
+	if (defaults && defaults->size() < trackCount)
+	{
+		throw std::runtime_error("Animation defaults don't cover every track");
+	}
+
+	// at least two frames, so sampling always has a pair to blend
+	frameCount = std::max<size_t>(static_cast<size_t>(std::ceil(duration * sampleRate)) + 1, 2);
+	frames.resize(frameCount * trackCount * FLOATS_PER_TRACK);
+
+	for (size_t track = 0; track < trackCount; track++)
+	{
+		const TransformTrack& source = clip.tracks[track];
+		JointTransform fallback = defaults ? (*defaults)[track] : JointTransform();
+		glm::quat previousRotation = fallback.rotation;
+
+		for (size_t frame = 0; frame < frameCount; frame++)
+		{
+			float time = std::min(frame / sampleRate, duration);
+			glm::vec3 translation = sampleKeyframes(source.positions, time, fallback.translation);
+			glm::quat rotation = sampleKeyframes(source.rotations, time, fallback.rotation);
+			glm::vec3 scale = sampleKeyframes(source.scales, time, fallback.scale);
+
+			// keep neighbouring frames in the same hemisphere, so blending them takes the short way
+			if (glm::dot(rotation, previousRotation) < 0)
+			{
+				rotation = glm::quat(-rotation.w, -rotation.x, -rotation.y, -rotation.z);
+			}
+			previousRotation = rotation;
+
+			float* out = &frames[(frame * trackCount + track) * FLOATS_PER_TRACK];
+			out[0] = translation.x;
+			out[1] = translation.y;
+			out[2] = translation.z;
+			out[3] = rotation.x;
+			out[4] = rotation.y;
+			out[5] = rotation.z;
+			out[6] = rotation.w;
+			out[7] = scale.x;
+			out[8] = scale.y;
+			out[9] = scale.z;
+		}
+	}
+}
+
+void SampledClip::sample(float time, bool loop, JointTransform* transforms) const
+{
+	if (loop && duration > 0)
+	{
+		time = std::fmod(time, duration);
+		if (time < 0)
+		{
+			time += duration;
+		}
+	}
+	time = std::min(std::max(time, 0.0f), duration);
+
+	float position = time * sampleRate;
+	size_t frame = std::min(static_cast<size_t>(position), frameCount - 2);
+	float blend = std::min(position - frame, 1.0f);
+
+	const size_t rowSize = trackCount * FLOATS_PER_TRACK;
+	const float* a = &frames[frame * rowSize];
+	const float* b = a + rowSize;
+
+	// blend the two rows, then unpack
+	thread_local std::vector<float> row;
+	row.resize(rowSize);
+	size_t i = 0;
+#if defined(ANIMATION_SSE2)
+	__m128 weight = _mm_set1_ps(blend);
+	for (; i + 4 <= rowSize; i += 4)
+	{
+		__m128 va = _mm_loadu_ps(a + i);
+		__m128 vb = _mm_loadu_ps(b + i);
+		_mm_storeu_ps(&row[i], _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), weight)));
+	}
+#endif
+	for (; i < rowSize; i++)
+	{
+		row[i] = a[i] + (b[i] - a[i]) * blend;
+	}
+
+	for (size_t track = 0; track < trackCount; track++)
+	{
+		const float* values = &row[track * FLOATS_PER_TRACK];
+		JointTransform& transform = transforms[track];
+		transform.translation = { values[0], values[1], values[2] };
+
+		// normalized linear blend, the frames are close enough for it to match a slerp
+		float length = std::sqrt(values[3] * values[3] + values[4] * values[4] + values[5] * values[5] + values[6] * values[6]);
+		float inverseLength = length > 0 ? 1.0f / length : 0.0f;
+		transform.rotation = glm::quat(values[6] * inverseLength, values[3] * inverseLength, values[4] * inverseLength, values[5] * inverseLength);
+		transform.scale = { values[7], values[8], values[9] };
+	}
+}
+
+void computeSkinningPalette(const Skeleton& skeleton, const JointTransform* pose, glm::mat4x4* globals, glm::mat4x4* palette)
+{
+	for (size_t joint = 0; joint < skeleton.size(); joint++)
+	{
+		int parent = skeleton.parents[joint];
+		glm::mat4x4 local = pose[joint].toMatrix();
+		globals[joint] = parent >= 0 ? globals[parent] * local : local;
+		palette[joint] = globals[joint] * skeleton.inverseBindMatrices[joint];
+	}
+}
+
+void skinVertices(const SkinnedMesh& mesh, const glm::mat4x4* palette, size_t first, size_t count, Vertex* out,
+	glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+	const Vertex* source = &mesh.vertices[first];
+	const SkinWeights* weights = &mesh.weights[first];
+
+#if defined(ANIMATION_SSE2)
+	// matrices are 16 floats, a column per register
+	const float* matrices = reinterpret_cast<const float*>(palette);
+	__m128 minimum = _mm_set1_ps(INFINITY);
+	__m128 maximum = _mm_set1_ps(-INFINITY);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const SkinWeights& skin = weights[i];
+		__m128 column0 = _mm_setzero_ps();
+		__m128 column1 = _mm_setzero_ps();
+		__m128 column2 = _mm_setzero_ps();
+		__m128 column3 = _mm_setzero_ps();
+
+		for (int influence = 0; influence < 4; influence++)
+		{
+			const float* matrix = matrices + size_t(skin.joints[influence]) * 16;
+			__m128 weight = _mm_set1_ps(skin.weights[influence]);
+			column0 = _mm_add_ps(column0, _mm_mul_ps(_mm_loadu_ps(matrix), weight));
+			column1 = _mm_add_ps(column1, _mm_mul_ps(_mm_loadu_ps(matrix + 4), weight));
+			column2 = _mm_add_ps(column2, _mm_mul_ps(_mm_loadu_ps(matrix + 8), weight));
+			column3 = _mm_add_ps(column3, _mm_mul_ps(_mm_loadu_ps(matrix + 12), weight));
+		}
+
+		const Vertex& vertex = source[i];
+		__m128 position = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(vertex.position.x)), _mm_mul_ps(column1, _mm_set1_ps(vertex.position.y))),
+			_mm_add_ps(_mm_mul_ps(column2, _mm_set1_ps(vertex.position.z)), column3));
+		__m128 normal = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(column0, _mm_set1_ps(vertex.normal.x)), _mm_mul_ps(column1, _mm_set1_ps(vertex.normal.y))),
+			_mm_mul_ps(column2, _mm_set1_ps(vertex.normal.z)));
+
+		// blended matrices can scale, renormalize (w is 0)
+		__m128 squared = _mm_mul_ps(normal, normal);
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(squared, _mm_shuffle_ps(squared, squared, _MM_SHUFFLE(2, 3, 0, 1))),
+			_mm_shuffle_ps(squared, squared, _MM_SHUFFLE(1, 0, 3, 2)));
+		lengthSquared = _mm_max_ps(lengthSquared, _mm_set1_ps(1e-20f));
+		normal = _mm_div_ps(normal, _mm_sqrt_ps(lengthSquared));
+
+		minimum = _mm_min_ps(minimum, position);
+		maximum = _mm_max_ps(maximum, position);
+
+		float values[8];
+		_mm_storeu_ps(values, position);
+		_mm_storeu_ps(values + 4, normal);
+
+		Vertex& result = out[i];
+		result.position = { values[0], values[1], values[2] };
+		result.normal = { values[4], values[5], values[6] };
+		result.color = vertex.color;
+	}
+
+	float bounds[8];
+	_mm_storeu_ps(bounds, minimum);
+	_mm_storeu_ps(bounds + 4, maximum);
+	boundsMin = { bounds[0], bounds[1], bounds[2] };
+	boundsMax = { bounds[4], bounds[5], bounds[6] };
+#else
+	boundsMin = glm::vec3(INFINITY);
+	boundsMax = glm::vec3(-INFINITY);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		const SkinWeights& skin = weights[i];
+		glm::mat4x4 matrix = palette[skin.joints[0]] * skin.weights[0];
+		for (int influence = 1; influence < 4; influence++)
+		{
+			const glm::mat4x4& joint = palette[skin.joints[influence]];
+			for (int column = 0; column < 4; column++)
+			{
+				matrix[column] += joint[column] * skin.weights[influence];
+			}
+		}
+
+		const Vertex& vertex = source[i];
+		Vertex& result = out[i];
+		result.position = glm::vec3(matrix * glm::vec4(vertex.position, 1.0f));
+		result.normal = glm::normalize(glm::vec3(matrix * glm::vec4(vertex.normal, 0.0f)));
+		result.color = vertex.color;
+
+		boundsMin = glm::min(boundsMin, result.position);
+		boundsMax = glm::max(boundsMax, result.position);
+	}
+#endif
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Assets.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+template <typename T>
+struct Keyframe
+{
+	float time;
+	T value;
+};
+
+// Keyframes of a single transform, sorted by time (in seconds).
+// A channel without keyframes keeps its default value.
+struct TransformTrack
+{
+	std::vector<Keyframe<glm::vec3>> positions;
+	std::vector<Keyframe<glm::quat>> rotations;
+	std::vector<Keyframe<glm::vec3>> scales;
+};
+
+// Keyframe animation of a set of transforms: the joints of a skeleton, or a single scene object
+struct AnimationClip
+{
+	float duration = 0;
+	std::vector<TransformTrack> tracks;
+};
+
+// A local transform, applied as scale, then rotation, then translation
+struct JointTransform
+{
+	glm::vec3 translation = { 0, 0, 0 };
+	glm::quat rotation = glm::quat(1, 0, 0, 0);
+	glm::vec3 scale = { 1, 1, 1 };
+
+	glm::mat4x4 toMatrix() const;
+};
+
+// A clip resampled at a fixed rate, for fast sampling of many tracks.
+// Each frame is a single row of floats with the translation, rotation and scale of every track,
+// so sampling blends two rows with SIMD regardless of how the keyframes were spaced.
+class SampledClip
+{
+public:
+	// Resamples a clip. Channels without keyframes take the default transform of their track if
+	// defaults are given (eg. a skeleton's bind pose), the identity otherwise.
+	SampledClip(const AnimationClip& clip, float sampleRate = 30.0f, const std::vector<JointTransform>* defaults = nullptr);
+
+	// Writes the transform of every track at a time in seconds. The time wraps around when looping,
+	// otherwise it is clamped to the clip.
+	void sample(float time, bool loop, JointTransform* transforms) const;
+
+	size_t getTrackCount() const { return trackCount; }
+	float getDuration() const { return duration; }
+
+private:
+	static const size_t FLOATS_PER_TRACK = 10;
+
+	std::vector<float> frames;
+	size_t frameCount = 0;
+	size_t trackCount = 0;
+	float sampleRate;
+	float duration;
+};
+
+// Joints of a skinned mesh. Parents come before their children.
+struct Skeleton
+{
+	// -1 for roots
+	std::vector<int> parents;
+
+	// Local transforms of the joints in the pose the mesh was modelled in
+	std::vector<JointTransform> bindPose;
+
+	// Moves a vertex from model space into the space of each joint in the bind pose
+	std::vector<glm::mat4x4> inverseBindMatrices;
+
+	size_t size() const { return parents.size(); }
+};
+
+// Up to four joints influencing a vertex. Weights add up to 1, unused ones are 0.
+struct SkinWeights
+{
+	uint16_t joints[4] = { 0, 0, 0, 0 };
+	float weights[4] = { 1, 0, 0, 0 };
+};
+
+// A mesh deformed by a skeleton
+struct SkinnedMesh
+{
+	Skeleton skeleton;
+
+	// vertices in the bind pose, with their unit normals
+	std::vector<Vertex> vertices;
+	std::vector<SkinWeights> weights;
+	std::vector<unsigned> indices;
+};
+
+// Computes the skinning matrix of every joint for a pose (one local transform per joint).
+// globals receives the model space transform of every joint.
+void computeSkinningPalette(const Skeleton& skeleton, const JointTransform* pose, glm::mat4x4* globals, glm::mat4x4* palette);
+
+// Linear blend skinning of the vertices [first, first + count) of a mesh into out[0, count).
+// Positions and normals are blended, colors copied. Returns the bounds of the skinned positions.
+void skinVertices(const SkinnedMesh& mesh, const glm::mat4x4* palette, size_t first, size_t count, Vertex* out,
+	glm::vec3& boundsMin, glm::vec3& boundsMax);
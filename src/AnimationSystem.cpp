@@ -0,0 +1,202 @@
+#include "AnimationSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+	float advanceTime(float time, float deltaSeconds, float speed, float duration, bool loop)
+	{
+		time += deltaSeconds * speed;
+
+		// keep looping clocks small, so they don't lose precision after playing for hours
+		if (loop && duration > 0)
+		{
+			time = std::fmod(time, duration);
+			if (time < 0)
+			{
+				time += duration;
+			}
+		}
+		return time;
+	}
+
+	template <typename Task>
+	void runBatch(JobSystem* jobs, size_t count, const Task& task)
+	{
+		if (jobs && count > 1)
+		{
+			jobs->parallelFor(count, task);
+		}
+		else
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				task(i);
+			}
+		}
+	}
+}
+
+void AnimationSystem::play(const SceneObjectPtr& object, std::shared_ptr<const SampledClip> clip, float speed, bool loop,
+	const glm::vec3& offset)
+{
+	if (!clip || clip->getTrackCount() < 1)
+	{
+		throw std::runtime_error("Object animations need a clip with a track");
+	}
+
+	auto found = objectIndices.find(object.get());
+	if (found != objectIndices.end())
+	{
+		objects[found->second] = { object, std::move(clip), 0.0f, speed, loop, offset };
+		return;
+	}
+
+	objectIndices[object.get()] = objects.size();
+	objects.push_back({ object, std::move(clip), 0.0f, speed, loop, offset });
+}
+
+void AnimationSystem::stop(const SceneObject* object)
+{
+	auto found = objectIndices.find(object);
+	if (found == objectIndices.end())
+	{
+		return;
+	}
+
+	// the last animation takes the place of the removed one
+	size_t index = found->second;
+	objectIndices.erase(found);
+	if (index + 1 != objects.size())
+	{
+		objects[index] = std::move(objects.back());
+		objectIndices[objects[index].object.get()] = index;
+	}
+	objects.pop_back();
+}
+
+SkinnedInstance& AnimationSystem::addSkinned(std::shared_ptr<const SkinnedMesh> mesh, std::shared_ptr<const SampledClip> clip, MeshResourcePtr target)
+{
+	if (!mesh || !clip || !target)
+	{
+		throw std::runtime_error("Skinned instances need a mesh, a clip and a target");
+	}
+	if (clip->getTrackCount() < mesh->skeleton.size())
+	{
+		throw std::runtime_error("Animation clip has fewer tracks than the skeleton has joints");
+	}
+	if (mesh->weights.size() != mesh->vertices.size())
+	{
+		throw std::runtime_error("Skinned mesh needs weights for every vertex");
+	}
+	for (const SkinWeights& weights : mesh->weights)
+	{
+		for (uint16_t joint : weights.joints)
+		{
+			if (joint >= mesh->skeleton.size())
+			{
+				throw std::runtime_error("Skinned mesh references a joint outside of its skeleton");
+			}
+		}
+	}
+
+	auto instance = std::make_unique<SkinnedInstance>();
+	instance->mesh = std::move(mesh);
+	instance->clip = std::move(clip);
+	instance->target = std::move(target);
+
+	size_t jointCount = instance->mesh->skeleton.size();
+	instance->pose = instance->mesh->skeleton.bindPose;
+	instance->pose.resize(instance->clip->getTrackCount());
+	instance->globals.resize(jointCount);
+	instance->palette.resize(jointCount);
+
+	MeshResource& targetMesh = *instance->target;
+	targetMesh.vertices = instance->mesh->vertices;
+	targetMesh.indices = instance->mesh->indices;
+	targetMesh.computeBounds();
+	targetMesh.updateMemoryStats();
+
+	skinnedInstances.push_back(std::move(instance));
+	chunksDirty = true;
+	return *skinnedInstances.back();
+}
+
+void AnimationSystem::buildChunks()
+{
+	chunks.clear();
+	for (auto& instance : skinnedInstances)
+	{
+		size_t vertexCount = instance->mesh->vertices.size();
+		for (size_t first = 0; first < vertexCount; first += VERTICES_PER_CHUNK)
+		{
+			size_t count = vertexCount - first < VERTICES_PER_CHUNK ? vertexCount - first : VERTICES_PER_CHUNK;
+			chunks.push_back({ instance.get(), first, count, glm::vec3(0.0f), glm::vec3(0.0f) });
+		}
+	}
+	chunksDirty = false;
+}
+
+void AnimationSystem::update(float deltaSeconds, JobSystem* jobs)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	if (chunksDirty)
+	{
+		buildChunks();
+	}
+
+	// Sample every clip. Object animations are grouped, instances are one task each.
+	size_t objectTasks = (objects.size() + OBJECTS_PER_TASK - 1) / OBJECTS_PER_TASK;
+	runBatch(jobs, objectTasks + skinnedInstances.size(), [this, deltaSeconds, objectTasks](size_t task) {
+		if (task < objectTasks)
+		{
+			size_t end = std::min(objects.size(), task * OBJECTS_PER_TASK + OBJECTS_PER_TASK);
+			for (size_t i = task * OBJECTS_PER_TASK; i < end; i++)
+			{
+				ObjectAnimation& animation = objects[i];
+				animation.time = advanceTime(animation.time, deltaSeconds, animation.speed, animation.clip->getDuration(), animation.loop);
+
+				JointTransform transform;
+				animation.clip->sample(animation.time, animation.loop, &transform);
+				animation.object->setPosition(transform.translation + animation.offset);
+				animation.object->setRotation(transform.rotation);
+				animation.object->setScale(transform.scale.x, transform.scale.y, transform.scale.z);
+			}
+			return;
+		}
+
+		SkinnedInstance& instance = *skinnedInstances[task - objectTasks];
+		instance.time = advanceTime(instance.time, deltaSeconds, instance.speed, instance.clip->getDuration(), instance.loop);
+		instance.clip->sample(instance.time, instance.loop, instance.pose.data());
+		computeSkinningPalette(instance.mesh->skeleton, instance.pose.data(), instance.globals.data(), instance.palette.data());
+	});
+
+	// Skin the vertices into the targets
+	runBatch(jobs, chunks.size(), [this](size_t task) {
+		SkinningChunk& chunk = chunks[task];
+		SkinnedInstance& instance = *chunk.instance;
+		skinVertices(*instance.mesh, instance.palette.data(), chunk.first, chunk.count,
+			&instance.target->vertices[chunk.first], chunk.boundsMin, chunk.boundsMax);
+	});
+
+	// Merge the bounds of the chunks, chunks of an instance are consecutive
+	size_t skinnedVertices = 0;
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		const SkinningChunk& chunk = chunks[i];
+		MeshResource& target = *chunk.instance->target;
+		bool firstChunk = i == 0 || chunks[i - 1].instance != chunk.instance;
+		target.boundsMin = firstChunk ? chunk.boundsMin : glm::min(target.boundsMin, chunk.boundsMin);
+		target.boundsMax = firstChunk ? chunk.boundsMax : glm::max(target.boundsMax, chunk.boundsMax);
+		skinnedVertices += chunk.count;
+	}
+
+	stats.animatedObjects = objects.size();
+	stats.skinnedInstances = skinnedInstances.size();
+	stats.skinnedVertices = skinnedVertices;
+	stats.updateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
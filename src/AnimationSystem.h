@@ -0,0 +1,105 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Animation.h"
+#include "Assets.h"
+#include "JobSystem.h"
+#include "Scene.h"
+
+// A skinned mesh playing a clip. Its target is the mesh that gets drawn, its CPU vertices
+// receive the skinned result every update.
+struct SkinnedInstance
+{
+	std::shared_ptr<const SkinnedMesh> mesh;
+	std::shared_ptr<const SampledClip> clip;
+	MeshResourcePtr target;
+
+	float time = 0;
+	float speed = 1;
+	bool loop = true;
+
+	// per-joint scratch, sized once when the instance is added
+	std::vector<JointTransform> pose;
+	std::vector<glm::mat4x4> globals;
+	std::vector<glm::mat4x4> palette;
+};
+
+struct AnimationStats
+{
+	size_t animatedObjects = 0;
+	size_t skinnedInstances = 0;
+	size_t skinnedVertices = 0;
+	double updateSeconds = 0;
+};
+
+// Advances keyframe animations every frame: clips moving scene objects, and skinned meshes.
+//
+// An update runs in two batches on a JobSystem. The first samples every clip (one task per
+// object or instance, computing the skinning palettes), the second skins the vertices in
+// fixed size chunks so a single large mesh is still spread over every thread.
+// Uploading the skinned vertices is left to the caller (see getSkinnedInstances()).
+class AnimationSystem
+{
+public:
+	// Plays a single track clip on a scene object, replacing any clip it was playing.
+	// The offset is added to the clip's translation, so one clip can move objects standing in different places.
+	void play(const SceneObjectPtr& object, std::shared_ptr<const SampledClip> clip, float speed = 1.0f, bool loop = true,
+		const glm::vec3& offset = { 0, 0, 0 });
+
+	// Stops the clip of a scene object, the object keeps its current transform
+	void stop(const SceneObject* object);
+
+	// Starts skinning a mesh into target. The clip needs a track per joint.
+	// The target's vertices and indices are set to the bind pose, ready for its buffers to be created.
+	SkinnedInstance& addSkinned(std::shared_ptr<const SkinnedMesh> mesh, std::shared_ptr<const SampledClip> clip, MeshResourcePtr target);
+
+	// Advances every animation by a number of seconds. Without a job system everything runs on the caller.
+	void update(float deltaSeconds, JobSystem* jobs = nullptr);
+
+	const std::vector<std::unique_ptr<SkinnedInstance>>& getSkinnedInstances() const { return skinnedInstances; }
+	const AnimationStats& getStats() const { return stats; }
+
+private:
+	struct ObjectAnimation
+	{
+		SceneObjectPtr object;
+		std::shared_ptr<const SampledClip> clip;
+		float time = 0;
+		float speed = 1;
+		bool loop = true;
+		glm::vec3 offset;
+	};
+
+	// A range of an instance's vertices, the unit of work of the skinning batch
+	struct SkinningChunk
+	{
+		SkinnedInstance* instance;
+		size_t first;
+		size_t count;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	static const size_t VERTICES_PER_CHUNK = 4096;
+
+	// Objects sampled per task, sampling a single object is too little work for a task
+	static const size_t OBJECTS_PER_TASK = 256;
+
+	void buildChunks();
+
+	std::vector<ObjectAnimation> objects;
+
+	// position of each animated object in objects
+	std::unordered_map<const SceneObject*, size_t> objectIndices;
+
+	std::vector<std::unique_ptr<SkinnedInstance>> skinnedInstances;
+
+	// rebuilt when instances are added
+	std::vector<SkinningChunk> chunks;
+	bool chunksDirty = false;
+
+	AnimationStats stats;
+};
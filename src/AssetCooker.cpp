@@ -0,0 +1,327 @@
+#include "AssetCooker.h"
+#include "Hash.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MeshCodec.h"
+#include "ObjLoader.h"
+#include "ScanImport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// What the manifest remembers of a source
+	struct ManifestEntry
+	{
+		uint64_t size = 0;
+		int64_t time = 0;
+		ContentHash hash;
+	};
+
+	enum class SourceState
+	{
+		UpToDate,
+		Check,
+		Cook,
+		Failed
+	};
+
+	struct Source
+	{
+		std::filesystem::path path;
+		std::string name;
+		uint64_t size = 0;
+		int64_t time = 0;
+		ContentHash hash;
+		SourceState state = SourceState::Check;
+		bool hashed = false;
+
+		// the manifest entry, if the source was cooked before with the same options
+		const ManifestEntry* previous = nullptr;
+	};
+
+	ContentHash getSettingsHash(const CookOptions& options)
+	{
+		Hasher hasher;
+		hasher.updateValue(ASSET_COOKER_VERSION);
+		hasher.updateValue(MESH_CODEC_VERSION);
+		hasher.updateValue(options.positionBits);
+		hasher.updateValue(options.weldEpsilon);
+		return hasher.finish();
+	}
+
+	bool parseHash(const std::string& hex, ContentHash& hash)
+	{
+		if (hex.size() != 32 || hex.find_first_not_of("0123456789abcdef") != std::string::npos)
+		{
+			return false;
+		}
+		hash.high = std::stoull(hex.substr(0, 16), nullptr, 16);
+		hash.low = std::stoull(hex.substr(16), nullptr, 16);
+		return true;
+	}
+
+	ContentHash hashFile(const std::filesystem::path& path)
+	{
+		// empty files can't be mapped, they hash as nothing
+		Hasher hasher;
+		MappedFile file;
+		if (file.open(path))
+		{
+			hasher.update(file.data(), file.size());
+		}
+		else if (std::filesystem::file_size(path) != 0)
+		{
+			throw std::runtime_error("Could not map " + path.string());
+		}
+		return hasher.finish();
+	}
+
+	// Reads the entries of a manifest written with the same settings. Any other manifest counts as empty.
+	// First line: "mvcook <version> <settings hash>", then one "<hash> <size> <time> <source>" line per source.
+	std::map<std::string, ManifestEntry> readManifest(const std::filesystem::path& path, const ContentHash& settings)
+	{
+		std::map<std::string, ManifestEntry> entries;
+		std::ifstream file(path);
+		std::string magic, hash;
+		uint32_t version = 0;
+		if (!(file >> magic >> version >> hash) || magic != "mvcook" || version != ASSET_COOKER_VERSION || hash != settings.toHex())
+		{
+			return entries;
+		}
+
+		std::string line;
+		std::getline(file, line);
+		while (std::getline(file, line))
+		{
+			std::istringstream s(line);
+			ManifestEntry entry;
+			std::string name;
+			if (s >> hash >> entry.size >> entry.time && parseHash(hash, entry.hash) && s.get() == ' ' && std::getline(s, name) && !name.empty())
+			{
+				entries[name] = entry;
+			}
+		}
+		return entries;
+	}
+
+	void writeManifest(const std::filesystem::path& path, const ContentHash& settings, const std::vector<Source>& sources)
+	{
+		std::filesystem::path temporary = path;
+		temporary += ".tmp";
+		{
+			std::ofstream file(temporary, std::ios::binary);
+			file << "mvcook " << ASSET_COOKER_VERSION << " " << settings.toHex() << "\n";
+			for (const Source& source : sources)
+			{
+				if (source.state != SourceState::Failed)
+				{
+					file << source.hash.toHex() << " " << source.size << " " << source.time << " " << source.name << "\n";
+				}
+			}
+			if (!file)
+			{
+				throw std::runtime_error("Could not write " + temporary.string());
+			}
+		}
+		std::filesystem::rename(temporary, path);
+	}
+}
+
+bool isCookableModel(const std::filesystem::path& path)
+{
+	std::filesystem::path extension = path.extension();
+	return extension == ".obj" || extension == ".stl" || extension == ".ply";
+}
+
+std::filesystem::path getCookedModelPath(const std::filesystem::path& relativeSource)
+{
+	std::filesystem::path cooked = relativeSource;
+	cooked += ".mvmesh";
+	return cooked;
+}
+
+void readSourceModel(const std::filesystem::path& path, std::vector<Vertex>& vertices, std::vector<unsigned>& indices,
+	const CookOptions& options, JobSystem* jobs)
+{
+	if (path.extension() == ".stl" || path.extension() == ".ply")
+	{
+		ScanImportOptions scanOptions;
+		scanOptions.weldEpsilon = options.weldEpsilon;
+		scanOptions.jobs = jobs;
+		importScan(path, vertices, indices, scanOptions);
+		return;
+	}
+
+	std::ifstream file(path);
+	if (!file)
+	{
+		throw std::runtime_error("Could not open model " + path.string());
+	}
+	parseObj(file, vertices, indices);
+	normalizeVertexNormals(vertices);
+}
+
+AssetCooker::AssetCooker(const CookOptions& options) :
+	options{ options }
+{
+}
+
+CookStats AssetCooker::run(const std::filesystem::path& sourceDirectory, const std::filesystem::path& outputDirectory, std::ostream* log)
+{
+	auto start = Clock::now();
+	if (!std::filesystem::is_directory(sourceDirectory))
+	{
+		throw std::runtime_error("Could not read source directory " + sourceDirectory.string());
+	}
+	std::filesystem::create_directories(outputDirectory);
+
+	std::unique_ptr<JobSystem> ownJobs;
+	if (options.threads > 0)
+	{
+		ownJobs = std::make_unique<JobSystem>(options.threads - 1);
+	}
+	JobSystem& jobs = ownJobs ? *ownJobs : JobSystem::getDefault();
+
+	CookStats stats;
+	stats.threads = jobs.getThreadCount();
+
+	std::vector<Source> sources;
+	for (const auto& item : std::filesystem::recursive_directory_iterator(sourceDirectory))
+	{
+		if (item.is_regular_file() && isCookableModel(item.path()))
+		{
+			Source source;
+			source.path = item.path();
+			source.name = item.path().lexically_relative(sourceDirectory).generic_string();
+			source.size = item.file_size();
+			source.time = static_cast<int64_t>(item.last_write_time().time_since_epoch().count());
+			sources.push_back(source);
+		}
+	}
+	std::sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) { return a.name < b.name; });
+	stats.sources = sources.size();
+
+	// a source is up to date when it looks the same as last time and its output is still there
+	ContentHash settings = getSettingsHash(options);
+	std::filesystem::path manifestPath = outputDirectory / ASSET_COOKER_MANIFEST;
+	std::map<std::string, ManifestEntry> manifest = readManifest(manifestPath, settings);
+	std::vector<size_t> changed;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		Source& source = sources[i];
+		auto entry = manifest.find(source.name);
+		if (entry != manifest.end() && !options.force && std::filesystem::exists(outputDirectory / getCookedModelPath(source.name)))
+		{
+			source.previous = &entry->second;
+			if (entry->second.size == source.size && entry->second.time == source.time)
+			{
+				source.state = SourceState::UpToDate;
+				source.hash = entry->second.hash;
+				continue;
+			}
+		}
+		changed.push_back(i);
+	}
+
+	std::mutex logMutex;
+	auto report = [&](const std::string& message) {
+		if (log)
+		{
+			std::lock_guard<std::mutex> lock(logMutex);
+			*log << message << std::endl;
+		}
+	};
+
+	// hash and cook together, a source whose content didn't change only gets its new time recorded
+	jobs.parallelFor(changed.size(), [&](size_t i) {
+		Source& source = sources[changed[i]];
+		try
+		{
+			source.hash = hashFile(source.path);
+			source.hashed = true;
+			if (source.previous != nullptr && source.previous->hash == source.hash)
+			{
+				source.state = SourceState::UpToDate;
+				return;
+			}
+
+			source.state = SourceState::Cook;
+			std::vector<Vertex> vertices;
+			std::vector<unsigned> indices;
+			readSourceModel(source.path, vertices, indices, options, &jobs);
+
+			std::filesystem::path output = outputDirectory / getCookedModelPath(source.name);
+			std::filesystem::path temporary = output;
+			temporary += ".tmp";
+			std::filesystem::create_directories(output.parent_path());
+
+			MeshCodecOptions codecOptions;
+			codecOptions.positionBits = options.positionBits;
+			writeMeshFile(temporary, vertices, indices, codecOptions);
+			std::filesystem::rename(temporary, output);
+
+			report("Cooked " + source.name + ": " + std::to_string(indices.size() / 3) + " triangles");
+		}
+		catch (const std::exception& e)
+		{
+			source.state = SourceState::Failed;
+			report("Failed to cook " + source.name + ": " + e.what());
+		}
+	});
+
+	for (const Source& source : sources)
+	{
+		if (source.hashed)
+		{
+			stats.hashed++;
+			stats.hashedBytes += source.size;
+		}
+
+		std::filesystem::path output = outputDirectory / getCookedModelPath(source.name);
+		std::error_code error;
+		switch (source.state)
+		{
+		case SourceState::UpToDate:
+			stats.upToDate++;
+			break;
+
+		case SourceState::Cook:
+			stats.cooked++;
+			stats.sourceBytes += source.size;
+			stats.outputBytes += std::filesystem::file_size(output, error);
+			break;
+
+		default:
+			// a stale output would be loaded as if it were current
+			stats.failed++;
+			std::filesystem::remove(output, error);
+			break;
+		}
+		manifest.erase(source.name);
+	}
+
+	// what is left in the manifest has no source anymore
+	for (const auto& entry : manifest)
+	{
+		std::error_code error;
+		if (std::filesystem::remove(outputDirectory / getCookedModelPath(entry.first), error))
+		{
+			stats.removed++;
+		}
+	}
+
+	writeManifest(manifestPath, settings, sources);
+	stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return stats;
+}
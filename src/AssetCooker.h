@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <vector>
+
+#include "Assets.h"
+
+// Version of the cooked output. Bumping it re-cooks everything.
+const uint32_t ASSET_COOKER_VERSION = 1;
+
+// Name of the file in the output directory recording what was cooked from what
+const char* const ASSET_COOKER_MANIFEST = "cook.manifest";
+
+struct CookOptions
+{
+	// Bits per position axis of the cooked meshes, see MeshCodecOptions
+	unsigned positionBits = 16;
+
+	// Positions of STL and PLY scans closer than this are welded, see ScanImportOptions
+	float weldEpsilon = 1e-5f;
+
+	// Cook every asset, even the ones that are up to date
+	bool force = false;
+
+	// Worker threads, 0 for one per hardware thread
+	unsigned threads = 0;
+};
+
+struct CookStats
+{
+	// Source models found, and what happened to them
+	size_t sources = 0;
+	size_t upToDate = 0;
+	size_t cooked = 0;
+	size_t failed = 0;
+
+	// Outputs deleted because their source is gone
+	size_t removed = 0;
+
+	// Sources whose size or time changed and were hashed, and their bytes
+	size_t hashed = 0;
+	uint64_t hashedBytes = 0;
+
+	// Bytes read and written by the cooked assets
+	uint64_t sourceBytes = 0;
+	uint64_t outputBytes = 0;
+
+	unsigned threads = 0;
+	double seconds = 0;
+
+	double getSourceBytesPerSecond() const { return seconds > 0 ? sourceBytes / seconds : 0; }
+};
+
+// Returns true for the source models the cooker converts: OBJ, STL and PLY files
+bool isCookableModel(const std::filesystem::path& path);
+
+// Where the cooked version of a model is written, relative to the output directory: the source path
+// with .mvmesh appended, so models differing only by extension don't collide. ResourceManager looks there too.
+std::filesystem::path getCookedModelPath(const std::filesystem::path& relativeSource);
+
+// Reads a source model into the vertices and indices the viewer draws: OBJ normals made into unit vectors,
+// scans welded into shared vertices. Throws std::runtime_error if the model can't be read.
+void readSourceModel(const std::filesystem::path& path, std::vector<Vertex>& vertices, std::vector<unsigned>& indices,
+	const CookOptions& options = {}, JobSystem* jobs = nullptr);
+
+// Converts a directory tree of source models into .mvmesh files, the format the viewer loads fastest
+// (decoded in parallel straight into staging memory).
+//
+// Builds are incremental. The manifest in the output directory records the size, time and content hash of
+// every source, with a hash of the options and cooker version. A source is re-cooked only when its content
+// or the options changed; one whose size or time changed is hashed first, and touching a file without
+// changing it only refreshes the manifest. Outputs of deleted sources are removed.
+// Sources are hashed and cooked in parallel, each output is written to a temporary file and renamed, so
+// an interrupted build never leaves a truncated output behind.
+class AssetCooker
+{
+public:
+	explicit AssetCooker(const CookOptions& options = {});
+
+	// Cooks the models under a directory into another. A model that fails is reported to the log and
+	// counted, the others still cook. Throws std::runtime_error if the source directory can't be read.
+	CookStats run(const std::filesystem::path& sourceDirectory, const std::filesystem::path& outputDirectory, std::ostream* log = nullptr);
+
+private:
+	CookOptions options;
+};
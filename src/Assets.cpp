@@ -0,0 +1,125 @@
+#include "Assets.h"
+#include "MeshCodec.h"
+
+#include <stdexcept>
+
+void MeshResource::setResidency(MeshResidency newResidency)
+{
+	if (newResidency == residency)
+	{
+		return;
+	}
+
+	if (residency == MeshResidency::Compressed && newResidency == MeshResidency::Full)
+	{
+		decodeMesh(compressed.data(), compressed.size(), vertices, indices);
+		std::vector<uint8_t>().swap(compressed);
+	}
+	else if (residency != MeshResidency::Full)
+	{
+		throw std::runtime_error("A mesh can only drop CPU data it still has");
+	}
+	else if (newResidency == MeshResidency::Positions)
+	{
+		positions.resize(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			positions[i] = vertices[i].position;
+		}
+		indices.shrink_to_fit();
+		std::vector<Vertex>().swap(vertices);
+	}
+	else
+	{
+		if (newResidency == MeshResidency::Compressed)
+		{
+			compressed = encodeMesh(vertices, indices);
+			compressed.shrink_to_fit();
+		}
+		std::vector<Vertex>().swap(vertices);
+		std::vector<unsigned>().swap(indices);
+	}
+
+	residency = newResidency;
+	updateMemoryStats();
+}
+
+size_t MeshResource::setCpuData(const Vertex* sourceVertices, size_t vertexCount, const unsigned* sourceIndices, size_t indexCount, MeshResidency newResidency)
+{
+	std::vector<Vertex>().swap(vertices);
+	std::vector<unsigned>().swap(indices);
+	std::vector<glm::vec3>().swap(positions);
+	std::vector<uint8_t>().swap(compressed);
+	residency = MeshResidency::Full;
+
+	size_t copied = 0;
+	if (newResidency == MeshResidency::Positions)
+	{
+		// straight from the source, the full vertices are never copied
+		positions.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			positions[i] = sourceVertices[i].position;
+		}
+		indices.assign(sourceIndices, sourceIndices + indexCount);
+		copied = vertexCount * sizeof(glm::vec3) + indexCount * sizeof(unsigned);
+		residency = MeshResidency::Positions;
+	}
+	else if (newResidency != MeshResidency::None)
+	{
+		// compressed meshes are encoded from a full copy
+		vertices.assign(sourceVertices, sourceVertices + vertexCount);
+		indices.assign(sourceIndices, sourceIndices + indexCount);
+		copied = vertexCount * sizeof(Vertex) + indexCount * sizeof(unsigned);
+	}
+
+	setResidency(newResidency);
+	updateMemoryStats();
+	return copied;
+}
+
+PositionView MeshResource::getCpuPositions() const
+{
+	PositionView view;
+	if (residency == MeshResidency::Full && !vertices.empty())
+	{
+		view.data = reinterpret_cast<const uint8_t*>(&vertices[0].position);
+		view.stride = sizeof(Vertex);
+		view.count = vertices.size();
+	}
+	else if (residency == MeshResidency::Positions && !positions.empty())
+	{
+		view.data = reinterpret_cast<const uint8_t*>(positions.data());
+		view.stride = sizeof(glm::vec3);
+		view.count = positions.size();
+	}
+	return view;
+}
+
+bool MeshResource::readCpuData(std::vector<Vertex>& outVertices, std::vector<unsigned>& outIndices, JobSystem* jobs) const
+{
+	switch (residency)
+	{
+	case MeshResidency::Full:
+		outVertices = vertices;
+		outIndices = indices;
+		return true;
+
+	case MeshResidency::Positions:
+		outVertices.clear();
+		outVertices.reserve(positions.size());
+		for (const glm::vec3& position : positions)
+		{
+			outVertices.emplace_back(position);
+		}
+		outIndices = indices;
+		return true;
+
+	case MeshResidency::Compressed:
+		decodeMesh(compressed.data(), compressed.size(), outVertices, outIndices, jobs);
+		return true;
+
+	default:
+		return false;
+	}
+}
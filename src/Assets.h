@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <vector>
+
+#include "MemoryStats.h"
 
 #define GLM_FORCE_LEFT_HANDED
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -8,6 +13,8 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
+class JobSystem;
+
 class Vertex
 {
 public:
@@ -20,6 +27,34 @@ public:
 	glm::vec3 color = { 0, 0, 0 };
 };
 
+// What a mesh keeps of its CPU vertices and indices once its buffers are created
+enum class MeshResidency
+{
+	// The vertices and indices, as they were
+	Full,
+
+	// Only the vertex positions and the indices, enough for picking, bounds and occlusion culling
+	Positions,
+
+	// A copy compressed with MeshCodec (positions quantized to 16 bits), decoded by readCpuData()
+	Compressed,
+
+	// Nothing, the mesh only lives on the GPU
+	None
+};
+
+// Positions of CPU vertices, read through a stride so they can come from full vertices or bare positions
+struct PositionView
+{
+	const uint8_t* data = nullptr;
+	size_t stride = 0;
+	size_t count = 0;
+
+	const glm::vec3& operator[](size_t i) const { return *reinterpret_cast<const glm::vec3*>(data + i * stride); }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+};
+
 // Defines a resource containing a mesh.
 // Contains the vertices, indices, and the primitives used to render it.
 struct MeshResource
@@ -29,12 +64,91 @@ struct MeshResource
 	// Default move constructor
 	MeshResource(MeshResource&& other) = default;
 
-	// CPU accessible vertices and indices
+	// CPU accessible vertices and indices. Depending on the residency, they may be gone after the upload.
 	std::vector<Vertex> vertices;
 	std::vector<unsigned> indices;
 
+	// The vertex positions kept in place of the vertices by MeshResidency::Positions
+	std::vector<glm::vec3> positions;
+
+	// The vertices and indices encoded with MeshCodec, kept in place of both by MeshResidency::Compressed
+	std::vector<uint8_t> compressed;
+
+	// Axis aligned bounds of the vertices in model space. Used for culling.
+	glm::vec3 boundsMin = { 0, 0, 0 };
+	glm::vec3 boundsMax = { 0, 0, 0 };
+
 	// Arbitrary primitive data
 	std::shared_ptr<void> primitiveBuffers;
+
+	// Optional simplified mesh rasterized in place of this one by the occlusion culler.
+	// It must lie inside this mesh, or objects visible around it would be culled.
+	std::shared_ptr<const MeshResource> occluder;
+
+	// Recalculates the bounds from the CPU vertices
+	void computeBounds()
+	{
+		computeBounds(vertices.data(), vertices.size());
+	}
+
+	// Calculates the bounds from vertices the mesh doesn't necessarily keep (eg. in staging memory)
+	void computeBounds(const Vertex* source, size_t count)
+	{
+		if (count == 0)
+		{
+			boundsMin = boundsMax = { 0, 0, 0 };
+			return;
+		}
+
+		boundsMin = boundsMax = source[0].position;
+		for (size_t i = 1; i < count; i++)
+		{
+			boundsMin = glm::min(boundsMin, source[i].position);
+			boundsMax = glm::max(boundsMax, source[i].position);
+		}
+	}
+
+	// Changes what is kept of the CPU data. Call once the buffers have been created from it.
+	// Any residency can be reached from Full, and a Compressed mesh can be decoded back to Full.
+	// Throws std::runtime_error for the other changes, the data they need is gone.
+	void setResidency(MeshResidency residency);
+
+	MeshResidency getResidency() const { return residency; }
+
+	// Replaces the CPU data with a copy of the given vertices and indices, in the form the residency keeps.
+	// Used when the geometry was loaded somewhere else, like the staging memory of its upload.
+	// Returns the bytes copied out of the given data.
+	size_t setCpuData(const Vertex* sourceVertices, size_t vertexCount, const unsigned* sourceIndices, size_t indexCount, MeshResidency residency);
+
+	// Positions of the CPU vertices, from the vertices or the kept positions. Empty for the other residencies.
+	PositionView getCpuPositions() const;
+
+	// Copies the CPU vertices and indices out under any residency, decoding the compressed copy.
+	// With Positions, only the positions of the vertices are filled in. Returns false with None.
+	bool readCpuData(std::vector<Vertex>& vertices, std::vector<unsigned>& indices, JobSystem* jobs = nullptr) const;
+
+	// Returns the number of bytes used by the CPU data, in whichever form it is kept
+	size_t getCpuBytes() const
+	{
+		return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned)
+			+ positions.capacity() * sizeof(glm::vec3) + compressed.capacity();
+	}
+
+	// Reports the current size of the CPU data to the memory stats, under the tag of each form.
+	// Call after the vertices or indices are modified.
+	void updateMemoryStats()
+	{
+		cpuMemory.set(vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned));
+		positionsMemory.set(positions.capacity() * sizeof(glm::vec3));
+		compressedMemory.set(compressed.capacity());
+	}
+
+private:
+	MeshResidency residency = MeshResidency::Full;
+
+	TrackedMemory cpuMemory{ MemoryTag::MeshCpu };
+	TrackedMemory positionsMemory{ MemoryTag::MeshCpuPositions };
+	TrackedMemory compressedMemory{ MemoryTag::MeshCpuCompressed };
 };
 
 typedef std::shared_ptr<MeshResource> MeshResourcePtr;
\ No newline at end of file
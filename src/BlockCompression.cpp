@@ -0,0 +1,715 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// Block rows compressed per task
+	const unsigned ROWS_PER_TASK = 4;
+
+	// Interpolation weights of 4 bit BC7 indices, out of 64
+	const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// The 16 texels of a block, RGBA
+	struct Block
+	{
+		uint8_t texels[16][4];
+	};
+
+	void fetchBlock(const uint8_t* rgba, unsigned width, unsigned height, unsigned blockX, unsigned blockY, Block& block)
+	{
+		for (unsigned y = 0; y < 4; y++)
+		{
+			unsigned row = std::min(blockY * 4 + y, height - 1);
+			for (unsigned x = 0; x < 4; x++)
+			{
+				unsigned column = std::min(blockX * 4 + x, width - 1);
+				memcpy(block.texels[y * 4 + x], rgba + (size_t(row) * width + column) * 4, 4);
+			}
+		}
+	}
+
+	// Finds the direction the texels vary the most along, by power iteration on their covariance.
+	// Returns the mean in center.
+	template <int Channels>
+	void findPrincipalAxis(const float (&values)[16][4], float (&center)[4], float (&axis)[4])
+	{
+		for (int c = 0; c < Channels; c++)
+		{
+			center[c] = 0;
+			for (int i = 0; i < 16; i++)
+			{
+				center[c] += values[i][c];
+			}
+			center[c] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			for (int a = 0; a < Channels; a++)
+			{
+				for (int b = 0; b < Channels; b++)
+				{
+					covariance[a][b] += (values[i][a] - center[a]) * (values[i][b] - center[b]);
+				}
+			}
+		}
+
+		// start along the diagonal, the power iteration converges in a few steps
+		for (int c = 0; c < Channels; c++)
+		{
+			axis[c] = 1.0f;
+		}
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0;
+			for (int a = 0; a < Channels; a++)
+			{
+				for (int b = 0; b < Channels; b++)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length += next[a] * next[a];
+			}
+			if (length < 1e-12f)
+			{
+				break;
+			}
+			length = std::sqrt(length);
+			for (int c = 0; c < Channels; c++)
+			{
+				axis[c] = next[c] / length;
+			}
+		}
+	}
+
+	// Places the two endpoints at the ends of the texels' spread along the axis
+	template <int Channels>
+	void findEndpoints(const float (&values)[16][4], float (&low)[4], float (&high)[4])
+	{
+		float center[4], axis[4];
+		findPrincipalAxis<Channels>(values, center, axis);
+
+		float minimum = 0, maximum = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			float t = 0;
+			for (int c = 0; c < Channels; c++)
+			{
+				t += (values[i][c] - center[c]) * axis[c];
+			}
+			minimum = std::min(minimum, t);
+			maximum = std::max(maximum, t);
+		}
+
+		for (int c = 0; c < Channels; c++)
+		{
+			low[c] = std::min(std::max(center[c] + axis[c] * minimum, 0.0f), 255.0f);
+			high[c] = std::min(std::max(center[c] + axis[c] * maximum, 0.0f), 255.0f);
+		}
+	}
+
+	// Least squares endpoints for texels with fixed interpolation weights (the share of the second endpoint)
+	template <int Channels>
+	bool solveEndpoints(const float (&values)[16][4], const float (&weights)[16], float (&low)[4], float (&high)[4])
+	{
+		float aa = 0, ab = 0, bb = 0;
+		float ax[4] = {}, bx[4] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			float b = weights[i];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < Channels; c++)
+			{
+				ax[c] += a * values[i][c];
+				bx[c] += b * values[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+		for (int c = 0; c < Channels; c++)
+		{
+			low[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / determinant, 0.0f), 255.0f);
+			high[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / determinant, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	uint16_t packRgb565(const float (&color)[4])
+	{
+		unsigned r = unsigned(color[0] * 31.0f / 255.0f + 0.5f);
+		unsigned g = unsigned(color[1] * 63.0f / 255.0f + 0.5f);
+		unsigned b = unsigned(color[2] * 31.0f / 255.0f + 0.5f);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRgb565(uint16_t packed, int (&color)[3])
+	{
+		int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// The four colors of a BC1 block with c0 > c1
+	void getBc1Palette(uint16_t c0, uint16_t c1, int (&palette)[4][3])
+	{
+		unpackRgb565(c0, palette[0]);
+		unpackRgb565(c1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	}
+
+	// Picks the closest palette color for every texel, returns the squared error.
+	// The palette lies on a line, so projecting onto it finds the closest step without comparing all four.
+	int indexBc1(const Block& block, uint16_t c0, uint16_t c1, uint32_t& indices)
+	{
+		int palette[4][3];
+		getBc1Palette(c0, c1, palette);
+
+		int axis[3], length = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			axis[c] = palette[1][c] - palette[0][c];
+			length += axis[c] * axis[c];
+		}
+		float scale = length > 0 ? 3.0f / float(length) : 0.0f;
+
+		// steps along the line from c0 to c1 and the palette entry of each
+		static const uint32_t STEP_INDEX[4] = { 0, 2, 3, 1 };
+
+		int total = 0;
+		indices = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int projection = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				projection += (block.texels[i][c] - palette[0][c]) * axis[c];
+			}
+			int step = std::min(std::max(int(float(projection) * scale + 0.5f), 0), 3);
+			uint32_t index = STEP_INDEX[step];
+
+			int error = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				int difference = block.texels[i][c] - palette[index][c];
+				error += difference * difference;
+			}
+			indices |= index << (i * 2);
+			total += error;
+		}
+		return total;
+	}
+
+	void encodeBc1(const Block& block, uint8_t* out)
+	{
+		float values[16][4];
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				values[i][c] = block.texels[i][c];
+			}
+		}
+
+		float low[4], high[4];
+		findEndpoints<3>(values, low, high);
+		uint16_t c0 = packRgb565(high);
+		uint16_t c1 = packRgb565(low);
+		uint32_t indices = 0;
+		int error = indexBc1(block, c0, c1, indices);
+
+		// one round of least squares on the chosen indices usually lowers the error
+		static const float SHARE_OF_C1[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		float weights[16];
+		for (int i = 0; i < 16; i++)
+		{
+			weights[i] = SHARE_OF_C1[(indices >> (i * 2)) & 3];
+		}
+		float refinedHigh[4], refinedLow[4];
+		if (c0 != c1 && solveEndpoints<3>(values, weights, refinedHigh, refinedLow))
+		{
+			uint16_t refined0 = packRgb565(refinedHigh);
+			uint16_t refined1 = packRgb565(refinedLow);
+			uint32_t refinedIndices = 0;
+			int refinedError = indexBc1(block, refined0, refined1, refinedIndices);
+			if (refinedError < error)
+			{
+				c0 = refined0;
+				c1 = refined1;
+				indices = refinedIndices;
+			}
+		}
+
+		// c0 > c1 selects the four color mode, swap the endpoints and their indices (0 <-> 1, 2 <-> 3)
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+			indices ^= 0x55555555u;
+		}
+		else if (c0 == c1)
+		{
+			indices = 0;
+		}
+
+		memcpy(out, &c0, 2);
+		memcpy(out + 2, &c1, 2);
+		memcpy(out + 4, &indices, 4);
+	}
+
+	// A single channel block (BC4), the alpha of BC3 and each channel of BC5
+	void encodeBc4(const Block& block, int channel, uint8_t* out)
+	{
+		int minimum = 255, maximum = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			minimum = std::min(minimum, int(block.texels[i][channel]));
+			maximum = std::max(maximum, int(block.texels[i][channel]));
+		}
+
+		out[0] = static_cast<uint8_t>(maximum);
+		out[1] = static_cast<uint8_t>(minimum);
+		uint64_t indices = 0;
+		if (maximum > minimum)
+		{
+			// eight values from max to min: index 0 is max, 1 is min, 2 to 7 are in between
+			int palette[8];
+			palette[0] = maximum;
+			palette[1] = minimum;
+			for (int i = 2; i < 8; i++)
+			{
+				palette[i] = ((8 - i) * maximum + (i - 1) * minimum) / 7;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int value = block.texels[i][channel];
+				int best = 0, bestError = INT32_MAX;
+				for (int candidate = 0; candidate < 8; candidate++)
+				{
+					int error = std::abs(value - palette[candidate]);
+					if (error < bestError)
+					{
+						bestError = error;
+						best = candidate;
+					}
+				}
+				indices |= uint64_t(best) << (i * 3);
+			}
+		}
+
+		for (int i = 0; i < 6; i++)
+		{
+			out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+
+	// Quantizes an endpoint to 7 bits per channel and a shared lowest bit, picking the bit that fits best
+	void quantizeBc7Endpoint(const float (&value)[4], int (&quantized)[4], int& pbit)
+	{
+		float bestError = 1e30f;
+		for (int p = 0; p < 2; p++)
+		{
+			int candidate[4];
+			float error = 0;
+			for (int c = 0; c < 4; c++)
+			{
+				candidate[c] = std::min(std::max(int(std::floor((value[c] - p) / 2.0f + 0.5f)), 0), 127);
+				float difference = float((candidate[c] << 1) | p) - value[c];
+				error += difference * difference;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pbit = p;
+				std::copy(candidate, candidate + 4, quantized);
+			}
+		}
+	}
+
+	// Mode 6 endpoints and indices
+	struct Bc7Block
+	{
+		int endpoints[2][4];
+		int pbits[2];
+		uint8_t indices[16];
+	};
+
+	// Picks the closest of the 16 interpolated colors for every texel, returns the squared error
+	float indexBc7(const float (&values)[16][4], Bc7Block& encoded)
+	{
+		int colors[2][4];
+		for (int e = 0; e < 2; e++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				colors[e][c] = (encoded.endpoints[e][c] << 1) | encoded.pbits[e];
+			}
+		}
+
+		int palette[16][4];
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				palette[i][c] = ((64 - BC7_WEIGHTS[i]) * colors[0][c] + BC7_WEIGHTS[i] * colors[1][c] + 32) >> 6;
+			}
+		}
+
+		float direction[4];
+		float lengthSquared = 0;
+		for (int c = 0; c < 4; c++)
+		{
+			direction[c] = float(colors[1][c] - colors[0][c]);
+			lengthSquared += direction[c] * direction[c];
+		}
+
+		float total = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			// project onto the endpoint line, then check the neighbouring indices exactly
+			int guess = 0;
+			if (lengthSquared > 0)
+			{
+				float t = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					t += (values[i][c] - colors[0][c]) * direction[c];
+				}
+				t = std::min(std::max(t / lengthSquared, 0.0f), 1.0f);
+				guess = std::min(15, int(t * 15.0f + 0.5f));
+			}
+
+			int best = guess;
+			float bestError = 1e30f;
+			for (int candidate = std::max(0, guess - 1); candidate <= std::min(15, guess + 1); candidate++)
+			{
+				float error = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					float difference = values[i][c] - palette[candidate][c];
+					error += difference * difference;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					best = candidate;
+				}
+			}
+			encoded.indices[i] = static_cast<uint8_t>(best);
+			total += bestError;
+		}
+		return total;
+	}
+
+	// Writes bits into a 128 bit block, least significant first
+	class BlockBitWriter
+	{
+	public:
+		explicit BlockBitWriter(uint8_t* out) : out{ out } { memset(out, 0, 16); }
+
+		void write(uint32_t value, unsigned count)
+		{
+			for (unsigned i = 0; i < count; i++, position++)
+			{
+				out[position / 8] |= uint8_t(((value >> i) & 1) << (position % 8));
+			}
+		}
+
+	private:
+		uint8_t* out;
+		unsigned position = 0;
+	};
+
+	class BlockBitReader
+	{
+	public:
+		explicit BlockBitReader(const uint8_t* data) : data{ data } {}
+
+		uint32_t read(unsigned count)
+		{
+			uint32_t value = 0;
+			for (unsigned i = 0; i < count; i++, position++)
+			{
+				value |= uint32_t((data[position / 8] >> (position % 8)) & 1) << i;
+			}
+			return value;
+		}
+
+	private:
+		const uint8_t* data;
+		unsigned position = 0;
+	};
+
+	void encodeBc7(const Block& block, uint8_t* out)
+	{
+		float values[16][4];
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				values[i][c] = block.texels[i][c];
+			}
+		}
+
+		float low[4], high[4];
+		findEndpoints<4>(values, low, high);
+
+		Bc7Block encoded;
+		quantizeBc7Endpoint(low, encoded.endpoints[0], encoded.pbits[0]);
+		quantizeBc7Endpoint(high, encoded.endpoints[1], encoded.pbits[1]);
+		float error = indexBc7(values, encoded);
+
+		// one round of least squares on the chosen indices
+		float weights[16];
+		for (int i = 0; i < 16; i++)
+		{
+			weights[i] = BC7_WEIGHTS[encoded.indices[i]] / 64.0f;
+		}
+		float refinedLow[4], refinedHigh[4];
+		if (error > 0 && solveEndpoints<4>(values, weights, refinedLow, refinedHigh))
+		{
+			Bc7Block refined;
+			quantizeBc7Endpoint(refinedLow, refined.endpoints[0], refined.pbits[0]);
+			quantizeBc7Endpoint(refinedHigh, refined.endpoints[1], refined.pbits[1]);
+			if (indexBc7(values, refined) < error)
+			{
+				encoded = refined;
+			}
+		}
+
+		// the first index is stored without its top bit, so it must be below 8
+		if (encoded.indices[0] >= 8)
+		{
+			std::swap(encoded.endpoints[0], encoded.endpoints[1]);
+			std::swap(encoded.pbits[0], encoded.pbits[1]);
+			for (int i = 0; i < 16; i++)
+			{
+				encoded.indices[i] = static_cast<uint8_t>(15 - encoded.indices[i]);
+			}
+		}
+
+		BlockBitWriter writer(out);
+		writer.write(1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			writer.write(encoded.endpoints[0][c], 7);
+			writer.write(encoded.endpoints[1][c], 7);
+		}
+		writer.write(encoded.pbits[0], 1);
+		writer.write(encoded.pbits[1], 1);
+		writer.write(encoded.indices[0], 3);
+		for (int i = 1; i < 16; i++)
+		{
+			writer.write(encoded.indices[i], 4);
+		}
+	}
+
+	void decodeBc1(const uint8_t* data, uint8_t (&texels)[16][4])
+	{
+		uint16_t c0, c1;
+		uint32_t indices;
+		memcpy(&c0, data, 2);
+		memcpy(&c1, data + 2, 2);
+		memcpy(&indices, data + 4, 4);
+
+		int palette[4][3];
+		getBc1Palette(c0, c1, palette);
+		for (int i = 0; i < 16; i++)
+		{
+			int index = (indices >> (i * 2)) & 3;
+			for (int c = 0; c < 3; c++)
+			{
+				texels[i][c] = static_cast<uint8_t>(palette[index][c]);
+			}
+			texels[i][3] = 255;
+		}
+	}
+
+	void decodeBc4(const uint8_t* data, int channel, uint8_t (&texels)[16][4])
+	{
+		int a0 = data[0], a1 = data[1];
+		int palette[8] = { a0, a1 };
+		if (a0 > a1)
+		{
+			for (int i = 2; i < 8; i++)
+			{
+				palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 2; i < 6; i++)
+			{
+				palette[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			indices |= uint64_t(data[2 + i]) << (i * 8);
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			texels[i][channel] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 7]);
+		}
+	}
+
+	void decodeBc7(const uint8_t* data, uint8_t (&texels)[16][4])
+	{
+		BlockBitReader reader(data);
+		if (reader.read(7) != (1 << 6))
+		{
+			// not mode 6, decoded as transparent black like invalid blocks
+			memset(texels, 0, sizeof(texels));
+			return;
+		}
+
+		int endpoints[2][4];
+		for (int c = 0; c < 4; c++)
+		{
+			endpoints[0][c] = reader.read(7) << 1;
+			endpoints[1][c] = reader.read(7) << 1;
+		}
+		int p0 = reader.read(1), p1 = reader.read(1);
+		for (int c = 0; c < 4; c++)
+		{
+			endpoints[0][c] |= p0;
+			endpoints[1][c] |= p1;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int weight = BC7_WEIGHTS[reader.read(i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; c++)
+			{
+				texels[i][c] = static_cast<uint8_t>(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+			}
+		}
+	}
+}
+
+size_t getBlockSize(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t getCompressedSize(BlockFormat format, unsigned width, unsigned height)
+{
+	return size_t((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+void compressImage(BlockFormat format, const uint8_t* rgba, unsigned width, unsigned height, uint8_t* blocks, JobSystem* jobs)
+{
+	const unsigned blocksX = (width + 3) / 4;
+	const unsigned blocksY = (height + 3) / 4;
+	const size_t blockSize = getBlockSize(format);
+
+	auto compressRows = [&](size_t task) {
+		unsigned first = static_cast<unsigned>(task * ROWS_PER_TASK);
+		unsigned end = std::min(blocksY, first + ROWS_PER_TASK);
+		Block block;
+		for (unsigned blockY = first; blockY < end; blockY++)
+		{
+			for (unsigned blockX = 0; blockX < blocksX; blockX++)
+			{
+				fetchBlock(rgba, width, height, blockX, blockY, block);
+				uint8_t* out = blocks + (size_t(blockY) * blocksX + blockX) * blockSize;
+				switch (format)
+				{
+				case BlockFormat::BC1:
+					encodeBc1(block, out);
+					break;
+				case BlockFormat::BC3:
+					encodeBc4(block, 3, out);
+					encodeBc1(block, out + 8);
+					break;
+				case BlockFormat::BC5:
+					encodeBc4(block, 0, out);
+					encodeBc4(block, 1, out + 8);
+					break;
+				case BlockFormat::BC7:
+					encodeBc7(block, out);
+					break;
+				}
+			}
+		}
+	};
+
+	size_t tasks = (blocksY + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+	if (jobs && tasks > 1)
+	{
+		jobs->parallelFor(tasks, compressRows);
+	}
+	else
+	{
+		for (size_t task = 0; task < tasks; task++)
+		{
+			compressRows(task);
+		}
+	}
+}
+
+void decompressImage(BlockFormat format, const uint8_t* blocks, unsigned width, unsigned height, uint8_t* rgba)
+{
+	const unsigned blocksX = (width + 3) / 4;
+	const unsigned blocksY = (height + 3) / 4;
+	const size_t blockSize = getBlockSize(format);
+
+	for (unsigned blockY = 0; blockY < blocksY; blockY++)
+	{
+		for (unsigned blockX = 0; blockX < blocksX; blockX++)
+		{
+			const uint8_t* data = blocks + (size_t(blockY) * blocksX + blockX) * blockSize;
+			uint8_t texels[16][4];
+			switch (format)
+			{
+			case BlockFormat::BC1:
+				decodeBc1(data, texels);
+				break;
+			case BlockFormat::BC3:
+				decodeBc1(data + 8, texels);
+				decodeBc4(data, 3, texels);
+				break;
+			case BlockFormat::BC5:
+				for (int i = 0; i < 16; i++)
+				{
+					texels[i][2] = 0;
+					texels[i][3] = 255;
+				}
+				decodeBc4(data, 0, texels);
+				decodeBc4(data + 8, 1, texels);
+				break;
+			case BlockFormat::BC7:
+				decodeBc7(data, texels);
+				break;
+			}
+
+			for (unsigned y = 0; y < 4 && blockY * 4 + y < height; y++)
+			{
+				for (unsigned x = 0; x < 4 && blockX * 4 + x < width; x++)
+				{
+					memcpy(rgba + (size_t(blockY * 4 + y) * width + blockX * 4 + x) * 4, texels[y * 4 + x], 4);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "JobSystem.h"
+
+// GPU block compression formats. Every format stores 4x4 texel blocks.
+enum class BlockFormat
+{
+	// RGB at 4 bits per texel, no alpha
+	BC1,
+
+	// RGB like BC1 plus a separate alpha block, 8 bits per texel
+	BC3,
+
+	// Two independent channels (red and green), 8 bits per texel. For normal maps.
+	BC5,
+
+	// RGBA at 8 bits per texel with much better quality than BC1/BC3. Only mode 6 (one subset,
+	// 7 bit endpoints with a shared bit, 4 bit indices) is written.
+	BC7
+};
+
+// Returns the bytes of a 4x4 block
+size_t getBlockSize(BlockFormat format);
+
+// Returns the bytes of an image of the format, partial blocks at the edges count as whole
+size_t getCompressedSize(BlockFormat format, unsigned width, unsigned height);
+
+// Compresses RGBA8 pixels (rows top to bottom, no padding) into blocks, stored row after row.
+// Blocks past the edge of the image repeat its last row and column.
+// Rows of blocks are spread across the job system.
+void compressImage(BlockFormat format, const uint8_t* rgba, unsigned width, unsigned height, uint8_t* blocks, JobSystem* jobs = nullptr);
+
+// Decodes blocks made by compressImage() back into RGBA8, to measure the quality.
+// BC5 decodes to red and green with blue 0 and alpha 255. BC7 only decodes mode 6.
+void decompressImage(BlockFormat format, const uint8_t* blocks, unsigned width, unsigned height, uint8_t* rgba);
@@ -18,6 +18,9 @@ public:
 		this->fov = fov;
 	}
 
+	// Returns the vertical fov in degrees
+	float getFov() const { return fov; }
+
 	// Sets the camera's aspect ratio. Use when the rendering area is resized
 	void setAspectRatio(float aspectRatio)
 	{
@@ -37,6 +40,9 @@ public:
 		this->farZ = farZ;
 	}
 
+	float getNearZ() const { return nearZ; }
+	float getFarZ() const { return farZ; }
+
 	// Returns the view projection matrix that can be used to modify all other objects to
 	// be within range of the camera in the aspect ratio.
 	// Because of how often a camera is expected to update, this value is not cached.
@@ -1,6 +1,7 @@
 #include "DX11Interface.h"
 
-#include <iostream>
+#include "Logger.h"
+#include "RenderStats.h"
 
 
 #include <comdef.h>
@@ -25,7 +26,7 @@ void DX11Interface::initialize(HWND hwnd, unsigned width, unsigned height, bool
 	// Read adapters. For now we pick the default one
 	auto adapters = readAdapters();
 	this->adapter = adapters[0];
-	std::cout << "There are " << adapters.size() << " adapters. Picking the first one" << std::endl;
+	LOG_INFO("There are {} adapters. Picking the first one", adapters.size());
 
 	D3D_FEATURE_LEVEL featureLevelInputs[7] =
 	{
@@ -103,7 +104,7 @@ void DX11Interface::initialize(HWND hwnd, unsigned width, unsigned height, bool
 	{
 		D3D11_SAMPLER_DESC samplerDesc;
 		ZeroMemory(&samplerDesc, sizeof(D3D11_SAMPLER_DESC));
-		samplerDesc.Filter = D3D11_FILTER_MIN_MAG_POINT_MIP_LINEAR; // texture scaling?
+		samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR; // trilinear, textures come with their mips
 		samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
 		samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
 		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -211,6 +212,17 @@ void DX11Interface::updateViewport(unsigned width, unsigned height)
 	context->RSSetViewports(1, &viewport);
 }
 
+void DX11Interface::setViewport(float x, float y, float width, float height)
+{
+	D3D11_VIEWPORT part = viewport;
+	part.TopLeftX = x;
+	part.TopLeftY = y;
+	part.Width = width;
+	part.Height = height;
+
+	context->RSSetViewports(1, &part);
+}
+
 std::vector<AdapterData> DX11Interface::readAdapters()
 {
 	std::vector<AdapterData> adapters;
@@ -271,19 +283,22 @@ VertexBufferPtr DX11Interface::createVertexBuffer(const void* verticesPtr, unsig
 		&buffer
 	));
 
+	RenderStats::add(RenderCounter::BufferUploads);
+	RenderStats::add(RenderCounter::BufferUploadBytes, vertexBufferDesc.ByteWidth);
 	return std::make_shared<VertexBuffer>(buffer, numVertices, strideU);
 }
 
 IndexBufferPtr DX11Interface::createIndexBuffer(const unsigned* indicesPtr, unsigned numIndices)
 {
-	static D3D11_BUFFER_DESC indexBufferDesc = {
+	// note: must not be static, every index buffer has its own size and data
+	D3D11_BUFFER_DESC indexBufferDesc = {
 		sizeof(unsigned) * numIndices,
 		D3D11_USAGE_DEFAULT,
 		D3D11_BIND_INDEX_BUFFER,
 		0, 0, 0 // flags and stride all 0
 		};
 
-	static D3D11_SUBRESOURCE_DATA indexBufferData = {
+	D3D11_SUBRESOURCE_DATA indexBufferData = {
 		indicesPtr,
 		0,
 		0
@@ -296,5 +311,301 @@ IndexBufferPtr DX11Interface::createIndexBuffer(const unsigned* indicesPtr, unsi
 		&buffer
 	));
 
+	RenderStats::add(RenderCounter::BufferUploads);
+	RenderStats::add(RenderCounter::BufferUploadBytes, indexBufferDesc.ByteWidth);
+
 	return std::make_shared<IndexBuffer>(buffer, numIndices);
 }
+
+VertexBufferPtr DX11Interface::createDynamicVertexBuffer(unsigned numVertices, size_t stride)
+{
+	unsigned strideU = static_cast<unsigned>(stride);
+
+	D3D11_BUFFER_DESC vertexBufferDesc;
+	ZeroMemory(&vertexBufferDesc, sizeof(D3D11_BUFFER_DESC));
+	vertexBufferDesc.ByteWidth = strideU * numVertices;
+	vertexBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	ID3D11Buffer* buffer;
+	ThrowIfFailed(device->CreateBuffer(
+		&vertexBufferDesc,
+		nullptr,
+		&buffer
+	));
+
+	return std::make_shared<VertexBuffer>(buffer, numVertices, strideU);
+}
+
+void DX11Interface::updateDynamicVertexBuffer(const VertexBuffer& vertexBuffer, const void* data, size_t bytes)
+{
+	D3D11_MAPPED_SUBRESOURCE resource;
+	ThrowIfFailed(context->Map(vertexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
+	CopyMemory(resource.pData, data, bytes);
+	context->Unmap(vertexBuffer.get(), 0);
+
+	RenderStats::add(RenderCounter::BufferUploads);
+	RenderStats::add(RenderCounter::BufferUploadBytes, bytes);
+}
+
+void DX11Interface::updateVertexBufferRange(const VertexBuffer& vertexBuffer, const void* data, size_t offset, size_t bytes)
+{
+	D3D11_BOX box = { static_cast<unsigned>(offset), 0, 0, static_cast<unsigned>(offset + bytes), 1, 1 };
+	context->UpdateSubresource(vertexBuffer.get(), 0, &box, data, 0, 0);
+
+	RenderStats::add(RenderCounter::BufferUploads);
+	RenderStats::add(RenderCounter::BufferUploadBytes, bytes);
+}
+
+namespace
+{
+	DXGI_FORMAT getTextureFormat(BlockFormat format, bool srgb)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+		case BlockFormat::BC3: return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+		case BlockFormat::BC5: return DXGI_FORMAT_BC5_UNORM; // two channel data, never sRGB
+		default: return srgb ? DXGI_FORMAT_BC7_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM;
+		}
+	}
+}
+
+TexturePtr DX11Interface::createTexture(const CompressedTexture& texture)
+{
+	D3D11_TEXTURE2D_DESC textureDesc;
+	ZeroMemory(&textureDesc, sizeof(D3D11_TEXTURE2D_DESC));
+	textureDesc.Width = texture.width;
+	textureDesc.Height = texture.height;
+	textureDesc.MipLevels = static_cast<unsigned>(texture.levels.size());
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = getTextureFormat(texture.format, texture.srgb);
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	// one subresource per mip, the pitch is a row of 4x4 blocks
+	std::vector<D3D11_SUBRESOURCE_DATA> levelData;
+	size_t blockSize = getBlockSize(texture.format);
+	for (const TextureLevel& level : texture.levels)
+	{
+		unsigned blocksX = (level.width + 3) / 4;
+		unsigned blocksY = (level.height + 3) / 4;
+
+		D3D11_SUBRESOURCE_DATA data;
+		data.pSysMem = &texture.data[level.offset];
+		data.SysMemPitch = static_cast<unsigned>(blocksX * blockSize);
+		data.SysMemSlicePitch = static_cast<unsigned>(blocksX * blocksY * blockSize);
+		levelData.push_back(data);
+	}
+
+	ID3D11Texture2D* resource;
+	ThrowIfFailed(device->CreateTexture2D(&textureDesc, levelData.data(), &resource));
+
+	ID3D11ShaderResourceView* view;
+	ThrowIfFailed(device->CreateShaderResourceView(resource, nullptr, &view));
+
+	RenderStats::add(RenderCounter::BufferUploads);
+	RenderStats::add(RenderCounter::BufferUploadBytes, texture.data.size());
+	return std::make_shared<Texture>(resource, view, texture.width, texture.height, texture.data.size());
+}
+
+TexturePtr DX11Interface::createTexture(const uint8_t* rgba, unsigned width, unsigned height, bool srgb)
+{
+	D3D11_TEXTURE2D_DESC textureDesc;
+	ZeroMemory(&textureDesc, sizeof(D3D11_TEXTURE2D_DESC));
+	textureDesc.Width = width;
+	textureDesc.Height = height;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA data = { rgba, width * 4, 0 };
+
+	ID3D11Texture2D* resource;
+	ThrowIfFailed(device->CreateTexture2D(&textureDesc, &data, &resource));
+
+	ID3D11ShaderResourceView* view;
+	ThrowIfFailed(device->CreateShaderResourceView(resource, nullptr, &view));
+
+	RenderStats::add(RenderCounter::BufferUploads);
+	RenderStats::add(RenderCounter::BufferUploadBytes, size_t(width) * height * 4);
+	return std::make_shared<Texture>(resource, view, width, height, size_t(width) * height * 4);
+}
+
+GrowableBuffer::GrowableBuffer(ID3D11Device* device, ID3D11DeviceContext* context, unsigned bindFlags, unsigned initialCapacity) :
+	device{ device }, context{ context }, bindFlags{ bindFlags }
+{
+	reserve(initialCapacity);
+}
+
+void GrowableBuffer::reserve(unsigned bytes)
+{
+	if (bytes <= allocated)
+	{
+		return;
+	}
+
+	// grow geometrically so appending stays linear overall
+	unsigned newCapacity = allocated + allocated / 2;
+	if (newCapacity < bytes)
+	{
+		newCapacity = bytes;
+	}
+
+	D3D11_BUFFER_DESC desc;
+	ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
+	desc.ByteWidth = newCapacity;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = bindFlags;
+
+	ComPtr<ID3D11Buffer> newBuffer;
+	ThrowIfFailed(device->CreateBuffer(&desc, nullptr, newBuffer.GetAddressOf()));
+
+	// copy the old contents on the GPU
+	if (buffer && used > 0)
+	{
+		D3D11_BOX box = { 0, 0, 0, used, 1, 1 };
+		context->CopySubresourceRegion(newBuffer.Get(), 0, 0, 0, 0, buffer.Get(), 0, &box);
+	}
+
+	buffer = newBuffer;
+	allocated = newCapacity;
+}
+
+void GrowableBuffer::append(const void* data, unsigned bytes)
+{
+	if (bytes == 0)
+	{
+		return;
+	}
+
+	reserve(used + bytes);
+	update(used, data, bytes);
+	used += bytes;
+}
+
+void GrowableBuffer::update(unsigned offset, const void* data, unsigned bytes)
+{
+	if (bytes == 0)
+	{
+		return;
+	}
+
+	D3D11_BOX box = { offset, 0, 0, offset + bytes, 1, 1 };
+	context->UpdateSubresource(buffer.Get(), 0, &box, data, 0, 0);
+
+	RenderStats::add(RenderCounter::BufferUploads);
+	RenderStats::add(RenderCounter::BufferUploadBytes, bytes);
+}
+
+D3D11GeometryUploader::~D3D11GeometryUploader()
+{
+	unmapStaging();
+}
+
+void* D3D11GeometryUploader::mapStaging(ComPtr<ID3D11Buffer>& buffer, unsigned& capacity, unsigned bytes)
+{
+	if (!buffer || capacity < bytes)
+	{
+		// grow geometrically, loading a few meshes of increasing size reallocates rarely
+		unsigned newCapacity = capacity + capacity / 2;
+		if (newCapacity < bytes)
+		{
+			newCapacity = bytes;
+		}
+
+		// readable too, the loaders read back what they wrote (eg. positions when adding up normals)
+		D3D11_BUFFER_DESC desc;
+		ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
+		desc.ByteWidth = newCapacity > 0 ? newCapacity : 1;
+		desc.Usage = D3D11_USAGE_STAGING;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ | D3D11_CPU_ACCESS_WRITE;
+
+		buffer.Reset();
+		ThrowIfFailed(device->CreateBuffer(&desc, nullptr, buffer.GetAddressOf()));
+		capacity = newCapacity;
+		memory.set(size_t(vertexCapacity) + indexCapacity);
+
+		UploadStats::add(UploadCounter::StagingAllocations);
+		UploadStats::add(UploadCounter::StagingBytes, desc.ByteWidth);
+	}
+
+	D3D11_MAPPED_SUBRESOURCE resource;
+	ThrowIfFailed(context->Map(buffer.Get(), 0, D3D11_MAP_READ_WRITE, 0, &resource));
+	return resource.pData;
+}
+
+void D3D11GeometryUploader::unmapStaging()
+{
+	if (mapped)
+	{
+		context->Unmap(vertexStaging.Get(), 0);
+		context->Unmap(indexStaging.Get(), 0);
+		mapped = false;
+	}
+}
+
+GeometryStaging D3D11GeometryUploader::allocateStaging(size_t vertexCount, size_t indexCount)
+{
+	GeometryStaging staging;
+	staging.vertexCount = vertexCount;
+	staging.indexCount = indexCount;
+	staging.vertices = static_cast<Vertex*>(mapStaging(vertexStaging, vertexCapacity, static_cast<unsigned>(vertexCount * sizeof(Vertex))));
+	try
+	{
+		staging.indices = static_cast<unsigned*>(mapStaging(indexStaging, indexCapacity, static_cast<unsigned>(indexCount * sizeof(unsigned))));
+	}
+	catch (...)
+	{
+		context->Unmap(vertexStaging.Get(), 0);
+		throw;
+	}
+
+	mapped = true;
+	return staging;
+}
+
+ID3D11Buffer* D3D11GeometryUploader::copyFromStaging(ID3D11Buffer* staging, unsigned bytes, unsigned bindFlags)
+{
+	D3D11_BUFFER_DESC desc;
+	ZeroMemory(&desc, sizeof(D3D11_BUFFER_DESC));
+	desc.ByteWidth = bytes;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = bindFlags;
+
+	ID3D11Buffer* buffer;
+	ThrowIfFailed(device->CreateBuffer(&desc, nullptr, &buffer));
+
+	D3D11_BOX box = { 0, 0, 0, bytes, 1, 1 };
+	context->CopySubresourceRegion(buffer, 0, 0, 0, 0, staging, 0, &box);
+
+	RenderStats::add(RenderCounter::BufferUploads);
+	RenderStats::add(RenderCounter::BufferUploadBytes, bytes);
+	UploadStats::add(UploadCounter::GpuCopiedBytes, bytes);
+	return buffer;
+}
+
+std::shared_ptr<void> D3D11GeometryUploader::createBuffers(const GeometryStaging& staging)
+{
+	unmapStaging();
+
+	unsigned vertexCount = static_cast<unsigned>(staging.vertexCount);
+	unsigned indexCount = static_cast<unsigned>(staging.indexCount);
+
+	auto buffers = std::make_shared<D3D11PrimitiveBuffers>();
+	buffers->vertexBuffer = std::make_shared<VertexBuffer>(
+		copyFromStaging(vertexStaging.Get(), vertexCount * unsigned(sizeof(Vertex)), D3D11_BIND_VERTEX_BUFFER), vertexCount, unsigned(sizeof(Vertex)));
+	buffers->indexBuffer = std::make_shared<IndexBuffer>(
+		copyFromStaging(indexStaging.Get(), indexCount * unsigned(sizeof(unsigned)), D3D11_BIND_INDEX_BUFFER), indexCount);
+	return buffers;
+}
+
+void D3D11GeometryUploader::releaseStaging(const GeometryStaging&)
+{
+	unmapStaging();
+}
@@ -10,6 +10,9 @@
 
 #include "Shaders.h"
 #include "Assets.h"
+#include "GeometryUpload.h"
+#include "MemoryStats.h"
+#include "TextureCache.h"
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
@@ -32,8 +35,10 @@ class VertexBuffer
 {
 public:
 	VertexBuffer(ID3D11Buffer* buffer, unsigned numVertices, unsigned stride):
-		buffer{ buffer }, numVertices{ numVertices }, stride{ stride } {}
+		buffer{ buffer }, numVertices{ numVertices }, stride{ stride },
+		memory{ MemoryTag::GpuBuffer, size_t(numVertices) * stride } {}
 
+	ID3D11Buffer* get() const { return buffer.Get(); }
 	ID3D11Buffer* const* getBufferPtr() const { return buffer.GetAddressOf(); }
 	const unsigned* getStridePtr() const { return &stride; }
 	const unsigned* getOffsetPtr() const { return &offset; }
@@ -43,6 +48,7 @@ private:
 	const unsigned numVertices;
 	const unsigned stride;
 	const unsigned offset = 0;
+	TrackedMemory memory;
 };
 
 // Encapsulates an index buffer, which is used to connect vertices into triangles.
@@ -51,7 +57,8 @@ class IndexBuffer
 {
 public:
 	IndexBuffer(ID3D11Buffer* buffer, unsigned numIndices) :
-		buffer{ buffer }, numIndices{ numIndices } {}
+		buffer{ buffer }, numIndices{ numIndices },
+		memory{ MemoryTag::GpuBuffer, size_t(numIndices) * sizeof(unsigned) } {}
 
 	// Returns a pointer to the managed low level buffer
 	ID3D11Buffer* get() const { return buffer.Get(); }
@@ -65,9 +72,31 @@ public:
 private:
 	ComPtr<ID3D11Buffer> buffer;
 	const unsigned numIndices;
+	TrackedMemory memory;
 };
 
 
+// A 2D texture with its mips and the shader resource view used to bind it to a pixel shader
+class Texture
+{
+public:
+	Texture(ID3D11Texture2D* texture, ID3D11ShaderResourceView* view, unsigned width, unsigned height, size_t bytes) :
+		texture{ texture }, view{ view }, width{ width }, height{ height },
+		memory{ MemoryTag::GpuTexture, bytes } {}
+
+	ID3D11ShaderResourceView* const* getViewPtr() const { return view.GetAddressOf(); }
+
+	unsigned getWidth() const { return width; }
+	unsigned getHeight() const { return height; }
+
+private:
+	ComPtr<ID3D11Texture2D> texture;
+	ComPtr<ID3D11ShaderResourceView> view;
+	const unsigned width;
+	const unsigned height;
+	TrackedMemory memory;
+};
+
 // Class used to encapsulate a constant buffer.
 // Constant buffers are a way of passing global data (like the model view projection matrix)
 // to a shader.
@@ -76,7 +105,8 @@ class ConstantBuffer
 {
 public:
 	ConstantBuffer(ComPtr<ID3D11DeviceContext> context, ID3D11Buffer* buffer, unsigned blockSize):
-		context{ context }, buffer{ buffer }, blockSize{ blockSize } {}
+		context{ context }, buffer{ buffer }, blockSize{ blockSize },
+		memory{ MemoryTag::GpuBuffer, blockSize } {}
 
 	ID3D11Buffer* const* getBufferPtr() const { return buffer.GetAddressOf(); }
 	unsigned sizeOf() const { return blockSize;  }
@@ -96,10 +126,79 @@ private:
 	ComPtr<ID3D11DeviceContext> context;
 	ComPtr<ID3D11Buffer> buffer;
 	const unsigned blockSize;
+	TrackedMemory memory;
+};
+
+// A GPU buffer that can be appended to, used to upload meshes while they are still loading.
+// When it is full a larger buffer is created and the contents are copied over on the GPU,
+// so no CPU copy of the data has to be kept.
+// Memory is reported by the VertexBuffer/IndexBuffer views created over it, not by this class.
+class GrowableBuffer
+{
+public:
+	GrowableBuffer(ID3D11Device* device, ID3D11DeviceContext* context, unsigned bindFlags, unsigned initialCapacity);
+
+	// Adds data after the current contents, growing the buffer if needed
+	void append(const void* data, unsigned bytes);
+
+	// Overwrites part of the current contents
+	void update(unsigned offset, const void* data, unsigned bytes);
+
+	ID3D11Buffer* get() const { return buffer.Get(); }
+
+	// Returns the number of bytes written so far
+	unsigned size() const { return used; }
+
+	unsigned capacity() const { return allocated; }
+
+private:
+	void reserve(unsigned bytes);
+
+	ComPtr<ID3D11Device> device;
+	ComPtr<ID3D11DeviceContext> context;
+	ComPtr<ID3D11Buffer> buffer;
+	const unsigned bindFlags;
+	unsigned used = 0;
+	unsigned allocated = 0;
+};
+
+// Uploads geometry through staging buffers that stay mapped while the loader writes into them.
+// The GPU then copies them into the final buffers, so the CPU writes each byte once.
+// The staging buffers are kept for the next uploads and grown when needed. Mapping them again
+// waits for the GPU to finish copying out of them.
+class D3D11GeometryUploader : public GeometryUploader
+{
+public:
+	D3D11GeometryUploader(ID3D11Device* device, ID3D11DeviceContext* context) :
+		device{ device }, context{ context } {}
+	~D3D11GeometryUploader();
+
+protected:
+	GeometryStaging allocateStaging(size_t vertexCount, size_t indexCount) override;
+	std::shared_ptr<void> createBuffers(const GeometryStaging& staging) override;
+	void releaseStaging(const GeometryStaging& staging) override;
+
+private:
+	// Grows a staging buffer to at least a number of bytes and maps it
+	void* mapStaging(ComPtr<ID3D11Buffer>& buffer, unsigned& capacity, unsigned bytes);
+	void unmapStaging();
+
+	// Creates a buffer and has the GPU copy the first bytes of a staging buffer into it
+	ID3D11Buffer* copyFromStaging(ID3D11Buffer* staging, unsigned bytes, unsigned bindFlags);
+
+	ComPtr<ID3D11Device> device;
+	ComPtr<ID3D11DeviceContext> context;
+	ComPtr<ID3D11Buffer> vertexStaging;
+	ComPtr<ID3D11Buffer> indexStaging;
+	unsigned vertexCapacity = 0;
+	unsigned indexCapacity = 0;
+	bool mapped = false;
+	TrackedMemory memory{ MemoryTag::GpuBuffer };
 };
 
 typedef std::shared_ptr<VertexBuffer> VertexBufferPtr;
 typedef std::shared_ptr<IndexBuffer> IndexBufferPtr;
+typedef std::shared_ptr<Texture> TexturePtr;
 
 template <typename T>
 using ConstantBufferPtr = std::shared_ptr<ConstantBuffer<T>>;
@@ -132,6 +231,9 @@ public:
 	// Clears the view to a specific color. Call before each render
 	void clearView(std::array<float, 4> color);
 
+	// Draws into a rectangle of the render target (in pixels) until the next resize
+	void setViewport(float x, float y, float width, float height);
+
 	// Presents the rendered view for display.
 	// Supply a vsync flag if the presentation should wait for vertical sync.
 	void present(bool vsync);
@@ -160,13 +262,32 @@ public:
 	VertexBufferPtr createVertexBuffer(const void* verticesPtr, unsigned numVertices, size_t stride);
 	IndexBufferPtr createIndexBuffer(const unsigned* indicesPtr, unsigned numIndices);
 
+	// Creates a vertex buffer the CPU rewrites every frame (eg. skinned meshes), its contents start undefined
+	VertexBufferPtr createDynamicVertexBuffer(unsigned numVertices, size_t stride);
+
+	// Replaces the contents of a dynamic vertex buffer. Map/discard, so the GPU can keep reading the previous contents.
+	void updateDynamicVertexBuffer(const VertexBuffer& vertexBuffer, const void* data, size_t bytes);
+
+	// Overwrites part of a vertex buffer created by createVertexBuffer(), offset and bytes in bytes.
+	// The driver takes a copy, so the GPU can keep drawing the previous contents.
+	void updateVertexBufferRange(const VertexBuffer& vertexBuffer, const void* data, size_t offset, size_t bytes);
+
+	// Creates an immutable texture from block compressed levels, the first level is the largest
+	TexturePtr createTexture(const CompressedTexture& texture);
+
+	// Creates an immutable texture without mips from RGBA8 pixels (eg. placeholder textures)
+	TexturePtr createTexture(const uint8_t* rgba, unsigned width, unsigned height, bool srgb);
+
+	// Returns the sampler state used by the pixel shader to sample textures
+	ID3D11SamplerState* const* getSamplerStatePtr() const { return samplerState.GetAddressOf(); }
+
 	template <typename T>
 	inline VertexBufferPtr createVertexBuffer(const std::vector<T>& vertices)
 	{
 		return createVertexBuffer(vertices.data(), vertices.size(), sizeof(T));
 	}
 
-	inline IndexBufferPtr createIndexBuffer(const std::vector<unsigned> indices)
+	inline IndexBufferPtr createIndexBuffer(const std::vector<unsigned>& indices)
 	{
 		return createIndexBuffer(indices.data(), indices.size());
 	}
@@ -0,0 +1,74 @@
+#include "FrameAllocator.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+	size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+LinearArena::LinearArena(size_t capacity) :
+	block{ new char[capacity] }, capacity{ capacity }, memory{ MemoryTag::FrameTransient, capacity }
+{
+}
+
+void* LinearArena::allocate(size_t bytes, size_t alignment)
+{
+	// align the absolute address, the block itself only guarantees max_align_t
+	uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+	size_t offset = alignUp(base + used, alignment) - base;
+
+	if (offset + bytes <= capacity)
+	{
+		used = offset + bytes;
+		return block.get() + offset;
+	}
+
+	// Doesn't fit. Serve it from its own heap block until the next reset grows the arena.
+	std::unique_ptr<char[]> overflow(new char[bytes + alignment]);
+	uintptr_t overflowBase = reinterpret_cast<uintptr_t>(overflow.get());
+	void* result = overflow.get() + (alignUp(overflowBase, alignment) - overflowBase);
+
+	overflowUsed += bytes + alignment;
+	overflowBlocks.push_back(std::move(overflow));
+	return result;
+}
+
+void LinearArena::reset()
+{
+	size_t total = getUsed();
+	highWater = std::max(highWater, total);
+
+	if (!overflowBlocks.empty())
+	{
+		// grow with some headroom so slowly increasing frames don't grow every time
+		capacity = alignUp(total + total / 2, 4096);
+		block.reset(new char[capacity]);
+		memory.set(capacity);
+		growCount++;
+
+		overflowBlocks.clear();
+		overflowBlocks.shrink_to_fit();
+	}
+
+	used = 0;
+	overflowUsed = 0;
+}
+
+FrameArena::FrameArena(size_t capacityPerFrame)
+{
+	for (auto& arena : arenas)
+	{
+		arena = std::make_unique<LinearArena>(capacityPerFrame);
+	}
+}
+
+void FrameArena::beginFrame()
+{
+	frameIndex = (frameIndex + 1) % FRAMES_IN_FLIGHT;
+	arenas[frameIndex]->reset();
+}
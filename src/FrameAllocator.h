@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "MemoryStats.h"
+
+// Linear (bump) allocator. Allocations are carved sequentially out of a single block
+// and are all freed at once by reset(); individual deallocations do nothing.
+// When a frame needs more than the block holds, the extra requests are served from overflow
+// blocks on the heap, and the next reset() grows the main block so the following frames fit.
+// Not thread safe, use one arena per thread.
+class LinearArena
+{
+public:
+	explicit LinearArena(size_t capacity = 64 * 1024);
+	LinearArena(const LinearArena& other) = delete;
+	LinearArena& operator=(const LinearArena& other) = delete;
+
+	// Returns memory for the given size and alignment (which must be a power of two)
+	void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+	// Frees every allocation. Grows the block if the previous use overflowed it.
+	void reset();
+
+	// Bytes handed out since the last reset, including overflow
+	size_t getUsed() const { return used + overflowUsed; }
+
+	size_t getCapacity() const { return capacity; }
+
+	// Largest getUsed() seen at a reset
+	size_t getHighWater() const { return highWater; }
+
+	// Number of times the main block had to be grown
+	unsigned getGrowCount() const { return growCount; }
+
+private:
+	std::unique_ptr<char[]> block;
+	size_t capacity;
+	size_t used = 0;
+
+	std::vector<std::unique_ptr<char[]>> overflowBlocks;
+	size_t overflowUsed = 0;
+
+	size_t highWater = 0;
+	unsigned growCount = 0;
+
+	TrackedMemory memory;
+};
+
+// A ring of arenas, one per frame in flight.
+// Data allocated during a frame stays valid until the ring wraps back to it,
+// so it can still be referenced while the next frames are prepared.
+class FrameArena
+{
+public:
+	static const unsigned FRAMES_IN_FLIGHT = 2;
+
+	explicit FrameArena(size_t capacityPerFrame = 64 * 1024);
+
+	// Moves to the next arena of the ring and resets it. Call once at the start of every frame.
+	void beginFrame();
+
+	// Returns the arena of the current frame
+	LinearArena& current() { return *arenas[frameIndex]; }
+
+private:
+	std::array<std::unique_ptr<LinearArena>, FRAMES_IN_FLIGHT> arenas;
+	unsigned frameIndex = 0;
+};
+
+// STL compatible allocator that takes its memory from a LinearArena.
+// With a null arena it falls back to the general heap, so containers can be switched
+// between the two at runtime (used to compare both in the benchmarks).
+template <typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	ArenaAllocator() noexcept : arena{ nullptr } {}
+	explicit ArenaAllocator(LinearArena* arena) noexcept : arena{ arena } {}
+
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena{ other.getArena() } {}
+
+	T* allocate(size_t n)
+	{
+		if (arena)
+		{
+			return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+		}
+		return static_cast<T*>(::operator new(n * sizeof(T)));
+	}
+
+	void deallocate(T* ptr, size_t)
+	{
+		// arena memory is released all at once on reset
+		if (!arena)
+		{
+			::operator delete(ptr);
+		}
+	}
+
+	LinearArena* getArena() const { return arena; }
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.getArena(); }
+
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.getArena(); }
+
+private:
+	LinearArena* arena;
+};
+
+// Vector whose storage lives in a frame arena
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
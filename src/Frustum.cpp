@@ -0,0 +1,72 @@
+#include "Frustum.h"
+
+#include <cmath>
+
+Frustum::Frustum(const glm::mat4x4& m)
+{
+	// Gribb/Hartmann plane extraction. glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	planes[0] = row3 + row0; // left
+	planes[1] = row3 - row0; // right
+	planes[2] = row3 + row1; // bottom
+	planes[3] = row3 - row1; // top
+	planes[4] = row2;        // near (depth is 0 to 1)
+	planes[5] = row3 - row2; // far
+
+	for (auto& plane : planes)
+	{
+		float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+		plane = plane * (1.0f / length);
+	}
+}
+
+bool Frustum::intersects(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4x4& model) const
+{
+	glm::vec3 worldMin, worldMax;
+	transformBounds(boundsMin, boundsMax, model, worldMin, worldMax);
+	return intersects(worldMin, worldMax);
+}
+
+bool Frustum::intersects(const glm::vec3& worldMin, const glm::vec3& worldMax) const
+{
+	glm::vec3 center = (worldMin + worldMax) * 0.5f;
+	glm::vec3 extents = (worldMax - worldMin) * 0.5f;
+
+	for (auto& plane : planes)
+	{
+		// distance of the center and the box's projected radius onto the plane normal
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float radius = extents.x * std::fabs(plane.x) + extents.y * std::fabs(plane.y) + extents.z * std::fabs(plane.z);
+		if (distance + radius < 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void transformBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4x4& model,
+	glm::vec3& worldMin, glm::vec3& worldMax)
+{
+	// Arvo's method: transform the center, and take the absolute matrix for the extents
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	glm::vec3 extents = (boundsMax - boundsMin) * 0.5f;
+
+	glm::vec3 worldCenter(
+		model[0][0] * center.x + model[1][0] * center.y + model[2][0] * center.z + model[3][0],
+		model[0][1] * center.x + model[1][1] * center.y + model[2][1] * center.z + model[3][1],
+		model[0][2] * center.x + model[1][2] * center.y + model[2][2] * center.z + model[3][2]);
+
+	glm::vec3 worldExtents(
+		std::fabs(model[0][0]) * extents.x + std::fabs(model[1][0]) * extents.y + std::fabs(model[2][0]) * extents.z,
+		std::fabs(model[0][1]) * extents.x + std::fabs(model[1][1]) * extents.y + std::fabs(model[2][1]) * extents.z,
+		std::fabs(model[0][2]) * extents.x + std::fabs(model[1][2]) * extents.y + std::fabs(model[2][2]) * extents.z);
+
+	worldMin = worldCenter - worldExtents;
+	worldMax = worldCenter + worldExtents;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+// The six planes of a camera's view volume, used to cull objects outside of the view.
+// Planes point inwards: a point is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them.
+class Frustum
+{
+public:
+	// Extracts the planes from a view projection matrix (depth range 0 to 1)
+	explicit Frustum(const glm::mat4x4& viewProjection);
+
+	// Returns true if an axis aligned box, given in model space, is at least partially inside.
+	// The model matrix moves the box into the world before testing.
+	bool intersects(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4x4& model) const;
+
+	// Returns true if a world space axis aligned box is at least partially inside
+	bool intersects(const glm::vec3& worldMin, const glm::vec3& worldMax) const;
+
+	const glm::vec4& getPlane(unsigned i) const { return planes[i]; }
+
+private:
+	glm::vec4 planes[6];
+};
+
+// Transforms a model space box by a matrix and returns the world space box that contains it
+void transformBounds(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4x4& model,
+	glm::vec3& worldMin, glm::vec3& worldMax);
@@ -0,0 +1,212 @@
+#include "GeometryUpload.h"
+#include "MappedFile.h"
+#include "MeshCodec.h"
+#include "ObjLoader.h"
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	const size_t COUNTER_COUNT = static_cast<size_t>(UploadCounter::Count);
+
+	std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters = {};
+
+	size_t getGeometryBytes(size_t vertexCount, size_t indexCount)
+	{
+		return vertexCount * sizeof(Vertex) + indexCount * sizeof(unsigned);
+	}
+}
+
+const char* getUploadCounterName(UploadCounter counter)
+{
+	switch (counter)
+	{
+	case UploadCounter::Meshes: return "meshes";
+	case UploadCounter::LoadedBytes: return "loaded_bytes";
+	case UploadCounter::StagingAllocations: return "staging_allocations";
+	case UploadCounter::StagingBytes: return "staging_bytes";
+	case UploadCounter::CopiedBytes: return "copied_bytes";
+	case UploadCounter::GpuCopiedBytes: return "gpu_copied_bytes";
+	default: return "unknown";
+	}
+}
+
+void UploadStats::add(UploadCounter counter, uint64_t value)
+{
+	counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t UploadStats::get(UploadCounter counter)
+{
+	return counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+void UploadStats::reset()
+{
+	for (auto& counter : counters)
+	{
+		counter.store(0, std::memory_order_relaxed);
+	}
+}
+
+double UploadStats::getCopiesPerLoadedByte()
+{
+	uint64_t loaded = get(UploadCounter::LoadedBytes);
+	return loaded == 0 ? 0.0 : double(get(UploadCounter::CopiedBytes)) / loaded;
+}
+
+GeometryStaging GeometryUploader::begin(size_t vertexCount, size_t indexCount)
+{
+	if (open)
+	{
+		throw std::runtime_error("A geometry upload is already open");
+	}
+
+	staging = allocateStaging(vertexCount, indexCount);
+	open = true;
+	return staging;
+}
+
+std::shared_ptr<void> GeometryUploader::finish()
+{
+	if (!open)
+	{
+		throw std::runtime_error("No geometry upload is open");
+	}
+
+	open = false;
+	std::shared_ptr<void> buffers = createBuffers(staging);
+	UploadStats::add(UploadCounter::Meshes);
+	UploadStats::add(UploadCounter::LoadedBytes, getGeometryBytes(staging.vertexCount, staging.indexCount));
+	return buffers;
+}
+
+void GeometryUploader::cancel()
+{
+	if (open)
+	{
+		open = false;
+		releaseStaging(staging);
+	}
+}
+
+std::shared_ptr<void> GeometryUploader::upload(const Vertex* vertices, size_t vertexCount, const unsigned* indices, size_t indexCount)
+{
+	GeometryStaging target = begin(vertexCount, indexCount);
+	std::memcpy(target.vertices, vertices, vertexCount * sizeof(Vertex));
+	std::memcpy(target.indices, indices, indexCount * sizeof(unsigned));
+	UploadStats::add(UploadCounter::CopiedBytes, getGeometryBytes(vertexCount, indexCount));
+	return finish();
+}
+
+GeometryStaging HeadlessUploader::allocateStaging(size_t vertexCount, size_t indexCount)
+{
+	// a block left by a cancelled upload is reused when it is large enough
+	size_t bytes = getGeometryBytes(vertexCount, indexCount);
+	if (!memory || memoryBytes < bytes)
+	{
+		memory.reset(new uint8_t[bytes]);
+		memoryBytes = bytes;
+		UploadStats::add(UploadCounter::StagingAllocations);
+		UploadStats::add(UploadCounter::StagingBytes, bytes);
+	}
+
+	// the vertex size is a multiple of 4, so the indices that follow are aligned
+	GeometryStaging staging;
+	staging.vertices = reinterpret_cast<Vertex*>(memory.get());
+	staging.vertexCount = vertexCount;
+	staging.indices = reinterpret_cast<unsigned*>(memory.get() + vertexCount * sizeof(Vertex));
+	staging.indexCount = indexCount;
+	return staging;
+}
+
+std::shared_ptr<void> HeadlessUploader::createBuffers(const GeometryStaging& staging)
+{
+	auto buffers = std::make_shared<HeadlessPrimitiveBuffers>();
+	buffers->tracked.set(memoryBytes);
+	buffers->memory = std::move(memory);
+	buffers->vertices = staging.vertices;
+	buffers->vertexCount = staging.vertexCount;
+	buffers->indices = staging.indices;
+	buffers->indexCount = staging.indexCount;
+	memoryBytes = 0;
+	return buffers;
+}
+
+void HeadlessUploader::releaseStaging(const GeometryStaging&)
+{
+	// kept for the next upload
+}
+
+MeshResourcePtr loadMeshFile(const std::filesystem::path& path, GeometryUploader& uploader, MeshResidency residency, JobSystem* jobs)
+{
+	MappedFile file;
+	if (!file.open(path))
+	{
+		throw std::runtime_error("Could not map mesh file " + path.string());
+	}
+
+	bool encoded = path.extension() == ".mvmesh";
+	const char* text = reinterpret_cast<const char*>(file.data());
+
+	// the size first, so the geometry can be written into staging memory as it is read
+	size_t vertexCount, indexCount;
+	if (encoded)
+	{
+		MeshCodecHeader header;
+		if (!readMeshCodecHeader(file.data(), file.size(), header))
+		{
+			throw std::runtime_error("Invalid mesh file " + path.string());
+		}
+		vertexCount = header.vertexCount;
+		indexCount = header.indexCount;
+	}
+	else
+	{
+		size_t faces;
+		countObj(text, file.size(), vertexCount, faces);
+		indexCount = faces * 3;
+
+		// a scan of loose points would load as a mesh with nothing to draw
+		if (faces == 0 && vertexCount > 0)
+		{
+			throw std::runtime_error(path.string() + " has points but no faces, load it as a point cloud (see PointOctree.h)");
+		}
+	}
+
+	MeshResourcePtr resource(new MeshResource());
+	GeometryStaging staging = uploader.begin(vertexCount, indexCount);
+	try
+	{
+		if (encoded)
+		{
+			decodeMesh(file.data(), file.size(), staging.vertices, vertexCount, staging.indices, indexCount, jobs);
+		}
+		else
+		{
+			parseObj(text, file.size(), staging.vertices, vertexCount, staging.indices, indexCount);
+			normalizeVertexNormals(staging.vertices, vertexCount);
+		}
+
+		resource->computeBounds(staging.vertices, vertexCount);
+		size_t copied = resource->setCpuData(staging.vertices, vertexCount, staging.indices, indexCount, residency);
+		UploadStats::add(UploadCounter::CopiedBytes, copied);
+	}
+	catch (const std::runtime_error& e)
+	{
+		uploader.cancel();
+		throw std::runtime_error("Invalid mesh file " + path.string() + ": " + e.what());
+	}
+	catch (...)
+	{
+		// anything else (eg. out of memory) still closes the upload, or every later begin() would fail
+		uploader.cancel();
+		throw;
+	}
+
+	resource->primitiveBuffers = uploader.finish();
+	return resource;
+}
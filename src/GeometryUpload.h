@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "Assets.h"
+#include "MemoryStats.h"
+
+class JobSystem;
+
+// Counters of the geometry upload path, totals since the last UploadStats::reset()
+enum class UploadCounter
+{
+	// Meshes whose buffers were created, and the bytes of their vertices and indices
+	Meshes,
+	LoadedBytes,
+
+	// Staging memory allocated for uploads. Backends that reuse their staging memory allocate less often.
+	StagingAllocations,
+	StagingBytes,
+
+	// Bytes of geometry the CPU copied on top of writing it into staging memory once:
+	// CPU vectors copied into staging, and the CPU copies kept for the mesh residency
+	CopiedBytes,
+
+	// Bytes the GPU copied from staging memory into the final buffers
+	GpuCopiedBytes,
+
+	Count
+};
+
+// Returns a short lowercase name for the counter, used as key names
+const char* getUploadCounterName(UploadCounter counter);
+
+// Global counters of the geometry upload path, to see how often geometry is copied on its way to the GPU.
+// add() is thread safe and lock-free.
+class UploadStats
+{
+public:
+	static void add(UploadCounter counter, uint64_t value = 1);
+	static uint64_t get(UploadCounter counter);
+	static void reset();
+
+	// CPU bytes copied for every byte of geometry loaded. 0 when the loaders write straight into staging
+	// memory and the meshes keep no CPU copy.
+	static double getCopiesPerLoadedByte();
+};
+
+// Writable memory for the vertices and indices of a single mesh. Its contents start undefined.
+struct GeometryStaging
+{
+	Vertex* vertices = nullptr;
+	size_t vertexCount = 0;
+	unsigned* indices = nullptr;
+	size_t indexCount = 0;
+};
+
+// Creates mesh buffers from staging memory that loaders write into directly, so parsed geometry
+// isn't collected in vectors and copied again on its way to the graphics API.
+//
+// begin() hands out staging memory for a mesh whose size is known, the loader writes the vertices and
+// indices in place, and finish() turns it into the mesh's primitive buffers. A single upload is open at a time.
+class GeometryUploader
+{
+public:
+	virtual ~GeometryUploader() = default;
+
+	// Returns staging memory for a mesh. Throws std::runtime_error if an upload is already open.
+	GeometryStaging begin(size_t vertexCount, size_t indexCount);
+
+	// Creates the buffers from the staging memory of the open upload, which can't be used afterwards.
+	// Returns them to be stored as a MeshResource's primitive buffers.
+	std::shared_ptr<void> finish();
+
+	// Drops the open upload without creating buffers, eg. when the loader fails
+	void cancel();
+
+	// Uploads geometry that is already in CPU memory, copying it into staging memory
+	std::shared_ptr<void> upload(const Vertex* vertices, size_t vertexCount, const unsigned* indices, size_t indexCount);
+
+protected:
+	// Backend: returns memory for the geometry, adding to the staging counters when it allocates
+	virtual GeometryStaging allocateStaging(size_t vertexCount, size_t indexCount) = 0;
+
+	// Backend: creates buffers from the staging memory
+	virtual std::shared_ptr<void> createBuffers(const GeometryStaging& staging) = 0;
+
+	// Backend: gives back staging memory that won't become buffers
+	virtual void releaseStaging(const GeometryStaging& staging) = 0;
+
+private:
+	GeometryStaging staging;
+	bool open = false;
+};
+
+// Buffers made by a HeadlessUploader: the staging memory itself, kept in place of GPU buffers
+struct HeadlessPrimitiveBuffers
+{
+	std::unique_ptr<uint8_t[]> memory;
+	const Vertex* vertices = nullptr;
+	size_t vertexCount = 0;
+	const unsigned* indices = nullptr;
+	size_t indexCount = 0;
+
+	TrackedMemory tracked{ MemoryTag::GpuBuffer };
+};
+
+// Uploader without a graphics API, for tools, benchmarks and platforms without one.
+// Each mesh gets a block of memory that becomes its buffers, nothing is copied after the loader writes it.
+class HeadlessUploader : public GeometryUploader
+{
+protected:
+	GeometryStaging allocateStaging(size_t vertexCount, size_t indexCount) override;
+	std::shared_ptr<void> createBuffers(const GeometryStaging& staging) override;
+	void releaseStaging(const GeometryStaging& staging) override;
+
+private:
+	std::unique_ptr<uint8_t[]> memory;
+	size_t memoryBytes = 0;
+};
+
+// Loads an OBJ or .mvmesh file straight into the staging memory of an uploader and creates its buffers.
+// The file is mapped, sized (counted or read from the header), then parsed or decoded in place.
+// The mesh gets the buffers, the bounds and a copy of the CPU data the residency keeps.
+// Throws std::runtime_error if the file can't be read or isn't valid, or is an OBJ of points without faces.
+MeshResourcePtr loadMeshFile(const std::filesystem::path& path, GeometryUploader& uploader, MeshResidency residency, JobSystem* jobs = nullptr);
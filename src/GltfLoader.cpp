@@ -0,0 +1,813 @@
+#include "GltfLoader.h"
+#include "Animation.h"
+#include "Json.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+	const uint32_t GLB_MAGIC = 0x46546c67; // "glTF"
+	const uint32_t GLB_VERSION = 2;
+	const uint32_t CHUNK_JSON = 0x4e4f534a; // "JSON"
+	const uint32_t CHUNK_BIN = 0x004e4942; // "BIN\0"
+
+	const unsigned COMPONENT_BYTE = 5120;
+	const unsigned COMPONENT_UNSIGNED_BYTE = 5121;
+	const unsigned COMPONENT_SHORT = 5122;
+	const unsigned COMPONENT_UNSIGNED_SHORT = 5123;
+	const unsigned COMPONENT_UNSIGNED_INT = 5125;
+	const unsigned COMPONENT_FLOAT = 5126;
+
+	const unsigned MODE_TRIANGLES = 4;
+
+	// the direct path reinterprets the file as Vertex
+	static_assert(sizeof(Vertex) == 36, "Vertex must be three tightly packed vec3");
+
+	uint32_t readU32(const uint8_t* data)
+	{
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	size_t getComponentSize(unsigned componentType)
+	{
+		switch (componentType)
+		{
+		case COMPONENT_BYTE:
+		case COMPONENT_UNSIGNED_BYTE: return 1;
+		case COMPONENT_SHORT:
+		case COMPONENT_UNSIGNED_SHORT: return 2;
+		case COMPONENT_UNSIGNED_INT:
+		case COMPONENT_FLOAT: return 4;
+		default: throw std::runtime_error("Unknown glTF component type " + std::to_string(componentType));
+		}
+	}
+
+	unsigned getComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		if (type == "MAT4") return 16;
+		throw std::runtime_error("Unsupported glTF accessor type " + type);
+	}
+
+	// An accessor checked against the binary buffer
+	struct Accessor
+	{
+		// nullptr when the accessor has no buffer view (all zeros)
+		const uint8_t* data = nullptr;
+		size_t count = 0;
+		size_t stride = 0;
+		unsigned componentType = 0;
+		unsigned components = 0;
+		bool normalized = false;
+
+		// the buffer view and offset, to find interleaved attributes
+		int bufferView = -1;
+		size_t byteOffset = 0;
+
+		const JsonValue* json = nullptr;
+	};
+
+	class GltfReader
+	{
+	public:
+		GltfReader(const JsonValue& json, const uint8_t* binary, size_t binarySize) :
+			json{ json }, binary{ binary }, binarySize{ binarySize } {}
+
+		Accessor getAccessor(double indexValue) const
+		{
+			size_t index = toIndex(indexValue, json["accessors"].size(), "accessor");
+			const JsonValue& source = json["accessors"][index];
+			if (source.has("sparse"))
+			{
+				throw std::runtime_error("Sparse glTF accessors are not supported");
+			}
+
+			Accessor accessor;
+			accessor.json = &source;
+			accessor.componentType = static_cast<unsigned>(source["componentType"].getNumber());
+			accessor.components = getComponentCount(source["type"].getString());
+			accessor.count = static_cast<size_t>(source["count"].getNumber(-1));
+			accessor.normalized = source["normalized"].getBool();
+			size_t elementSize = getComponentSize(accessor.componentType) * accessor.components;
+			if (source["count"].getNumber(-1) < 1)
+			{
+				throw std::runtime_error("glTF accessor " + std::to_string(index) + " has no elements");
+			}
+
+			if (!source.has("bufferView"))
+			{
+				accessor.stride = elementSize;
+				return accessor;
+			}
+
+			const JsonValue& views = json["bufferViews"];
+			accessor.bufferView = static_cast<int>(toIndex(source["bufferView"].getNumber(-1), views.size(), "buffer view"));
+			const JsonValue& view = views[accessor.bufferView];
+			if (view["buffer"].getNumber(-1) != 0)
+			{
+				throw std::runtime_error("glTF buffer views must use the GLB binary buffer");
+			}
+
+			size_t viewOffset = static_cast<size_t>(view["byteOffset"].getNumber(0));
+			size_t viewLength = static_cast<size_t>(view["byteLength"].getNumber(0));
+			if (viewOffset > binarySize || viewLength > binarySize - viewOffset)
+			{
+				throw std::runtime_error("glTF buffer view outside of the binary buffer");
+			}
+
+			accessor.byteOffset = static_cast<size_t>(source["byteOffset"].getNumber(0));
+			accessor.stride = static_cast<size_t>(view["byteStride"].getNumber(double(elementSize)));
+			if (accessor.stride < elementSize)
+			{
+				throw std::runtime_error("glTF buffer view stride is smaller than its elements");
+			}
+
+			// divided, a huge count must not wrap around
+			if (accessor.byteOffset > viewLength || accessor.count - 1 > (viewLength - accessor.byteOffset) / accessor.stride
+				|| elementSize > viewLength - (accessor.byteOffset + accessor.stride * (accessor.count - 1)))
+			{
+				throw std::runtime_error("glTF accessor " + std::to_string(index) + " reads outside of its buffer view");
+			}
+
+			accessor.data = binary + viewOffset + accessor.byteOffset;
+			return accessor;
+		}
+
+		static size_t toIndex(double value, size_t count, const char* what)
+		{
+			if (!(value >= 0) || value >= double(count) || value != std::floor(value))
+			{
+				throw std::runtime_error(std::string("Invalid glTF ") + what + " index");
+			}
+			return static_cast<size_t>(value);
+		}
+
+	private:
+		const JsonValue& json;
+		const uint8_t* binary;
+		size_t binarySize;
+	};
+
+	// Reads an element of an accessor as floats, normalized integers become [0, 1] or [-1, 1]
+	void readFloats(const Accessor& accessor, size_t index, float* out, unsigned count)
+	{
+		count = std::min(count, accessor.components);
+		if (accessor.data == nullptr)
+		{
+			std::fill(out, out + count, 0.0f);
+			return;
+		}
+
+		const uint8_t* element = accessor.data + index * accessor.stride;
+		for (unsigned i = 0; i < count; i++)
+		{
+			switch (accessor.componentType)
+			{
+			case COMPONENT_FLOAT:
+				std::memcpy(&out[i], element + i * 4, 4);
+				break;
+			case COMPONENT_UNSIGNED_BYTE:
+				out[i] = element[i] * (accessor.normalized ? 1.0f / 255.0f : 1.0f);
+				break;
+			case COMPONENT_BYTE:
+				out[i] = static_cast<int8_t>(element[i]) * (accessor.normalized ? 1.0f / 127.0f : 1.0f);
+				break;
+			case COMPONENT_UNSIGNED_SHORT:
+			{
+				uint16_t value;
+				std::memcpy(&value, element + i * 2, 2);
+				out[i] = value * (accessor.normalized ? 1.0f / 65535.0f : 1.0f);
+				break;
+			}
+			case COMPONENT_SHORT:
+			{
+				int16_t value;
+				std::memcpy(&value, element + i * 2, 2);
+				out[i] = value * (accessor.normalized ? 1.0f / 32767.0f : 1.0f);
+				break;
+			}
+			default:
+				out[i] = 0.0f;
+				break;
+			}
+		}
+	}
+
+	bool isFloatVec3(const Accessor& accessor)
+	{
+		return accessor.componentType == COMPONENT_FLOAT && accessor.components == 3;
+	}
+
+	// Whether the attributes are one interleaved buffer view with the layout of Vertex
+	bool matchesVertexLayout(const Accessor& position, const Accessor* normal, const Accessor* color)
+	{
+		if (!normal || !color || !position.data || !normal->data || !color->data)
+		{
+			return false;
+		}
+		if (!isFloatVec3(position) || !isFloatVec3(*normal) || !isFloatVec3(*color))
+		{
+			return false;
+		}
+		if (position.stride != sizeof(Vertex) || normal->bufferView != position.bufferView || color->bufferView != position.bufferView)
+		{
+			return false;
+		}
+		if (normal->count != position.count || color->count != position.count)
+		{
+			return false;
+		}
+		return normal->byteOffset == position.byteOffset + offsetof(Vertex, normal)
+			&& color->byteOffset == position.byteOffset + offsetof(Vertex, color)
+			&& reinterpret_cast<uintptr_t>(position.data) % alignof(Vertex) == 0;
+	}
+
+	// Unit quaternion of an orthonormal rotation matrix given by its columns
+	glm::quat rotationToQuaternion(const glm::vec3& x, const glm::vec3& y, const glm::vec3& z)
+	{
+		float trace = x.x + y.y + z.z;
+		if (trace > 0)
+		{
+			float s = std::sqrt(trace + 1.0f) * 2.0f;
+			return glm::quat(0.25f * s, (y.z - z.y) / s, (z.x - x.z) / s, (x.y - y.x) / s);
+		}
+		if (x.x > y.y && x.x > z.z)
+		{
+			float s = std::sqrt(1.0f + x.x - y.y - z.z) * 2.0f;
+			return glm::quat((y.z - z.y) / s, 0.25f * s, (y.x + x.y) / s, (z.x + x.z) / s);
+		}
+		if (y.y > z.z)
+		{
+			float s = std::sqrt(1.0f + y.y - x.x - z.z) * 2.0f;
+			return glm::quat((z.x - x.z) / s, (y.x + x.y) / s, 0.25f * s, (z.y + y.z) / s);
+		}
+		float s = std::sqrt(1.0f + z.z - x.x - y.y) * 2.0f;
+		return glm::quat((x.y - y.x) / s, (z.x + x.z) / s, (z.y + y.z) / s, 0.25f * s);
+	}
+
+	// Splits a right handed world matrix into the left handed scene object transform.
+	// The engine's model matrix is C * M with C the z mirror, which is (C M C) * C:
+	// C M C is a regular transform in the engine's space, and the trailing C becomes scale.z = -1.
+	void setNodeTransform(GltfNode& node, const glm::mat4x4& world)
+	{
+		glm::vec3 columns[3] = { glm::vec3(world[0]), glm::vec3(world[1]), glm::vec3(world[2]) };
+		glm::vec3 scale = { glm::length(columns[0]), glm::length(columns[1]), glm::length(columns[2]) };
+		if (glm::dot(glm::cross(columns[0], columns[1]), columns[2]) < 0)
+		{
+			scale.x = -scale.x;
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			columns[i] = scale[i] != 0 ? columns[i] / scale[i] : glm::vec3(0.0f);
+		}
+		glm::quat rotation = rotationToQuaternion(columns[0], columns[1], columns[2]);
+
+		node.position = { world[3].x, world[3].y, -world[3].z };
+		node.rotation = glm::quat(rotation.w, -rotation.x, -rotation.y, rotation.z);
+		node.scale = { scale.x, scale.y, -scale.z };
+	}
+
+	glm::mat4x4 getLocalMatrix(const JsonValue& node)
+	{
+		const JsonValue& matrix = node["matrix"];
+		if (matrix.size() == 16)
+		{
+			glm::mat4x4 result(1.0f);
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					result[column][row] = static_cast<float>(matrix[column * 4 + row].getNumber());
+				}
+			}
+			return result;
+		}
+
+		JointTransform transform;
+		const JsonValue& translation = node["translation"];
+		const JsonValue& rotation = node["rotation"];
+		const JsonValue& scale = node["scale"];
+		if (translation.size() == 3)
+		{
+			transform.translation = { float(translation[0].getNumber()), float(translation[1].getNumber()), float(translation[2].getNumber()) };
+		}
+		if (rotation.size() == 4)
+		{
+			// stored as x, y, z, w
+			transform.rotation = glm::normalize(glm::quat(float(rotation[3].getNumber(1)), float(rotation[0].getNumber()),
+				float(rotation[1].getNumber()), float(rotation[2].getNumber())));
+		}
+		if (scale.size() == 3)
+		{
+			transform.scale = { float(scale[0].getNumber(1)), float(scale[1].getNumber(1)), float(scale[2].getNumber(1)) };
+		}
+		return transform.toMatrix();
+	}
+
+	GltfPrimitive readPrimitive(const GltfReader& reader, const JsonValue& source, GltfStats& stats)
+	{
+		GltfPrimitive primitive;
+		const JsonValue& attributes = source["attributes"];
+		if (!attributes.has("POSITION"))
+		{
+			throw std::runtime_error("glTF primitive has no positions");
+		}
+
+		Accessor position = reader.getAccessor(attributes["POSITION"].getNumber(-1));
+		if (!isFloatVec3(position))
+		{
+			throw std::runtime_error("glTF positions must be float VEC3");
+		}
+
+		Accessor normal, color;
+		bool hasNormal = attributes.has("NORMAL");
+		bool hasColor = attributes.has("COLOR_0");
+		if (hasNormal)
+		{
+			normal = reader.getAccessor(attributes["NORMAL"].getNumber(-1));
+			if (normal.count != position.count || normal.components != 3)
+			{
+				throw std::runtime_error("glTF normals don't match the positions");
+			}
+		}
+		if (hasColor)
+		{
+			color = reader.getAccessor(attributes["COLOR_0"].getNumber(-1));
+			if (color.count != position.count || color.components < 3)
+			{
+				throw std::runtime_error("glTF colors don't match the positions");
+			}
+		}
+
+		primitive.vertexCount = position.count;
+		size_t vertexBytes = position.count * sizeof(Vertex);
+		if (matchesVertexLayout(position, hasNormal ? &normal : nullptr, hasColor ? &color : nullptr))
+		{
+			primitive.vertices = reinterpret_cast<const Vertex*>(position.data);
+			primitive.verticesMapped = true;
+			stats.mappedVertexBytes += vertexBytes;
+		}
+		else
+		{
+			primitive.convertedVertices.resize(position.count);
+			for (size_t i = 0; i < position.count; i++)
+			{
+				Vertex& vertex = primitive.convertedVertices[i];
+				readFloats(position, i, &vertex.position.x, 3);
+				if (hasNormal)
+				{
+					readFloats(normal, i, &vertex.normal.x, 3);
+				}
+				if (hasColor)
+				{
+					readFloats(color, i, &vertex.color.x, 3);
+				}
+			}
+			primitive.vertices = primitive.convertedVertices.data();
+			stats.convertedVertexBytes += vertexBytes;
+		}
+
+		if (source.has("indices"))
+		{
+			Accessor indices = reader.getAccessor(source["indices"].getNumber(-1));
+			if (indices.components != 1 || indices.data == nullptr)
+			{
+				throw std::runtime_error("glTF indices must be scalars in a buffer view");
+			}
+
+			primitive.indexCount = indices.count;
+			if (indices.componentType == COMPONENT_UNSIGNED_INT && indices.stride == sizeof(unsigned)
+				&& reinterpret_cast<uintptr_t>(indices.data) % alignof(unsigned) == 0)
+			{
+				primitive.indices = reinterpret_cast<const unsigned*>(indices.data);
+				primitive.indicesMapped = true;
+				stats.mappedIndexBytes += indices.count * sizeof(unsigned);
+			}
+			else if (indices.componentType == COMPONENT_UNSIGNED_SHORT || indices.componentType == COMPONENT_UNSIGNED_BYTE
+				|| indices.componentType == COMPONENT_UNSIGNED_INT)
+			{
+				primitive.convertedIndices.resize(indices.count);
+				for (size_t i = 0; i < indices.count; i++)
+				{
+					const uint8_t* element = indices.data + i * indices.stride;
+					if (indices.componentType == COMPONENT_UNSIGNED_BYTE)
+					{
+						primitive.convertedIndices[i] = element[0];
+					}
+					else if (indices.componentType == COMPONENT_UNSIGNED_SHORT)
+					{
+						uint16_t value;
+						std::memcpy(&value, element, sizeof(value));
+						primitive.convertedIndices[i] = value;
+					}
+					else
+					{
+						std::memcpy(&primitive.convertedIndices[i], element, sizeof(unsigned));
+					}
+				}
+				primitive.indices = primitive.convertedIndices.data();
+				stats.convertedIndexBytes += indices.count * sizeof(unsigned);
+			}
+			else
+			{
+				throw std::runtime_error("glTF indices must be unsigned integers");
+			}
+		}
+		else
+		{
+			// not indexed, every three vertices are a triangle
+			primitive.convertedIndices.resize(position.count);
+			for (size_t i = 0; i < position.count; i++)
+			{
+				primitive.convertedIndices[i] = static_cast<unsigned>(i);
+			}
+			primitive.indices = primitive.convertedIndices.data();
+			primitive.indexCount = position.count;
+			stats.convertedIndexBytes += position.count * sizeof(unsigned);
+		}
+
+		if (primitive.indexCount % 3 != 0)
+		{
+			throw std::runtime_error("glTF triangle list has a partial triangle");
+		}
+
+		// the GPU would read out of the vertex buffer
+		unsigned largest = 0;
+		for (size_t i = 0; i < primitive.indexCount; i++)
+		{
+			largest = std::max(largest, primitive.indices[i]);
+		}
+		if (primitive.indexCount > 0 && largest >= primitive.vertexCount)
+		{
+			throw std::runtime_error("glTF index out of the vertex range");
+		}
+
+		// glTF leaves missing normals to the viewer, use smooth ones
+		if (!hasNormal)
+		{
+			std::vector<Vertex>& vertices = primitive.convertedVertices;
+			for (size_t i = 0; i + 2 < primitive.indexCount; i += 3)
+			{
+				Vertex& a = vertices[primitive.indices[i]];
+				Vertex& b = vertices[primitive.indices[i + 1]];
+				Vertex& c = vertices[primitive.indices[i + 2]];
+				glm::vec3 faceNormal = glm::cross(b.position - a.position, c.position - a.position);
+				a.normal += faceNormal;
+				b.normal += faceNormal;
+				c.normal += faceNormal;
+			}
+			for (Vertex& vertex : vertices)
+			{
+				float length = glm::length(vertex.normal);
+				vertex.normal = length > 0 ? vertex.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+		}
+
+		// positions must have bounds in a valid file, only compute them otherwise
+		const JsonValue& minimum = (*position.json)["min"];
+		const JsonValue& maximum = (*position.json)["max"];
+		if (minimum.size() == 3 && maximum.size() == 3)
+		{
+			primitive.boundsMin = { float(minimum[0].getNumber()), float(minimum[1].getNumber()), float(minimum[2].getNumber()) };
+			primitive.boundsMax = { float(maximum[0].getNumber()), float(maximum[1].getNumber()), float(maximum[2].getNumber()) };
+		}
+		else
+		{
+			primitive.boundsMin = primitive.boundsMax = primitive.vertices[0].position;
+			for (size_t i = 1; i < primitive.vertexCount; i++)
+			{
+				primitive.boundsMin = glm::min(primitive.boundsMin, primitive.vertices[i].position);
+				primitive.boundsMax = glm::max(primitive.boundsMax, primitive.vertices[i].position);
+			}
+		}
+
+		return primitive;
+	}
+}
+
+GltfFile::GltfFile(const std::filesystem::path& path)
+{
+	if (!file.open(path))
+	{
+		throw std::runtime_error("Could not open glTF file " + path.string());
+	}
+
+	const uint8_t* data = file.data();
+	size_t size = file.size();
+	if (size < 20 || readU32(data) != GLB_MAGIC)
+	{
+		throw std::runtime_error("Not a binary glTF file " + path.string());
+	}
+	if (readU32(data + 4) != GLB_VERSION)
+	{
+		throw std::runtime_error("Unsupported glTF version in " + path.string());
+	}
+	size = std::min<size_t>(size, readU32(data + 8));
+
+	// JSON chunk first, then the optional binary chunk. Chunks are 4 byte aligned.
+	const char* jsonText = nullptr;
+	size_t jsonSize = 0;
+	const uint8_t* binary = nullptr;
+	size_t binarySize = 0;
+	for (size_t offset = 12; offset + 8 <= size;)
+	{
+		size_t chunkSize = readU32(data + offset);
+		uint32_t chunkType = readU32(data + offset + 4);
+		if (chunkSize > size - offset - 8)
+		{
+			throw std::runtime_error("Truncated glTF chunk in " + path.string());
+		}
+
+		if (chunkType == CHUNK_JSON && jsonText == nullptr)
+		{
+			jsonText = reinterpret_cast<const char*>(data + offset + 8);
+			jsonSize = chunkSize;
+		}
+		else if (chunkType == CHUNK_BIN && binary == nullptr)
+		{
+			binary = data + offset + 8;
+			binarySize = chunkSize;
+		}
+		offset += 8 + ((chunkSize + 3) & ~size_t(3));
+	}
+	if (jsonText == nullptr)
+	{
+		throw std::runtime_error("glTF file has no JSON chunk " + path.string());
+	}
+
+	JsonValue json = parseJson(jsonText, jsonSize);
+
+	const JsonValue& buffers = json["buffers"];
+	for (size_t i = 0; i < buffers.size(); i++)
+	{
+		if (buffers[i].has("uri") || i > 0)
+		{
+			throw std::runtime_error("glTF buffers outside of the GLB binary chunk are not supported");
+		}
+		if (buffers[i]["byteLength"].getNumber(0) > double(binarySize))
+		{
+			throw std::runtime_error("glTF buffer is larger than the binary chunk");
+		}
+	}
+
+	GltfReader reader(json, binary, binarySize);
+
+	const JsonValue& sourceMeshes = json["meshes"];
+	meshes.resize(sourceMeshes.size());
+	for (size_t i = 0; i < sourceMeshes.size(); i++)
+	{
+		GltfMesh& mesh = meshes[i];
+		mesh.name = sourceMeshes[i]["name"].getString();
+
+		const JsonValue& primitives = sourceMeshes[i]["primitives"];
+		for (size_t p = 0; p < primitives.size(); p++)
+		{
+			if (primitives[p]["mode"].getNumber(MODE_TRIANGLES) != MODE_TRIANGLES)
+			{
+				stats.skippedPrimitives++;
+				continue;
+			}
+			mesh.primitives.push_back(readPrimitive(reader, primitives[p], stats));
+		}
+	}
+
+	// Walk the default scene (or every root) from the top, so parents come before their children
+	const JsonValue& sourceNodes = json["nodes"];
+	std::vector<int> parents(sourceNodes.size(), -1);
+	for (size_t i = 0; i < sourceNodes.size(); i++)
+	{
+		const JsonValue& children = sourceNodes[i]["children"];
+		for (size_t c = 0; c < children.size(); c++)
+		{
+			size_t child = GltfReader::toIndex(children[c].getNumber(-1), sourceNodes.size(), "node");
+			if (parents[child] != -1)
+			{
+				throw std::runtime_error("glTF node has several parents");
+			}
+			parents[child] = static_cast<int>(i);
+		}
+	}
+
+	std::vector<size_t> roots;
+	const JsonValue& scenes = json["scenes"];
+	if (scenes.size() > 0)
+	{
+		const JsonValue& scene = scenes[static_cast<size_t>(json["scene"].getNumber(0))]["nodes"];
+		for (size_t i = 0; i < scene.size(); i++)
+		{
+			roots.push_back(GltfReader::toIndex(scene[i].getNumber(-1), sourceNodes.size(), "node"));
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < sourceNodes.size(); i++)
+		{
+			if (parents[i] == -1)
+			{
+				roots.push_back(i);
+			}
+		}
+	}
+
+	struct Pending
+	{
+		size_t node;
+		glm::mat4x4 parentWorld;
+		int parentOutput;
+	};
+	std::vector<Pending> stack;
+	for (auto it = roots.rbegin(); it != roots.rend(); ++it)
+	{
+		stack.push_back({ *it, glm::mat4x4(1.0f), -1 });
+	}
+
+	std::vector<bool> visited(sourceNodes.size(), false);
+	while (!stack.empty())
+	{
+		Pending pending = stack.back();
+		stack.pop_back();
+		if (visited[pending.node])
+		{
+			throw std::runtime_error("glTF node hierarchy has a cycle");
+		}
+		visited[pending.node] = true;
+
+		const JsonValue& source = sourceNodes[pending.node];
+		glm::mat4x4 world = pending.parentWorld * getLocalMatrix(source);
+
+		int output = pending.parentOutput;
+		if (source.has("mesh"))
+		{
+			GltfNode node;
+			node.name = source["name"].getString();
+			node.mesh = static_cast<int>(GltfReader::toIndex(source["mesh"].getNumber(-1), meshes.size(), "mesh"));
+			node.parent = pending.parentOutput;
+			setNodeTransform(node, world);
+
+			output = static_cast<int>(nodes.size());
+			nodes.push_back(node);
+		}
+
+		const JsonValue& children = source["children"];
+		for (size_t c = children.size(); c-- > 0;)
+		{
+			stack.push_back({ GltfReader::toIndex(children[c].getNumber(-1), sourceNodes.size(), "node"), world, output });
+		}
+	}
+}
+
+std::vector<uint8_t> encodeGlb(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, GlbLayout layout)
+{
+	if (vertices.empty() || indices.empty())
+	{
+		throw std::runtime_error("Can't encode an empty mesh as glTF");
+	}
+
+	// right handed: mirror z and reverse the triangles
+	std::vector<Vertex> converted(vertices);
+	glm::vec3 boundsMin = converted[0].position * glm::vec3(1, 1, -1);
+	glm::vec3 boundsMax = boundsMin;
+	for (Vertex& vertex : converted)
+	{
+		vertex.position.z = -vertex.position.z;
+		vertex.normal.z = -vertex.normal.z;
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+	std::vector<unsigned> flipped(indices);
+	for (size_t i = 0; i + 2 < flipped.size(); i += 3)
+	{
+		std::swap(flipped[i + 1], flipped[i + 2]);
+	}
+
+	std::vector<uint8_t> binary;
+	auto append = [&binary](const void* data, size_t bytes) {
+		size_t offset = binary.size();
+		binary.insert(binary.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + bytes);
+		binary.resize((binary.size() + 3) & ~size_t(3), 0);
+		return offset;
+	};
+
+	std::ostringstream os;
+	os.precision(9);
+	auto writeVec3 = [&os](const glm::vec3& value) {
+		os << "[" << value.x << "," << value.y << "," << value.z << "]";
+	};
+
+	size_t vertexCount = converted.size();
+	bool shortIndices = layout == GlbLayout::Separate && vertexCount <= 65536;
+	size_t indexOffset;
+	size_t indexBytes;
+
+	os << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"ModelViewer\"},";
+	os << "\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],";
+
+	if (layout == GlbLayout::Engine)
+	{
+		size_t vertexOffset = append(converted.data(), vertexCount * sizeof(Vertex));
+		indexBytes = flipped.size() * sizeof(unsigned);
+		indexOffset = append(flipped.data(), indexBytes);
+
+		os << "\"bufferViews\":["
+			<< "{\"buffer\":0,\"byteOffset\":" << vertexOffset << ",\"byteLength\":" << vertexCount * sizeof(Vertex)
+			<< ",\"byteStride\":" << sizeof(Vertex) << ",\"target\":34962},"
+			<< "{\"buffer\":0,\"byteOffset\":" << indexOffset << ",\"byteLength\":" << indexBytes << ",\"target\":34963}],";
+		os << "\"accessors\":["
+			<< "{\"bufferView\":0,\"byteOffset\":" << offsetof(Vertex, position) << ",\"componentType\":5126,\"count\":" << vertexCount
+			<< ",\"type\":\"VEC3\",\"min\":";
+		writeVec3(boundsMin);
+		os << ",\"max\":";
+		writeVec3(boundsMax);
+		os << "},"
+			<< "{\"bufferView\":0,\"byteOffset\":" << offsetof(Vertex, normal) << ",\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC3\"},"
+			<< "{\"bufferView\":0,\"byteOffset\":" << offsetof(Vertex, color) << ",\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC3\"},"
+			<< "{\"bufferView\":1,\"componentType\":5125,\"count\":" << flipped.size() << ",\"type\":\"SCALAR\"}],";
+		os << "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"COLOR_0\":2},\"indices\":3}]}],";
+	}
+	else
+	{
+		std::vector<glm::vec3> attribute(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			attribute[i] = converted[i].position;
+		}
+		size_t positionOffset = append(attribute.data(), vertexCount * sizeof(glm::vec3));
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			attribute[i] = converted[i].normal;
+		}
+		size_t normalOffset = append(attribute.data(), vertexCount * sizeof(glm::vec3));
+
+		if (shortIndices)
+		{
+			std::vector<uint16_t> narrow(flipped.begin(), flipped.end());
+			indexBytes = narrow.size() * sizeof(uint16_t);
+			indexOffset = append(narrow.data(), indexBytes);
+		}
+		else
+		{
+			indexBytes = flipped.size() * sizeof(unsigned);
+			indexOffset = append(flipped.data(), indexBytes);
+		}
+
+		size_t attributeBytes = vertexCount * sizeof(glm::vec3);
+		os << "\"bufferViews\":["
+			<< "{\"buffer\":0,\"byteOffset\":" << positionOffset << ",\"byteLength\":" << attributeBytes << ",\"target\":34962},"
+			<< "{\"buffer\":0,\"byteOffset\":" << normalOffset << ",\"byteLength\":" << attributeBytes << ",\"target\":34962},"
+			<< "{\"buffer\":0,\"byteOffset\":" << indexOffset << ",\"byteLength\":" << indexBytes << ",\"target\":34963}],";
+		os << "\"accessors\":["
+			<< "{\"bufferView\":0,\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC3\",\"min\":";
+		writeVec3(boundsMin);
+		os << ",\"max\":";
+		writeVec3(boundsMax);
+		os << "},"
+			<< "{\"bufferView\":1,\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC3\"},"
+			<< "{\"bufferView\":2,\"componentType\":" << (shortIndices ? COMPONENT_UNSIGNED_SHORT : COMPONENT_UNSIGNED_INT)
+			<< ",\"count\":" << flipped.size() << ",\"type\":\"SCALAR\"}],";
+		os << "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1},\"indices\":2}]}],";
+	}
+	os << "\"buffers\":[{\"byteLength\":" << binary.size() << "}]}";
+
+	// the JSON chunk is padded with spaces, the binary chunk with zeros
+	std::string json = os.str();
+	json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+	std::vector<uint8_t> glb;
+	auto writeU32 = [&glb](uint32_t value) {
+		uint8_t bytes[4];
+		std::memcpy(bytes, &value, sizeof(value));
+		glb.insert(glb.end(), bytes, bytes + 4);
+	};
+	writeU32(GLB_MAGIC);
+	writeU32(GLB_VERSION);
+	writeU32(static_cast<uint32_t>(12 + 8 + json.size() + 8 + binary.size()));
+	writeU32(static_cast<uint32_t>(json.size()));
+	writeU32(CHUNK_JSON);
+	glb.insert(glb.end(), json.begin(), json.end());
+	writeU32(static_cast<uint32_t>(binary.size()));
+	writeU32(CHUNK_BIN);
+	glb.insert(glb.end(), binary.begin(), binary.end());
+	return glb;
+}
+
+void writeGlb(const std::filesystem::path& path, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, GlbLayout layout)
+{
+	std::vector<uint8_t> glb = encodeGlb(vertices, indices, layout);
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(glb.data()), glb.size());
+	if (!file)
+	{
+		throw std::runtime_error("Could not write glTF file " + path.string());
+	}
+}
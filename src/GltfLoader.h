@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Assets.h"
+#include "MappedFile.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+// Triangles of a glTF mesh in the engine's vertex and index formats.
+//
+// Vertices and indices point straight into the mapped file when its buffer views already have the
+// engine's layout (interleaved Vertex, 32 bit indices), so they can go to buffer creation as they are.
+// Otherwise they point into converted copies owned by the primitive.
+//
+// The data keeps glTF's right handed coordinates and counter clockwise winding. GltfNode folds the
+// conversion into the object transform (a mirror along z), so no vertex needs to be touched for it.
+struct GltfPrimitive
+{
+	const Vertex* vertices = nullptr;
+	size_t vertexCount = 0;
+	const unsigned* indices = nullptr;
+	size_t indexCount = 0;
+
+	// Whether the data points into the file
+	bool verticesMapped = false;
+	bool indicesMapped = false;
+
+	glm::vec3 boundsMin = { 0, 0, 0 };
+	glm::vec3 boundsMax = { 0, 0, 0 };
+
+	std::vector<Vertex> convertedVertices;
+	std::vector<unsigned> convertedIndices;
+};
+
+struct GltfMesh
+{
+	std::string name;
+
+	// Primitives that aren't triangle lists are skipped
+	std::vector<GltfPrimitive> primitives;
+};
+
+// A node placing a mesh in the scene
+struct GltfNode
+{
+	std::string name;
+	int mesh = -1;
+	int parent = -1;
+
+	// Transform from the mesh's data into the engine's left handed world, as the scene object
+	// properties. scale.z is negative: it mirrors the right handed data, and flips its winding
+	// to the engine's clockwise front faces.
+	glm::vec3 position = { 0, 0, 0 };
+	glm::quat rotation = glm::quat(1, 0, 0, 0);
+	glm::vec3 scale = { 1, 1, -1 };
+};
+
+struct GltfStats
+{
+	uint64_t mappedVertexBytes = 0;
+	uint64_t convertedVertexBytes = 0;
+	uint64_t mappedIndexBytes = 0;
+	uint64_t convertedIndexBytes = 0;
+	size_t skippedPrimitives = 0;
+};
+
+// A binary glTF 2.0 file (.glb), memory mapped.
+// Only the embedded binary buffer is supported, external and data URIs are rejected, and so are
+// sparse accessors. Every accessor is checked against its buffer view and every index against
+// the vertex count, so a broken file throws std::runtime_error instead of reading out of bounds.
+// The mapping stays open while the file exists, mapped primitives point into it.
+class GltfFile
+{
+public:
+	explicit GltfFile(const std::filesystem::path& path);
+
+	GltfFile(const GltfFile&) = delete;
+	GltfFile& operator=(const GltfFile&) = delete;
+
+	const std::vector<GltfMesh>& getMeshes() const { return meshes; }
+
+	// Nodes with a mesh, in the scene's order. Empty if the file has meshes but no nodes.
+	const std::vector<GltfNode>& getNodes() const { return nodes; }
+
+	const GltfStats& getStats() const { return stats; }
+
+private:
+	MappedFile file;
+	std::vector<GltfMesh> meshes;
+	std::vector<GltfNode> nodes;
+	GltfStats stats;
+};
+
+enum class GlbLayout
+{
+	// Interleaved Vertex data with 32 bit indices, what GltfFile uploads without conversion
+	Engine,
+
+	// A buffer view per attribute, positions and normals only, 16 bit indices when they fit.
+	// What most exporters write.
+	Separate
+};
+
+// Encodes a single mesh (in the engine's left handed convention) as a GLB file with one node.
+// Positions and normals are converted to glTF's right handed convention, and triangles to
+// counter clockwise, so the file reads correctly in other tools.
+std::vector<uint8_t> encodeGlb(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, GlbLayout layout = GlbLayout::Engine);
+
+void writeGlb(const std::filesystem::path& path, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices,
+	GlbLayout layout = GlbLayout::Engine);
@@ -0,0 +1,206 @@
+#include "Hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const uint64_t PRIME1 = 11400714785074694791ULL;
+	const uint64_t PRIME2 = 14029467366897019727ULL;
+	const uint64_t PRIME3 = 1609587929392839161ULL;
+	const uint64_t PRIME4 = 9650029242287828579ULL;
+	const uint64_t PRIME5 = 2870177450012600261ULL;
+
+	// seed of the second lane of the 128 bit hash
+	const uint64_t SECOND_SEED = 0x9E3779B97F4A7C15ULL;
+
+	inline uint64_t rotl(uint64_t x, int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+
+	inline uint64_t read64(const unsigned char* p)
+	{
+		uint64_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t read32(const unsigned char* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint64_t round(uint64_t acc, uint64_t input)
+	{
+		acc += input * PRIME2;
+		acc = rotl(acc, 31);
+		return acc * PRIME1;
+	}
+
+	inline uint64_t mergeRound(uint64_t acc, uint64_t value)
+	{
+		acc ^= round(0, value);
+		return acc * PRIME1 + PRIME4;
+	}
+
+	// Finishes a hash given the four lane accumulators and the trailing bytes (less than 32)
+	uint64_t finalize(const uint64_t v[4], uint64_t seed, uint64_t totalSize, const unsigned char* tail, size_t tailSize)
+	{
+		uint64_t h;
+		if (totalSize >= 32)
+		{
+			h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+			h = mergeRound(h, v[0]);
+			h = mergeRound(h, v[1]);
+			h = mergeRound(h, v[2]);
+			h = mergeRound(h, v[3]);
+		}
+		else
+		{
+			h = seed + PRIME5;
+		}
+
+		h += totalSize;
+
+		const unsigned char* p = tail;
+		const unsigned char* end = tail + tailSize;
+		while (p + 8 <= end)
+		{
+			h ^= round(0, read64(p));
+			h = rotl(h, 27) * PRIME1 + PRIME4;
+			p += 8;
+		}
+		if (p + 4 <= end)
+		{
+			h ^= uint64_t(read32(p)) * PRIME1;
+			h = rotl(h, 23) * PRIME2 + PRIME3;
+			p += 4;
+		}
+		while (p < end)
+		{
+			h ^= uint64_t(*p) * PRIME5;
+			h = rotl(h, 11) * PRIME1;
+			p++;
+		}
+
+		h ^= h >> 33;
+		h *= PRIME2;
+		h ^= h >> 29;
+		h *= PRIME3;
+		h ^= h >> 32;
+		return h;
+	}
+}
+
+std::string ContentHash::toHex() const
+{
+	static const char digits[] = "0123456789abcdef";
+
+	std::string result(32, '0');
+	for (int i = 0; i < 16; i++)
+	{
+		result[15 - i] = digits[(high >> (i * 4)) & 0xF];
+		result[31 - i] = digits[(low >> (i * 4)) & 0xF];
+	}
+	return result;
+}
+
+uint64_t hash64(const void* data, size_t size, uint64_t seed)
+{
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	const unsigned char* end = p + size;
+
+	uint64_t v[4] = { seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1 };
+	while (p + 32 <= end)
+	{
+		v[0] = round(v[0], read64(p));
+		v[1] = round(v[1], read64(p + 8));
+		v[2] = round(v[2], read64(p + 16));
+		v[3] = round(v[3], read64(p + 24));
+		p += 32;
+	}
+
+	return finalize(v, seed, size, p, end - p);
+}
+
+Hasher::Hasher()
+{
+	resetState(states[0], 0);
+	resetState(states[1], SECOND_SEED);
+}
+
+void Hasher::resetState(State& state, uint64_t seed)
+{
+	state.seed = seed;
+	state.v[0] = seed + PRIME1 + PRIME2;
+	state.v[1] = seed + PRIME2;
+	state.v[2] = seed;
+	state.v[3] = seed - PRIME1;
+}
+
+void Hasher::consumeBlock(const unsigned char* block)
+{
+	for (auto& state : states)
+	{
+		state.v[0] = round(state.v[0], read64(block));
+		state.v[1] = round(state.v[1], read64(block + 8));
+		state.v[2] = round(state.v[2], read64(block + 16));
+		state.v[3] = round(state.v[3], read64(block + 24));
+	}
+}
+
+void Hasher::update(const void* data, size_t size)
+{
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	const unsigned char* end = p + size;
+	totalSize += size;
+
+	// complete a partially filled block first
+	if (bufferSize > 0)
+	{
+		size_t fill = std::min(size, sizeof(buffer) - bufferSize);
+		std::memcpy(buffer + bufferSize, p, fill);
+		bufferSize += fill;
+		p += fill;
+
+		if (bufferSize < sizeof(buffer))
+		{
+			return;
+		}
+
+		consumeBlock(buffer);
+		bufferSize = 0;
+	}
+
+	while (p + 32 <= end)
+	{
+		consumeBlock(p);
+		p += 32;
+	}
+
+	bufferSize = end - p;
+	std::memcpy(buffer, p, bufferSize);
+}
+
+void Hasher::update(const std::string& value)
+{
+	uint64_t length = value.size();
+	updateValue(length);
+	update(value.data(), value.size());
+}
+
+uint64_t Hasher::finishState(const State& state) const
+{
+	return finalize(state.v, state.seed, totalSize, buffer, bufferSize);
+}
+
+ContentHash Hasher::finish() const
+{
+	ContentHash hash;
+	hash.high = finishState(states[0]);
+	hash.low = finishState(states[1]);
+	return hash;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 128 bit content hash, used to address cached data by what it was built from
+struct ContentHash
+{
+	uint64_t high = 0;
+	uint64_t low = 0;
+
+	bool operator==(const ContentHash& other) const { return high == other.high && low == other.low; }
+	bool operator!=(const ContentHash& other) const { return !(*this == other); }
+
+	// Returns the hash as 32 lowercase hex characters, usable as a file name
+	std::string toHex() const;
+};
+
+// Returns the 64 bit xxHash (XXH64) of a block of memory
+uint64_t hash64(const void* data, size_t size, uint64_t seed = 0);
+
+// Incremental hasher. Feed data with update() in any number of pieces, then call finish().
+// The result is the same no matter how the data was split.
+class Hasher
+{
+public:
+	Hasher();
+
+	// Adds raw bytes
+	void update(const void* data, size_t size);
+
+	// Adds a string, prefixed with its length so "ab" + "c" and "a" + "bc" hash differently
+	void update(const std::string& value);
+
+	// Adds a trivially copyable value
+	template <typename T>
+	void updateValue(const T& value)
+	{
+		update(&value, sizeof(T));
+	}
+
+	ContentHash finish() const;
+
+private:
+	// Streaming XXH64 state. Two lanes with different seeds are combined into 128 bits.
+	struct State
+	{
+		uint64_t seed;
+		uint64_t v[4];
+	};
+
+	void resetState(State& state, uint64_t seed);
+	void consumeBlock(const unsigned char* block);
+	uint64_t finishState(const State& state) const;
+
+	State states[2];
+	unsigned char buffer[32];
+	size_t bufferSize = 0;
+	uint64_t totalSize = 0;
+};
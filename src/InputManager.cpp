@@ -1,94 +1,142 @@
 #include "InputManager.h"
-#include "InputManager.h"
-#include "InputManager.h"
 
-// helper to return a map's value if it exists, or some default value.
-// comes from https://stackoverflow.com/a/2333816
-template <template<class, class, class...> class C, typename K, typename V, typename... Args>
-V getOrDefault(const C<K, V, Args...>& m, const K& key, const V& defVal)
+#include <algorithm>
+#include <chrono>
+
+int64_t InputEvent::now()
 {
-	typename C<K, V, Args...>::const_iterator it = m.find(key);
-	if (it == m.end())
-	{
-		return defVal;
-	}
-	return it->second;
+	auto time = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
 }
 
-bool InputManager::isDown(xwin::Key key)
+void InputManager::processEvents(std::vector<InputEvent>* applied)
 {
-	auto iter = keyStates.find(key);
-	if (iter == keyStates.end())
-	{
-		return false;
-	}
+	int64_t now = InputEvent::now();
 
-	return iter->second;
-}
+	InputLatencyStats stats;
+	double totalMs = 0;
 
-bool InputManager::isDown(xwin::MouseInput mouseButton)
-{
-	auto iter = mouseStates.find(mouseButton);
-	if (iter == mouseStates.end())
+	InputEvent event;
+	while (eventQueue.pop(event))
 	{
-		return false;
-	}
+		applyEvent(event);
+		if (applied != nullptr)
+		{
+			applied->push_back(event);
+		}
 
-	return iter->second;
-}
+		double latencyMs = (now - event.timestamp) / 1e6;
+		totalMs += latencyMs;
+		stats.maxMs = std::max(stats.maxMs, latencyMs);
+		stats.events++;
+	}
 
-float InputManager::getAxis(const InputAxis& inputAxis)
-{
-	return getOrDefault(this->axisValues, inputAxis, 0.0f);
+	if (stats.events > 0)
+	{
+		stats.averageMs = totalMs / stats.events;
+	}
+	latencyStats = stats;
 }
 
 void InputManager::notifyUpdateFinished()
 {
 	// axis values are cleared before each frame
-	axisValues.clear();
+	axisValues.fill(0.0f);
 }
 
 void InputManager::notifyLostFocus()
 {
-	keyStates.clear();
-	mouseStates.clear();
-	axisValues.clear();
+	InputEvent event;
+	event.type = InputEventType::LostFocus;
+	postEvent(event);
 }
 
 void InputManager::notifyKeyStateChange(xwin::Key key, xwin::ButtonState state)
 {
-	if (state == xwin::ButtonState::Pressed)
-	{
-		keyStates[key] = true;
-	}
-	else if (state == xwin::ButtonState::Released)
-	{
-		keyStates.erase(key);
-	}
+	InputEvent event;
+	event.type = InputEventType::Key;
+	event.key = key;
+	event.state = state;
+	postEvent(event);
 }
 
 void InputManager::notifyMouseButtonChange(xwin::MouseInput button, xwin::ButtonState state)
 {
-	if (state == xwin::ButtonState::Pressed)
+	InputEvent event;
+	event.type = InputEventType::MouseButton;
+	event.button = button;
+	event.state = state;
+	postEvent(event);
+}
+
+void InputManager::notifyMouseRawInput(int xDelta, int yDelta)
+{
+	InputEvent event;
+	event.type = InputEventType::MouseRaw;
+	event.deltaX = xDelta;
+	event.deltaY = yDelta;
+	postEvent(event);
+}
+
+void InputManager::postEvent(const InputEvent& event)
+{
+	InputEvent stamped = event;
+	if (stamped.timestamp == 0)
 	{
-		mouseStates[button] = true;
+		stamped.timestamp = InputEvent::now();
 	}
-	else if (state == xwin::ButtonState::Released)
+
+	if (!eventQueue.push(stamped))
 	{
-		mouseStates.erase(button);
+		droppedEvents.fetch_add(1, std::memory_order_relaxed);
 	}
 }
 
-void InputManager::notifyMouseRawInput(int xDelta, int yDelta)
+void InputManager::applyEvent(const InputEvent& event)
 {
-	if (xDelta != 0)
+	switch (event.type)
+	{
+	case InputEventType::Key:
 	{
-		auto curValue = getOrDefault(axisValues, InputAxis::MOUSE_X, 0.0f);
-		axisValues[InputAxis::MOUSE_X] = curValue + float(xDelta);
+		size_t index = static_cast<size_t>(event.key);
+		if (index < KEY_COUNT)
+		{
+			if (event.state == xwin::ButtonState::Pressed)
+			{
+				keyStates.set(index);
+			}
+			else if (event.state == xwin::ButtonState::Released)
+			{
+				keyStates.reset(index);
+			}
+		}
+		break;
 	}
-	if (yDelta != 0)
+	case InputEventType::MouseButton:
 	{
-		auto curValue = getOrDefault(axisValues, InputAxis::MOUSE_Y, 0.0f);
-		axisValues[InputAxis::MOUSE_Y] = curValue + float(yDelta);
+		size_t index = static_cast<size_t>(event.button);
+		if (index < MOUSE_BUTTON_COUNT)
+		{
+			if (event.state == xwin::ButtonState::Pressed)
+			{
+				mouseStates.set(index);
+			}
+			else if (event.state == xwin::ButtonState::Released)
+			{
+				mouseStates.reset(index);
+			}
+		}
+		break;
+	}
+	case InputEventType::MouseRaw:
+		// movement is accumulated over every event that arrived during the frame
+		axisValues[static_cast<size_t>(InputAxis::MOUSE_X)] += float(event.deltaX);
+		axisValues[static_cast<size_t>(InputAxis::MOUSE_Y)] += float(event.deltaY);
+		break;
+	case InputEventType::LostFocus:
+		keyStates.reset();
+		mouseStates.reset();
+		axisValues.fill(0.0f);
+		break;
 	}
 }
@@ -1,29 +1,100 @@
 #pragma once
 
-#include <map>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <vector>
 
 #include "CrossWindow/CrossWindow.h"
+#include "SpscRing.h"
 
 enum class InputAxis
 {
 	MOUSE_X,
-	MOUSE_Y
+	MOUSE_Y,
+	COUNT
+};
+
+enum class InputEventType : uint8_t
+{
+	Key,
+	MouseButton,
+	MouseRaw,
+	LostFocus
+};
+
+// A single input change, timestamped when it arrived from the event loop
+struct InputEvent
+{
+	InputEventType type = InputEventType::Key;
+
+	// Arrival time in nanoseconds of the steady clock
+	int64_t timestamp = 0;
+
+	// Set for Key events
+	xwin::Key key = xwin::Key::KeysMax;
+
+	// Set for MouseButton events
+	xwin::MouseInput button = xwin::MouseInput::MouseInputMax;
+
+	// Set for Key and MouseButton events
+	xwin::ButtonState state = xwin::ButtonState::Released;
+
+	// Set for MouseRaw events
+	int deltaX = 0;
+	int deltaY = 0;
+
+	// Returns the current time in the same clock as timestamp
+	static int64_t now();
+};
+
+// How long events waited between arriving and being applied by processEvents()
+struct InputLatencyStats
+{
+	size_t events = 0;
+	double averageMs = 0;
+	double maxMs = 0;
 };
 
 // Used to query the state of key and mouse inputs.
-// Notify methods are called by the main event loop, and should not be used directly.
+// Notify methods are called by the event loop: they timestamp the change and queue it in a
+// lock-free ring, so the event loop and the update may run on different threads.
+// The update calls processEvents() to apply the queued changes before querying the state.
 class InputManager
 {
 public:
 	// Returns true if the given keyboard key is currently down
-	bool isDown(xwin::Key key);
+	bool isDown(xwin::Key key) const
+	{
+		size_t index = static_cast<size_t>(key);
+		return index < KEY_COUNT && keyStates[index];
+	}
 
 	// Returns true if the given mouse button is currently down
-	bool isDown(xwin::MouseInput mouseButton);
+	bool isDown(xwin::MouseInput mouseButton) const
+	{
+		size_t index = static_cast<size_t>(mouseButton);
+		return index < MOUSE_BUTTON_COUNT && mouseStates[index];
+	}
 
 	// Returns the value for a particular given axis.
 	// For Mouse values, it returns the number of pixels travelled during the current frame.
-	float getAxis(const InputAxis& inputAxis);
+	float getAxis(const InputAxis& inputAxis) const
+	{
+		return axisValues[static_cast<size_t>(inputAxis)];
+	}
+
+	// Applies every queued event to the key, button and axis state.
+	// Called by the update at the start of each frame.
+	// When given a vector, the applied events are appended to it (eg. to record them).
+	void processEvents(std::vector<InputEvent>* applied = nullptr);
+
+	// Returns the latency of the events applied by the last processEvents()
+	const InputLatencyStats& getLatencyStats() const { return latencyStats; }
+
+	// Returns the number of events lost because the queue was full
+	size_t getDroppedEventCount() const { return droppedEvents.load(std::memory_order_relaxed); }
 
 	// Called each frame at the very end to clean up data to prepare for the next update
 	void notifyUpdateFinished();
@@ -40,8 +111,26 @@ public:
 	// Called by event loop when raw mouse movement occurs
 	void notifyMouseRawInput(int xDelta, int yDelta);
 
+	// Queues an already built event. The notify methods go through this.
+	void postEvent(const InputEvent& event);
+
 private:
-	std::map<xwin::Key, bool> keyStates;
-	std::map<xwin::MouseInput, bool> mouseStates;
-	std::map<InputAxis, float> axisValues;
-};
\ No newline at end of file
+	// Applies a single event to the state
+	void applyEvent(const InputEvent& event);
+
+	static const size_t KEY_COUNT = static_cast<size_t>(xwin::Key::KeysMax);
+	static const size_t MOUSE_BUTTON_COUNT = static_cast<size_t>(xwin::MouseInput::MouseInputMax);
+	static const size_t AXIS_COUNT = static_cast<size_t>(InputAxis::COUNT);
+
+	std::bitset<KEY_COUNT> keyStates;
+	std::bitset<MOUSE_BUTTON_COUNT> mouseStates;
+	std::array<float, AXIS_COUNT> axisValues = {};
+
+	// Events from the event loop waiting to be applied
+	SpscRing<InputEvent, 1024> eventQueue;
+
+	// counted by the producer, read by anyone
+	std::atomic<size_t> droppedEvents{ 0 };
+
+	InputLatencyStats latencyStats;
+};
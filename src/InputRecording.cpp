@@ -0,0 +1,198 @@
+#include "InputRecording.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	void writeU8(std::vector<uint8_t>& out, uint8_t value)
+	{
+		out.push_back(value);
+	}
+
+	void writeU16(std::vector<uint8_t>& out, uint16_t value)
+	{
+		out.push_back(uint8_t(value));
+		out.push_back(uint8_t(value >> 8));
+	}
+
+	void writeU32(std::vector<uint8_t>& out, uint32_t value)
+	{
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			out.push_back(uint8_t(value >> shift));
+		}
+	}
+
+	// Reads little-endian values from a stream, throwing when it ends early
+	class StreamReader
+	{
+	public:
+		explicit StreamReader(std::istream& in) : in{ in } {}
+
+		// Returns true at the end of the stream, checked at the start of a frame
+		bool atEnd()
+		{
+			return in.peek() == std::char_traits<char>::eof();
+		}
+
+		uint8_t readU8()
+		{
+			uint8_t value;
+			read(&value, 1);
+			return value;
+		}
+
+		uint16_t readU16()
+		{
+			uint8_t bytes[2];
+			read(bytes, 2);
+			return uint16_t(bytes[0] | (bytes[1] << 8));
+		}
+
+		uint32_t readU32()
+		{
+			uint8_t bytes[4];
+			read(bytes, 4);
+			return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+		}
+
+		void read(void* data, size_t size)
+		{
+			in.read(static_cast<char*>(data), size);
+			if (size_t(in.gcount()) != size)
+			{
+				throw std::runtime_error("Input recording is truncated");
+			}
+		}
+
+	private:
+		std::istream& in;
+	};
+}
+
+InputRecorder::InputRecorder(std::ostream& out) : out{ out }
+{
+	std::vector<uint8_t> header(INPUT_RECORDING_MAGIC, INPUT_RECORDING_MAGIC + sizeof(INPUT_RECORDING_MAGIC));
+	writeU32(header, INPUT_RECORDING_VERSION);
+	out.write(reinterpret_cast<const char*>(header.data()), header.size());
+}
+
+void InputRecorder::writeFrame(float deltaSeconds, const std::vector<InputEvent>& frameEvents)
+{
+	buffer.clear();
+
+	uint32_t deltaBits;
+	std::memcpy(&deltaBits, &deltaSeconds, sizeof(deltaBits));
+	writeU32(buffer, deltaBits);
+	writeU32(buffer, static_cast<uint32_t>(frameEvents.size()));
+
+	for (const InputEvent& event : frameEvents)
+	{
+		writeU8(buffer, static_cast<uint8_t>(event.type));
+		switch (event.type)
+		{
+		case InputEventType::Key:
+			writeU16(buffer, static_cast<uint16_t>(event.key));
+			writeU8(buffer, static_cast<uint8_t>(event.state));
+			break;
+		case InputEventType::MouseButton:
+			writeU16(buffer, static_cast<uint16_t>(event.button));
+			writeU8(buffer, static_cast<uint8_t>(event.state));
+			break;
+		case InputEventType::MouseRaw:
+			writeU32(buffer, static_cast<uint32_t>(event.deltaX));
+			writeU32(buffer, static_cast<uint32_t>(event.deltaY));
+			break;
+		case InputEventType::LostFocus:
+			break;
+		}
+	}
+
+	out.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	frames++;
+	events += frameEvents.size();
+}
+
+InputReplayer::InputReplayer(std::istream& in, const InputReplayOptions& options) : in{ in }, options{ options }
+{
+	char magic[4] = {};
+	in.read(magic, sizeof(magic));
+	if (in.gcount() != sizeof(magic) || std::memcmp(magic, INPUT_RECORDING_MAGIC, sizeof(magic)) != 0)
+	{
+		throw std::runtime_error("Not an input recording");
+	}
+
+	uint32_t version = StreamReader(in).readU32();
+	if (version != INPUT_RECORDING_VERSION)
+	{
+		throw std::runtime_error("Unsupported input recording version " + std::to_string(version));
+	}
+}
+
+bool InputReplayer::readFrame(InputFrame& frame)
+{
+	StreamReader reader(in);
+	if (reader.atEnd())
+	{
+		return false;
+	}
+
+	uint32_t deltaBits = reader.readU32();
+	std::memcpy(&frame.deltaSeconds, &deltaBits, sizeof(deltaBits));
+	if (options.fixedDeltaSeconds > 0)
+	{
+		frame.deltaSeconds = options.fixedDeltaSeconds;
+	}
+
+	uint32_t count = reader.readU32();
+	frame.events.clear();
+	for (uint32_t i = 0; i < count; i++)
+	{
+		InputEvent event;
+		uint8_t type = reader.readU8();
+		if (type > static_cast<uint8_t>(InputEventType::LostFocus))
+		{
+			throw std::runtime_error("Input recording has an unknown event type");
+		}
+
+		event.type = static_cast<InputEventType>(type);
+		switch (event.type)
+		{
+		case InputEventType::Key:
+			event.key = static_cast<xwin::Key>(reader.readU16());
+			event.state = static_cast<xwin::ButtonState>(reader.readU8());
+			break;
+		case InputEventType::MouseButton:
+			event.button = static_cast<xwin::MouseInput>(reader.readU16());
+			event.state = static_cast<xwin::ButtonState>(reader.readU8());
+			break;
+		case InputEventType::MouseRaw:
+			event.deltaX = static_cast<int32_t>(reader.readU32());
+			event.deltaY = static_cast<int32_t>(reader.readU32());
+			break;
+		case InputEventType::LostFocus:
+			break;
+		}
+		frame.events.push_back(event);
+	}
+
+	frames++;
+	return true;
+}
+
+bool InputReplayer::nextFrame(InputManager& input, float& deltaSeconds)
+{
+	if (!readFrame(frame))
+	{
+		return false;
+	}
+
+	for (const InputEvent& event : frame.events)
+	{
+		input.postEvent(event);
+	}
+	deltaSeconds = frame.deltaSeconds;
+	return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "InputManager.h"
+
+const char INPUT_RECORDING_MAGIC[4] = { 'M', 'V', 'I', 'R' };
+const uint32_t INPUT_RECORDING_VERSION = 1;
+
+// One update of a recorded session: the frame time and the input events applied before it.
+// Event timestamps aren't recorded, they depend on when the session is played.
+struct InputFrame
+{
+	float deltaSeconds = 0;
+	std::vector<InputEvent> events;
+};
+
+// Writes the input of a session, frame by frame, so it can be played back with InputReplayer.
+// Layout: the magic and version, then per frame the frame time (float), the event count (uint32)
+// and the events, each a type byte followed by its fields. Values are little-endian.
+class InputRecorder
+{
+public:
+	// Writes the header. The stream must be binary and outlive the recorder.
+	explicit InputRecorder(std::ostream& out);
+
+	// Appends a frame: its time and the events processEvents() applied before the update
+	void writeFrame(float deltaSeconds, const std::vector<InputEvent>& events);
+
+	size_t getFrameCount() const { return frames; }
+	size_t getEventCount() const { return events; }
+
+private:
+	std::ostream& out;
+
+	// encoded frame, reused
+	std::vector<uint8_t> buffer;
+
+	size_t frames = 0;
+	size_t events = 0;
+};
+
+// How a recorded session is played back
+struct InputReplayOptions
+{
+	// When above 0, every frame takes this long instead of its recorded time
+	float fixedDeltaSeconds = 0;
+};
+
+// Plays back a session written by InputRecorder.
+// Feeding its frames to the same update in the same order gives the same transforms every run,
+// on any machine, since nothing depends on the wall clock or on when the events arrive.
+class InputReplayer
+{
+public:
+	// Reads the header. Throws std::runtime_error if the stream isn't a recording.
+	explicit InputReplayer(std::istream& in, const InputReplayOptions& options = {});
+
+	// Reads the next frame. Returns false at the end of the session.
+	// Throws std::runtime_error if the recording is truncated or corrupt.
+	bool readFrame(InputFrame& frame);
+
+	// Reads the next frame and queues its events in the input manager, to be applied by processEvents().
+	// Returns false at the end of the session.
+	bool nextFrame(InputManager& input, float& deltaSeconds);
+
+	size_t getFrameCount() const { return frames; }
+
+private:
+	std::istream& in;
+	InputReplayOptions options;
+	InputFrame frame;
+	size_t frames = 0;
+};
@@ -0,0 +1,170 @@
+#include "JobSystem.h"
+
+namespace
+{
+	// set on worker threads and while the caller runs a batch, so nested batches run inline
+	thread_local bool insideBatch = false;
+
+	// Marks the calling thread as running a batch until the scope ends, even when a task throws
+	class BatchScope
+	{
+	public:
+		BatchScope() : previous{ insideBatch } { insideBatch = true; }
+		~BatchScope() { insideBatch = previous; }
+
+		BatchScope(const BatchScope&) = delete;
+		BatchScope& operator=(const BatchScope&) = delete;
+
+	private:
+		bool previous;
+	};
+}
+
+unsigned JobSystem::defaultWorkerCount()
+{
+	unsigned hardware = std::thread::hardware_concurrency();
+	return hardware > 1 ? hardware - 1 : 0;
+}
+
+JobSystem& JobSystem::getDefault()
+{
+	static JobSystem jobSystem;
+	return jobSystem;
+}
+
+JobSystem::JobSystem(unsigned workerCount)
+{
+	workers.reserve(workerCount);
+	for (unsigned i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back([this]() { workerLoop(); });
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void JobSystem::parallelFor(size_t count, const std::function<void(size_t)>& function)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (insideBatch || workers.empty() || count == 1)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			function(i);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> submitLock(submitMutex);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		task = &function;
+		taskCount = count;
+		nextTask = 0;
+		doneTasks = 0;
+		error = nullptr;
+		failed = false;
+		generation++;
+	}
+	wake.notify_all();
+
+	{
+		BatchScope scope;
+		runTasks();
+	}
+
+	// wait for the tasks still running on workers, and for the workers to leave the batch,
+	// since the function only lives until we return
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [&]() { return doneTasks == taskCount && activeWorkers == 0; });
+	task = nullptr;
+
+	if (error)
+	{
+		std::exception_ptr thrown = error;
+		error = nullptr;
+		std::rethrow_exception(thrown);
+	}
+}
+
+void JobSystem::runTasks()
+{
+	while (true)
+	{
+		size_t index = nextTask.fetch_add(1);
+		if (index >= taskCount)
+		{
+			return;
+		}
+
+		// after a failure the remaining tasks are only counted, the batch is rethrowing anyway
+		if (!failed.load(std::memory_order_relaxed))
+		{
+			try
+			{
+				(*task)(index);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!error)
+				{
+					error = std::current_exception();
+				}
+				failed = true;
+			}
+		}
+
+		if (doneTasks.fetch_add(1) + 1 == taskCount)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finished.notify_all();
+		}
+	}
+}
+
+void JobSystem::workerLoop()
+{
+	insideBatch = true;
+	uint64_t seenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&]() { return stopping || (generation != seenGeneration && task != nullptr); });
+			if (stopping)
+			{
+				return;
+			}
+
+			seenGeneration = generation;
+			activeWorkers++;
+		}
+
+		runTasks();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			activeWorkers--;
+		}
+		finished.notify_all();
+	}
+}
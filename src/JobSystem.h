@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed pool of worker threads that runs batches of independent tasks.
+// The calling thread works on the batch too, so a pool of 0 workers runs everything inline.
+class JobSystem
+{
+public:
+	// Creates the workers. By default one less than the hardware threads, the caller is the last one.
+	explicit JobSystem(unsigned workerCount = defaultWorkerCount());
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// Calls task(i) for every i in [0, count), spread over the workers and the calling thread.
+	// Returns once every task has finished. Calls from inside a task run inline.
+	// If tasks throw, the tasks not started yet are skipped and the first exception is rethrown here.
+	void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+	// Number of threads working on a batch, including the caller
+	unsigned getThreadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+	// Shared pool for engine subsystems
+	static JobSystem& getDefault();
+
+	static unsigned defaultWorkerCount();
+
+private:
+	void workerLoop();
+
+	// Runs tasks of the current batch until none are left
+	void runTasks();
+
+	std::vector<std::thread> workers;
+
+	// serializes batches submitted from different threads
+	std::mutex submitMutex;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	uint64_t generation = 0;
+	bool stopping = false;
+
+	const std::function<void(size_t)>* task = nullptr;
+	size_t taskCount = 0;
+	std::atomic<size_t> nextTask{ 0 };
+	std::atomic<size_t> doneTasks{ 0 };
+	unsigned activeWorkers = 0;
+
+	// first exception thrown by a task of the current batch
+	std::exception_ptr error;
+	std::atomic<bool> failed{ false };
+};
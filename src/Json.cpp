@@ -0,0 +1,335 @@
+#include "Json.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	const JsonValue NULL_VALUE;
+
+	// Nesting deeper than this is rejected instead of overflowing the stack
+	const unsigned MAX_DEPTH = 256;
+
+	void appendUtf8(std::string& out, uint32_t codepoint)
+	{
+		if (codepoint < 0x80)
+		{
+			out += static_cast<char>(codepoint);
+		}
+		else if (codepoint < 0x800)
+		{
+			out += static_cast<char>(0xc0 | (codepoint >> 6));
+			out += static_cast<char>(0x80 | (codepoint & 0x3f));
+		}
+		else if (codepoint < 0x10000)
+		{
+			out += static_cast<char>(0xe0 | (codepoint >> 12));
+			out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+			out += static_cast<char>(0x80 | (codepoint & 0x3f));
+		}
+		else
+		{
+			out += static_cast<char>(0xf0 | (codepoint >> 18));
+			out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f));
+			out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+			out += static_cast<char>(0x80 | (codepoint & 0x3f));
+		}
+	}
+}
+
+// Recursive descent over the text, fills values in place
+class JsonParser
+{
+public:
+	JsonParser(const char* text, size_t size) : text{ text }, end{ text + size }, position{ text } {}
+
+	void parseDocument(JsonValue& value)
+	{
+		parseValue(value, 0);
+		skipWhitespace();
+		if (position != end)
+		{
+			fail("unexpected data after the document");
+		}
+	}
+
+private:
+	[[noreturn]] void fail(const char* message) const
+	{
+		throw std::runtime_error(std::string("Invalid JSON at offset ") + std::to_string(position - text) + ": " + message);
+	}
+
+	void skipWhitespace()
+	{
+		while (position != end && (*position == ' ' || *position == '\t' || *position == '\n' || *position == '\r'))
+		{
+			position++;
+		}
+	}
+
+	void expect(const char* word)
+	{
+		size_t length = std::strlen(word);
+		if (size_t(end - position) < length || std::memcmp(position, word, length) != 0)
+		{
+			fail("unknown literal");
+		}
+		position += length;
+	}
+
+	void parseValue(JsonValue& value, unsigned depth)
+	{
+		if (depth > MAX_DEPTH)
+		{
+			fail("nested too deep");
+		}
+
+		skipWhitespace();
+		if (position == end)
+		{
+			fail("unexpected end");
+		}
+
+		switch (*position)
+		{
+		case '{':
+			parseObject(value, depth);
+			break;
+		case '[':
+			parseArray(value, depth);
+			break;
+		case '"':
+			value.type = JsonValue::Type::String;
+			parseString(value.text);
+			break;
+		case 't':
+			expect("true");
+			value.type = JsonValue::Type::Bool;
+			value.boolean = true;
+			break;
+		case 'f':
+			expect("false");
+			value.type = JsonValue::Type::Bool;
+			value.boolean = false;
+			break;
+		case 'n':
+			expect("null");
+			value.type = JsonValue::Type::Null;
+			break;
+		default:
+			parseNumber(value);
+			break;
+		}
+	}
+
+	void parseObject(JsonValue& value, unsigned depth)
+	{
+		value.type = JsonValue::Type::Object;
+		position++;
+		skipWhitespace();
+		if (position != end && *position == '}')
+		{
+			position++;
+			return;
+		}
+
+		while (true)
+		{
+			skipWhitespace();
+			if (position == end || *position != '"')
+			{
+				fail("expected a member name");
+			}
+			value.keys.emplace_back();
+			parseString(value.keys.back());
+
+			skipWhitespace();
+			if (position == end || *position != ':')
+			{
+				fail("expected ':'");
+			}
+			position++;
+
+			value.items.emplace_back();
+			parseValue(value.items.back(), depth + 1);
+
+			skipWhitespace();
+			if (position != end && *position == ',')
+			{
+				position++;
+				continue;
+			}
+			if (position != end && *position == '}')
+			{
+				position++;
+				return;
+			}
+			fail("expected ',' or '}'");
+		}
+	}
+
+	void parseArray(JsonValue& value, unsigned depth)
+	{
+		value.type = JsonValue::Type::Array;
+		position++;
+		skipWhitespace();
+		if (position != end && *position == ']')
+		{
+			position++;
+			return;
+		}
+
+		while (true)
+		{
+			value.items.emplace_back();
+			parseValue(value.items.back(), depth + 1);
+
+			skipWhitespace();
+			if (position != end && *position == ',')
+			{
+				position++;
+				continue;
+			}
+			if (position != end && *position == ']')
+			{
+				position++;
+				return;
+			}
+			fail("expected ',' or ']'");
+		}
+	}
+
+	uint32_t parseHex4()
+	{
+		if (end - position < 4)
+		{
+			fail("truncated escape");
+		}
+
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			char c = *position++;
+			value <<= 4;
+			if (c >= '0' && c <= '9') value |= c - '0';
+			else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+			else fail("invalid escape");
+		}
+		return value;
+	}
+
+	void parseString(std::string& out)
+	{
+		// skip the opening quote
+		position++;
+		while (true)
+		{
+			// copy runs without escapes at once
+			const char* start = position;
+			while (position != end && *position != '"' && *position != '\\')
+			{
+				position++;
+			}
+			out.append(start, position);
+
+			if (position == end)
+			{
+				fail("unterminated string");
+			}
+			if (*position++ == '"')
+			{
+				return;
+			}
+
+			if (position == end)
+			{
+				fail("unterminated string");
+			}
+			char escape = *position++;
+			switch (escape)
+			{
+			case '"': out += '"'; break;
+			case '\\': out += '\\'; break;
+			case '/': out += '/'; break;
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+			{
+				uint32_t codepoint = parseHex4();
+				// surrogate pair
+				if (codepoint >= 0xd800 && codepoint < 0xdc00 && end - position >= 6 && position[0] == '\\' && position[1] == 'u')
+				{
+					position += 2;
+					uint32_t low = parseHex4();
+					codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (low - 0xdc00);
+				}
+				appendUtf8(out, codepoint);
+				break;
+			}
+			default:
+				fail("invalid escape");
+			}
+		}
+	}
+
+	void parseNumber(JsonValue& value)
+	{
+		// strtod needs a terminated string, numbers are short
+		char buffer[64];
+		size_t length = 0;
+		while (position + length != end && length < sizeof(buffer) - 1 && std::strchr("+-0123456789.eE", position[length]))
+		{
+			buffer[length] = position[length];
+			length++;
+		}
+		buffer[length] = '\0';
+
+		char* parsedEnd = nullptr;
+		value.number = std::strtod(buffer, &parsedEnd);
+		if (length == 0 || parsedEnd != buffer + length)
+		{
+			fail("invalid number");
+		}
+		value.type = JsonValue::Type::Number;
+		position += length;
+	}
+
+	const char* text;
+	const char* end;
+	const char* position;
+};
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	return type == Type::Array && index < items.size() ? items[index] : NULL_VALUE;
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const
+{
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		if (keys[i] == key)
+		{
+			return items[i];
+		}
+	}
+	return NULL_VALUE;
+}
+
+bool JsonValue::has(const std::string& key) const
+{
+	return !(*this)[key].isNull();
+}
+
+JsonValue parseJson(const char* text, size_t size)
+{
+	JsonValue value;
+	JsonParser parser(text, size);
+	parser.parseDocument(value);
+	return value;
+}
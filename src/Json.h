@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A parsed JSON document, read only.
+// Looking up a missing member or an index out of range returns a null value instead of throwing,
+// so optional fields read as json["a"]["b"].getNumber(fallback).
+class JsonValue
+{
+public:
+	enum class Type
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Type getType() const { return type; }
+	bool isNull() const { return type == Type::Null; }
+	bool isNumber() const { return type == Type::Number; }
+	bool isString() const { return type == Type::String; }
+	bool isArray() const { return type == Type::Array; }
+	bool isObject() const { return type == Type::Object; }
+
+	bool getBool(bool fallback = false) const { return type == Type::Bool ? boolean : fallback; }
+	double getNumber(double fallback = 0) const { return type == Type::Number ? number : fallback; }
+	const std::string& getString() const { return text; }
+
+	// Number of elements of an array, or members of an object
+	size_t size() const { return items.size(); }
+
+	const JsonValue& operator[](size_t index) const;
+	const JsonValue& operator[](const std::string& key) const;
+	bool has(const std::string& key) const;
+
+	// Member names of an object, in the order of the document. The values are at the same positions.
+	const std::vector<std::string>& getKeys() const { return keys; }
+
+private:
+	friend class JsonParser;
+
+	Type type = Type::Null;
+	bool boolean = false;
+	double number = 0;
+	std::string text;
+
+	// array elements, or object values
+	std::vector<JsonValue> items;
+	std::vector<std::string> keys;
+};
+
+// Parses a JSON document. Throws std::runtime_error with the offset of the first error.
+JsonValue parseJson(const char* text, size_t size);
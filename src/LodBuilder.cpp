@@ -0,0 +1,572 @@
+#include "LodBuilder.h"
+#include "LodFormat.h"
+#include "MappedFile.h"
+#include "ObjStreamLoader.h"
+#include "Hash.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const glm::vec3 DEFAULT_COLOR = { 0.8, 0.8, 0.8 };
+
+	// Triangles are moved to the partition file in blocks of this many
+	const size_t BLOCK_TRIANGLES = 4096;
+
+	// Grid cells are packed into a 64 bit key, 20 bits per axis
+	const unsigned MAX_LEVELS = 10;
+
+	// Vertex as kept in the temporary vertex file: position and accumulated normal
+	struct SourceVertex
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+	};
+
+	// A run of triangles of one leaf cell in the partition file
+	struct Block
+	{
+		uint64_t offset;
+		size_t triangles;
+	};
+
+	// Triangles of one leaf cell, three vertices each
+	struct Bucket
+	{
+		std::vector<SourceVertex> pending;
+		std::vector<Block> blocks;
+	};
+
+	// Geometry of a single node while it is being built
+	struct ChunkMesh
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned> indices;
+	};
+
+	// Removes a temporary file when it goes out of scope
+	struct TempFile
+	{
+		explicit TempFile(fs::path path) : path{ std::move(path) } {}
+		~TempFile()
+		{
+			std::error_code error;
+			fs::remove(path, error);
+		}
+
+		fs::path path;
+	};
+
+	fs::path makeTempPath(const fs::path& directory, const std::string& name)
+	{
+		static std::atomic<uint64_t> counter{ 0 };
+
+		Hasher hasher;
+		hasher.updateValue(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+		hasher.updateValue(counter.fetch_add(1));
+		hasher.updateValue(&counter);
+		return directory / ("lodbuild-" + hasher.finish().toHex().substr(0, 16) + "-" + name + ".tmp");
+	}
+
+	void checkStream(const std::ios& stream, const fs::path& path)
+	{
+		if (!stream)
+		{
+			throw std::runtime_error("Could not access " + path.string());
+		}
+	}
+
+	uint64_t cellKey(uint64_t x, uint64_t y, uint64_t z)
+	{
+		return x | (y << 20) | (z << 40);
+	}
+
+	void cellCoordinates(uint64_t key, uint64_t& x, uint64_t& y, uint64_t& z)
+	{
+		const uint64_t mask = (1 << 20) - 1;
+		x = key & mask;
+		y = (key >> 20) & mask;
+		z = (key >> 40) & mask;
+	}
+
+	uint64_t gridCell(const glm::vec3& position, const glm::vec3& origin, const glm::vec3& cellSize, uint64_t cellsPerAxis)
+	{
+		glm::vec3 cell = (position - origin) / cellSize;
+		uint64_t coords[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float value = std::floor(cell[axis]);
+			value = std::max(0.0f, std::min(value, float(cellsPerAxis - 1)));
+			coords[axis] = static_cast<uint64_t>(value);
+		}
+		return cellKey(coords[0], coords[1], coords[2]);
+	}
+
+	// Writes the streamed mesh into flat vertex and index files
+	class FileMeshSink : public MeshStreamSink
+	{
+	public:
+		FileMeshSink(const fs::path& vertexPath, const fs::path& indexPath) :
+			vertexPath{ vertexPath }, indexPath{ indexPath }
+		{
+			vertexFile.open(vertexPath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+			checkStream(vertexFile, vertexPath);
+			indexFile.open(indexPath, std::ios::out | std::ios::binary | std::ios::trunc);
+			checkStream(indexFile, indexPath);
+		}
+
+		void appendVertices(const Vertex* vertices, size_t count) override
+		{
+			updateVertices(vertexCount, vertices, count);
+			vertexCount += count;
+		}
+
+		void updateVertices(size_t first, const Vertex* vertices, size_t count) override
+		{
+			scratch.resize(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				scratch[i] = { vertices[i].position, vertices[i].normal };
+			}
+
+			vertexFile.seekp(std::streamoff(first * sizeof(SourceVertex)));
+			vertexFile.write(reinterpret_cast<const char*>(scratch.data()), count * sizeof(SourceVertex));
+			checkStream(vertexFile, vertexPath);
+		}
+
+		void appendIndices(const unsigned* indices, size_t count) override
+		{
+			indexFile.write(reinterpret_cast<const char*>(indices), count * sizeof(unsigned));
+			checkStream(indexFile, indexPath);
+		}
+
+		void close()
+		{
+			vertexFile.close();
+			indexFile.close();
+		}
+
+	private:
+		fs::path vertexPath;
+		fs::path indexPath;
+		std::fstream vertexFile;
+		std::ofstream indexFile;
+		std::vector<SourceVertex> scratch;
+		size_t vertexCount = 0;
+	};
+
+	// Merges vertices sharing a position. Normals of merged vertices are averaged.
+	ChunkMesh weldTriangles(const std::vector<SourceVertex>& triangles)
+	{
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& p) const { return static_cast<size_t>(hash64(&p, sizeof(p))); }
+		};
+
+		ChunkMesh mesh;
+		std::unordered_map<glm::vec3, unsigned, PositionHash> welded;
+		welded.reserve(triangles.size() / 2);
+		mesh.indices.reserve(triangles.size());
+
+		for (const SourceVertex& source : triangles)
+		{
+			auto result = welded.emplace(source.position, static_cast<unsigned>(mesh.vertices.size()));
+			if (result.second)
+			{
+				Vertex vertex(source.position, DEFAULT_COLOR);
+				vertex.normal = source.normal;
+				mesh.vertices.push_back(vertex);
+			}
+			else
+			{
+				mesh.vertices[result.first->second].normal += source.normal;
+			}
+			mesh.indices.push_back(result.first->second);
+		}
+
+		for (auto& vertex : mesh.vertices)
+		{
+			float length = glm::length(vertex.normal);
+			vertex.normal = length > 0 ? vertex.normal / length : glm::vec3(0, 1, 0);
+		}
+		return mesh;
+	}
+
+	// Vertex clustering: vertices in the same grid cell collapse into their average,
+	// triangles that collapse to a line or a point are dropped.
+	ChunkMesh simplify(const ChunkMesh& input, const glm::vec3& origin, const glm::vec3& clusterSize)
+	{
+		struct Cluster
+		{
+			glm::vec3 positionSum = { 0, 0, 0 };
+			glm::vec3 normalSum = { 0, 0, 0 };
+			unsigned count = 0;
+		};
+
+		std::unordered_map<uint64_t, unsigned> clusterIndex;
+		std::vector<Cluster> clusters;
+		std::vector<unsigned> remap(input.vertices.size());
+
+		for (size_t i = 0; i < input.vertices.size(); i++)
+		{
+			const Vertex& vertex = input.vertices[i];
+			uint64_t key = gridCell(vertex.position, origin, clusterSize, 1 << 20);
+			auto result = clusterIndex.emplace(key, static_cast<unsigned>(clusters.size()));
+			if (result.second)
+			{
+				clusters.emplace_back();
+			}
+
+			Cluster& cluster = clusters[result.first->second];
+			cluster.positionSum += vertex.position;
+			cluster.normalSum += vertex.normal;
+			cluster.count++;
+			remap[i] = result.first->second;
+		}
+
+		ChunkMesh output;
+		output.vertices.reserve(clusters.size());
+		for (const Cluster& cluster : clusters)
+		{
+			Vertex vertex(cluster.positionSum / float(cluster.count), DEFAULT_COLOR);
+			float length = glm::length(cluster.normalSum);
+			vertex.normal = length > 0 ? cluster.normalSum / length : glm::vec3(0, 1, 0);
+			output.vertices.push_back(vertex);
+		}
+
+		for (size_t i = 0; i + 2 < input.indices.size(); i += 3)
+		{
+			unsigned a = remap[input.indices[i]];
+			unsigned b = remap[input.indices[i + 1]];
+			unsigned c = remap[input.indices[i + 2]];
+			if (a != b && b != c && a != c)
+			{
+				output.indices.push_back(a);
+				output.indices.push_back(b);
+				output.indices.push_back(c);
+			}
+		}
+		return output;
+	}
+
+	// Appends node data to the output file at an aligned offset
+	class LodWriter
+	{
+	public:
+		explicit LodWriter(const fs::path& path) : path{ path }
+		{
+			file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+			checkStream(file, path);
+
+			// room for the header, written last
+			LodFileHeader header = {};
+			write(&header, sizeof(header));
+		}
+
+		uint32_t writeNode(const ChunkMesh& mesh, uint32_t level, float geometricError)
+		{
+			LodNode node = {};
+			node.level = level;
+			node.geometricError = geometricError;
+			node.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+			node.indexCount = static_cast<uint32_t>(mesh.indices.size());
+			std::fill(std::begin(node.children), std::end(node.children), LOD_NO_NODE);
+
+			if (!mesh.vertices.empty())
+			{
+				node.boundsMin = node.boundsMax = mesh.vertices[0].position;
+				for (auto& vertex : mesh.vertices)
+				{
+					node.boundsMin = glm::min(node.boundsMin, vertex.position);
+					node.boundsMax = glm::max(node.boundsMax, vertex.position);
+				}
+			}
+
+			align(LOD_DATA_ALIGNMENT);
+			node.dataOffset = size;
+			write(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+			write(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned));
+			node.dataBytes = size - node.dataOffset;
+
+			nodes.push_back(node);
+			return static_cast<uint32_t>(nodes.size() - 1);
+		}
+
+		ChunkMesh readNode(uint32_t index)
+		{
+			const LodNode& node = nodes[index];
+			ChunkMesh mesh;
+			mesh.vertices.resize(node.vertexCount);
+			mesh.indices.resize(node.indexCount);
+
+			file.seekg(std::streamoff(node.dataOffset));
+			file.read(reinterpret_cast<char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+			file.read(reinterpret_cast<char*>(mesh.indices.data()), mesh.indices.size() * sizeof(unsigned));
+			checkStream(file, path);
+			return mesh;
+		}
+
+		LodNode& getNode(uint32_t index) { return nodes[index]; }
+
+		// Writes the node table and the header
+		uint64_t finish(uint32_t rootNode, uint64_t sourceTriangles)
+		{
+			align(sizeof(uint64_t));
+			LodFileHeader header = {};
+			std::memcpy(header.magic, LOD_FILE_MAGIC, sizeof(LOD_FILE_MAGIC));
+			header.version = LOD_FILE_VERSION;
+			header.nodeCount = static_cast<uint32_t>(nodes.size());
+			header.rootNode = rootNode;
+			header.nodeTableOffset = size;
+			header.sourceTriangles = sourceTriangles;
+			header.boundsMin = nodes[rootNode].boundsMin;
+			header.boundsMax = nodes[rootNode].boundsMax;
+
+			write(nodes.data(), nodes.size() * sizeof(LodNode));
+
+			file.seekp(0);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.close();
+			checkStream(file, path);
+			return size;
+		}
+
+	private:
+		void write(const void* data, size_t bytes)
+		{
+			file.seekp(std::streamoff(size));
+			file.write(static_cast<const char*>(data), bytes);
+			checkStream(file, path);
+			size += bytes;
+		}
+
+		void align(uint64_t alignment)
+		{
+			static const char zeros[LOD_DATA_ALIGNMENT] = {};
+			uint64_t padding = (alignment - size % alignment) % alignment;
+			write(zeros, static_cast<size_t>(padding));
+		}
+
+		fs::path path;
+		std::fstream file;
+		uint64_t size = 0;
+		std::vector<LodNode> nodes;
+	};
+}
+
+LodBuildStats buildLodFile(const std::filesystem::path& objPath, const std::filesystem::path& outputPath, const LodBuildOptions& options)
+{
+	auto file = std::make_unique<std::ifstream>(objPath);
+	if (!*file)
+	{
+		throw std::runtime_error("Could not open model file " + objPath.string());
+	}
+	return buildLodFile(std::move(file), outputPath, options);
+}
+
+LodBuildStats buildLodFile(std::unique_ptr<std::istream> obj, const std::filesystem::path& outputPath, const LodBuildOptions& options)
+{
+	LodBuildStats stats;
+	TempFile vertexFile(makeTempPath(options.tempDirectory, "vertices"));
+	TempFile indexFile(makeTempPath(options.tempDirectory, "indices"));
+	TempFile partitionFile(makeTempPath(options.tempDirectory, "partition"));
+
+	// Pass 1: stream the OBJ into flat files, the loader keeps half of the memory limit
+	glm::vec3 boundsMin, boundsMax;
+	{
+		ObjStreamOptions streamOptions;
+		streamOptions.memoryLimit = options.memoryLimit / 2;
+		streamOptions.spillDirectory = options.tempDirectory;
+		ObjStreamLoader loader(std::move(obj), 0, streamOptions);
+
+		FileMeshSink sink(vertexFile.path, indexFile.path);
+		while (loader.step(sink))
+		{
+		}
+		sink.close();
+
+		stats.sourceVertices = loader.getStats().vertices;
+		stats.sourceTriangles = loader.getStats().indices / 3;
+		boundsMin = loader.getBoundsMin();
+		boundsMax = loader.getBoundsMax();
+	}
+
+	if (stats.sourceTriangles == 0)
+	{
+		throw std::runtime_error("Model has no triangles");
+	}
+
+	// A surface covers roughly 4 of the 8 children of a cell, so size the grid for that
+	size_t leafTarget = static_cast<size_t>((stats.sourceTriangles + options.leafTriangles - 1) / std::max<size_t>(options.leafTriangles, 1));
+	uint32_t levels = 0;
+	while ((uint64_t(1) << (2 * levels)) < leafTarget && levels < MAX_LEVELS)
+	{
+		levels++;
+	}
+	stats.levels = levels + 1;
+
+	uint64_t cellsPerAxis = uint64_t(1) << levels;
+	glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+
+	// Pass 2: bucket the triangles into leaf cells by their centroid
+	std::map<uint64_t, Bucket> buckets;
+	{
+		MappedFile vertices;
+		if (!vertices.open(vertexFile.path))
+		{
+			throw std::runtime_error("Could not map " + vertexFile.path.string());
+		}
+		const SourceVertex* source = reinterpret_cast<const SourceVertex*>(vertices.data());
+
+		std::ifstream indices(indexFile.path, std::ios::binary);
+		checkStream(indices, indexFile.path);
+		std::fstream partition(partitionFile.path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+		checkStream(partition, partitionFile.path);
+
+		uint64_t partitionSize = 0;
+		size_t pendingBytes = 0;
+		size_t pendingLimit = options.memoryLimit / 2;
+
+		auto flushBucket = [&](Bucket& bucket) {
+			if (bucket.pending.empty())
+			{
+				return;
+			}
+
+			size_t bytes = bucket.pending.size() * sizeof(SourceVertex);
+			partition.write(reinterpret_cast<const char*>(bucket.pending.data()), bytes);
+			checkStream(partition, partitionFile.path);
+			bucket.blocks.push_back({ partitionSize, bucket.pending.size() / 3 });
+			partitionSize += bytes;
+			pendingBytes -= bytes;
+			bucket.pending = std::vector<SourceVertex>();
+		};
+
+		glm::vec3 cellSize = extent / float(cellsPerAxis);
+		std::vector<unsigned> chunk(3 * 65536);
+		while (indices)
+		{
+			indices.read(reinterpret_cast<char*>(chunk.data()), chunk.size() * sizeof(unsigned));
+			size_t count = static_cast<size_t>(indices.gcount()) / sizeof(unsigned);
+
+			for (size_t i = 0; i + 2 < count; i += 3)
+			{
+				const SourceVertex& a = source[chunk[i]];
+				const SourceVertex& b = source[chunk[i + 1]];
+				const SourceVertex& c = source[chunk[i + 2]];
+				glm::vec3 centroid = (a.position + b.position + c.position) / 3.0f;
+
+				Bucket& bucket = buckets[gridCell(centroid, boundsMin, cellSize, cellsPerAxis)];
+				bucket.pending.push_back(a);
+				bucket.pending.push_back(b);
+				bucket.pending.push_back(c);
+				pendingBytes += 3 * sizeof(SourceVertex);
+
+				if (bucket.pending.size() >= 3 * BLOCK_TRIANGLES)
+				{
+					flushBucket(bucket);
+				}
+			}
+
+			if (pendingBytes > pendingLimit)
+			{
+				for (auto& entry : buckets)
+				{
+					flushBucket(entry.second);
+				}
+			}
+		}
+
+		for (auto& entry : buckets)
+		{
+			flushBucket(entry.second);
+		}
+	}
+
+	LodWriter writer(outputPath);
+
+	// Pass 3: weld and write the leaves
+	std::map<uint64_t, uint32_t> levelNodes;
+	{
+		std::ifstream partition(partitionFile.path, std::ios::binary);
+		checkStream(partition, partitionFile.path);
+
+		std::vector<SourceVertex> triangles;
+		for (auto& entry : buckets)
+		{
+			triangles.clear();
+			for (const Block& block : entry.second.blocks)
+			{
+				size_t first = triangles.size();
+				triangles.resize(first + block.triangles * 3);
+				partition.seekg(std::streamoff(block.offset));
+				partition.read(reinterpret_cast<char*>(triangles.data() + first), block.triangles * 3 * sizeof(SourceVertex));
+				checkStream(partition, partitionFile.path);
+			}
+
+			levelNodes[entry.first] = writer.writeNode(weldTriangles(triangles), levels, 0.0f);
+			stats.leaves++;
+		}
+	}
+	buckets.clear();
+
+	// Pass 4: build each level from the one below it
+	for (uint32_t level = levels; level > 0; level--)
+	{
+		std::map<uint64_t, std::vector<std::pair<unsigned, uint32_t>>> parents;
+		for (auto& entry : levelNodes)
+		{
+			uint64_t x, y, z;
+			cellCoordinates(entry.first, x, y, z);
+			unsigned octant = unsigned((x & 1) | ((y & 1) << 1) | ((z & 1) << 2));
+			parents[cellKey(x >> 1, y >> 1, z >> 1)].push_back({ octant, entry.second });
+		}
+
+		glm::vec3 parentCellSize = extent / float(uint64_t(1) << (level - 1));
+		glm::vec3 clusterSize = parentCellSize / float(std::max(options.clusterResolution, 1u));
+
+		std::map<uint64_t, uint32_t> parentNodes;
+		for (auto& entry : parents)
+		{
+			ChunkMesh merged;
+			float childError = 0.0f;
+			for (auto& child : entry.second)
+			{
+				ChunkMesh childMesh = writer.readNode(child.second);
+				unsigned base = static_cast<unsigned>(merged.vertices.size());
+				merged.vertices.insert(merged.vertices.end(), childMesh.vertices.begin(), childMesh.vertices.end());
+				for (unsigned index : childMesh.indices)
+				{
+					merged.indices.push_back(base + index);
+				}
+				childError = std::max(childError, writer.getNode(child.second).geometricError);
+			}
+
+			// errors only grow towards the root, so refining always gets closer to the source
+			float error = glm::length(clusterSize) + childError;
+			uint32_t parent = writer.writeNode(simplify(merged, boundsMin, clusterSize), level - 1, error);
+
+			for (auto& child : entry.second)
+			{
+				writer.getNode(parent).children[child.first] = child.second;
+			}
+			parentNodes[entry.first] = parent;
+		}
+
+		levelNodes = std::move(parentNodes);
+	}
+
+	uint32_t root = levelNodes.begin()->second;
+	stats.outputBytes = writer.finish(root, stats.sourceTriangles);
+	stats.nodes = root + 1;
+	return stats;
+}
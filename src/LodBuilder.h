@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <memory>
+
+struct LodBuildOptions
+{
+	// Leaves are sized to hold about this many triangles
+	size_t leafTriangles = 65536;
+
+	// Every parent is simplified onto a grid of this many cells per axis
+	unsigned clusterResolution = 64;
+
+	// Most memory used while building. The source mesh is kept in temporary files instead.
+	size_t memoryLimit = 512 * 1024 * 1024;
+
+	// Where the temporary files are created
+	std::filesystem::path tempDirectory = std::filesystem::temp_directory_path();
+};
+
+struct LodBuildStats
+{
+	uint64_t sourceVertices = 0;
+	uint64_t sourceTriangles = 0;
+	uint32_t nodes = 0;
+	uint32_t leaves = 0;
+	uint32_t levels = 0;
+	uint64_t outputBytes = 0;
+};
+
+// Preprocesses an OBJ file into an out-of-core LOD file (see LodFormat.h).
+// Works in passes over temporary files, so the source can be far larger than memory:
+//  1. the OBJ is streamed into flat vertex and index files
+//  2. triangles are bucketed into the leaf cells of a uniform grid
+//  3. each leaf is welded and written
+//  4. parents are built bottom up by clustering the vertices of their children
+// Throws std::runtime_error if a file can't be read or written.
+LodBuildStats buildLodFile(const std::filesystem::path& objPath, const std::filesystem::path& outputPath,
+	const LodBuildOptions& options = {});
+
+// Same as above, reading the OBJ from a stream
+LodBuildStats buildLodFile(std::unique_ptr<std::istream> obj, const std::filesystem::path& outputPath,
+	const LodBuildOptions& options = {});
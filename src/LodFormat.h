@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/vec3.hpp>
+
+// Layout of the out-of-core LOD files (.mvlod) written by buildLodFile() and read by LodStreamer.
+//
+// The file holds a tree of mesh chunks. Leaves hold the full resolution triangles of one cell of
+// a uniform grid, and every parent holds a simplified version of its children's triangles.
+// The data of each node is Vertex[vertexCount] followed by uint32 indices[indexCount], in the
+// same layout the GPU buffers use, starting at a page aligned offset so it can be mapped and
+// dropped on its own.
+//
+//   LodFileHeader | node data ... | LodNode[nodeCount]
+
+const char LOD_FILE_MAGIC[4] = { 'M', 'V', 'L', 'D' };
+const uint32_t LOD_FILE_VERSION = 1;
+
+// Node data offsets are aligned to this
+const uint64_t LOD_DATA_ALIGNMENT = 4096;
+
+// Marks an unused child slot
+const uint32_t LOD_NO_NODE = 0xFFFFFFFF;
+
+struct LodFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t nodeCount;
+	uint32_t rootNode;
+	uint64_t nodeTableOffset;
+	uint64_t sourceTriangles;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+struct LodNode
+{
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	// Largest distance between this node's surface and the full resolution one, in model units.
+	// Zero for leaves.
+	float geometricError;
+
+	// Depth in the tree, the root is 0
+	uint32_t level;
+
+	uint32_t children[8];
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint64_t dataOffset;
+	uint64_t dataBytes;
+};
+
+static_assert(sizeof(glm::vec3) == 12, "LOD files store glm::vec3 directly");
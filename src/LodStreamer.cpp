@@ -0,0 +1,307 @@
+#include "LodStreamer.h"
+#include "MemoryStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+	// The process' resident memory is read from the OS this often, in updates
+	const uint64_t RESIDENT_SAMPLE_FRAMES = 30;
+
+	// A node handed to the OS for read ahead isn't handed again for this many updates
+	const uint64_t PREFETCH_REPEAT_FRAMES = 30;
+
+	// Weight of the newest value in the smoothed rates
+	const double SMOOTHING = 0.1;
+}
+
+LodStreamer::LodStreamer(const std::filesystem::path& path, UploadFunction upload, const LodStreamerOptions& options) :
+	upload{ std::move(upload) }, options{ options }
+{
+	if (!file.open(path))
+	{
+		throw std::runtime_error("Could not map LOD file " + path.string());
+	}
+
+	auto invalid = [&]() { return std::runtime_error("Invalid LOD file " + path.string()); };
+
+	if (file.size() < sizeof(LodFileHeader))
+	{
+		throw invalid();
+	}
+
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, LOD_FILE_MAGIC, sizeof(LOD_FILE_MAGIC)) != 0 || header.version != LOD_FILE_VERSION
+		|| header.nodeCount == 0 || header.rootNode >= header.nodeCount
+		|| header.nodeTableOffset > file.size()
+		|| (file.size() - header.nodeTableOffset) / sizeof(LodNode) < header.nodeCount)
+	{
+		throw invalid();
+	}
+
+	nodes.resize(header.nodeCount);
+	std::memcpy(nodes.data(), file.data() + header.nodeTableOffset, nodes.size() * sizeof(LodNode));
+	// the nodes must form a tree: every child is one level below its parent and has no other parent,
+	// so select() can't recurse forever or reach a node more than once
+	std::vector<bool> hasParent(nodes.size(), false);
+	for (const LodNode& node : nodes)
+	{
+		uint64_t expectedBytes = uint64_t(node.vertexCount) * sizeof(Vertex) + uint64_t(node.indexCount) * sizeof(unsigned);
+		if (node.dataBytes != expectedBytes || node.dataOffset % alignof(Vertex) != 0
+			|| node.dataOffset > file.size() || file.size() - node.dataOffset < node.dataBytes)
+		{
+			throw invalid();
+		}
+
+		for (uint32_t child : node.children)
+		{
+			if (child == LOD_NO_NODE)
+			{
+				continue;
+			}
+			if (child >= header.nodeCount || child == header.rootNode || hasParent[child] || nodes[child].level != node.level + 1)
+			{
+				throw invalid();
+			}
+			hasParent[child] = true;
+		}
+	}
+
+	// only the copy is used from now on
+	file.release(0, sizeof(LodFileHeader));
+	file.release(static_cast<size_t>(header.nodeTableOffset), nodes.size() * sizeof(LodNode));
+
+	states.resize(nodes.size());
+	resident = ResidentNodes(nodes.size());
+}
+
+float LodStreamer::getProjectionScale(float fovDegrees, unsigned screenHeight)
+{
+	return float(screenHeight) / (2.0f * std::tan(glm::radians(fovDegrees) * 0.5f));
+}
+
+float LodStreamer::getScreenError(const LodNode& node, const glm::vec3& cameraPosition, float projectionScale) const
+{
+	// distance to the node's bounding sphere, nodes around the camera get the full error
+	glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+	float radius = glm::length(node.boundsMax - node.boundsMin) * 0.5f;
+	float distance = std::max(glm::length(cameraPosition - center) - radius, 1e-3f);
+	return node.geometricError * projectionScale / distance;
+}
+
+void LodStreamer::select(uint32_t index, const glm::vec3& cameraPosition, const Frustum& frustum,
+	float projectionScale, bool collect, std::vector<Request>& requests)
+{
+	const LodNode& node = nodes[index];
+	NodeState& state = states[index];
+	if (!frustum.intersects(node.boundsMin, node.boundsMax))
+	{
+		return;
+	}
+
+	if (collect)
+	{
+		resident.markUsed(index, frame);
+	}
+
+	float error = getScreenError(node, cameraPosition, projectionScale);
+	bool hasChildren = std::any_of(std::begin(node.children), std::end(node.children),
+		[](uint32_t child) { return child != LOD_NO_NODE; });
+
+	if (hasChildren && error > options.maxScreenError)
+	{
+		// Refine only once every visible child is loaded, so no holes appear.
+		// Loaded children are kept from eviction while their siblings arrive.
+		bool childrenReady = true;
+		for (uint32_t child : node.children)
+		{
+			if (child == LOD_NO_NODE || !frustum.intersects(nodes[child].boundsMin, nodes[child].boundsMax))
+			{
+				continue;
+			}
+
+			if (!states[child].mesh)
+			{
+				childrenReady = false;
+				requests.push_back({ child, error });
+			}
+			else if (collect)
+			{
+				resident.markUsed(child, frame);
+			}
+		}
+
+		if (childrenReady)
+		{
+			for (uint32_t child : node.children)
+			{
+				if (child != LOD_NO_NODE)
+				{
+					select(child, cameraPosition, frustum, projectionScale, collect, requests);
+				}
+			}
+			return;
+		}
+	}
+
+	// draw this node, coarser than wanted if its children are still loading
+	if (state.mesh)
+	{
+		if (collect)
+		{
+			visible.push_back(state.mesh.get());
+			stats.visibleTriangles += node.indexCount / 3;
+		}
+	}
+	else
+	{
+		// nothing covers this part of the view, load it before anything else
+		requests.push_back({ index, std::numeric_limits<float>::max() });
+	}
+}
+
+void LodStreamer::update(const glm::vec3& cameraPosition, const glm::mat4x4& viewProjection, float projectionScale, float deltaSeconds)
+{
+	frame++;
+	stats.loadsThisFrame = 0;
+	stats.evictionsThisFrame = 0;
+	stats.prefetchesThisFrame = 0;
+	stats.visibleTriangles = 0;
+
+	// track the camera's motion, for prefetching and the bandwidth estimate
+	float distance = 0.0f;
+	if (hasPreviousPosition && deltaSeconds > 0)
+	{
+		glm::vec3 delta = cameraPosition - previousPosition;
+		distance = glm::length(delta);
+		velocity = glm::mix(velocity, delta / deltaSeconds, float(SMOOTHING));
+		stats.cameraSpeed += (distance / deltaSeconds - stats.cameraSpeed) * SMOOTHING;
+		travelledDistance += distance;
+	}
+	previousPosition = cameraPosition;
+	hasPreviousPosition = true;
+
+	// select what the current view needs
+	Frustum frustum(viewProjection);
+	visible.clear();
+	requests.clear();
+	select(header.rootNode, cameraPosition, frustum, projectionScale, true, requests);
+
+	std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b) {
+		return a.priority != b.priority ? a.priority > b.priority : a.node < b.node;
+	});
+
+	// load the most needed nodes within the frame's budget
+	auto evict = [this](uint32_t index) {
+		states[index].mesh.reset();
+		stats.evictionsThisFrame++;
+	};
+	size_t loadedBytes = 0;
+	size_t pending = 0;
+	for (const Request& request : requests)
+	{
+		if (states[request.node].mesh)
+		{
+			continue;
+		}
+
+		size_t bytes = static_cast<size_t>(nodes[request.node].dataBytes);
+		bool fits = loadedBytes == 0 || loadedBytes + bytes <= options.loadBytesPerFrame;
+		if (fits && resident.makeRoom(bytes, options.residentBudget, frame, evict) && load(request.node))
+		{
+			loadedBytes += bytes;
+		}
+		else
+		{
+			pending++;
+		}
+	}
+	stats.pendingNodes = pending;
+
+	// Read ahead what the view will need soon: what didn't fit this frame, then what the
+	// camera will see if it keeps moving the same way
+	prefetchRequests.clear();
+	if (options.prefetchSeconds > 0 && glm::length(velocity) > 0)
+	{
+		glm::vec3 offset = velocity * options.prefetchSeconds;
+		Frustum predictedFrustum(viewProjection * glm::translate(glm::mat4x4(1.0f), -offset));
+		select(header.rootNode, cameraPosition + offset, predictedFrustum, projectionScale, false, prefetchRequests);
+	}
+
+	size_t prefetchedBytes = 0;
+	for (auto* list : { &requests, &prefetchRequests })
+	{
+		for (const Request& request : *list)
+		{
+			NodeState& state = states[request.node];
+			if (state.mesh || (state.prefetched != 0 && frame - state.prefetched < PREFETCH_REPEAT_FRAMES))
+			{
+				continue;
+			}
+
+			const LodNode& node = nodes[request.node];
+			if (prefetchedBytes + node.dataBytes > options.prefetchBytesPerFrame)
+			{
+				break;
+			}
+
+			file.prefetch(static_cast<size_t>(node.dataOffset), static_cast<size_t>(node.dataBytes));
+			state.prefetched = frame;
+			prefetchedBytes += static_cast<size_t>(node.dataBytes);
+			stats.prefetchesThisFrame++;
+		}
+	}
+
+	// bandwidth
+	stats.loadedBytesTotal += loadedBytes;
+	if (deltaSeconds > 0)
+	{
+		stats.ioBytesPerSecond += (double(loadedBytes) / deltaSeconds - stats.ioBytesPerSecond) * SMOOTHING;
+	}
+	if (distance > 0)
+	{
+		bytesWhileMoving += loadedBytes;
+		stats.bytesPerDistance = double(bytesWhileMoving) / travelledDistance;
+	}
+
+	if (frame % RESIDENT_SAMPLE_FRAMES == 1)
+	{
+		stats.processResidentBytes = MemoryStats::getProcessResidentBytes();
+	}
+
+	stats.visibleNodes = visible.size();
+	stats.residentNodes = resident.getCount();
+	stats.residentBytes = resident.getBytes();
+}
+
+bool LodStreamer::load(uint32_t index)
+{
+	const LodNode& node = nodes[index];
+	const unsigned char* data = file.data() + node.dataOffset;
+	const Vertex* vertices = reinterpret_cast<const Vertex*>(data);
+	const unsigned* indices = reinterpret_cast<const unsigned*>(data + size_t(node.vertexCount) * sizeof(Vertex));
+
+	MeshResourcePtr mesh = upload(vertices, node.vertexCount, indices, node.indexCount);
+
+	// the data now lives wherever it was uploaded, the mapped copy can go
+	file.release(static_cast<size_t>(node.dataOffset), static_cast<size_t>(node.dataBytes));
+
+	if (!mesh)
+	{
+		return false;
+	}
+
+	mesh->boundsMin = node.boundsMin;
+	mesh->boundsMax = node.boundsMax;
+
+	states[index].mesh = mesh;
+	resident.add(index, static_cast<size_t>(node.dataBytes), frame);
+	stats.loadsThisFrame++;
+	return true;
+}
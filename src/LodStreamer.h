@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+#include "Assets.h"
+#include "Frustum.h"
+#include "LodFormat.h"
+#include "MappedFile.h"
+#include "ResidentNodes.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+struct LodStreamerOptions
+{
+	// Most node data kept loaded at once (usually on the GPU)
+	size_t residentBudget = 512 * 1024 * 1024;
+
+	// Most node data loaded in a single update, keeps frame times steady
+	size_t loadBytesPerFrame = 32 * 1024 * 1024;
+
+	// Nodes are refined until their error projects to fewer pixels than this
+	float maxScreenError = 2.0f;
+
+	// How far ahead, in seconds, the camera's motion is extrapolated for prefetching
+	float prefetchSeconds = 0.5f;
+
+	// Most node data handed to the OS for read ahead in a single update
+	size_t prefetchBytesPerFrame = 64 * 1024 * 1024;
+};
+
+struct LodStreamerStats
+{
+	size_t visibleNodes = 0;
+	size_t visibleTriangles = 0;
+	size_t residentNodes = 0;
+	size_t residentBytes = 0;
+
+	// nodes wanted by the current view that are not loaded yet
+	size_t pendingNodes = 0;
+
+	size_t loadsThisFrame = 0;
+	size_t evictionsThisFrame = 0;
+	size_t prefetchesThisFrame = 0;
+	uint64_t loadedBytesTotal = 0;
+
+	// physical memory of the whole process, sampled every few updates
+	size_t processResidentBytes = 0;
+
+	// smoothed over recent updates
+	double ioBytesPerSecond = 0;
+	double cameraSpeed = 0;
+
+	// node data loaded per unit of distance travelled by the camera, over the whole session
+	double bytesPerDistance = 0;
+};
+
+// Streams an out-of-core LOD file (see LodFormat.h) for the current camera.
+//
+// The file is memory mapped. Every update selects the nodes whose error is small enough on
+// screen, loads missing ones (most visible error first) through the upload function, and evicts
+// the least recently used nodes once the resident budget is reached. Node data is released from
+// the mapping once uploaded, so only what the OS reads ahead stays in the process' memory.
+// The camera's motion is extrapolated to prefetch what will be needed next.
+class LodStreamer
+{
+public:
+	// Creates the resource for a loaded node, usually by uploading it to the GPU.
+	// The pointers are only valid during the call.
+	typedef std::function<MeshResourcePtr(const Vertex* vertices, size_t vertexCount, const unsigned* indices, size_t indexCount)> UploadFunction;
+
+	// Throws std::runtime_error if the file can't be mapped or isn't a valid LOD file
+	LodStreamer(const std::filesystem::path& path, UploadFunction upload, const LodStreamerOptions& options = {});
+
+	// Selects, loads and evicts nodes for a view.
+	// projectionScale converts a size at distance 1 into pixels, see getProjectionScale().
+	void update(const glm::vec3& cameraPosition, const glm::mat4x4& viewProjection, float projectionScale, float deltaSeconds);
+
+	// Returns the nodes to draw this frame. Valid until the next update.
+	const std::vector<const MeshResource*>& getVisible() const { return visible; }
+
+	const LodStreamerStats& getStats() const { return stats; }
+
+	// Returns the disk bandwidth needed to keep up with a camera moving at the given speed,
+	// estimated from what was loaded per distance travelled so far
+	double estimateIoRate(double cameraSpeed) const { return stats.bytesPerDistance * cameraSpeed; }
+
+	const LodFileHeader& getHeader() const { return header; }
+	const std::vector<LodNode>& getNodes() const { return nodes; }
+
+	// Returns the pixels covered by one unit at distance 1 for a vertical fov in degrees
+	static float getProjectionScale(float fovDegrees, unsigned screenHeight);
+
+private:
+	struct NodeState
+	{
+		MeshResourcePtr mesh;
+		uint64_t prefetched = 0;
+	};
+
+	struct Request
+	{
+		uint32_t node;
+		float priority;
+	};
+
+	float getScreenError(const LodNode& node, const glm::vec3& cameraPosition, float projectionScale) const;
+
+	// Walks the tree. With collect set, visible nodes are gathered and marked as used.
+	void select(uint32_t index, const glm::vec3& cameraPosition, const Frustum& frustum,
+		float projectionScale, bool collect, std::vector<Request>& requests);
+
+	bool load(uint32_t index);
+
+	MappedFile file;
+	LodFileHeader header;
+	std::vector<LodNode> nodes;
+	std::vector<NodeState> states;
+	ResidentNodes resident;
+
+	UploadFunction upload;
+	LodStreamerOptions options;
+
+	std::vector<const MeshResource*> visible;
+	std::vector<Request> requests;
+	std::vector<Request> prefetchRequests;
+
+	uint64_t frame = 0;
+	bool hasPreviousPosition = false;
+	glm::vec3 previousPosition = { 0, 0, 0 };
+	glm::vec3 velocity = { 0, 0, 0 };
+	double travelledDistance = 0;
+	uint64_t bytesWhileMoving = 0;
+
+	LodStreamerStats stats;
+};
@@ -0,0 +1,423 @@
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SpscRing.h"
+
+namespace
+{
+	const size_t RING_CAPACITY = 1024;
+
+	typedef std::chrono::steady_clock Clock;
+
+	// The ring of one thread. Kept until drained after the thread exits.
+	struct ThreadBuffer
+	{
+		SpscRing<LogRecord, RING_CAPACITY> ring;
+		std::atomic<bool> retired{ false };
+	};
+
+	struct LoggerState
+	{
+		Clock::time_point startTime = Clock::now();
+
+		// registered thread buffers, read by the writer
+		std::mutex buffersMutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+		// writer thread and where it writes, guarded by the mutex
+		std::mutex writerMutex;
+		std::condition_variable wake;
+		std::condition_variable drained;
+		std::thread writer;
+		bool running = false;
+		bool stopping = false;
+		bool stopped = false;
+		LoggerOptions options;
+		std::FILE* file = nullptr;
+
+		// flush() bumps requested, the writer copies it to completed after draining what came before
+		uint64_t flushRequested = 0;
+		uint64_t flushCompleted = 0;
+
+		std::atomic<bool> wakePending{ false };
+		std::atomic<size_t> dropped{ 0 };
+		std::atomic<size_t> written{ 0 };
+	};
+
+	// Never destroyed: threads may still log while static objects are being destroyed at exit
+	LoggerState& getState()
+	{
+		static LoggerState* state = new LoggerState();
+		return *state;
+	}
+
+	// Stops the writer at exit, so the last records are written
+	struct ExitFlush
+	{
+		~ExitFlush() { Logger::stop(); }
+	} exitFlush;
+
+	// Marks the ring of a thread as retired when the thread exits
+	struct ThreadRegistration
+	{
+		ThreadBuffer* buffer = nullptr;
+
+		~ThreadRegistration()
+		{
+			if (buffer != nullptr)
+			{
+				buffer->retired.store(true, std::memory_order_release);
+			}
+		}
+	};
+
+	thread_local ThreadRegistration threadRegistration;
+
+	// Appends printf style output to a line without allocating once it has grown
+	template <typename... Args>
+	void appendFormat(std::string& line, const char* format, Args... args)
+	{
+		char buffer[64];
+		int length = std::snprintf(buffer, sizeof(buffer), format, args...);
+		if (length > 0)
+		{
+			line.append(buffer, std::min(size_t(length), sizeof(buffer) - 1));
+		}
+	}
+
+	void appendArgument(std::string& line, const LogRecord& record, const LogRecord::Argument& argument)
+	{
+		switch (argument.type)
+		{
+		case LogRecord::Type::Signed: appendFormat(line, "%lld", static_cast<long long>(argument.signedValue)); break;
+		case LogRecord::Type::Unsigned: appendFormat(line, "%llu", static_cast<unsigned long long>(argument.unsignedValue)); break;
+		case LogRecord::Type::Float: appendFormat(line, "%g", argument.floatValue); break;
+		case LogRecord::Type::Bool: line.append(argument.unsignedValue != 0 ? "true" : "false"); break;
+		case LogRecord::Type::Vector: appendFormat(line, "[%g, %g, %g]", argument.vector[0], argument.vector[1], argument.vector[2]); break;
+		case LogRecord::Type::Text: line.append(record.text + argument.text.offset, argument.text.length); break;
+		case LogRecord::Type::LongText: line.append(argument.longText); break;
+		}
+	}
+
+	void formatRecord(std::string& line, const LogRecord& record, Clock::time_point startTime)
+	{
+		double seconds = std::chrono::duration<double>(Clock::duration(record.time) - startTime.time_since_epoch()).count();
+		appendFormat(line, "[%10.3f] %-7s ", seconds, Logger::getLevelName(record.level));
+
+		// every {} takes the next argument, extra ones are left as they are
+		size_t argument = 0;
+		for (const char* c = record.format; *c != 0; c++)
+		{
+			if (c[0] == '{' && c[1] == '}' && argument < record.argumentCount)
+			{
+				appendArgument(line, record, record.arguments[argument++]);
+				c++;
+			}
+			else
+			{
+				line.push_back(*c);
+			}
+		}
+		line.push_back('\n');
+	}
+
+	void releaseRecord(LogRecord& record)
+	{
+		for (size_t i = 0; i < record.argumentCount; i++)
+		{
+			if (record.arguments[i].type == LogRecord::Type::LongText)
+			{
+				std::free(record.arguments[i].longText);
+			}
+		}
+	}
+
+	void runWriter(LoggerState& state)
+	{
+		std::vector<ThreadBuffer*> buffers;
+		std::vector<LogRecord> batch;
+		std::vector<std::pair<int64_t, size_t>> order;
+		std::string line;
+		batch.reserve(RING_CAPACITY);
+		order.reserve(RING_CAPACITY);
+		line.reserve(1024);
+
+		std::unique_lock<std::mutex> lock(state.writerMutex);
+		while (true)
+		{
+			state.wake.wait_for(lock, std::chrono::milliseconds(state.options.flushMilliseconds), [&]() {
+				return state.stopping || state.flushRequested != state.flushCompleted || state.wakePending.load(std::memory_order_relaxed);
+			});
+			state.wakePending.store(false, std::memory_order_relaxed);
+			bool stopping = state.stopping;
+			uint64_t request = state.flushRequested;
+			lock.unlock();
+
+			{
+				std::lock_guard<std::mutex> buffersLock(state.buffersMutex);
+				buffers.clear();
+				for (auto& buffer : state.buffers)
+				{
+					buffers.push_back(buffer.get());
+				}
+			}
+
+			// records of all threads in the order they were logged
+			batch.clear();
+			for (ThreadBuffer* buffer : buffers)
+			{
+				LogRecord record;
+				while (buffer->ring.pop(record))
+				{
+					batch.push_back(record);
+				}
+			}
+
+			// by time, and in the order of their ring for records of the same tick
+			order.clear();
+			for (size_t i = 0; i < batch.size(); i++)
+			{
+				order.emplace_back(batch[i].time, i);
+			}
+			std::sort(order.begin(), order.end());
+
+			lock.lock();
+			for (auto& entry : order)
+			{
+				LogRecord& record = batch[entry.second];
+				line.clear();
+				formatRecord(line, record, state.startTime);
+				if (state.options.console)
+				{
+					std::fwrite(line.data(), 1, line.size(), stdout);
+				}
+				if (state.file != nullptr)
+				{
+					std::fwrite(line.data(), 1, line.size(), state.file);
+				}
+				releaseRecord(record);
+			}
+			if (!batch.empty())
+			{
+				std::fflush(stdout);
+				if (state.file != nullptr)
+				{
+					std::fflush(state.file);
+				}
+				state.written += batch.size();
+			}
+
+			// forget the rings of threads that exited once they are empty
+			{
+				std::lock_guard<std::mutex> buffersLock(state.buffersMutex);
+				state.buffers.erase(std::remove_if(state.buffers.begin(), state.buffers.end(), [](const std::unique_ptr<ThreadBuffer>& buffer) {
+					return buffer->retired.load(std::memory_order_acquire) && buffer->ring.empty();
+				}), state.buffers.end());
+			}
+
+			state.flushCompleted = request;
+			state.drained.notify_all();
+			if (stopping)
+			{
+				break;
+			}
+		}
+	}
+
+	// Opens the file and starts the writer, the writer mutex must be held
+	void startWriter(LoggerState& state)
+	{
+		if (state.file != nullptr)
+		{
+			std::fclose(state.file);
+			state.file = nullptr;
+		}
+		if (!state.options.file.empty())
+		{
+#if defined(_MSC_VER)
+			state.file = _wfopen(state.options.file.c_str(), L"a");
+#else
+			state.file = std::fopen(state.options.file.c_str(), "a");
+#endif
+		}
+
+		if (!state.running && !state.stopped)
+		{
+			state.running = true;
+			state.writer = std::thread(runWriter, std::ref(state));
+		}
+	}
+
+	ThreadBuffer* registerThread(LoggerState& state)
+	{
+		auto buffer = std::make_unique<ThreadBuffer>();
+		ThreadBuffer* result = buffer.get();
+		{
+			std::lock_guard<std::mutex> lock(state.buffersMutex);
+			state.buffers.push_back(std::move(buffer));
+		}
+
+		std::lock_guard<std::mutex> lock(state.writerMutex);
+		if (!state.running && !state.stopped)
+		{
+			startWriter(state);
+		}
+		return result;
+	}
+}
+
+void LogRecord::add(const glm::vec3& value)
+{
+	Argument& argument = next(Type::Vector);
+	argument.vector[0] = value.x;
+	argument.vector[1] = value.y;
+	argument.vector[2] = value.z;
+}
+
+void LogRecord::addText(const char* value, size_t length)
+{
+	if (length <= TEXT_BYTES - textUsed)
+	{
+		Argument& argument = next(Type::Text);
+		argument.text.offset = textUsed;
+		argument.text.length = static_cast<uint16_t>(length);
+		std::memcpy(text + textUsed, value, length);
+		textUsed = static_cast<uint8_t>(textUsed + length);
+		return;
+	}
+
+	// rare (eg. compiler errors), the writer frees it
+	char* copy = static_cast<char*>(std::malloc(length + 1));
+	if (copy == nullptr)
+	{
+		next(Type::Text).text = { 0, 0 };
+		return;
+	}
+	std::memcpy(copy, value, length);
+	copy[length] = 0;
+	next(Type::LongText).longText = copy;
+}
+
+void Logger::start(const LoggerOptions& options)
+{
+	LoggerState& state = getState();
+	std::lock_guard<std::mutex> lock(state.writerMutex);
+	state.options = options;
+	startWriter(state);
+}
+
+void Logger::flush()
+{
+	LoggerState& state = getState();
+	std::unique_lock<std::mutex> lock(state.writerMutex);
+	if (!state.running)
+	{
+		return;
+	}
+
+	uint64_t request = ++state.flushRequested;
+	state.wake.notify_one();
+	state.drained.wait(lock, [&]() {
+		return state.flushCompleted >= request || !state.running;
+	});
+}
+
+void Logger::stop()
+{
+	LoggerState& state = getState();
+	{
+		std::lock_guard<std::mutex> lock(state.writerMutex);
+		if (!state.running)
+		{
+			return;
+		}
+		state.stopping = true;
+		state.wake.notify_one();
+	}
+
+	state.writer.join();
+
+	std::lock_guard<std::mutex> lock(state.writerMutex);
+	state.running = false;
+	state.stopped = true;
+	if (state.file != nullptr)
+	{
+		std::fclose(state.file);
+		state.file = nullptr;
+	}
+	state.drained.notify_all();
+}
+
+size_t Logger::getDroppedCount()
+{
+	return getState().dropped.load();
+}
+
+size_t Logger::getWrittenCount()
+{
+	LoggerState& state = getState();
+	std::lock_guard<std::mutex> lock(state.writerMutex);
+	return state.written;
+}
+
+const char* Logger::getLevelName(LogLevel level)
+{
+	switch (level)
+	{
+	case LogLevel::Debug: return "debug";
+	case LogLevel::Info: return "info";
+	case LogLevel::Warning: return "warning";
+	case LogLevel::Error: return "error";
+	default: return "unknown";
+	}
+}
+
+LogRecord* Logger::beginRecord(LogLevel level, const char* format)
+{
+	ThreadRegistration& registration = threadRegistration;
+	if (registration.buffer == nullptr)
+	{
+		registration.buffer = registerThread(getState());
+	}
+
+	LogRecord* record = registration.buffer->ring.acquire();
+	if (record == nullptr)
+	{
+		getState().dropped.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	record->time = Clock::now().time_since_epoch().count();
+	record->format = format;
+	record->level = level;
+	record->argumentCount = 0;
+	record->textUsed = 0;
+	return record;
+}
+
+void Logger::commitRecord(LogLevel level)
+{
+	threadRegistration.buffer->ring.publish();
+
+	if (level == LogLevel::Error)
+	{
+		flush();
+	}
+	else if (level == LogLevel::Warning)
+	{
+		LoggerState& state = getState();
+		state.wakePending.store(true, std::memory_order_relaxed);
+		state.wake.notify_one();
+	}
+}
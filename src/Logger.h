@@ -1,11 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
+#include <string>
+#include <type_traits>
 
 #define GLM_FORCE_LEFT_HANDED
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/vec3.hpp>
 
-std::ostream& operator <<(std::ostream& os, const glm::vec3& v)
+inline std::ostream& operator <<(std::ostream& os, const glm::vec3& v)
 {
 	os << "[" << v.x << ", " << v.y << ", " << v.z << "]";
 	return os;
-}
\ No newline at end of file
+}
+
+enum class LogLevel
+{
+	Debug,
+	Info,
+	Warning,
+	Error
+};
+
+// Calls below this level are compiled out, their arguments aren't even evaluated.
+// Define it for the whole build to change it (0 debug, 1 info, 2 warning, 3 error).
+#if !defined(LOG_MIN_LEVEL)
+#if defined(NDEBUG)
+#define LOG_MIN_LEVEL 1
+#else
+#define LOG_MIN_LEVEL 0
+#endif
+#endif
+
+// LOG_INFO("Loaded {} vertices from {}", count, path). Every {} takes the next argument.
+#define LOG_AT(level, ...) do { if constexpr (static_cast<int>(level) >= LOG_MIN_LEVEL) { Logger::write(level, __VA_ARGS__); } } while (false)
+#define LOG_DEBUG(...) LOG_AT(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::Error, __VA_ARGS__)
+
+// A log call as it travels from the thread that logged it to the writer thread.
+// Arguments are stored as values and only formatted by the writer, so logging costs a few stores.
+// Text arguments are copied into the record; text that doesn't fit is copied to the heap instead.
+struct LogRecord
+{
+	static const size_t MAX_ARGUMENTS = 8;
+	static const size_t TEXT_BYTES = 100;
+
+	enum class Type : uint8_t
+	{
+		Signed,
+		Unsigned,
+		Float,
+		Bool,
+		Vector,
+		Text,
+		LongText
+	};
+
+	struct Argument
+	{
+		Type type;
+		union
+		{
+			int64_t signedValue;
+			uint64_t unsignedValue;
+			double floatValue;
+			float vector[3];
+			struct
+			{
+				uint16_t offset;
+				uint16_t length;
+			} text;
+			char* longText;
+		};
+	};
+
+	int64_t time;
+
+	// Must be a string literal or live as long as the program, it is read by the writer thread
+	const char* format;
+
+	LogLevel level;
+	uint8_t argumentCount;
+	uint8_t textUsed;
+	Argument arguments[MAX_ARGUMENTS];
+	char text[TEXT_BYTES];
+
+	template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+	void add(T value) { next(Type::Signed).signedValue = value; }
+
+	template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, int>::type = 0>
+	void add(T value) { next(Type::Unsigned).unsignedValue = value; }
+
+	void add(bool value) { next(Type::Bool).unsignedValue = value ? 1 : 0; }
+	void add(float value) { next(Type::Float).floatValue = value; }
+	void add(double value) { next(Type::Float).floatValue = value; }
+	void add(const glm::vec3& value);
+	void add(const char* value) { addText(value, std::char_traits<char>::length(value)); }
+	void add(const std::string& value) { addText(value.data(), value.size()); }
+	void add(const std::filesystem::path& value) { add(value.string()); }
+
+private:
+	Argument& next(Type type)
+	{
+		Argument& argument = arguments[argumentCount++];
+		argument.type = type;
+		return argument;
+	}
+
+	void addText(const char* value, size_t length);
+};
+
+// Where the writer thread sends the log
+struct LoggerOptions
+{
+	bool console = true;
+
+	// Also append to this file when set
+	std::filesystem::path file;
+
+	// Longest time a record waits before it is written, warnings and errors are written right away
+	unsigned flushMilliseconds = 50;
+};
+
+// Asynchronous logger for runtime paths.
+// Each thread writes fixed size records into its own lock-free ring, so logging never takes a lock,
+// formats or flushes on the calling thread. A background thread drains the rings, orders the records
+// by time and formats them to the console and/or a file. When a ring is full the record is dropped
+// and counted instead of waiting. Errors wait until they are written, so they survive a crash right after.
+// Starts writing to the console on first use; call start() to change where it goes.
+class Logger
+{
+public:
+	// Sets where records are written, starting the writer thread if needed
+	static void start(const LoggerOptions& options);
+
+	// Waits until every record logged before the call is written
+	static void flush();
+
+	// Writes what is left and stops the writer thread. Records logged afterwards are dropped.
+	static void stop();
+
+	// Records dropped because their thread's ring was full
+	static size_t getDroppedCount();
+
+	// Records written so far
+	static size_t getWrittenCount();
+
+	static const char* getLevelName(LogLevel level);
+
+	// Use the LOG_* macros, which filter levels at compile time
+	template <typename... Args>
+	static void write(LogLevel level, const char* format, const Args&... args)
+	{
+		static_assert(sizeof...(Args) <= LogRecord::MAX_ARGUMENTS, "Too many log arguments");
+
+		LogRecord* record = beginRecord(level, format);
+		if (record == nullptr)
+		{
+			return;
+		}
+		(record->add(args), ...);
+		commitRecord(level);
+	}
+
+private:
+	static LogRecord* beginRecord(LogLevel level, const char* format);
+	static void commitRecord(LogLevel level);
+};
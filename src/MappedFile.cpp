@@ -0,0 +1,209 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+		std::swap(mapping, other.mapping);
+		std::swap(length, other.length);
+#if defined(_WIN32)
+		std::swap(fileHandle, other.fileHandle);
+		std::swap(mappingHandle, other.mappingHandle);
+#endif
+	}
+	return *this;
+}
+
+size_t MappedFile::getPageSize()
+{
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwPageSize;
+#else
+	return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(const std::filesystem::path& path)
+{
+	close();
+
+	HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE fileMapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (fileMapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr)
+	{
+		CloseHandle(fileMapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = fileMapping;
+	mapping = view;
+	length = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mapping != nullptr)
+	{
+		UnmapViewOfFile(mapping);
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+	}
+	mapping = nullptr;
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+	length = 0;
+}
+
+void MappedFile::prefetch(size_t offset, size_t bytes) const
+{
+	if (mapping == nullptr || offset >= length)
+	{
+		return;
+	}
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = static_cast<char*>(mapping) + offset;
+	range.NumberOfBytes = (std::min)(bytes, length - offset);
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::release(size_t offset, size_t bytes) const
+{
+	if (mapping == nullptr || offset >= length)
+	{
+		return;
+	}
+
+	// Unlocking pages that aren't locked removes them from the working set
+	VirtualUnlock(static_cast<char*>(mapping) + offset, (std::min)(bytes, length - offset));
+}
+
+#else
+
+bool MappedFile::open(const std::filesystem::path& path)
+{
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+	// the mapping keeps its own reference to the file
+	::close(fd);
+
+	if (view == MAP_FAILED)
+	{
+		return false;
+	}
+
+	mapping = view;
+	length = static_cast<size_t>(info.st_size);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mapping != nullptr)
+	{
+		munmap(mapping, length);
+	}
+	mapping = nullptr;
+	length = 0;
+}
+
+void MappedFile::prefetch(size_t offset, size_t bytes) const
+{
+	if (mapping == nullptr || offset >= length)
+	{
+		return;
+	}
+
+	// widen to whole pages
+	size_t pageSize = getPageSize();
+	size_t begin = offset / pageSize * pageSize;
+	size_t end = std::min(offset + bytes, length);
+	madvise(static_cast<char*>(mapping) + begin, end - begin, MADV_WILLNEED);
+}
+
+void MappedFile::release(size_t offset, size_t bytes) const
+{
+	if (mapping == nullptr || offset >= length)
+	{
+		return;
+	}
+
+	// narrow to whole pages, so neighbouring data that is still in use stays resident
+	size_t pageSize = getPageSize();
+	size_t begin = (offset + pageSize - 1) / pageSize * pageSize;
+	size_t end = std::min(offset + bytes, length) / pageSize * pageSize;
+	if (begin < end)
+	{
+		madvise(static_cast<char*>(mapping) + begin, end - begin, MADV_DONTNEED);
+	}
+}
+
+#endif
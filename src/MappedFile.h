@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+// A read only view of a whole file mapped into memory.
+// Pages are read from disk the first time they are touched, and can be dropped from the
+// process' resident set again with release(). Files larger than RAM can be mapped this way.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// Maps a file. Returns false if it can't be opened or is empty.
+	bool open(const std::filesystem::path& path);
+	void close();
+
+	bool isOpen() const { return mapping != nullptr; }
+	const unsigned char* data() const { return static_cast<const unsigned char*>(mapping); }
+	size_t size() const { return length; }
+
+	// Asks the OS to start reading a range in the background, so touching it later won't stall
+	void prefetch(size_t offset, size_t bytes) const;
+
+	// Tells the OS a range is not needed for now, so its pages leave the resident set.
+	// The data stays valid, it is read from disk again if touched.
+	void release(size_t offset, size_t bytes) const;
+
+	// Size of a virtual memory page
+	static size_t getPageSize();
+
+private:
+	void* mapping = nullptr;
+	size_t length = 0;
+
+#if defined(_WIN32)
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
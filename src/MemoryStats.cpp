@@ -0,0 +1,397 @@
+#include "MemoryStats.h"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const size_t TAG_COUNT = static_cast<size_t>(MemoryTag::Count);
+
+	struct TagCounters
+	{
+		std::atomic<size_t> current{ 0 };
+		std::atomic<size_t> peak{ 0 };
+	};
+
+	std::array<TagCounters, TAG_COUNT> tagCounters;
+
+	// Heap counters, updated by the global operator new/delete below.
+	// Plain globals with constant initialization, so they are valid before any static constructor runs.
+	std::atomic<size_t> heapAllocations{ 0 };
+	std::atomic<size_t> heapAllocatedBytes{ 0 };
+	std::atomic<size_t> heapFrees{ 0 };
+
+	// Frame bookkeeping. Only touched by beginFrame/endFrame, which are expected once per frame.
+	std::mutex frameMutex;
+	uint64_t frameIndex = 0;
+	size_t frameStartAllocations = 0;
+	size_t frameStartBytes = 0;
+	size_t frameStartFrees = 0;
+	FrameMemoryStats lastFrame;
+}
+
+const char* getMemoryTagName(MemoryTag tag)
+{
+	switch (tag)
+	{
+	case MemoryTag::MeshCpu: return "mesh_cpu";
+	case MemoryTag::MeshCpuPositions: return "mesh_cpu_positions";
+	case MemoryTag::MeshCpuCompressed: return "mesh_cpu_compressed";
+	case MemoryTag::GpuBuffer: return "gpu_buffer";
+	case MemoryTag::GpuTexture: return "gpu_texture";
+	case MemoryTag::SceneObject: return "scene_object";
+	case MemoryTag::ShaderBlob: return "shader_blob";
+	case MemoryTag::FrameTransient: return "frame_transient";
+	default: return "unknown";
+	}
+}
+
+void MemoryStats::track(MemoryTag tag, size_t bytes)
+{
+	if (bytes == 0)
+	{
+		return;
+	}
+
+	auto& counters = tagCounters[static_cast<size_t>(tag)];
+	size_t current = counters.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+	// raise the peak if we went above it
+	size_t peak = counters.peak.load(std::memory_order_relaxed);
+	while (current > peak && !counters.peak.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+	{
+	}
+}
+
+void MemoryStats::release(MemoryTag tag, size_t bytes)
+{
+	if (bytes == 0)
+	{
+		return;
+	}
+
+	tagCounters[static_cast<size_t>(tag)].current.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+MemoryTagStats MemoryStats::get(MemoryTag tag)
+{
+	auto& counters = tagCounters[static_cast<size_t>(tag)];
+
+	MemoryTagStats stats;
+	stats.currentBytes = counters.current.load(std::memory_order_relaxed);
+	stats.peakBytes = counters.peak.load(std::memory_order_relaxed);
+	return stats;
+}
+
+size_t MemoryStats::getTotalBytes()
+{
+	size_t total = 0;
+	for (auto& counters : tagCounters)
+	{
+		total += counters.current.load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+size_t MemoryStats::getHeapAllocationCount()
+{
+	return heapAllocations.load(std::memory_order_relaxed);
+}
+
+size_t MemoryStats::getProcessResidentBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return 0;
+	}
+	return counters.WorkingSetSize;
+#else
+	// second field of statm is the resident page count
+	FILE* file = std::fopen("/proc/self/statm", "r");
+	if (file == nullptr)
+	{
+		return 0;
+	}
+
+	unsigned long long sizePages = 0;
+	unsigned long long residentPages = 0;
+	int read = std::fscanf(file, "%llu %llu", &sizePages, &residentPages);
+	std::fclose(file);
+	if (read != 2)
+	{
+		return 0;
+	}
+	return static_cast<size_t>(residentPages) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+void MemoryStats::beginFrame()
+{
+	std::lock_guard<std::mutex> lock(frameMutex);
+	frameStartAllocations = heapAllocations.load(std::memory_order_relaxed);
+	frameStartBytes = heapAllocatedBytes.load(std::memory_order_relaxed);
+	frameStartFrees = heapFrees.load(std::memory_order_relaxed);
+}
+
+FrameMemoryStats MemoryStats::endFrame()
+{
+	std::lock_guard<std::mutex> lock(frameMutex);
+
+	FrameMemoryStats stats;
+	stats.frame = frameIndex++;
+	stats.allocations = heapAllocations.load(std::memory_order_relaxed) - frameStartAllocations;
+	stats.allocatedBytes = heapAllocatedBytes.load(std::memory_order_relaxed) - frameStartBytes;
+	stats.frees = heapFrees.load(std::memory_order_relaxed) - frameStartFrees;
+
+	lastFrame = stats;
+	return stats;
+}
+
+FrameMemoryStats MemoryStats::getLastFrame()
+{
+	std::lock_guard<std::mutex> lock(frameMutex);
+	return lastFrame;
+}
+
+void MemoryStats::dump(std::ostream& os)
+{
+	os << std::left << std::setw(18) << "tag"
+		<< std::right << std::setw(14) << "current" << std::setw(14) << "peak" << "\n";
+
+	for (size_t i = 0; i < TAG_COUNT; i++)
+	{
+		auto tag = static_cast<MemoryTag>(i);
+		auto stats = get(tag);
+		os << std::left << std::setw(18) << getMemoryTagName(tag)
+			<< std::right << std::setw(14) << stats.currentBytes << std::setw(14) << stats.peakBytes << "\n";
+	}
+
+	auto frame = getLastFrame();
+	os << "frame " << frame.frame << ": " << frame.allocations << " allocations ("
+		<< frame.allocatedBytes << " bytes), " << frame.frees << " frees\n";
+}
+
+void MemoryStats::writeCsvHeader(std::ostream& os)
+{
+	os << "frame,allocations,allocated_bytes,frees";
+	for (size_t i = 0; i < TAG_COUNT; i++)
+	{
+		const char* name = getMemoryTagName(static_cast<MemoryTag>(i));
+		os << "," << name << "_current," << name << "_peak";
+	}
+	os << "\n";
+}
+
+void MemoryStats::writeCsvRow(std::ostream& os)
+{
+	auto frame = getLastFrame();
+	os << frame.frame << "," << frame.allocations << "," << frame.allocatedBytes << "," << frame.frees;
+	for (size_t i = 0; i < TAG_COUNT; i++)
+	{
+		auto stats = get(static_cast<MemoryTag>(i));
+		os << "," << stats.currentBytes << "," << stats.peakBytes;
+	}
+	os << "\n";
+}
+
+// ============================================================
+// Global allocation hooks. Every heap allocation made through new/delete is counted,
+// including the std::align_val_t forms used for over-aligned types.
+// Define MODELVIEWER_NO_ALLOCATION_HOOKS to use the default allocator untouched.
+
+#ifndef MODELVIEWER_NO_ALLOCATION_HOOKS
+
+namespace
+{
+	void* countedAllocate(size_t size)
+	{
+		heapAllocations.fetch_add(1, std::memory_order_relaxed);
+		heapAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+		return std::malloc(size == 0 ? 1 : size);
+	}
+
+	void countedFree(void* ptr)
+	{
+		if (ptr)
+		{
+			heapFrees.fetch_add(1, std::memory_order_relaxed);
+			std::free(ptr);
+		}
+	}
+
+	// Over-aligned types (alignas above the default new alignment) come through here
+	void* countedAllocateAligned(size_t size, std::align_val_t alignment)
+	{
+		heapAllocations.fetch_add(1, std::memory_order_relaxed);
+		heapAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+		size_t align = static_cast<size_t>(alignment);
+		if (size == 0)
+		{
+			size = 1;
+		}
+#if defined(_WIN32)
+		return _aligned_malloc(size, align);
+#else
+		void* ptr = nullptr;
+		if (posix_memalign(&ptr, align < sizeof(void*) ? sizeof(void*) : align, size) != 0)
+		{
+			return nullptr;
+		}
+		return ptr;
+#endif
+	}
+
+	void countedFreeAligned(void* ptr)
+	{
+		if (ptr)
+		{
+			heapFrees.fetch_add(1, std::memory_order_relaxed);
+#if defined(_WIN32)
+			_aligned_free(ptr);
+#else
+			std::free(ptr);
+#endif
+		}
+	}
+}
+
+void* operator new(size_t size)
+{
+	void* ptr = countedAllocate(size);
+	if (!ptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	void* ptr = countedAllocate(size);
+	if (!ptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	countedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	countedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	countedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	countedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	countedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	countedFree(ptr);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* ptr = countedAllocateAligned(size, alignment);
+	if (!ptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	void* ptr = countedAllocateAligned(size, alignment);
+	if (!ptr)
+	{
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return countedAllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return countedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+	countedFreeAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+	countedFreeAligned(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept
+{
+	countedFreeAligned(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept
+{
+	countedFreeAligned(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	countedFreeAligned(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	countedFreeAligned(ptr);
+}
+
+#endif
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Categories that memory usage is accounted to
+enum class MemoryTag
+{
+	// CPU copies of mesh vertices and indices
+	MeshCpu,
+
+	// CPU copies of mesh vertex positions, kept in place of the vertices (MeshResidency::Positions)
+	MeshCpuPositions,
+
+	// Compressed CPU copies of meshes (MeshResidency::Compressed)
+	MeshCpuCompressed,
+
+	// Vertex, index and constant buffers created on the GPU
+	GpuBuffer,
+
+	// Textures created on the GPU, with all their mips
+	GpuTexture,
+
+	// Scene objects and the scene's object list
+	SceneObject,
+
+	// Compiled shader bytecode
+	ShaderBlob,
+
+	// Data that only lives for the duration of a frame
+	FrameTransient,
+
+	Count
+};
+
+// Returns a short lowercase name for the tag, used in dumps
+const char* getMemoryTagName(MemoryTag tag);
+
+// Current and peak usage of a single memory tag
+struct MemoryTagStats
+{
+	size_t currentBytes = 0;
+	size_t peakBytes = 0;
+};
+
+// Heap activity during a single frame, as counted by the global allocation hooks
+struct FrameMemoryStats
+{
+	uint64_t frame = 0;
+	size_t allocations = 0;
+	size_t allocatedBytes = 0;
+	size_t frees = 0;
+};
+
+// Global memory accounting.
+// Subsystems report what they own through track() and release() (usually via TrackedMemory),
+// and every heap allocation of the process is counted so per frame churn can be seen.
+// All methods are thread safe.
+class MemoryStats
+{
+public:
+	// Adds a number of bytes to a tag
+	static void track(MemoryTag tag, size_t bytes);
+
+	// Removes a number of bytes from a tag
+	static void release(MemoryTag tag, size_t bytes);
+
+	// Returns the current and peak usage of a tag
+	static MemoryTagStats get(MemoryTag tag);
+
+	// Returns the current usage summed over all tags
+	static size_t getTotalBytes();
+
+	// Returns the number of heap allocations made since the process started
+	static size_t getHeapAllocationCount();
+
+	// Returns the physical memory currently used by the process (resident set / working set),
+	// including memory mapped files. Asks the OS, so avoid calling it every frame.
+	static size_t getProcessResidentBytes();
+
+	// Marks the start of a frame. Heap counters are measured from this point.
+	static void beginFrame();
+
+	// Marks the end of the frame started by beginFrame() and returns its heap activity
+	static FrameMemoryStats endFrame();
+
+	// Returns the stats of the last frame finished by endFrame()
+	static FrameMemoryStats getLastFrame();
+
+	// Writes a human readable summary of all tags
+	static void dump(std::ostream& os);
+
+	// Writes the column names matching writeCsvRow()
+	static void writeCsvHeader(std::ostream& os);
+
+	// Writes a row with the last frame's heap activity and the current/peak usage of every tag
+	static void writeCsvRow(std::ostream& os);
+};
+
+// Holds a number of bytes accounted to a memory tag, and releases them when destroyed.
+// Add as a member of whatever owns the memory.
+class TrackedMemory
+{
+public:
+	explicit TrackedMemory(MemoryTag tag, size_t bytes = 0) : tag{ tag }, bytes{ bytes }
+	{
+		MemoryStats::track(tag, bytes);
+	}
+
+	TrackedMemory(const TrackedMemory& other) = delete;
+	TrackedMemory& operator=(const TrackedMemory& other) = delete;
+
+	TrackedMemory(TrackedMemory&& other) noexcept : tag{ other.tag }, bytes{ other.bytes }
+	{
+		other.bytes = 0;
+	}
+
+	~TrackedMemory()
+	{
+		MemoryStats::release(tag, bytes);
+	}
+
+	// Changes the number of bytes accounted.
+	// The old bytes are released first, so a resize doesn't count both sizes into the peak.
+	void set(size_t newBytes)
+	{
+		MemoryStats::release(tag, bytes);
+		MemoryStats::track(tag, newBytes);
+		bytes = newBytes;
+	}
+
+	size_t get() const { return bytes; }
+
+private:
+	MemoryTag tag;
+	size_t bytes;
+};
@@ -0,0 +1,825 @@
+#include "MeshCodec.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESH_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Quantized vertex: position x, y, z (16 bits each, low byte first), octahedral normal, color
+	const size_t VERTEX_PLANES = 11;
+
+	// Bytes packed together with the same bit width
+	const size_t GROUP_SIZE = 16;
+
+	// Entries of the edge and vertex FIFOs used by the index coder
+	const unsigned EDGE_FIFO_SIZE = 16;
+	const unsigned VERTEX_FIFO_SIZE = 16;
+
+	// High nibble of an index code, the low nibble is the FIFO entry for the edge codes
+	const uint8_t CODE_EDGE_NEXT = 0x00;
+	const uint8_t CODE_EDGE_EXPLICIT = 0x10;
+	const uint8_t CODE_EXPLICIT = 0x20;
+
+	// Values of an explicit index: the next unseen vertex, a vertex FIFO entry, or a delta
+	const uint32_t EXPLICIT_NEXT = 0;
+	const uint32_t EXPLICIT_FIFO = 1;
+	const uint32_t EXPLICIT_DELTA = EXPLICIT_FIFO + VERTEX_FIFO_SIZE;
+
+	std::runtime_error invalidData()
+	{
+		return std::runtime_error("Invalid encoded mesh");
+	}
+
+	uint8_t zigzag8(uint8_t delta)
+	{
+		return static_cast<uint8_t>((delta << 1) ^ static_cast<uint8_t>(static_cast<int8_t>(delta) >> 7));
+	}
+
+#if !defined(MESH_CODEC_SSE2)
+	uint8_t unzigzag8(uint8_t value)
+	{
+		return static_cast<uint8_t>((value >> 1) ^ static_cast<uint8_t>(-(value & 1)));
+	}
+#endif
+
+	uint32_t zigzag32(int32_t value)
+	{
+		return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+	}
+
+	int32_t unzigzag32(uint32_t value)
+	{
+		return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+	}
+
+	void writeVarint(std::vector<uint8_t>& out, uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	uint32_t readVarint(const uint8_t*& data, const uint8_t* end)
+	{
+		uint32_t value = 0;
+		for (unsigned shift = 0; shift < 35; shift += 7)
+		{
+			if (data == end)
+			{
+				throw invalidData();
+			}
+
+			uint8_t byte = *data++;
+			value |= uint32_t(byte & 0x7f) << shift;
+			if (byte < 0x80)
+			{
+				return value;
+			}
+		}
+		throw invalidData();
+	}
+
+	// Bits per byte of a group: 0, 2, 4 or 8, stored as 0 to 3
+	unsigned groupWidth(const uint8_t* group)
+	{
+		uint8_t largest = *std::max_element(group, group + GROUP_SIZE);
+		return largest == 0 ? 0 : largest < 4 ? 1 : largest < 16 ? 2 : 3;
+	}
+
+	// Delta codes a byte plane and packs it. Layout: 2 bits of width per group (4 groups per byte),
+	// then the packed groups.
+	void encodePlane(const uint8_t* plane, size_t count, std::vector<uint8_t>& out)
+	{
+		size_t groupCount = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+		size_t widthsOffset = out.size();
+		out.resize(out.size() + (groupCount + 3) / 4, 0);
+
+		uint8_t previous = 0;
+		uint8_t group[GROUP_SIZE];
+		for (size_t g = 0; g < groupCount; g++)
+		{
+			for (size_t i = 0; i < GROUP_SIZE; i++)
+			{
+				size_t index = g * GROUP_SIZE + i;
+				uint8_t value = index < count ? plane[index] : previous;
+				group[i] = zigzag8(static_cast<uint8_t>(value - previous));
+				previous = value;
+			}
+
+			unsigned width = groupWidth(group);
+			out[widthsOffset + g / 4] |= static_cast<uint8_t>(width << ((g % 4) * 2));
+
+			if (width == 1)
+			{
+				for (size_t i = 0; i < GROUP_SIZE; i += 4)
+				{
+					out.push_back(static_cast<uint8_t>(group[i] | group[i + 1] << 2 | group[i + 2] << 4 | group[i + 3] << 6));
+				}
+			}
+			else if (width == 2)
+			{
+				for (size_t i = 0; i < GROUP_SIZE; i += 2)
+				{
+					out.push_back(static_cast<uint8_t>(group[i] | group[i + 1] << 4));
+				}
+			}
+			else if (width == 3)
+			{
+				out.insert(out.end(), group, group + GROUP_SIZE);
+			}
+		}
+	}
+
+	// Unpacks a byte plane into out, which has room for count rounded up to a whole group
+	const uint8_t* decodePlane(const uint8_t* data, const uint8_t* end, uint8_t* out, size_t count)
+	{
+		size_t groupCount = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+		const uint8_t* widths = data;
+		data += (groupCount + 3) / 4;
+		if (data > end)
+		{
+			throw invalidData();
+		}
+
+#if defined(MESH_CODEC_SSE2)
+		const __m128i lowBit = _mm_set1_epi8(1);
+		const __m128i lowSeven = _mm_set1_epi8(0x7f);
+		const __m128i lowTwo = _mm_set1_epi8(0x03);
+		const __m128i lowFour = _mm_set1_epi8(0x0f);
+		__m128i carry = _mm_setzero_si128();
+
+		for (size_t g = 0; g < groupCount; g++)
+		{
+			unsigned width = (widths[g / 4] >> ((g % 4) * 2)) & 3;
+			static const size_t groupBytes[4] = { 0, 4, 8, 16 };
+			if (size_t(end - data) < groupBytes[width])
+			{
+				throw invalidData();
+			}
+
+			__m128i value;
+			if (width == 0)
+			{
+				value = _mm_setzero_si128();
+			}
+			else if (width == 1)
+			{
+				uint32_t packed;
+				std::memcpy(&packed, data, 4);
+				__m128i bits = _mm_cvtsi32_si128(static_cast<int>(packed));
+				__m128i a = _mm_and_si128(bits, lowTwo);
+				__m128i b = _mm_and_si128(_mm_srli_epi16(bits, 2), lowTwo);
+				__m128i c = _mm_and_si128(_mm_srli_epi16(bits, 4), lowTwo);
+				__m128i d = _mm_and_si128(_mm_srli_epi16(bits, 6), lowTwo);
+				value = _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, b), _mm_unpacklo_epi8(c, d));
+			}
+			else if (width == 2)
+			{
+				__m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+				__m128i low = _mm_and_si128(bits, lowFour);
+				__m128i high = _mm_and_si128(_mm_srli_epi16(bits, 4), lowFour);
+				value = _mm_unpacklo_epi8(low, high);
+			}
+			else
+			{
+				value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+			}
+			data += groupBytes[width];
+
+			// undo the zigzag, then a prefix sum of the deltas on top of the last decoded byte
+			__m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(value, lowBit));
+			value = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(value, 1), lowSeven), sign);
+			value = _mm_add_epi8(value, _mm_slli_si128(value, 1));
+			value = _mm_add_epi8(value, _mm_slli_si128(value, 2));
+			value = _mm_add_epi8(value, _mm_slli_si128(value, 4));
+			value = _mm_add_epi8(value, _mm_slli_si128(value, 8));
+			value = _mm_add_epi8(value, carry);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + g * GROUP_SIZE), value);
+
+			// broadcast the last byte
+			carry = _mm_unpackhi_epi8(value, value);
+			carry = _mm_unpackhi_epi16(carry, carry);
+			carry = _mm_shuffle_epi32(carry, 0xff);
+		}
+#else
+		uint8_t previous = 0;
+		for (size_t g = 0; g < groupCount; g++)
+		{
+			unsigned width = (widths[g / 4] >> ((g % 4) * 2)) & 3;
+			static const size_t groupBytes[4] = { 0, 4, 8, 16 };
+			if (size_t(end - data) < groupBytes[width])
+			{
+				throw invalidData();
+			}
+
+			uint8_t* group = out + g * GROUP_SIZE;
+			for (size_t i = 0; i < GROUP_SIZE; i++)
+			{
+				uint8_t value = 0;
+				if (width == 1)
+				{
+					value = (data[i / 4] >> ((i % 4) * 2)) & 3;
+				}
+				else if (width == 2)
+				{
+					value = (data[i / 2] >> ((i % 2) * 4)) & 15;
+				}
+				else if (width == 3)
+				{
+					value = data[i];
+				}
+
+				previous = static_cast<uint8_t>(previous + unzigzag8(value));
+				group[i] = previous;
+			}
+			data += groupBytes[width];
+		}
+#endif
+
+		return data;
+	}
+
+	uint8_t quantizeUnit(float value)
+	{
+		return static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+	}
+
+	// Octahedral mapping of a unit vector to two 0..1 values
+	glm::vec2 encodeOctahedral(glm::vec3 normal)
+	{
+		float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (length == 0)
+		{
+			return { 0.5f, 0.5f };
+		}
+
+		normal /= length;
+		glm::vec2 result(normal.x, normal.y);
+		if (normal.z < 0)
+		{
+			result.x = (1.0f - std::abs(normal.y)) * (normal.x >= 0 ? 1.0f : -1.0f);
+			result.y = (1.0f - std::abs(normal.x)) * (normal.y >= 0 ? 1.0f : -1.0f);
+		}
+		return result * 0.5f + glm::vec2(0.5f, 0.5f);
+	}
+
+	glm::vec3 decodeOctahedral(uint8_t qx, uint8_t qy)
+	{
+		float x = qx * (2.0f / 255.0f) - 1.0f;
+		float y = qy * (2.0f / 255.0f) - 1.0f;
+		float z = 1.0f - std::abs(x) - std::abs(y);
+
+		// folded into the lower hemisphere
+		float fold = std::max(-z, 0.0f);
+		x += x >= 0 ? -fold : fold;
+		y += y >= 0 ? -fold : fold;
+
+		float inverseLength = 1.0f / std::sqrt(x * x + y * y + z * z);
+		return { x * inverseLength, y * inverseLength, z * inverseLength };
+	}
+
+	// Position quantization of a mesh, shared by the encoder and decoder
+	struct Quantization
+	{
+		glm::vec3 origin;
+		glm::vec3 scale;
+		glm::vec3 inverseScale;
+
+		Quantization(const glm::vec3& boundsMin, const glm::vec3& boundsMax, unsigned bits)
+		{
+			float steps = float((1u << bits) - 1);
+			origin = boundsMin;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float extent = boundsMax[axis] - boundsMin[axis];
+				scale[axis] = extent > 0 ? extent / steps : 0.0f;
+				inverseScale[axis] = extent > 0 ? steps / extent : 0.0f;
+			}
+		}
+	};
+
+	void encodeVertexChunk(const Vertex* vertices, size_t count, const Quantization& quantization, unsigned positionBits, std::vector<uint8_t>& out)
+	{
+		std::vector<uint8_t> planes(VERTEX_PLANES * count);
+		uint32_t maxValue = (1u << positionBits) - 1;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const Vertex& vertex = vertices[i];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float steps = (vertex.position[axis] - quantization.origin[axis]) * quantization.inverseScale[axis];
+				uint32_t value = std::min(static_cast<uint32_t>(std::lround(std::max(steps, 0.0f))), maxValue);
+				planes[(axis * 2) * count + i] = static_cast<uint8_t>(value);
+				planes[(axis * 2 + 1) * count + i] = static_cast<uint8_t>(value >> 8);
+			}
+
+			glm::vec2 normal = encodeOctahedral(vertex.normal);
+			planes[6 * count + i] = quantizeUnit(normal.x);
+			planes[7 * count + i] = quantizeUnit(normal.y);
+			planes[8 * count + i] = quantizeUnit(vertex.color.x);
+			planes[9 * count + i] = quantizeUnit(vertex.color.y);
+			planes[10 * count + i] = quantizeUnit(vertex.color.z);
+		}
+
+		for (size_t plane = 0; plane < VERTEX_PLANES; plane++)
+		{
+			encodePlane(&planes[plane * count], count, out);
+		}
+	}
+
+	void decodeVertexChunk(const uint8_t* data, const uint8_t* end, Vertex* vertices, size_t count, const Quantization& quantization)
+	{
+		// planes, each rounded up to a whole group. Reused by the thread for the next chunks.
+		size_t stride = (count + GROUP_SIZE - 1) / GROUP_SIZE * GROUP_SIZE;
+		thread_local std::vector<uint8_t> planes;
+		planes.resize(VERTEX_PLANES * MESH_CODEC_VERTEX_CHUNK);
+
+		for (size_t plane = 0; plane < VERTEX_PLANES; plane++)
+		{
+			data = decodePlane(data, end, &planes[plane * stride], count);
+		}
+
+		const uint8_t* p = planes.data();
+		for (size_t i = 0; i < count; i++)
+		{
+			Vertex& vertex = vertices[i];
+			vertex.position.x = quantization.origin.x + float(p[i] | p[stride + i] << 8) * quantization.scale.x;
+			vertex.position.y = quantization.origin.y + float(p[2 * stride + i] | p[3 * stride + i] << 8) * quantization.scale.y;
+			vertex.position.z = quantization.origin.z + float(p[4 * stride + i] | p[5 * stride + i] << 8) * quantization.scale.z;
+			vertex.normal = decodeOctahedral(p[6 * stride + i], p[7 * stride + i]);
+			vertex.color.x = p[8 * stride + i] * (1.0f / 255.0f);
+			vertex.color.y = p[9 * stride + i] * (1.0f / 255.0f);
+			vertex.color.z = p[10 * stride + i] * (1.0f / 255.0f);
+		}
+	}
+
+	// Recently seen edges, newest first
+	struct EdgeFifo
+	{
+		uint32_t edges[EDGE_FIFO_SIZE][2];
+		unsigned head = 0;
+		unsigned size = 0;
+
+		void push(uint32_t a, uint32_t b)
+		{
+			head = (head + EDGE_FIFO_SIZE - 1) % EDGE_FIFO_SIZE;
+			edges[head][0] = a;
+			edges[head][1] = b;
+			size = std::min(size + 1, EDGE_FIFO_SIZE);
+		}
+
+		const uint32_t* get(unsigned index) const
+		{
+			return edges[(head + index) % EDGE_FIFO_SIZE];
+		}
+	};
+
+	// Recently used vertices, newest first
+	struct VertexFifo
+	{
+		uint32_t vertices[VERTEX_FIFO_SIZE];
+		unsigned head = 0;
+		unsigned size = 0;
+
+		void push(uint32_t vertex)
+		{
+			head = (head + VERTEX_FIFO_SIZE - 1) % VERTEX_FIFO_SIZE;
+			vertices[head] = vertex;
+			size = std::min(size + 1, VERTEX_FIFO_SIZE);
+		}
+
+		uint32_t get(unsigned index) const
+		{
+			return vertices[(head + index) % VERTEX_FIFO_SIZE];
+		}
+	};
+
+	void encodeIndexChunk(const unsigned* indices, size_t triangleCount, uint32_t nextVertex, std::vector<uint8_t>& out)
+	{
+		EdgeFifo fifo;
+		VertexFifo recent;
+		uint32_t next = nextVertex;
+		uint32_t last = nextVertex;
+
+		auto writeExplicit = [&](uint32_t index) {
+			unsigned entry = 0;
+			while (entry < recent.size && recent.get(entry) != index)
+			{
+				entry++;
+			}
+
+			if (index == next)
+			{
+				writeVarint(out, EXPLICIT_NEXT);
+			}
+			else if (entry < recent.size)
+			{
+				writeVarint(out, EXPLICIT_FIFO + entry);
+			}
+			else
+			{
+				writeVarint(out, zigzag32(static_cast<int32_t>(index - last)) + EXPLICIT_DELTA);
+				last = index;
+			}
+			next = std::max(next, index + 1);
+			recent.push(index);
+		};
+
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			const unsigned* triangle = &indices[t * 3];
+
+			// a recent edge walked the other way is shared with a neighbour of the same winding
+			bool found = false;
+			unsigned entry = 0;
+			unsigned rotation = 0;
+			for (entry = 0; entry < fifo.size && !found; entry++)
+			{
+				const uint32_t* edge = fifo.get(entry);
+				for (rotation = 0; rotation < 3; rotation++)
+				{
+					if (triangle[rotation] == edge[1] && triangle[(rotation + 1) % 3] == edge[0])
+					{
+						found = true;
+						break;
+					}
+				}
+			}
+
+			if (found)
+			{
+				entry--;
+				uint32_t a = triangle[rotation];
+				uint32_t b = triangle[(rotation + 1) % 3];
+				uint32_t c = triangle[(rotation + 2) % 3];
+
+				if (c == next)
+				{
+					out.push_back(static_cast<uint8_t>(CODE_EDGE_NEXT | entry));
+					next++;
+					recent.push(c);
+				}
+				else
+				{
+					out.push_back(static_cast<uint8_t>(CODE_EDGE_EXPLICIT | entry));
+					writeExplicit(c);
+				}
+
+				fifo.push(b, c);
+				fifo.push(c, a);
+			}
+			else
+			{
+				out.push_back(CODE_EXPLICIT);
+				writeExplicit(triangle[0]);
+				writeExplicit(triangle[1]);
+				writeExplicit(triangle[2]);
+
+				fifo.push(triangle[0], triangle[1]);
+				fifo.push(triangle[1], triangle[2]);
+				fifo.push(triangle[2], triangle[0]);
+			}
+		}
+	}
+
+	void decodeIndexChunk(const uint8_t* data, const uint8_t* end, unsigned* indices, size_t triangleCount, uint32_t nextVertex, uint32_t vertexCount)
+	{
+		EdgeFifo fifo;
+		VertexFifo recent;
+		uint32_t next = nextVertex;
+		uint32_t last = nextVertex;
+
+		auto readExplicit = [&]() {
+			uint32_t value = readVarint(data, end);
+			uint32_t index;
+			if (value == EXPLICIT_NEXT)
+			{
+				index = next;
+			}
+			else if (value < EXPLICIT_DELTA)
+			{
+				if (value - EXPLICIT_FIFO >= recent.size)
+				{
+					throw invalidData();
+				}
+				index = recent.get(value - EXPLICIT_FIFO);
+			}
+			else
+			{
+				index = last + static_cast<uint32_t>(unzigzag32(value - EXPLICIT_DELTA));
+				last = index;
+			}
+			next = std::max(next, index + 1);
+			recent.push(index);
+			return index;
+		};
+
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			if (data == end)
+			{
+				throw invalidData();
+			}
+
+			uint8_t code = *data++;
+			uint8_t type = code & 0xf0;
+			unsigned* triangle = &indices[t * 3];
+
+			if (type == CODE_EDGE_NEXT || type == CODE_EDGE_EXPLICIT)
+			{
+				unsigned entry = code & 0x0f;
+				if (entry >= fifo.size)
+				{
+					throw invalidData();
+				}
+
+				const uint32_t* edge = fifo.get(entry);
+				uint32_t a = edge[1];
+				uint32_t b = edge[0];
+				uint32_t c;
+				if (type == CODE_EDGE_NEXT)
+				{
+					c = next++;
+					recent.push(c);
+				}
+				else
+				{
+					c = readExplicit();
+				}
+
+				triangle[0] = a;
+				triangle[1] = b;
+				triangle[2] = c;
+				fifo.push(b, c);
+				fifo.push(c, a);
+			}
+			else if (code == CODE_EXPLICIT)
+			{
+				triangle[0] = readExplicit();
+				triangle[1] = readExplicit();
+				triangle[2] = readExplicit();
+				fifo.push(triangle[0], triangle[1]);
+				fifo.push(triangle[1], triangle[2]);
+				fifo.push(triangle[2], triangle[0]);
+			}
+			else
+			{
+				throw invalidData();
+			}
+
+			if (triangle[0] >= vertexCount || triangle[1] >= vertexCount || triangle[2] >= vertexCount)
+			{
+				throw invalidData();
+			}
+		}
+	}
+}
+
+std::vector<uint8_t> encodeMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, const MeshCodecOptions& options)
+{
+	if (options.positionBits < 1 || options.positionBits > 16)
+	{
+		throw std::runtime_error("Mesh codec position bits must be between 1 and 16");
+	}
+	if (indices.size() % 3 != 0)
+	{
+		throw std::runtime_error("Mesh codec index count must be a multiple of 3");
+	}
+	for (unsigned index : indices)
+	{
+		if (index >= vertices.size())
+		{
+			throw std::runtime_error("Mesh codec index out of range");
+		}
+	}
+
+	MeshCodecHeader header = {};
+	std::memcpy(header.magic, MESH_CODEC_MAGIC, sizeof(header.magic));
+	header.version = MESH_CODEC_VERSION;
+	header.vertexCount = static_cast<uint32_t>(vertices.size());
+	header.indexCount = static_cast<uint32_t>(indices.size());
+	header.positionBits = options.positionBits;
+	if (!vertices.empty())
+	{
+		header.boundsMin = header.boundsMax = vertices[0].position;
+		for (const Vertex& vertex : vertices)
+		{
+			header.boundsMin = glm::min(header.boundsMin, vertex.position);
+			header.boundsMax = glm::max(header.boundsMax, vertex.position);
+		}
+	}
+
+	size_t triangleCount = indices.size() / 3;
+	header.vertexChunkCount = static_cast<uint32_t>((vertices.size() + MESH_CODEC_VERTEX_CHUNK - 1) / MESH_CODEC_VERTEX_CHUNK);
+	header.indexChunkCount = static_cast<uint32_t>((triangleCount + MESH_CODEC_TRIANGLE_CHUNK - 1) / MESH_CODEC_TRIANGLE_CHUNK);
+
+	std::vector<MeshCodecChunk> chunks(header.vertexChunkCount + header.indexChunkCount);
+	std::vector<uint8_t> out(sizeof(header) + chunks.size() * sizeof(MeshCodecChunk));
+
+	Quantization quantization(header.boundsMin, header.boundsMax, options.positionBits);
+	for (uint32_t i = 0; i < header.vertexChunkCount; i++)
+	{
+		MeshCodecChunk& chunk = chunks[i];
+		chunk.offset = out.size();
+		chunk.first = i * MESH_CODEC_VERTEX_CHUNK;
+		chunk.count = std::min(MESH_CODEC_VERTEX_CHUNK, header.vertexCount - chunk.first);
+		chunk.nextVertex = 0;
+		encodeVertexChunk(&vertices[chunk.first], chunk.count, quantization, options.positionBits, out);
+		chunk.bytes = static_cast<uint32_t>(out.size() - chunk.offset);
+	}
+
+	uint32_t nextVertex = 0;
+	for (uint32_t i = 0; i < header.indexChunkCount; i++)
+	{
+		MeshCodecChunk& chunk = chunks[header.vertexChunkCount + i];
+		chunk.offset = out.size();
+		chunk.first = i * MESH_CODEC_TRIANGLE_CHUNK * 3;
+		chunk.count = std::min(MESH_CODEC_TRIANGLE_CHUNK * 3, header.indexCount - chunk.first);
+		chunk.nextVertex = nextVertex;
+		encodeIndexChunk(&indices[chunk.first], chunk.count / 3, nextVertex, out);
+		chunk.bytes = static_cast<uint32_t>(out.size() - chunk.offset);
+
+		for (uint32_t j = 0; j < chunk.count; j++)
+		{
+			nextVertex = std::max(nextVertex, indices[chunk.first + j] + 1);
+		}
+	}
+
+	std::memcpy(out.data(), &header, sizeof(header));
+	if (!chunks.empty())
+	{
+		std::memcpy(out.data() + sizeof(header), chunks.data(), chunks.size() * sizeof(MeshCodecChunk));
+	}
+	return out;
+}
+
+bool readMeshCodecHeader(const uint8_t* data, size_t size, MeshCodecHeader& header)
+{
+	if (size < sizeof(MeshCodecHeader))
+	{
+		return false;
+	}
+
+	std::memcpy(&header, data, sizeof(header));
+	return std::memcmp(header.magic, MESH_CODEC_MAGIC, sizeof(header.magic)) == 0 && header.version == MESH_CODEC_VERSION;
+}
+
+namespace
+{
+	// Reads the header and the chunk table of encoded data, checking every chunk lies inside it
+	std::vector<MeshCodecChunk> readMeshCodecLayout(const uint8_t* data, size_t size, MeshCodecHeader& header)
+	{
+		if (!readMeshCodecHeader(data, size, header) || header.positionBits < 1 || header.positionBits > 16
+			|| header.indexCount % 3 != 0)
+		{
+			throw invalidData();
+		}
+
+		size_t chunkCount = size_t(header.vertexChunkCount) + header.indexChunkCount;
+		if ((size - sizeof(header)) / sizeof(MeshCodecChunk) < chunkCount)
+		{
+			throw invalidData();
+		}
+
+		std::vector<MeshCodecChunk> chunks(chunkCount);
+		if (chunkCount > 0)
+		{
+			std::memcpy(chunks.data(), data + sizeof(header), chunkCount * sizeof(MeshCodecChunk));
+		}
+
+		for (size_t i = 0; i < chunkCount; i++)
+		{
+			const MeshCodecChunk& chunk = chunks[i];
+			bool isVertexChunk = i < header.vertexChunkCount;
+			uint64_t total = isVertexChunk ? header.vertexCount : header.indexCount;
+			uint64_t limit = isVertexChunk ? MESH_CODEC_VERTEX_CHUNK : MESH_CODEC_TRIANGLE_CHUNK * 3;
+			if (chunk.offset > size || size - chunk.offset < chunk.bytes || chunk.count > limit
+				|| uint64_t(chunk.first) + chunk.count > total || (!isVertexChunk && chunk.count % 3 != 0))
+			{
+				throw invalidData();
+			}
+		}
+
+		return chunks;
+	}
+
+	// Decodes every chunk into memory sized for the header's vertex and index counts
+	void decodeMeshChunks(const uint8_t* data, const MeshCodecHeader& header, const std::vector<MeshCodecChunk>& chunks,
+		Vertex* vertices, unsigned* indices, JobSystem* jobs)
+	{
+		size_t chunkCount = chunks.size();
+		Quantization quantization(header.boundsMin, header.boundsMax, header.positionBits);
+		auto decodeChunk = [&](size_t i) {
+			const MeshCodecChunk& chunk = chunks[i];
+			const uint8_t* begin = data + chunk.offset;
+			const uint8_t* end = begin + chunk.bytes;
+			if (i < header.vertexChunkCount)
+			{
+				decodeVertexChunk(begin, end, &vertices[chunk.first], chunk.count, quantization);
+			}
+			else
+			{
+				decodeIndexChunk(begin, end, &indices[chunk.first], chunk.count / 3, chunk.nextVertex, header.vertexCount);
+			}
+		};
+
+		if (jobs)
+		{
+			// an exception can't cross threads, the first failure is rethrown here
+			std::exception_ptr failure;
+			std::mutex failureMutex;
+			jobs->parallelFor(chunkCount, [&](size_t i) {
+				try
+				{
+					decodeChunk(i);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(failureMutex);
+					if (!failure)
+					{
+						failure = std::current_exception();
+					}
+				}
+			});
+
+			if (failure)
+			{
+				std::rethrow_exception(failure);
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < chunkCount; i++)
+			{
+				decodeChunk(i);
+			}
+		}
+	}
+}
+
+void decodeMesh(const uint8_t* data, size_t size, std::vector<Vertex>& vertices, std::vector<unsigned>& indices, JobSystem* jobs)
+{
+	MeshCodecHeader header;
+	std::vector<MeshCodecChunk> chunks = readMeshCodecLayout(data, size, header);
+
+	vertices.resize(header.vertexCount);
+	indices.resize(header.indexCount);
+	decodeMeshChunks(data, header, chunks, vertices.data(), indices.data(), jobs);
+}
+
+void decodeMesh(const uint8_t* data, size_t size, Vertex* vertices, size_t vertexCount, unsigned* indices, size_t indexCount, JobSystem* jobs)
+{
+	MeshCodecHeader header;
+	std::vector<MeshCodecChunk> chunks = readMeshCodecLayout(data, size, header);
+	if (header.vertexCount != vertexCount || header.indexCount != indexCount)
+	{
+		throw std::runtime_error("Mesh codec data doesn't match the size of the memory it is decoded into");
+	}
+
+	decodeMeshChunks(data, header, chunks, vertices, indices, jobs);
+}
+
+void writeMeshFile(const std::filesystem::path& path, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, const MeshCodecOptions& options)
+{
+	std::vector<uint8_t> data = encodeMesh(vertices, indices, options);
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	if (!file)
+	{
+		throw std::runtime_error("Could not write mesh file " + path.string());
+	}
+}
+
+void readMeshFile(const std::filesystem::path& path, std::vector<Vertex>& vertices, std::vector<unsigned>& indices, JobSystem* jobs)
+{
+	MappedFile file;
+	if (!file.open(path))
+	{
+		throw std::runtime_error("Could not map mesh file " + path.string());
+	}
+
+	try
+	{
+		decodeMesh(file.data(), file.size(), vertices, indices, jobs);
+	}
+	catch (const std::runtime_error&)
+	{
+		throw std::runtime_error("Invalid mesh file " + path.string());
+	}
+}
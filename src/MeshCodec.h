@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "Assets.h"
+#include "JobSystem.h"
+
+// Compressed mesh encoding, used for .mvmesh files.
+//
+// Vertices are quantized (positions to the bounds of the mesh, normals octahedral in 8 bits per axis,
+// colors to 8 bits per channel) and split into byte planes. Each plane is delta coded against the
+// previous vertex and packed in groups of 16 bytes with 0, 2, 4 or 8 bits per byte, which decodes
+// with a handful of SIMD instructions per group.
+//
+// Triangles are coded against a small FIFO of recently seen edges. A triangle sharing an edge with
+// a recent one and using the next unseen vertex takes a single byte, other indices are stored as
+// variable length deltas. Triangles may come back rotated, the winding is kept.
+//
+// Both streams are split into chunks coded independently, so decoding spreads across threads.
+
+const char MESH_CODEC_MAGIC[4] = { 'M', 'V', 'M', 'C' };
+const uint32_t MESH_CODEC_VERSION = 1;
+
+// Vertices per vertex chunk
+const uint32_t MESH_CODEC_VERTEX_CHUNK = 8192;
+
+// Triangles per index chunk
+const uint32_t MESH_CODEC_TRIANGLE_CHUNK = 16384;
+
+struct MeshCodecHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t vertexChunkCount;
+	uint32_t indexChunkCount;
+	uint32_t positionBits;
+	uint32_t reserved;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+// Follows the header, vertex chunks first
+struct MeshCodecChunk
+{
+	// from the start of the encoded data
+	uint64_t offset;
+	uint32_t bytes;
+
+	// first vertex or index written by the chunk, and how many
+	uint32_t first;
+	uint32_t count;
+
+	// index chunks: one past the highest vertex referenced by earlier chunks
+	uint32_t nextVertex;
+};
+
+struct MeshCodecOptions
+{
+	// Bits per position axis, 1 to 16. The error is at most half a step of the bounds divided by 2^bits - 1.
+	unsigned positionBits = 16;
+};
+
+// Encodes a mesh. Normals don't need to be unit vectors, they are normalized.
+// Throws std::runtime_error if the options are invalid or an index is out of range.
+std::vector<uint8_t> encodeMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, const MeshCodecOptions& options = {});
+
+// Decodes a mesh produced by encodeMesh(), chunks are spread over the job system if one is given.
+// Throws std::runtime_error if the data is not a valid encoded mesh.
+void decodeMesh(const uint8_t* data, size_t size, std::vector<Vertex>& vertices, std::vector<unsigned>& indices, JobSystem* jobs = nullptr);
+
+// Decodes a mesh into memory the caller provides, eg. staging memory for its upload.
+// The counts must match the ones in the header (see readMeshCodecHeader()), or std::runtime_error is thrown.
+void decodeMesh(const uint8_t* data, size_t size, Vertex* vertices, size_t vertexCount, unsigned* indices, size_t indexCount, JobSystem* jobs = nullptr);
+
+// Reads the header of encoded data. Returns false if it doesn't start with one.
+bool readMeshCodecHeader(const uint8_t* data, size_t size, MeshCodecHeader& header);
+
+// Encodes a mesh into a .mvmesh file. Throws std::runtime_error on failure.
+void writeMeshFile(const std::filesystem::path& path, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, const MeshCodecOptions& options = {});
+
+// Maps and decodes a .mvmesh file. Throws std::runtime_error on failure.
+void readMeshFile(const std::filesystem::path& path, std::vector<Vertex>& vertices, std::vector<unsigned>& indices, JobSystem* jobs = nullptr);
@@ -0,0 +1,161 @@
+#include "MeshEditor.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+MeshEditor::MeshEditor(MeshResourcePtr mesh, const MeshEditorOptions& options) :
+	mesh{ std::move(mesh) }, options{ options }
+{
+	if (this->mesh->getResidency() != MeshResidency::Full)
+	{
+		throw std::runtime_error("Only meshes with their full CPU data can be edited");
+	}
+
+	const std::vector<unsigned>& indices = this->mesh->indices;
+	size_t vertexCount = this->mesh->vertices.size();
+	for (unsigned index : indices)
+	{
+		if (index >= vertexCount)
+		{
+			throw std::runtime_error("Mesh index out of range");
+		}
+	}
+
+	// counting sort of the corners by vertex, which keeps the faces of each vertex in order
+	faceOffsets.assign(vertexCount + 1, 0);
+	for (unsigned index : indices)
+	{
+		faceOffsets[index + 1]++;
+	}
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		faceOffsets[i + 1] += faceOffsets[i];
+	}
+
+	vertexFaces.resize(indices.size());
+	std::vector<uint32_t> cursors(faceOffsets.begin(), faceOffsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		vertexFaces[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	marks.assign(vertexCount, 0);
+}
+
+Vertex* MeshEditor::edit(size_t first, size_t count)
+{
+	if (first > mesh->vertices.size() || mesh->vertices.size() - first < count)
+	{
+		throw std::runtime_error("Mesh edit outside of the vertices");
+	}
+
+	if (count > 0)
+	{
+		VertexRange range;
+		range.first = first;
+		range.count = count;
+		edits.push_back(range);
+	}
+	return mesh->vertices.data() + first;
+}
+
+void MeshEditor::touch(uint32_t vertex)
+{
+	if (marks[vertex] != stamp)
+	{
+		marks[vertex] = stamp;
+		touched.push_back(vertex);
+	}
+}
+
+const std::vector<VertexRange>& MeshEditor::commit()
+{
+	dirtyRanges.clear();
+	touched.clear();
+	stats = MeshEditStats();
+	if (edits.empty())
+	{
+		return dirtyRanges;
+	}
+
+	// a new stamp clears the marks, they are only reset for real when it wraps around
+	if (++stamp == 0)
+	{
+		std::fill(marks.begin(), marks.end(), 0);
+		stamp = 1;
+	}
+
+	std::vector<Vertex>& vertices = mesh->vertices;
+	const std::vector<unsigned>& indices = mesh->indices;
+	for (const VertexRange& range : edits)
+	{
+		for (size_t v = range.first; v < range.first + range.count; v++)
+		{
+			touch(static_cast<uint32_t>(v));
+			mesh->boundsMin = glm::min(mesh->boundsMin, vertices[v].position);
+			mesh->boundsMax = glm::max(mesh->boundsMax, vertices[v].position);
+		}
+	}
+	edits.clear();
+	stats.editedVertices = touched.size();
+
+	// moving a vertex turns the faces around it, which changes the normal of every corner of those faces
+	if (options.updateNormals)
+	{
+		size_t editedCount = touched.size();
+		for (size_t i = 0; i < editedCount; i++)
+		{
+			uint32_t v = touched[i];
+			for (uint32_t f = faceOffsets[v]; f < faceOffsets[v + 1]; f++)
+			{
+				const unsigned* face = &indices[size_t(vertexFaces[f]) * 3];
+				touch(face[0]);
+				touch(face[1]);
+				touch(face[2]);
+			}
+		}
+
+		// same sum in the same face order as a full recomputation, so the result is identical
+		for (uint32_t v : touched)
+		{
+			if (faceOffsets[v] == faceOffsets[v + 1])
+			{
+				continue;
+			}
+
+			glm::vec3 normal(0.0f);
+			for (uint32_t f = faceOffsets[v]; f < faceOffsets[v + 1]; f++)
+			{
+				const unsigned* face = &indices[size_t(vertexFaces[f]) * 3];
+				normal += computeFaceNormal(vertices[face[0]].position, vertices[face[1]].position, vertices[face[2]].position);
+			}
+			vertices[v].normal = glm::normalize(normal);
+		}
+		stats.normalVertices = touched.size();
+	}
+
+	// sorted, then neighbours close enough share a range
+	std::sort(touched.begin(), touched.end());
+	for (uint32_t v : touched)
+	{
+		if (!dirtyRanges.empty() && v - (dirtyRanges.back().first + dirtyRanges.back().count) <= options.mergeGap)
+		{
+			dirtyRanges.back().count = v + 1 - dirtyRanges.back().first;
+		}
+		else
+		{
+			VertexRange range;
+			range.first = v;
+			range.count = 1;
+			dirtyRanges.push_back(range);
+		}
+	}
+
+	stats.ranges = dirtyRanges.size();
+	for (const VertexRange& range : dirtyRanges)
+	{
+		stats.uploadBytes += range.count * sizeof(Vertex);
+	}
+	return dirtyRanges;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Assets.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/vec3.hpp>
+
+// Vertices first to first + count
+struct VertexRange
+{
+	size_t first = 0;
+	size_t count = 0;
+};
+
+struct MeshEditorOptions
+{
+	// Dirty ranges with at most this many clean vertices between them are uploaded as one.
+	// Trades a few extra bytes for fewer upload calls.
+	size_t mergeGap = 32;
+
+	// Recompute the normals of the vertices around the edited ones, like parseObj() and normalizeVertexNormals() do
+	bool updateNormals = true;
+};
+
+// What the last commit() did
+struct MeshEditStats
+{
+	// Vertices passed to edit() and vertices whose normal was recomputed (including those)
+	size_t editedVertices = 0;
+	size_t normalVertices = 0;
+
+	// Ranges to upload after coalescing, and their bytes
+	size_t ranges = 0;
+	size_t uploadBytes = 0;
+};
+
+// Edits the vertices of a mesh whose buffers already exist (measurements, morphs, sculpting previews),
+// so only what changed is uploaded instead of recreating the buffers.
+//
+// Callers write vertex ranges returned by edit(), then commit() once per frame. Only the normals around the
+// edited vertices are recomputed, through a vertex to face adjacency built once, and everything that changed
+// is coalesced into a few sorted ranges for ResourceManager::uploadMeshRanges(). The indices never change.
+class MeshEditor
+{
+public:
+	// The mesh must keep its full CPU data (MeshResidency::Full), throws std::runtime_error otherwise
+	explicit MeshEditor(MeshResourcePtr mesh, const MeshEditorOptions& options = {});
+
+	const MeshResourcePtr& getMesh() const { return mesh; }
+
+	// Returns a range of vertices to write and marks it dirty. The pointer stays valid, the vertices are never reallocated.
+	// Throws std::runtime_error if the range is outside the mesh.
+	Vertex* edit(size_t first, size_t count);
+
+	// Moves a single vertex
+	void setPosition(size_t vertex, const glm::vec3& position) { edit(vertex, 1)->position = position; }
+
+	// Finishes the edits made since the last commit: recomputes the affected normals and returns the
+	// ranges of vertices to upload, sorted. The bounds of the mesh only grow, to stay conservative for culling.
+	const std::vector<VertexRange>& commit();
+
+	// Returns the ranges of the last commit
+	const std::vector<VertexRange>& getDirtyRanges() const { return dirtyRanges; }
+
+	const MeshEditStats& getLastStats() const { return stats; }
+
+private:
+	// Adds a vertex to the ones changed by this commit, once
+	void touch(uint32_t vertex);
+
+	MeshResourcePtr mesh;
+	MeshEditorOptions options;
+
+	// Faces around each vertex: faceOffsets[v] to faceOffsets[v + 1] in vertexFaces, in face order
+	std::vector<uint32_t> faceOffsets;
+	std::vector<uint32_t> vertexFaces;
+
+	std::vector<VertexRange> edits;
+	std::vector<VertexRange> dirtyRanges;
+
+	// Vertices changed by the current commit, deduplicated with a mark per vertex
+	std::vector<uint32_t> touched;
+	std::vector<uint32_t> marks;
+	uint32_t stamp = 0;
+
+	MeshEditStats stats;
+};
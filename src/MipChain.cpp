@@ -0,0 +1,322 @@
+#include "MipChain.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_CHAIN_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Rows filtered per task
+	const unsigned TILE_ROWS = 16;
+
+	// Levels smaller than this are filtered on the calling thread, tasks would cost more than they save
+	const size_t MIN_PARALLEL_TEXELS = 64 * 64;
+
+	// Resolution of the linear to sRGB table
+	const int ENCODE_STEPS = 16384;
+
+	const int KAISER_TAPS = 6;
+	const float KAISER_ALPHA = 4.0f;
+
+	const float PI = 3.14159265358979f;
+
+	// The filter of one axis: texel x of the smaller level is the sum of weights[i] * source[2x + offsets[i]]
+	struct Filter
+	{
+		int taps = 0;
+		int offsets[KAISER_TAPS];
+		float weights[KAISER_TAPS];
+	};
+
+	float besselI0(float x)
+	{
+		// power series, converges quickly for the small arguments of the window
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (int k = 1; k < 20; k++)
+		{
+			term *= (x / (2.0f * k)) * (x / (2.0f * k));
+			sum += term;
+		}
+		return sum;
+	}
+
+	Filter makeFilter(MipFilter type)
+	{
+		Filter filter;
+		if (type == MipFilter::Box)
+		{
+			filter.taps = 2;
+			filter.offsets[0] = 0;
+			filter.offsets[1] = 1;
+			filter.weights[0] = filter.weights[1] = 0.5f;
+			return filter;
+		}
+
+		// centered between source texels 2x and 2x + 1, reaching 3 texels to each side
+		filter.taps = KAISER_TAPS;
+		float total = 0;
+		for (int i = 0; i < KAISER_TAPS; i++)
+		{
+			filter.offsets[i] = i - KAISER_TAPS / 2 + 1;
+			float distance = std::abs(filter.offsets[i] - 0.5f);
+
+			// a sinc for half the sampling rate, windowed over the taps
+			float t = distance / 2.0f;
+			float sinc = std::sin(PI * t) / (PI * t);
+			float window = distance / (KAISER_TAPS / 2.0f);
+			float kaiser = besselI0(KAISER_ALPHA * std::sqrt(std::max(0.0f, 1.0f - window * window))) / besselI0(KAISER_ALPHA);
+
+			filter.weights[i] = sinc * kaiser;
+			total += filter.weights[i];
+		}
+		for (int i = 0; i < KAISER_TAPS; i++)
+		{
+			filter.weights[i] /= total;
+		}
+		return filter;
+	}
+
+	float srgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float linearToSrgb(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	const float* getDecodeTable()
+	{
+		static const std::vector<float> table = []() {
+			std::vector<float> values(256);
+			for (int i = 0; i < 256; i++)
+			{
+				values[i] = srgbToLinear(i / 255.0f);
+			}
+			return values;
+		}();
+		return table.data();
+	}
+
+	const uint8_t* getEncodeTable()
+	{
+		static const std::vector<uint8_t> table = []() {
+			std::vector<uint8_t> values(ENCODE_STEPS + 1);
+			for (int i = 0; i <= ENCODE_STEPS; i++)
+			{
+				values[i] = static_cast<uint8_t>(linearToSrgb(float(i) / ENCODE_STEPS) * 255.0f + 0.5f);
+			}
+			return values;
+		}();
+		return table.data();
+	}
+
+#if defined(MIP_CHAIN_SSE2)
+	typedef __m128 Texel;
+
+	inline Texel loadTexel(const float* texel) { return _mm_loadu_ps(texel); }
+	inline void storeTexel(float* texel, Texel value) { _mm_storeu_ps(texel, value); }
+	inline Texel zeroTexel() { return _mm_setzero_ps(); }
+
+	// accumulator + texel * weight
+	inline Texel addWeighted(Texel accumulator, Texel texel, float weight)
+	{
+		return _mm_add_ps(accumulator, _mm_mul_ps(texel, _mm_set1_ps(weight)));
+	}
+
+	// the negative lobes of the Kaiser filter can undershoot
+	inline Texel clampTexel(Texel value)
+	{
+		return _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	}
+#else
+	struct Texel
+	{
+		float values[4];
+	};
+
+	inline Texel loadTexel(const float* texel) { return { { texel[0], texel[1], texel[2], texel[3] } }; }
+	inline void storeTexel(float* texel, Texel value) { std::copy(value.values, value.values + 4, texel); }
+	inline Texel zeroTexel() { return { { 0, 0, 0, 0 } }; }
+
+	inline Texel addWeighted(Texel accumulator, Texel texel, float weight)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			accumulator.values[i] += texel.values[i] * weight;
+		}
+		return accumulator;
+	}
+
+	inline Texel clampTexel(Texel value)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			value.values[i] = std::min(std::max(value.values[i], 0.0f), 1.0f);
+		}
+		return value;
+	}
+#endif
+
+	template <typename Task>
+	void runTiles(JobSystem* jobs, size_t texels, unsigned rows, const Task& task)
+	{
+		size_t tiles = (rows + TILE_ROWS - 1) / TILE_ROWS;
+		auto runTile = [&](size_t tile) {
+			unsigned first = static_cast<unsigned>(tile * TILE_ROWS);
+			task(first, std::min(rows, first + TILE_ROWS));
+		};
+
+		if (jobs && tiles > 1 && texels >= MIN_PARALLEL_TEXELS)
+		{
+			jobs->parallelFor(tiles, runTile);
+		}
+		else
+		{
+			for (size_t tile = 0; tile < tiles; tile++)
+			{
+				runTile(tile);
+			}
+		}
+	}
+
+	int address(int index, int size, bool wrap)
+	{
+		if (wrap)
+		{
+			return ((index % size) + size) % size;
+		}
+		return std::min(std::max(index, 0), size - 1);
+	}
+
+	// Source texels of every texel along one axis of the smaller level
+	std::vector<int> getSourceIndices(const Filter& filter, unsigned sourceSize, unsigned size, bool wrap)
+	{
+		std::vector<int> indices(size_t(size) * filter.taps);
+		for (unsigned x = 0; x < size; x++)
+		{
+			for (int tap = 0; tap < filter.taps; tap++)
+			{
+				indices[x * filter.taps + tap] = address(int(x) * 2 + filter.offsets[tap], int(sourceSize), wrap);
+			}
+		}
+		return indices;
+	}
+}
+
+unsigned getMipCount(unsigned width, unsigned height)
+{
+	unsigned count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = std::max(1u, width / 2);
+		height = std::max(1u, height / 2);
+		count++;
+	}
+	return count;
+}
+
+std::vector<Image> generateMipChain(const Image& image, const MipOptions& options, JobSystem* jobs)
+{
+	std::vector<Image> levels;
+	levels.push_back(image);
+	if (image.width == 0 || image.height == 0)
+	{
+		return levels;
+	}
+
+	const float* decode = getDecodeTable();
+	const uint8_t* encode = getEncodeTable();
+	const Filter filter = makeFilter(options.filter);
+
+	// an axis of a single texel is copied instead of filtered
+	Filter copy;
+	copy.taps = 1;
+	copy.offsets[0] = 0;
+	copy.weights[0] = 1.0f;
+
+	// the previous level in linear floating point
+	unsigned width = image.width;
+	unsigned height = image.height;
+	std::vector<float> source(size_t(width) * height * 4);
+	runTiles(jobs, size_t(width) * height, height, [&](unsigned firstRow, unsigned endRow) {
+		for (size_t i = size_t(firstRow) * width * 4; i < size_t(endRow) * width * 4; i++)
+		{
+			bool color = (i & 3) != 3;
+			source[i] = options.srgb && color ? decode[image.pixels[i]] : image.pixels[i] / 255.0f;
+		}
+	});
+
+	std::vector<float> horizontal;
+	std::vector<float> target;
+	while (width > 1 || height > 1)
+	{
+		unsigned levelWidth = std::max(1u, width / 2);
+		unsigned levelHeight = std::max(1u, height / 2);
+		const Filter& filterX = width > 1 ? filter : copy;
+		const Filter& filterY = height > 1 ? filter : copy;
+		std::vector<int> columns = getSourceIndices(filterX, width, levelWidth, options.wrap);
+		std::vector<int> rows = getSourceIndices(filterY, height, levelHeight, options.wrap);
+
+		// filter the rows, then the columns of the result
+		horizontal.resize(size_t(levelWidth) * height * 4);
+		runTiles(jobs, size_t(levelWidth) * height, height, [&](unsigned firstRow, unsigned endRow) {
+			for (unsigned y = firstRow; y < endRow; y++)
+			{
+				const float* sourceRow = &source[size_t(y) * width * 4];
+				float* out = &horizontal[size_t(y) * levelWidth * 4];
+				for (unsigned x = 0; x < levelWidth; x++)
+				{
+					const int* taps = &columns[x * filterX.taps];
+					Texel sum = zeroTexel();
+					for (int tap = 0; tap < filterX.taps; tap++)
+					{
+						sum = addWeighted(sum, loadTexel(sourceRow + taps[tap] * 4), filterX.weights[tap]);
+					}
+					storeTexel(out + x * 4, sum);
+				}
+			}
+		});
+
+		Image level;
+		level.width = levelWidth;
+		level.height = levelHeight;
+		level.pixels.resize(size_t(levelWidth) * levelHeight * 4);
+		target.resize(size_t(levelWidth) * levelHeight * 4);
+		runTiles(jobs, size_t(levelWidth) * levelHeight, levelHeight, [&](unsigned firstRow, unsigned endRow) {
+			for (unsigned y = firstRow; y < endRow; y++)
+			{
+				const int* taps = &rows[y * filterY.taps];
+				float* out = &target[size_t(y) * levelWidth * 4];
+				for (unsigned x = 0; x < levelWidth; x++)
+				{
+					Texel sum = zeroTexel();
+					for (int tap = 0; tap < filterY.taps; tap++)
+					{
+						sum = addWeighted(sum, loadTexel(&horizontal[(size_t(taps[tap]) * levelWidth + x) * 4]), filterY.weights[tap]);
+					}
+					storeTexel(out + x * 4, clampTexel(sum));
+				}
+
+				uint8_t* pixels = &level.pixels[size_t(y) * levelWidth * 4];
+				for (size_t i = 0; i < size_t(levelWidth) * 4; i++)
+				{
+					bool color = (i & 3) != 3;
+					pixels[i] = options.srgb && color ? encode[int(out[i] * ENCODE_STEPS + 0.5f)] : static_cast<uint8_t>(out[i] * 255.0f + 0.5f);
+				}
+			}
+		});
+
+		levels.push_back(std::move(level));
+		source.swap(target);
+		width = levelWidth;
+		height = levelHeight;
+	}
+	return levels;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "JobSystem.h"
+#include "PngReader.h"
+
+enum class MipFilter
+{
+	// Average of 2x2 texels. Fast, but blurry and lets some aliasing through.
+	Box,
+
+	// Kaiser windowed sinc over 6x6 texels. Sharper levels with less aliasing.
+	Kaiser
+};
+
+struct MipOptions
+{
+	MipFilter filter = MipFilter::Kaiser;
+
+	// Color data is filtered in linear light and stored as sRGB again, so dark and bright texels
+	// average like they look. Turn off for data like normal maps and masks. Alpha is always linear.
+	bool srgb = true;
+
+	// Texels past the edges wrap around, like the sampler does. Otherwise the edges are repeated.
+	bool wrap = true;
+};
+
+// Generates the mip chain of an image, from the image itself down to 1x1. Every level halves the
+// previous one (rounding down). Each level is filtered from the previous one in floating point,
+// four channels per SSE register, and its rows are split into tiles spread across the job system.
+std::vector<Image> generateMipChain(const Image& image, const MipOptions& options = {}, JobSystem* jobs = nullptr);
+
+// Number of levels in the full chain of an image
+unsigned getMipCount(unsigned width, unsigned height);
@@ -0,0 +1,168 @@
+#include "MultiViewQueue.h"
+#include "Frustum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MULTI_VIEW_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Returns a bit for each of the four lanes whose frustum the box touches.
+	// Same test as Frustum::intersects: the box is outside when it lies behind any plane.
+	template <typename Group>
+	unsigned testGroup(const Group& group, const glm::vec3& center, const glm::vec3& extents)
+	{
+#if defined(MULTI_VIEW_SSE2)
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		__m128 cx = _mm_set1_ps(center.x);
+		__m128 cy = _mm_set1_ps(center.y);
+		__m128 cz = _mm_set1_ps(center.z);
+		__m128 ex = _mm_set1_ps(extents.x);
+		__m128 ey = _mm_set1_ps(extents.y);
+		__m128 ez = _mm_set1_ps(extents.z);
+
+		__m128 outside = _mm_setzero_ps();
+		for (int plane = 0; plane < 6; plane++)
+		{
+			__m128 px = _mm_load_ps(group.x[plane]);
+			__m128 py = _mm_load_ps(group.y[plane]);
+			__m128 pz = _mm_load_ps(group.z[plane]);
+
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)),
+				_mm_add_ps(_mm_mul_ps(pz, cz), _mm_load_ps(group.w[plane])));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(px, signMask), ex), _mm_mul_ps(_mm_and_ps(py, signMask), ey)),
+				_mm_mul_ps(_mm_and_ps(pz, signMask), ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+		return ~static_cast<unsigned>(_mm_movemask_ps(outside)) & 0xF;
+#else
+		unsigned inside = 0;
+		for (int lane = 0; lane < 4; lane++)
+		{
+			bool visible = true;
+			for (int plane = 0; plane < 6 && visible; plane++)
+			{
+				float distance = group.x[plane][lane] * center.x + group.y[plane][lane] * center.y + group.z[plane][lane] * center.z + group.w[plane][lane];
+				float radius = std::fabs(group.x[plane][lane]) * extents.x + std::fabs(group.y[plane][lane]) * extents.y + std::fabs(group.z[plane][lane]) * extents.z;
+				visible = distance + radius >= 0;
+			}
+			inside |= unsigned(visible) << lane;
+		}
+		return inside;
+#endif
+	}
+}
+
+void MultiViewQueue::build(const Scene& scene, const glm::mat4x4* viewProjections, size_t viewCount)
+{
+	if (viewCount > MAX_VIEWS)
+	{
+		throw std::runtime_error("Too many views for a MultiViewQueue");
+	}
+
+	items.clear();
+	viewItems.clear();
+	this->viewCount = viewCount;
+	std::fill(std::begin(viewOffsets), std::end(viewOffsets), 0);
+	std::fill(std::begin(culledCounts), std::end(culledCounts), 0);
+	if (viewCount == 0)
+	{
+		return;
+	}
+
+	// unused lanes of the last group are zero, and never set a bit that is kept
+	size_t groupCount = (viewCount + 3) / 4;
+	std::fill(groups, groups + groupCount, FrustumGroup{});
+	for (size_t view = 0; view < viewCount; view++)
+	{
+		Frustum frustum(viewProjections[view]);
+		FrustumGroup& group = groups[view / 4];
+		for (unsigned plane = 0; plane < 6; plane++)
+		{
+			const glm::vec4& p = frustum.getPlane(plane);
+			group.x[plane][view % 4] = p.x;
+			group.y[plane][view % 4] = p.y;
+			group.z[plane][view % 4] = p.z;
+			group.w[plane][view % 4] = p.w;
+		}
+	}
+	uint32_t allViews = viewCount == 32 ? 0xFFFFFFFF : (1u << viewCount) - 1;
+
+	// reserve up front, growing one step at a time would leave the old blocks unused in the arena
+	items.reserve(scene.size());
+
+	size_t meshObjects = 0;
+	for (auto& sceneObject : scene)
+	{
+		const MeshResource* mesh = sceneObject->mesh.get();
+		if (mesh == nullptr)
+		{
+			continue;
+		}
+		meshObjects++;
+
+		// the transform and bounds are the part shared by every view
+		const glm::mat4x4& model = sceneObject->getModelMatrix();
+		glm::vec3 worldMin, worldMax;
+		transformBounds(mesh->boundsMin, mesh->boundsMax, model, worldMin, worldMax);
+		glm::vec3 center = (worldMin + worldMax) * 0.5f;
+		glm::vec3 extents = (worldMax - worldMin) * 0.5f;
+
+		uint32_t views = 0;
+		for (size_t group = 0; group < groupCount; group++)
+		{
+			views |= testGroup(groups[group], center, extents) << (group * 4);
+		}
+		views &= allViews;
+		if (views == 0)
+		{
+			continue;
+		}
+
+		MultiViewItem item;
+		item.draw.sortKey = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(mesh));
+		item.draw.mesh = mesh;
+		item.draw.model = &model;
+		item.views = views;
+		items.push_back(item);
+	}
+
+	std::sort(items.begin(), items.end(), [](const MultiViewItem& a, const MultiViewItem& b) {
+		return a.draw.sortKey < b.draw.sortKey;
+	});
+
+	// split the sorted items into the views' lists, back to back in a single array
+	size_t counts[MAX_VIEWS] = {};
+	for (const MultiViewItem& item : items)
+	{
+		for (size_t view = 0; view < viewCount; view++)
+		{
+			counts[view] += (item.views >> view) & 1;
+		}
+	}
+	for (size_t view = 0; view < viewCount; view++)
+	{
+		viewOffsets[view + 1] = viewOffsets[view] + counts[view];
+		culledCounts[view] = meshObjects - counts[view];
+	}
+
+	viewItems.resize(viewOffsets[viewCount]);
+	size_t cursors[MAX_VIEWS];
+	std::copy(viewOffsets, viewOffsets + viewCount, cursors);
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		uint32_t views = items[i].views;
+		for (size_t view = 0; view < viewCount; view++)
+		{
+			if ((views >> view) & 1)
+			{
+				viewItems[cursors[view]++] = static_cast<uint32_t>(i);
+			}
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+#include "FrameAllocator.h"
+#include "RenderQueue.h"
+#include "Scene.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/mat4x4.hpp>
+
+// An object visible in at least one view, with one bit set for each view that sees it
+struct MultiViewItem
+{
+	DrawItem draw;
+	uint32_t views;
+};
+
+// Builds the lists of objects to draw for several views at once (split screen, video walls, cube captures).
+//
+// The scene is traversed once: each object's matrix and world bounds are computed a single time and
+// tested against the frusta of every view, four views at a time with SIMD. The visible objects are
+// sorted once into a shared list, and each view's draw list is a list of indices into it, in the same order.
+// Like RenderQueue, everything lives in a frame arena, or on the general heap with a null arena.
+class MultiViewQueue
+{
+public:
+	static constexpr size_t MAX_VIEWS = 32;
+
+	explicit MultiViewQueue(LinearArena* arena) :
+		items{ ArenaAllocator<MultiViewItem>(arena) }, viewItems{ ArenaAllocator<uint32_t>(arena) } {}
+
+	// Fills the lists with the visible objects of a scene for each view's view projection matrix.
+	// Throws std::runtime_error for more than MAX_VIEWS views.
+	void build(const Scene& scene, const glm::mat4x4* viewProjections, size_t viewCount);
+
+	size_t getViewCount() const { return viewCount; }
+
+	// Every object visible in any view, sorted to minimize state changes
+	const FrameVector<MultiViewItem>& getItems() const { return items; }
+
+	// Indices into getItems() of the objects visible in a view, in draw order
+	const uint32_t* getViewItems(size_t view) const { return viewItems.data() + viewOffsets[view]; }
+	size_t getViewItemCount(size_t view) const { return viewOffsets[view + 1] - viewOffsets[view]; }
+
+	// Number of objects rejected by a view's frustum in the last build
+	size_t getCulledCount(size_t view) const { return culledCounts[view]; }
+
+private:
+	// Planes of four views, one view per lane, laid out to be loaded straight into SIMD registers
+	struct alignas(16) FrustumGroup
+	{
+		float x[6][4];
+		float y[6][4];
+		float z[6][4];
+		float w[6][4];
+	};
+
+	FrameVector<MultiViewItem> items;
+	FrameVector<uint32_t> viewItems;
+	size_t viewOffsets[MAX_VIEWS + 1] = {};
+	size_t culledCounts[MAX_VIEWS] = {};
+	size_t viewCount = 0;
+
+	FrustumGroup groups[MAX_VIEWS / 4];
+};
@@ -0,0 +1,252 @@
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/vec3.hpp>
+
+using namespace std;
+
+namespace
+{
+	bool isObjSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* skipObjSpace(const char* begin, const char* end)
+	{
+		while (begin != end && isObjSpace(*begin))
+		{
+			begin++;
+		}
+		return begin;
+	}
+
+	// Reads the next number of a line and moves past it. Returns false, leaving the value alone, if there is none.
+	bool readObjFloat(const char*& begin, const char* end, float& value)
+	{
+		const char* start = skipObjSpace(begin, end);
+		if (start != end && *start == '+')
+		{
+			start++;
+		}
+
+		auto result = std::from_chars(start, end, value);
+		if (result.ec != std::errc())
+		{
+			return false;
+		}
+		begin = result.ptr;
+		return true;
+	}
+
+	// Reads the position index of the next face vertex, skipping the texture and normal indices after it ("1/2/3")
+	bool readObjIndex(const char*& begin, const char* end, unsigned& value)
+	{
+		const char* start = skipObjSpace(begin, end);
+		auto result = std::from_chars(start, end, value);
+		if (result.ec != std::errc())
+		{
+			return false;
+		}
+
+		begin = result.ptr;
+		while (begin != end && !isObjSpace(*begin))
+		{
+			begin++;
+		}
+		return true;
+	}
+
+	// Type of a line from its first word, like parseObjStatement() reads it
+	ObjStatementType getObjLineType(const char* begin, const char* end)
+	{
+		begin = skipObjSpace(begin, end);
+		if (begin == end || (begin + 1 != end && !isObjSpace(begin[1])))
+		{
+			return ObjStatementType::Other;
+		}
+		return *begin == 'v' ? ObjStatementType::Position : *begin == 'f' ? ObjStatementType::Face : ObjStatementType::Other;
+	}
+
+	// Calls a function with the start and end of every line
+	template <typename Function>
+	void forEachObjLine(const char* data, size_t size, Function function)
+	{
+		const char* end = data + size;
+		while (data != end)
+		{
+			const char* lineEnd = std::find(data, end, '\n');
+			function(data, lineEnd);
+			data = lineEnd == end ? end : lineEnd + 1;
+		}
+	}
+}
+
+ObjStatement parseObjStatement(const std::string& line)
+{
+	return parseObjStatement(line.data(), line.data() + line.size());
+}
+
+ObjStatement parseObjStatement(const char* begin, const char* end)
+{
+	// note: this assumes DX11, which means we negate the Z access and read faces backwards.
+	// OBJ files assume right hand coordinate systems looking down negative Z.
+	// The numbers are read in place, loading a model doesn't allocate per line.
+	ObjStatement statement;
+	statement.type = getObjLineType(begin, end);
+	begin = skipObjSpace(begin, end);
+	if (begin != end)
+	{
+		begin++;
+	}
+
+	if (statement.type == ObjStatementType::Position)
+	{
+		float x = 0, y = 0, z = 0;
+		readObjFloat(begin, end, x);
+		readObjFloat(begin, end, y);
+		readObjFloat(begin, end, z);
+		statement.position = { x, y, -z };
+
+		float r, g, b;
+		if (readObjFloat(begin, end, r) && readObjFloat(begin, end, g) && readObjFloat(begin, end, b))
+		{
+			statement.color = std::max(std::max(r, g), b) > 1.0f ? glm::vec3(r, g, b) / 255.0f : glm::vec3(r, g, b);
+		}
+	}
+	else if (statement.type == ObjStatementType::Face)
+	{
+		// obj are counter clockwise, make clockwise and make them 0 indexed.
+		// A missing index stays 0 and ends up out of range.
+		unsigned p1 = 0, p2 = 0, p3 = 0;
+		readObjIndex(begin, end, p3);
+		readObjIndex(begin, end, p2);
+		readObjIndex(begin, end, p1);
+		statement.indices[0] = p1 - 1;
+		statement.indices[1] = p2 - 1;
+		statement.indices[2] = p3 - 1;
+	}
+
+	return statement;
+}
+
+glm::vec3 computeFaceNormal(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3)
+{
+	glm::vec3 v1 = p2 - p1;
+	glm::vec3 v2 = p3 - p1;
+	return glm::normalize(glm::cross(v1, v2));
+}
+
+void parseObj(std::istream& stream, std::vector<Vertex>& vertices, std::vector<unsigned>& indices)
+{
+	string line;
+	while (getline(stream, line))
+	{
+		ObjStatement statement = parseObjStatement(line);
+
+		if (statement.type == ObjStatementType::Position)
+		{
+			vertices.push_back(Vertex(statement.position, statement.color));
+		}
+		else if (statement.type == ObjStatementType::Face)
+		{
+			unsigned p1 = statement.indices[0];
+			unsigned p2 = statement.indices[1];
+			unsigned p3 = statement.indices[2];
+			if (p1 >= vertices.size() || p2 >= vertices.size() || p3 >= vertices.size())
+			{
+				throw std::runtime_error("OBJ face references a vertex that isn't defined before it");
+			}
+
+			// calculate the normal, and add it to the normal of each vertex.
+			// We normalize in the end
+			glm::vec3 normal = computeFaceNormal(vertices[p1].position, vertices[p2].position, vertices[p3].position);
+
+			vertices[p1].normal += normal;
+			vertices[p2].normal += normal;
+			vertices[p3].normal += normal;
+
+			indices.push_back(p1);
+			indices.push_back(p2);
+			indices.push_back(p3);
+		}
+	}
+}
+
+void countObj(const char* data, size_t size, size_t& positions, size_t& faces)
+{
+	positions = 0;
+	faces = 0;
+	forEachObjLine(data, size, [&](const char* begin, const char* end) {
+		ObjStatementType type = getObjLineType(begin, end);
+		positions += type == ObjStatementType::Position;
+		faces += type == ObjStatementType::Face;
+	});
+}
+
+void parseObj(const char* data, size_t size, Vertex* vertices, size_t vertexCount, unsigned* indices, size_t indexCount)
+{
+	size_t vertex = 0;
+	size_t index = 0;
+	forEachObjLine(data, size, [&](const char* begin, const char* end) {
+		ObjStatementType type = getObjLineType(begin, end);
+		if (type == ObjStatementType::Other)
+		{
+			return;
+		}
+		if ((type == ObjStatementType::Position && vertex == vertexCount) || (type == ObjStatementType::Face && index + 3 > indexCount))
+		{
+			throw std::runtime_error("OBJ data has more statements than counted");
+		}
+
+		ObjStatement statement = parseObjStatement(begin, end);
+		if (type == ObjStatementType::Position)
+		{
+			new (&vertices[vertex++]) Vertex(statement.position, statement.color);
+			return;
+		}
+
+		unsigned p1 = statement.indices[0];
+		unsigned p2 = statement.indices[1];
+		unsigned p3 = statement.indices[2];
+		if (p1 >= vertex || p2 >= vertex || p3 >= vertex)
+		{
+			throw std::runtime_error("OBJ face references a vertex that isn't defined before it");
+		}
+
+		glm::vec3 normal = computeFaceNormal(vertices[p1].position, vertices[p2].position, vertices[p3].position);
+		vertices[p1].normal += normal;
+		vertices[p2].normal += normal;
+		vertices[p3].normal += normal;
+
+		indices[index++] = p1;
+		indices[index++] = p2;
+		indices[index++] = p3;
+	});
+
+	if (vertex != vertexCount || index != indexCount)
+	{
+		throw std::runtime_error("OBJ data has fewer statements than counted");
+	}
+}
+
+void normalizeVertexNormals(std::vector<Vertex>& vertices)
+{
+	normalizeVertexNormals(vertices.data(), vertices.size());
+}
+
+void normalizeVertexNormals(Vertex* vertices, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		vertices[i].normal = glm::normalize(vertices[i].normal);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "Assets.h"
+
+enum class ObjStatementType
+{
+	Other,
+	Position,
+	Face
+};
+
+// A single line of an OBJ file, already converted to the engine's conventions
+struct ObjStatement
+{
+	ObjStatementType type = ObjStatementType::Other;
+
+	// For Position statements. Z is negated (left handed).
+	glm::vec3 position = { 0, 0, 0 };
+
+	// For Position statements. The color some scanners write after the position ("v x y z r g b"),
+	// from 0 to 1 or 0 to 255, and grey when there is none.
+	glm::vec3 color = { 0.8f, 0.8f, 0.8f };
+
+	// For Face statements. Zero based, in clockwise order.
+	unsigned indices[3] = { 0, 0, 0 };
+};
+
+// Parses a single line of an OBJ file
+ObjStatement parseObjStatement(const std::string& line);
+
+// Parses a single line of OBJ text in place, given by its bounds (without the line break)
+ObjStatement parseObjStatement(const char* begin, const char* end);
+
+// Returns the unit normal of a clockwise triangle
+glm::vec3 computeFaceNormal(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3);
+
+// Parses the vertices and faces of an OBJ stream.
+// Only positions ("v") and triangular faces ("f") are read, other statements are skipped.
+// Positions are converted to a left handed coordinate system (Z is negated) and faces are
+// flipped to clockwise winding. Each face normal is added to the normal of its vertices,
+// so the resulting normals are NOT unit vectors. Use normalizeVertexNormals() to finish them.
+// Throws std::runtime_error if a face references a vertex not defined before it.
+void parseObj(std::istream& stream, std::vector<Vertex>& vertices, std::vector<unsigned>& indices);
+
+// Counts the positions and faces of OBJ text, to size the memory the parseObj() below writes into
+void countObj(const char* data, size_t size, size_t& positions, size_t& faces);
+
+// Parses OBJ text already in memory (eg. a mapped file) straight into memory sized with countObj(),
+// such as staging memory for the upload. The memory needs no initialization.
+// Same conversions as the stream version, and the normals are left accumulated the same way.
+// Throws std::runtime_error if the counts don't match or a face references a vertex not defined before it.
+void parseObj(const char* data, size_t size, Vertex* vertices, size_t vertexCount, unsigned* indices, size_t indexCount);
+
+// Turns the accumulated vertex normals produced by parseObj() into unit vectors
+void normalizeVertexNormals(std::vector<Vertex>& vertices);
+void normalizeVertexNormals(Vertex* vertices, size_t count);
@@ -0,0 +1,347 @@
+#include "ObjStreamLoader.h"
+#include "ObjLoader.h"
+#include "Hash.h"
+
+#include <chrono>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+ObjStreamLoader::ObjStreamLoader(const std::filesystem::path& path, const ObjStreamOptions& options)
+{
+	auto file = std::make_unique<std::ifstream>(path);
+	if (!*file)
+	{
+		throw std::runtime_error("Could not open model file " + path.string());
+	}
+
+	std::error_code error;
+	totalBytes = fs::file_size(path, error);
+	stream = std::move(file);
+	initialize(options);
+}
+
+ObjStreamLoader::ObjStreamLoader(std::unique_ptr<std::istream> stream, uint64_t totalBytes, const ObjStreamOptions& options) :
+	stream{ std::move(stream) }, totalBytes{ totalBytes }
+{
+	initialize(options);
+}
+
+ObjStreamLoader::~ObjStreamLoader()
+{
+	if (spillFile.is_open())
+	{
+		spillFile.close();
+		std::error_code error;
+		fs::remove(spillPath, error);
+	}
+}
+
+void ObjStreamLoader::initialize(const ObjStreamOptions& options)
+{
+	batchBytes = std::max<size_t>(options.batchBytes, 1);
+
+	// The scratch vertices and pending indices are the fixed cost, pages get the rest.
+	// A face can touch three pages, plus one more to evict, so at least four must fit.
+	scratch.reserve(PAGE_VERTICES);
+	pendingIndices.reserve(INDEX_FLUSH);
+	size_t fixedBytes = scratch.capacity() * sizeof(Vertex) + pendingIndices.capacity() * sizeof(unsigned);
+	size_t pageBytes = PAGE_VERTICES * PAGE_ARRAYS * sizeof(glm::vec3);
+	size_t available = options.memoryLimit > fixedBytes ? options.memoryLimit - fixedBytes : 0;
+	maxResidentPages = std::max<size_t>(available / pageBytes, 4);
+
+	// unique per loader, so several files can stream at once
+	Hasher hasher;
+	hasher.updateValue(this);
+	hasher.updateValue(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+	spillPath = options.spillDirectory / ("objstream-" + hasher.finish().toHex().substr(0, 16) + ".tmp");
+
+	updateMemory();
+}
+
+float ObjStreamLoader::getProgress() const
+{
+	if (finished)
+	{
+		return 1.0f;
+	}
+	if (totalBytes == 0)
+	{
+		return 0.0f;
+	}
+	return std::min(1.0f, float(double(stats.bytesRead) / double(totalBytes)));
+}
+
+bool ObjStreamLoader::step(MeshStreamSink& sink)
+{
+	if (finished)
+	{
+		return false;
+	}
+
+	this->sink = &sink;
+
+	size_t read = 0;
+	while (read < batchBytes && std::getline(*stream, line))
+	{
+		read += line.size() + 1;
+
+		ObjStatement statement = parseObjStatement(line);
+		if (statement.type == ObjStatementType::Position)
+		{
+			addPosition(statement.position, statement.color);
+		}
+		else if (statement.type == ObjStatementType::Face)
+		{
+			addFace(statement.indices);
+		}
+	}
+
+	stats.bytesRead += read;
+	finished = !*stream;
+
+	// everything parsed in this batch is visible once the step returns
+	flush();
+
+	if (finished)
+	{
+		// the pages are no longer needed, only the sink holds the mesh now
+		pages = std::vector<Page>();
+		residentPages = std::vector<size_t>();
+		scratch = std::vector<Vertex>();
+		pendingIndices = std::vector<unsigned>();
+		if (spillFile.is_open())
+		{
+			spillFile.close();
+			std::error_code error;
+			fs::remove(spillPath, error);
+		}
+	}
+
+	updateMemory();
+	this->sink = nullptr;
+	return !finished;
+}
+
+void ObjStreamLoader::addPosition(const glm::vec3& position, const glm::vec3& color)
+{
+	size_t index = static_cast<size_t>(stats.vertices);
+	size_t pageIndex = index / PAGE_VERTICES;
+	size_t offset = index % PAGE_VERTICES;
+	if (pageIndex == pages.size())
+	{
+		pages.emplace_back();
+	}
+
+	useCounter++;
+	Page& page = acquirePage(pageIndex);
+	page.data[offset] = position;
+	page.data[PAGE_VERTICES + offset] = { 0, 0, 0 };
+	page.data[PAGE_VERTICES * 2 + offset] = color;
+	page.count = offset + 1;
+
+	if (!page.isDirty())
+	{
+		dirtyPages.push_back(pageIndex);
+	}
+	page.markDirty(offset);
+
+	if (stats.vertices == 0)
+	{
+		boundsMin = boundsMax = position;
+	}
+	boundsMin = glm::min(boundsMin, position);
+	boundsMax = glm::max(boundsMax, position);
+
+	stats.vertices++;
+}
+
+void ObjStreamLoader::addFace(const unsigned indices[3])
+{
+	for (int i = 0; i < 3; i++)
+	{
+		if (indices[i] >= stats.vertices)
+		{
+			stats.invalidFaces++;
+			return;
+		}
+	}
+
+	// Pages used by this face share the same use count, so acquiring one never evicts another
+	useCounter++;
+	Page* facePages[3];
+	size_t offsets[3];
+	for (int i = 0; i < 3; i++)
+	{
+		facePages[i] = &acquirePage(indices[i] / PAGE_VERTICES);
+		offsets[i] = indices[i] % PAGE_VERTICES;
+	}
+
+	glm::vec3 normal = computeFaceNormal(
+		facePages[0]->data[offsets[0]],
+		facePages[1]->data[offsets[1]],
+		facePages[2]->data[offsets[2]]);
+
+	for (int i = 0; i < 3; i++)
+	{
+		Page& page = *facePages[i];
+		page.data[PAGE_VERTICES + offsets[i]] += normal;
+
+		if (!page.isDirty())
+		{
+			dirtyPages.push_back(indices[i] / PAGE_VERTICES);
+		}
+		page.markDirty(offsets[i]);
+
+		pendingIndices.push_back(indices[i]);
+	}
+
+	if (pendingIndices.size() >= INDEX_FLUSH)
+	{
+		flush();
+	}
+}
+
+ObjStreamLoader::Page& ObjStreamLoader::acquirePage(size_t pageIndex)
+{
+	Page& page = pages[pageIndex];
+	page.lastUse = useCounter;
+	if (page.data)
+	{
+		return page;
+	}
+
+	while (residentPages.size() >= maxResidentPages)
+	{
+		evictPage();
+	}
+
+	page.data = std::make_unique<glm::vec3[]>(PAGE_VERTICES * PAGE_ARRAYS);
+	residentPages.push_back(pageIndex);
+
+	if (page.spilled)
+	{
+		spillFile.seekg(std::streamoff(pageIndex) * PAGE_VERTICES * PAGE_ARRAYS * sizeof(glm::vec3));
+		spillFile.read(reinterpret_cast<char*>(page.data.get()), PAGE_VERTICES * PAGE_ARRAYS * sizeof(glm::vec3));
+		if (!spillFile)
+		{
+			throw std::runtime_error("Could not read back spilled vertices from " + spillPath.string());
+		}
+		stats.pagesLoaded++;
+	}
+
+	updateMemory();
+	return page;
+}
+
+void ObjStreamLoader::evictPage()
+{
+	// least recently used, skipping the pages of the current face
+	size_t victim = residentPages.size();
+	for (size_t i = 0; i < residentPages.size(); i++)
+	{
+		const Page& candidate = pages[residentPages[i]];
+		if (candidate.lastUse == useCounter)
+		{
+			continue;
+		}
+		if (victim == residentPages.size() || candidate.lastUse < pages[residentPages[victim]].lastUse)
+		{
+			victim = i;
+		}
+	}
+
+	size_t pageIndex = residentPages[victim];
+	Page& page = pages[pageIndex];
+
+	// Vertices must reach the sink in order, so send every change rather than just this page
+	if (page.isDirty())
+	{
+		flushVertices();
+	}
+
+	if (!spillFile.is_open())
+	{
+		spillFile.open(spillPath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!spillFile)
+		{
+			throw std::runtime_error("Could not create spill file " + spillPath.string());
+		}
+	}
+
+	spillFile.seekp(std::streamoff(pageIndex) * PAGE_VERTICES * PAGE_ARRAYS * sizeof(glm::vec3));
+	spillFile.write(reinterpret_cast<const char*>(page.data.get()), PAGE_VERTICES * PAGE_ARRAYS * sizeof(glm::vec3));
+	if (!spillFile)
+	{
+		throw std::runtime_error("Could not write spill file " + spillPath.string());
+	}
+
+	page.spilled = true;
+	page.data.reset();
+	residentPages[victim] = residentPages.back();
+	residentPages.pop_back();
+	stats.pagesSpilled++;
+}
+
+void ObjStreamLoader::flushVertices()
+{
+	// ascending, so the new vertices at the end are appended in order
+	std::sort(dirtyPages.begin(), dirtyPages.end());
+
+	for (size_t pageIndex : dirtyPages)
+	{
+		Page& page = pages[pageIndex];
+		size_t first = pageIndex * PAGE_VERTICES + page.dirtyFirst;
+		size_t end = pageIndex * PAGE_VERTICES + page.dirtyEnd;
+
+		scratch.clear();
+		for (size_t i = page.dirtyFirst; i < page.dirtyEnd; i++)
+		{
+			Vertex vertex(page.data[i], page.data[PAGE_VERTICES * 2 + i]);
+			vertex.normal = page.data[PAGE_VERTICES + i];
+			scratch.push_back(vertex);
+		}
+
+		size_t updateEnd = std::min(end, sentVertices);
+		if (first < updateEnd)
+		{
+			sink->updateVertices(first, scratch.data(), updateEnd - first);
+		}
+		if (end > sentVertices)
+		{
+			size_t appendFirst = std::max(first, sentVertices);
+			sink->appendVertices(scratch.data() + (appendFirst - first), end - appendFirst);
+			sentVertices = end;
+		}
+
+		page.dirtyFirst = page.dirtyEnd = 0;
+	}
+
+	dirtyPages.clear();
+}
+
+void ObjStreamLoader::flush()
+{
+	flushVertices();
+
+	if (!pendingIndices.empty())
+	{
+		sink->appendIndices(pendingIndices.data(), pendingIndices.size());
+		stats.indices += pendingIndices.size();
+		pendingIndices.clear();
+	}
+}
+
+void ObjStreamLoader::updateMemory()
+{
+	size_t bytes = residentPages.size() * PAGE_VERTICES * PAGE_ARRAYS * sizeof(glm::vec3)
+		+ pages.capacity() * sizeof(Page)
+		+ residentPages.capacity() * sizeof(size_t)
+		+ dirtyPages.capacity() * sizeof(size_t)
+		+ scratch.capacity() * sizeof(Vertex)
+		+ pendingIndices.capacity() * sizeof(unsigned)
+		+ line.capacity();
+
+	memory.set(bytes);
+	stats.peakMemory = std::max(stats.peakMemory, bytes);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Assets.h"
+#include "MemoryStats.h"
+
+// Receives the geometry produced by an ObjStreamLoader, usually to upload it to the GPU.
+// Vertices always arrive in order, and indices only reference vertices that were already received.
+class MeshStreamSink
+{
+public:
+	virtual ~MeshStreamSink() = default;
+
+	// Adds vertices after the ones already received
+	virtual void appendVertices(const Vertex* vertices, size_t count) = 0;
+
+	// Replaces vertices that were received before, because later faces changed their normals
+	virtual void updateVertices(size_t first, const Vertex* vertices, size_t count) = 0;
+
+	// Adds triangle indices
+	virtual void appendIndices(const unsigned* indices, size_t count) = 0;
+};
+
+struct ObjStreamOptions
+{
+	// Bytes of the file parsed by each step()
+	size_t batchBytes = 4 * 1024 * 1024;
+
+	// Most memory the loader holds at once. Vertices that don't fit are spilled to a temporary file
+	// and read back when a later face references them.
+	size_t memoryLimit = 256 * 1024 * 1024;
+
+	// Where the spill file is created
+	std::filesystem::path spillDirectory = std::filesystem::temp_directory_path();
+};
+
+struct ObjStreamStats
+{
+	uint64_t bytesRead = 0;
+	uint64_t vertices = 0;
+	uint64_t indices = 0;
+
+	// faces referencing vertices that don't exist, these are skipped
+	uint64_t invalidFaces = 0;
+
+	// the most memory held by the loader at once
+	size_t peakMemory = 0;
+
+	// pages written to and read back from the spill file
+	uint64_t pagesSpilled = 0;
+	uint64_t pagesLoaded = 0;
+};
+
+// Loads an OBJ file a batch at a time, sending the geometry to a MeshStreamSink as it goes.
+// This lets huge files show up progressively, without ever holding the whole mesh in memory.
+//
+// Produces the same vertices and indices as parseObj(). Normals are accumulated the same way,
+// so vertices are sent again (updateVertices) whenever a later face touches them.
+// Positions, normals and colors are kept in fixed size pages. When they don't fit in the memory limit,
+// the least recently used pages are uploaded and written to a spill file.
+class ObjStreamLoader
+{
+public:
+	ObjStreamLoader(const std::filesystem::path& path, const ObjStreamOptions& options = {});
+
+	// Streams from an already open stream. totalBytes is only used for the progress.
+	ObjStreamLoader(std::unique_ptr<std::istream> stream, uint64_t totalBytes, const ObjStreamOptions& options = {});
+
+	~ObjStreamLoader();
+
+	ObjStreamLoader(const ObjStreamLoader&) = delete;
+	ObjStreamLoader& operator=(const ObjStreamLoader&) = delete;
+
+	// Parses the next batch and sends the new geometry to the sink.
+	// Returns false once the whole file has been loaded.
+	bool step(MeshStreamSink& sink);
+
+	bool isFinished() const { return finished; }
+
+	// Returns the loaded fraction of the file, from 0 to 1
+	float getProgress() const;
+
+	const ObjStreamStats& getStats() const { return stats; }
+
+	// Bounds of the vertices read so far
+	glm::vec3 getBoundsMin() const { return boundsMin; }
+	glm::vec3 getBoundsMax() const { return boundsMax; }
+
+private:
+	static const size_t PAGE_VERTICES = 16384;
+
+	// vec3 arrays in a page: positions, accumulated normals and colors
+	static const size_t PAGE_ARRAYS = 3;
+
+	// pending indices are sent once there are this many
+	static const size_t INDEX_FLUSH = 65536;
+
+	// Positions, then accumulated normals, then colors of PAGE_VERTICES vertices
+	struct Page
+	{
+		std::unique_ptr<glm::vec3[]> data; // null when not resident
+		size_t count = 0;
+		uint64_t lastUse = 0;
+		bool spilled = false;
+
+		// range of vertices changed since they were last sent, relative to the page
+		size_t dirtyFirst = 0;
+		size_t dirtyEnd = 0;
+
+		bool isDirty() const { return dirtyFirst < dirtyEnd; }
+		void markDirty(size_t index)
+		{
+			if (!isDirty())
+			{
+				dirtyFirst = index;
+				dirtyEnd = index + 1;
+			}
+			else
+			{
+				dirtyFirst = std::min(dirtyFirst, index);
+				dirtyEnd = std::max(dirtyEnd, index + 1);
+			}
+		}
+	};
+
+	void initialize(const ObjStreamOptions& options);
+	void addPosition(const glm::vec3& position, const glm::vec3& color);
+	void addFace(const unsigned indices[3]);
+
+	// Returns the page, reading it back from the spill file if needed
+	Page& acquirePage(size_t pageIndex);
+	void evictPage();
+
+	// Sends all changed vertices to the sink
+	void flushVertices();
+
+	// Sends all changed vertices, then the pending indices
+	void flush();
+
+	void updateMemory();
+
+	std::unique_ptr<std::istream> stream;
+	uint64_t totalBytes = 0;
+	size_t batchBytes;
+	size_t maxResidentPages;
+	std::filesystem::path spillPath;
+	std::fstream spillFile;
+
+	std::vector<Page> pages;
+	std::vector<size_t> residentPages;
+	std::vector<size_t> dirtyPages;
+	uint64_t useCounter = 0;
+
+	// vertices already sent to the sink
+	size_t sentVertices = 0;
+
+	std::vector<unsigned> pendingIndices;
+	std::vector<Vertex> scratch;
+	std::string line;
+
+	MeshStreamSink* sink = nullptr;
+	bool finished = false;
+
+	glm::vec3 boundsMin = { 0, 0, 0 };
+	glm::vec3 boundsMax = { 0, 0, 0 };
+
+	ObjStreamStats stats;
+	TrackedMemory memory{ MemoryTag::MeshCpu };
+};
@@ -0,0 +1,344 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	double secondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	unsigned roundUp(unsigned value, unsigned multiple)
+	{
+		return std::max((value + multiple - 1) / multiple * multiple, multiple);
+	}
+
+	// Twice the signed area of a, b, p. Positive when the three are clockwise on screen (y down).
+	float edge(float ax, float ay, float bx, float by, float px, float py)
+	{
+		return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+	}
+}
+
+OcclusionCuller::OcclusionCuller(const OcclusionOptions& options) :
+	options{ options },
+	width{ roundUp(options.width, 64) },
+	height{ roundUp(options.height, 16) },
+	viewProjection{ 1.0f }
+{
+	for (unsigned level = 0; level < LEVEL_COUNT; level++)
+	{
+		levels[level].assign(size_t(width >> level) * (height >> level), 1.0f);
+	}
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4x4& viewProjection)
+{
+	phaseStart = Clock::now();
+	this->viewProjection = viewProjection;
+	std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+	stats = OcclusionStats();
+}
+
+ScreenBounds OcclusionCuller::projectBounds(const glm::vec3& worldMin, const glm::vec3& worldMax) const
+{
+	// the corners are the projected minimum corner plus any of the projected edges along each axis
+	glm::vec4 base = viewProjection * glm::vec4(worldMin, 1.0f);
+	glm::vec4 edgeX = viewProjection[0] * (worldMax.x - worldMin.x);
+	glm::vec4 edgeY = viewProjection[1] * (worldMax.y - worldMin.y);
+	glm::vec4 edgeZ = viewProjection[2] * (worldMax.z - worldMin.z);
+
+	ScreenBounds bounds;
+	bounds.minX = float(width);
+	bounds.minY = float(height);
+	bounds.maxX = 0.0f;
+	bounds.maxY = 0.0f;
+	bounds.nearest = 1.0f;
+	bounds.crossesNear = false;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec4 clip = base;
+		if (corner & 1) clip += edgeX;
+		if (corner & 2) clip += edgeY;
+		if (corner & 4) clip += edgeZ;
+
+		if (clip.w <= 1e-6f || clip.z < 0.0f)
+		{
+			bounds.crossesNear = true;
+			return bounds;
+		}
+
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+		float y = (0.5f - clip.y * inverseW * 0.5f) * height;
+		bounds.minX = std::min(bounds.minX, x);
+		bounds.maxX = std::max(bounds.maxX, x);
+		bounds.minY = std::min(bounds.minY, y);
+		bounds.maxY = std::max(bounds.maxY, y);
+		bounds.nearest = std::min(bounds.nearest, clip.z * inverseW);
+	}
+	return bounds;
+}
+
+float OcclusionCuller::getScreenArea(const ScreenBounds& bounds) const
+{
+	if (bounds.crossesNear)
+	{
+		return 1.0f;
+	}
+
+	float coveredX = std::max(std::min(bounds.maxX, float(width)) - std::max(bounds.minX, 0.0f), 0.0f);
+	float coveredY = std::max(std::min(bounds.maxY, float(height)) - std::max(bounds.minY, 0.0f), 0.0f);
+	return coveredX * coveredY / (float(width) * float(height));
+}
+
+bool OcclusionCuller::addOccluder(const MeshResource& mesh, const glm::mat4x4& model)
+{
+	const MeshResource& source = mesh.occluder != nullptr ? *mesh.occluder : mesh;
+	size_t triangles = source.indices.size() / 3;
+	if (triangles == 0 || triangles > options.maxOccluderTriangles)
+	{
+		return false;
+	}
+
+	// meshes keeping only their positions can still hide others
+	PositionView positions = source.getCpuPositions();
+	if (positions.empty())
+	{
+		return false;
+	}
+
+	glm::mat4x4 modelViewProjection = viewProjection * model;
+	screenVertices.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		glm::vec4 clip = modelViewProjection * glm::vec4(positions[i], 1.0f);
+		ScreenVertex& screen = screenVertices[i];
+
+		// triangles crossing the near plane are skipped, drawing less of an occluder is always safe
+		screen.visible = clip.w > 1e-6f && clip.z >= 0.0f;
+		float inverseW = screen.visible ? 1.0f / clip.w : 0.0f;
+		screen.x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+		screen.y = (0.5f - clip.y * inverseW * 0.5f) * height;
+		screen.z = clip.z * inverseW;
+	}
+
+	for (size_t i = 0; i + 2 < source.indices.size(); i += 3)
+	{
+		const ScreenVertex& a = screenVertices[source.indices[i]];
+		const ScreenVertex& b = screenVertices[source.indices[i + 1]];
+		const ScreenVertex& c = screenVertices[source.indices[i + 2]];
+		if (a.visible && b.visible && c.visible)
+		{
+			drawTriangle(a, b, c);
+		}
+	}
+
+	stats.occluders++;
+	stats.occluderTriangles += triangles;
+	return true;
+}
+
+void OcclusionCuller::drawTriangle(const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c)
+{
+	// both faces are drawn: occluders need not be closed, and a wall hides what is behind it from either side
+	float area = edge(a.x, a.y, b.x, b.y, c.x, c.y);
+	if (area == 0)
+	{
+		return;
+	}
+	const ScreenVertex& second = area > 0 ? b : c;
+	const ScreenVertex& third = area > 0 ? c : b;
+	area = std::fabs(area);
+
+	int minX = std::max(static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))), 0);
+	int maxX = std::min(static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))), static_cast<int>(width) - 1);
+	int minY = std::max(static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))), 0);
+	int maxY = std::min(static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))), static_cast<int>(height) - 1);
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+
+	// start at a multiple of four pixels so every group is a whole SSE register of the row
+	minX &= ~3;
+
+	// edge functions and depth at the first pixel center, stepped per pixel
+	float startX = minX + 0.5f;
+	float startY = minY + 0.5f;
+	float rowA = edge(second.x, second.y, third.x, third.y, startX, startY);
+	float rowB = edge(third.x, third.y, a.x, a.y, startX, startY);
+	float rowC = edge(a.x, a.y, second.x, second.y, startX, startY);
+	float stepXA = -(third.y - second.y), stepYA = third.x - second.x;
+	float stepXB = -(a.y - third.y), stepYB = a.x - third.x;
+	float stepXC = -(second.y - a.y), stepYC = second.x - a.x;
+
+	// depth is affine on screen: the edge functions over the area are the weights of a, second and third
+	float inverseArea = 1.0f / area;
+	float deltaB = (second.z - a.z) * inverseArea;
+	float deltaC = (third.z - a.z) * inverseArea;
+	float rowZ = a.z + rowB * deltaB + rowC * deltaC;
+	float stepXZ = stepXB * deltaB + stepXC * deltaC;
+	float stepYZ = stepYB * deltaB + stepYC * deltaC;
+
+	float* depth = levels[0].data();
+	for (int y = minY; y <= maxY; y++)
+	{
+		float* row = depth + size_t(y) * width;
+
+#if defined(OCCLUSION_SSE2)
+		const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+		__m128 weightA = _mm_add_ps(_mm_set1_ps(rowA), _mm_mul_ps(lanes, _mm_set1_ps(stepXA)));
+		__m128 weightB = _mm_add_ps(_mm_set1_ps(rowB), _mm_mul_ps(lanes, _mm_set1_ps(stepXB)));
+		__m128 weightC = _mm_add_ps(_mm_set1_ps(rowC), _mm_mul_ps(lanes, _mm_set1_ps(stepXC)));
+		__m128 z = _mm_add_ps(_mm_set1_ps(rowZ), _mm_mul_ps(lanes, _mm_set1_ps(stepXZ)));
+		const __m128 groupStepA = _mm_set1_ps(stepXA * 4.0f);
+		const __m128 groupStepB = _mm_set1_ps(stepXB * 4.0f);
+		const __m128 groupStepC = _mm_set1_ps(stepXC * 4.0f);
+		const __m128 groupStepZ = _mm_set1_ps(stepXZ * 4.0f);
+
+		for (int x = minX; x <= maxX; x += 4)
+		{
+			// a pixel is inside when no edge function is negative, the sign bits tell
+			__m128 outside = _mm_or_ps(_mm_or_ps(weightA, weightB), weightC);
+			int outsideMask = _mm_movemask_ps(outside);
+			if (outsideMask != 0xF)
+			{
+				__m128 inside = _mm_castsi128_ps(_mm_cmpgt_epi32(_mm_castps_si128(outside), _mm_set1_epi32(-1)));
+				__m128 current = _mm_loadu_ps(row + x);
+				__m128 nearest = _mm_min_ps(current, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+			}
+
+			weightA = _mm_add_ps(weightA, groupStepA);
+			weightB = _mm_add_ps(weightB, groupStepB);
+			weightC = _mm_add_ps(weightC, groupStepC);
+			z = _mm_add_ps(z, groupStepZ);
+		}
+#else
+		float weightA = rowA;
+		float weightB = rowB;
+		float weightC = rowC;
+		float z = rowZ;
+		for (int x = minX; x <= maxX; x++)
+		{
+			if (weightA >= 0 && weightB >= 0 && weightC >= 0)
+			{
+				row[x] = std::min(row[x], z);
+			}
+
+			weightA += stepXA;
+			weightB += stepXB;
+			weightC += stepXC;
+			z += stepXZ;
+		}
+#endif
+
+		rowA += stepYA;
+		rowB += stepYB;
+		rowC += stepYC;
+		rowZ += stepYZ;
+	}
+}
+
+void OcclusionCuller::buildHierarchy()
+{
+	for (unsigned level = 1; level < LEVEL_COUNT; level++)
+	{
+		const float* source = levels[level - 1].data();
+		float* target = levels[level].data();
+		unsigned sourceWidth = width >> (level - 1);
+		unsigned targetWidth = width >> level;
+		unsigned targetHeight = height >> level;
+
+		for (unsigned y = 0; y < targetHeight; y++)
+		{
+			const float* top = source + size_t(y) * 2 * sourceWidth;
+			const float* bottom = top + sourceWidth;
+			float* row = target + size_t(y) * targetWidth;
+
+			unsigned x = 0;
+#if defined(OCCLUSION_SSE2)
+			// eight source texels of two rows become four, keeping the farthest depth
+			for (; x + 4 <= targetWidth; x += 4)
+			{
+				__m128 left = _mm_max_ps(_mm_loadu_ps(top + x * 2), _mm_loadu_ps(bottom + x * 2));
+				__m128 right = _mm_max_ps(_mm_loadu_ps(top + x * 2 + 4), _mm_loadu_ps(bottom + x * 2 + 4));
+				__m128 even = _mm_shuffle_ps(left, right, _MM_SHUFFLE(2, 0, 2, 0));
+				__m128 odd = _mm_shuffle_ps(left, right, _MM_SHUFFLE(3, 1, 3, 1));
+				_mm_storeu_ps(row + x, _mm_max_ps(even, odd));
+			}
+#endif
+			for (; x < targetWidth; x++)
+			{
+				row[x] = std::max(std::max(top[x * 2], top[x * 2 + 1]), std::max(bottom[x * 2], bottom[x * 2 + 1]));
+			}
+		}
+	}
+
+	stats.rasterizeSeconds = secondsSince(phaseStart);
+	phaseStart = Clock::now();
+}
+
+bool OcclusionCuller::isVisible(const ScreenBounds& bounds)
+{
+	stats.tested++;
+
+	// boxes reaching past the near plane surround the camera
+	if (bounds.crossesNear)
+	{
+		return true;
+	}
+	float nearest = bounds.nearest;
+
+	// every pixel the rectangle touches
+	int x0 = std::max(static_cast<int>(std::floor(bounds.minX)), 0);
+	int x1 = std::min(static_cast<int>(std::floor(bounds.maxX)), static_cast<int>(width) - 1);
+	int y0 = std::max(static_cast<int>(std::floor(bounds.minY)), 0);
+	int y1 = std::min(static_cast<int>(std::floor(bounds.maxY)), static_cast<int>(height) - 1);
+	if (x0 > x1 || y0 > y1)
+	{
+		return true;
+	}
+
+	// the level where the rectangle spans at most a few texels
+	unsigned level = 0;
+	int span = std::max(x1 - x0, y1 - y0);
+	while (span > 3 && level + 1 < LEVEL_COUNT)
+	{
+		span >>= 1;
+		level++;
+	}
+
+	const float* depth = levels[level].data();
+	unsigned levelWidth = width >> level;
+	for (int y = y0 >> level; y <= (y1 >> level); y++)
+	{
+		const float* row = depth + size_t(y) * levelWidth;
+		for (int x = x0 >> level; x <= (x1 >> level); x++)
+		{
+			// some occluder in the tile is farther than the box, or there is no occluder
+			if (row[x] >= nearest)
+			{
+				return true;
+			}
+		}
+	}
+
+	stats.occluded++;
+	return false;
+}
+
+void OcclusionCuller::endFrame()
+{
+	stats.testSeconds = secondsSince(phaseStart);
+}
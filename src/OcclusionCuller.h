@@ -0,0 +1,136 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+#include "Assets.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+struct OcclusionOptions
+{
+	// Size of the depth buffer. Rounded up to a multiple of 64 wide and 16 high for the hierarchy.
+	unsigned width = 256;
+	unsigned height = 128;
+
+	// Objects covering less of the screen than this (0 to 1) are never drawn as occluders
+	float minOccluderArea = 0.02f;
+
+	// The largest objects on screen are drawn as occluders, up to this many
+	size_t maxOccluders = 16;
+
+	// Meshes with more triangles are skipped unless they have a simplified occluder mesh
+	size_t maxOccluderTriangles = 8192;
+};
+
+// Work done by the occlusion pass in the last frame
+struct OcclusionStats
+{
+	size_t occluders = 0;
+	size_t occluderTriangles = 0;
+
+	// Objects tested against the depth buffer and the ones found hidden
+	size_t tested = 0;
+	size_t occluded = 0;
+
+	// Time spent picking and rasterizing occluders and building the hierarchy, and testing objects
+	double rasterizeSeconds = 0;
+	double testSeconds = 0;
+
+	double getRejectedShare() const { return tested > 0 ? double(occluded) / double(tested) : 0.0; }
+};
+
+// Screen rectangle of a box in depth buffer pixels, with the depth of its nearest point
+struct ScreenBounds
+{
+	float minX;
+	float minY;
+	float maxX;
+	float maxY;
+	float nearest;
+
+	// The box reaches past the near plane, so it surrounds the camera and the rectangle is meaningless
+	bool crossesNear;
+};
+
+// Culls objects hidden behind others on the CPU, before they are submitted.
+// A few large occluders are rasterized into a small depth buffer (four pixels at a time with SSE2),
+// which is reduced into a hierarchy holding the farthest depth of each tile. An object is hidden
+// when the nearest point of its bounds is behind every tile its screen rectangle touches.
+// Follows the viewer's conventions: depth from 0 (near) to 1 (far), rows top to bottom.
+//
+// A frame goes: beginFrame(), addOccluder() for each occluder, buildHierarchy(), then isVisible()
+// for each object and endFrame().
+class OcclusionCuller
+{
+public:
+	explicit OcclusionCuller(const OcclusionOptions& options = {});
+
+	// Clears the depth buffer for a camera
+	void beginFrame(const glm::mat4x4& viewProjection);
+
+	// Projects a world space box for the camera of the frame
+	ScreenBounds projectBounds(const glm::vec3& worldMin, const glm::vec3& worldMax) const;
+
+	// Returns the share of the screen (0 to 1) covered by a projected box.
+	// Boxes crossing the near plane cover the whole screen.
+	float getScreenArea(const ScreenBounds& bounds) const;
+
+	// Rasterizes the triangles of a mesh, or its simplified occluder mesh when it has one.
+	// Returns false when the mesh keeps no CPU positions and indices (see MeshResidency) or has too many triangles.
+	bool addOccluder(const MeshResource& mesh, const glm::mat4x4& model);
+
+	// Reduces the depth buffer into the hierarchy. Call after the last occluder.
+	void buildHierarchy();
+
+	// Returns false if a projected box is certainly hidden behind the occluders
+	bool isVisible(const ScreenBounds& bounds);
+
+	bool isVisible(const glm::vec3& worldMin, const glm::vec3& worldMax)
+	{
+		return isVisible(projectBounds(worldMin, worldMax));
+	}
+
+	// Finishes the statistics of the frame
+	void endFrame();
+
+	const OcclusionStats& getStats() const { return stats; }
+	const OcclusionOptions& getOptions() const { return options; }
+
+	unsigned getWidth() const { return width; }
+	unsigned getHeight() const { return height; }
+
+	// Depth buffer of the occluders, rows top to bottom
+	const float* getDepth() const { return levels[0].data(); }
+
+private:
+	static const unsigned LEVEL_COUNT = 5;
+
+	struct ScreenVertex
+	{
+		float x;
+		float y;
+		float z;
+		bool visible;
+	};
+
+	void drawTriangle(const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c);
+
+	OcclusionOptions options;
+	unsigned width;
+	unsigned height;
+	glm::mat4x4 viewProjection;
+
+	// Level 0 is the depth buffer, every next level the farthest depth of 2x2 texels of the previous one
+	std::vector<float> levels[LEVEL_COUNT];
+
+	// transformed vertices of the occluder being drawn, kept to avoid reallocating
+	std::vector<ScreenVertex> screenVertices;
+
+	OcclusionStats stats;
+	std::chrono::steady_clock::time_point phaseStart;
+};
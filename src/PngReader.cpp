@@ -0,0 +1,546 @@
+#include "PngReader.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const unsigned MAX_BITS = 15;
+
+	// Images larger than this are rejected before anything is allocated for them
+	const uint64_t MAX_PIXELS = uint64_t(1) << 28;
+
+	const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	void fail(const char* message)
+	{
+		throw std::runtime_error(std::string("Could not decode PNG: ") + message);
+	}
+
+	// Reads the bits of a deflate stream, least significant first
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* data, size_t size) : data{ data }, size{ size } {}
+
+		uint32_t read(unsigned count)
+		{
+			while (bitCount < count)
+			{
+				if (position >= size)
+				{
+					fail("compressed data ends early");
+				}
+				buffer |= uint32_t(data[position++]) << bitCount;
+				bitCount += 8;
+			}
+
+			uint32_t value = buffer & ((uint32_t(1) << count) - 1);
+			buffer >>= count;
+			bitCount -= count;
+			return value;
+		}
+
+		// Stored blocks start at a byte boundary
+		void alignToByte()
+		{
+			buffer = 0;
+			bitCount = 0;
+		}
+
+		const uint8_t* readBytes(size_t count)
+		{
+			if (count > size - position)
+			{
+				fail("compressed data ends early");
+			}
+			const uint8_t* bytes = data + position;
+			position += count;
+			return bytes;
+		}
+
+	private:
+		const uint8_t* data;
+		size_t size;
+		size_t position = 0;
+		uint32_t buffer = 0;
+		unsigned bitCount = 0;
+	};
+
+	// Canonical Huffman code, decoded a bit at a time from the code lengths
+	struct Huffman
+	{
+		uint16_t counts[MAX_BITS + 1];
+		uint16_t symbols[288];
+
+		void build(const uint8_t* lengths, unsigned count)
+		{
+			std::fill(counts, counts + MAX_BITS + 1, uint16_t(0));
+			for (unsigned i = 0; i < count; i++)
+			{
+				counts[lengths[i]]++;
+			}
+			counts[0] = 0;
+
+			// a code that uses more codes than there are is broken, incomplete ones are allowed
+			int left = 1;
+			for (unsigned bits = 1; bits <= MAX_BITS; bits++)
+			{
+				left = left * 2 - counts[bits];
+				if (left < 0)
+				{
+					fail("invalid Huffman code");
+				}
+			}
+
+			uint16_t offsets[MAX_BITS + 1];
+			offsets[1] = 0;
+			for (unsigned bits = 1; bits < MAX_BITS; bits++)
+			{
+				offsets[bits + 1] = offsets[bits] + counts[bits];
+			}
+			for (unsigned i = 0; i < count; i++)
+			{
+				if (lengths[i] != 0)
+				{
+					symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+				}
+			}
+		}
+
+		unsigned decode(BitReader& reader) const
+		{
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (unsigned bits = 1; bits <= MAX_BITS; bits++)
+			{
+				code |= int(reader.read(1));
+				int count = counts[bits];
+				if (code - count < first)
+				{
+					return symbols[index + (code - first)];
+				}
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			fail("invalid Huffman code");
+			return 0;
+		}
+	};
+
+	void inflateBlock(BitReader& reader, const Huffman& literals, const Huffman& distances, std::vector<uint8_t>& out, size_t limit)
+	{
+		for (;;)
+		{
+			unsigned symbol = literals.decode(reader);
+			if (symbol < 256)
+			{
+				if (out.size() >= limit)
+				{
+					fail("more data than the image holds");
+				}
+				out.push_back(static_cast<uint8_t>(symbol));
+			}
+			else if (symbol == 256)
+			{
+				return;
+			}
+			else
+			{
+				symbol -= 257;
+				if (symbol >= 29)
+				{
+					fail("invalid length");
+				}
+				size_t length = LENGTH_BASE[symbol] + reader.read(LENGTH_EXTRA[symbol]);
+
+				unsigned distanceSymbol = distances.decode(reader);
+				if (distanceSymbol >= 30)
+				{
+					fail("invalid distance");
+				}
+				size_t distance = DISTANCE_BASE[distanceSymbol] + reader.read(DISTANCE_EXTRA[distanceSymbol]);
+				if (distance > out.size())
+				{
+					fail("distance before the start of the data");
+				}
+				if (length > limit - out.size())
+				{
+					fail("more data than the image holds");
+				}
+
+				// copies may overlap what they write
+				size_t from = out.size() - distance;
+				for (size_t i = 0; i < length; i++)
+				{
+					out.push_back(out[from + i]);
+				}
+			}
+		}
+	}
+
+	// Decompresses a zlib stream of at most limit bytes
+	std::vector<uint8_t> inflate(const uint8_t* data, size_t size, size_t limit)
+	{
+		if (size < 2 || (data[0] & 0x0f) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+		{
+			fail("unsupported zlib stream");
+		}
+
+		std::vector<uint8_t> out;
+		out.reserve(limit);
+		BitReader reader(data + 2, size - 2);
+
+		bool last = false;
+		while (!last)
+		{
+			last = reader.read(1) != 0;
+			unsigned type = reader.read(2);
+			if (type == 0)
+			{
+				reader.alignToByte();
+				const uint8_t* header = reader.readBytes(4);
+				unsigned length = header[0] | (header[1] << 8);
+				unsigned complement = header[2] | (header[3] << 8);
+				if (length != (~complement & 0xffff) || length > limit - out.size())
+				{
+					fail("invalid stored block");
+				}
+				const uint8_t* bytes = reader.readBytes(length);
+				out.insert(out.end(), bytes, bytes + length);
+			}
+			else if (type == 1)
+			{
+				static const auto fixed = []() {
+					uint8_t lengths[320];
+					std::fill(lengths, lengths + 144, uint8_t(8));
+					std::fill(lengths + 144, lengths + 256, uint8_t(9));
+					std::fill(lengths + 256, lengths + 280, uint8_t(7));
+					std::fill(lengths + 280, lengths + 288, uint8_t(8));
+					std::fill(lengths + 288, lengths + 320, uint8_t(5));
+
+					std::pair<Huffman, Huffman> codes;
+					codes.first.build(lengths, 288);
+					codes.second.build(lengths + 288, 30);
+					return codes;
+				}();
+				inflateBlock(reader, fixed.first, fixed.second, out, limit);
+			}
+			else if (type == 2)
+			{
+				unsigned literalCount = reader.read(5) + 257;
+				unsigned distanceCount = reader.read(5) + 1;
+				unsigned codeLengthCount = reader.read(4) + 4;
+				if (literalCount > 286 || distanceCount > 30)
+				{
+					fail("invalid dynamic block");
+				}
+
+				static const uint8_t ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+				uint8_t codeLengths[19] = {};
+				for (unsigned i = 0; i < codeLengthCount; i++)
+				{
+					codeLengths[ORDER[i]] = static_cast<uint8_t>(reader.read(3));
+				}
+				Huffman lengthCode;
+				lengthCode.build(codeLengths, 19);
+
+				uint8_t lengths[286 + 30] = {};
+				unsigned index = 0;
+				while (index < literalCount + distanceCount)
+				{
+					unsigned symbol = lengthCode.decode(reader);
+					if (symbol < 16)
+					{
+						lengths[index++] = static_cast<uint8_t>(symbol);
+						continue;
+					}
+
+					uint8_t value = 0;
+					unsigned repeat = 0;
+					if (symbol == 16)
+					{
+						if (index == 0)
+						{
+							fail("invalid dynamic block");
+						}
+						value = lengths[index - 1];
+						repeat = 3 + reader.read(2);
+					}
+					else if (symbol == 17)
+					{
+						repeat = 3 + reader.read(3);
+					}
+					else
+					{
+						repeat = 11 + reader.read(7);
+					}
+					if (index + repeat > literalCount + distanceCount)
+					{
+						fail("invalid dynamic block");
+					}
+					std::fill(lengths + index, lengths + index + repeat, value);
+					index += repeat;
+				}
+
+				Huffman literals, distances;
+				literals.build(lengths, literalCount);
+				distances.build(lengths + literalCount, distanceCount);
+				inflateBlock(reader, literals, distances, out, limit);
+			}
+			else
+			{
+				fail("invalid block type");
+			}
+		}
+		return out;
+	}
+
+	uint32_t readBigEndian(const uint8_t* data)
+	{
+		return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | data[3];
+	}
+
+	uint8_t paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = std::abs(p - a);
+		int pb = std::abs(p - b);
+		int pc = std::abs(p - c);
+		return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+	}
+}
+
+Image decodePng(const uint8_t* data, size_t size)
+{
+	static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	if (size < 8 || memcmp(data, SIGNATURE, 8) != 0)
+	{
+		fail("not a PNG file");
+	}
+
+	unsigned width = 0, height = 0;
+	unsigned bitDepth = 0, colorType = 0;
+	bool hasHeader = false;
+	std::vector<uint8_t> palette;
+	std::vector<uint8_t> paletteAlpha;
+	int transparentGray = -1;
+	std::vector<uint8_t> compressed;
+
+	size_t offset = 8;
+	for (;;)
+	{
+		if (size - offset < 12)
+		{
+			fail("file ends before IEND");
+		}
+		uint32_t length = readBigEndian(data + offset);
+		const uint8_t* type = data + offset + 4;
+		const uint8_t* chunk = data + offset + 8;
+		if (length > size - offset - 12)
+		{
+			fail("chunk larger than the file");
+		}
+		offset += 12 + size_t(length);
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length != 13)
+			{
+				fail("invalid header");
+			}
+			width = readBigEndian(chunk);
+			height = readBigEndian(chunk + 4);
+			bitDepth = chunk[8];
+			colorType = chunk[9];
+			if (chunk[10] != 0 || chunk[11] != 0)
+			{
+				fail("unknown compression or filter method");
+			}
+			if (chunk[12] != 0)
+			{
+				fail("interlaced images are not supported");
+			}
+			if (width == 0 || height == 0 || uint64_t(width) * height > MAX_PIXELS)
+			{
+				fail("unsupported image size");
+			}
+			bool validDepth = (colorType == 0 && (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16))
+				|| (colorType == 3 && (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8))
+				|| ((colorType == 2 || colorType == 4 || colorType == 6) && (bitDepth == 8 || bitDepth == 16));
+			if (!validDepth)
+			{
+				fail("unsupported color type or bit depth");
+			}
+			hasHeader = true;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			palette.assign(chunk, chunk + length);
+		}
+		else if (memcmp(type, "tRNS", 4) == 0)
+		{
+			if (colorType == 3)
+			{
+				paletteAlpha.assign(chunk, chunk + length);
+			}
+			else if (colorType == 0 && length >= 2)
+			{
+				transparentGray = (chunk[0] << 8) | chunk[1];
+			}
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			break;
+		}
+		else if ((type[0] & 0x20) == 0)
+		{
+			fail("unknown critical chunk");
+		}
+	}
+
+	if (!hasHeader)
+	{
+		fail("missing header");
+	}
+	if (colorType == 3 && palette.empty())
+	{
+		fail("missing palette");
+	}
+
+	const unsigned channels = colorType == 0 ? 1 : colorType == 2 ? 3 : colorType == 3 ? 1 : colorType == 4 ? 2 : 4;
+	const size_t bitsPerPixel = size_t(channels) * bitDepth;
+	const size_t stride = (size_t(width) * bitsPerPixel + 7) / 8;
+	const size_t pixelBytes = std::max<size_t>(1, bitsPerPixel / 8);
+
+	std::vector<uint8_t> raw = inflate(compressed.data(), compressed.size(), (stride + 1) * height);
+	if (raw.size() != (stride + 1) * height)
+	{
+		fail("image data has the wrong size");
+	}
+
+	// undo the filters in place, each row predicts from the already decoded one above
+	std::vector<uint8_t> zeroRow(stride, 0);
+	for (unsigned y = 0; y < height; y++)
+	{
+		uint8_t* row = &raw[y * (stride + 1) + 1];
+		const uint8_t* above = y > 0 ? row - (stride + 1) : zeroRow.data();
+		uint8_t filter = row[-1];
+		for (size_t x = 0; x < stride; x++)
+		{
+			int left = x >= pixelBytes ? row[x - pixelBytes] : 0;
+			int upLeft = x >= pixelBytes ? above[x - pixelBytes] : 0;
+			int predicted = 0;
+			switch (filter)
+			{
+			case 0: predicted = 0; break;
+			case 1: predicted = left; break;
+			case 2: predicted = above[x]; break;
+			case 3: predicted = (left + above[x]) / 2; break;
+			case 4: predicted = paeth(left, above[x], upLeft); break;
+			default: fail("unknown row filter");
+			}
+			row[x] = static_cast<uint8_t>(row[x] + predicted);
+		}
+	}
+
+	Image image;
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(size_t(width) * height * 4);
+	for (unsigned y = 0; y < height; y++)
+	{
+		const uint8_t* row = &raw[y * (stride + 1) + 1];
+		uint8_t* out = &image.pixels[size_t(y) * width * 4];
+
+		// the most significant byte of 16 bit samples, or the bits of packed ones
+		auto sample = [&](size_t index) -> unsigned {
+			if (bitDepth == 16)
+			{
+				return row[index * 2];
+			}
+			if (bitDepth == 8)
+			{
+				return row[index];
+			}
+			size_t bit = index * bitDepth;
+			return (row[bit / 8] >> (8 - bitDepth - bit % 8)) & ((1u << bitDepth) - 1);
+		};
+
+		for (unsigned x = 0; x < width; x++)
+		{
+			uint8_t* pixel = out + size_t(x) * 4;
+			size_t first = size_t(x) * channels;
+			switch (colorType)
+			{
+			case 0:
+			{
+				unsigned value = sample(first);
+				unsigned raw16 = bitDepth == 16 ? (row[first * 2] << 8) | row[first * 2 + 1] : value;
+				uint8_t gray = static_cast<uint8_t>(bitDepth < 8 ? value * 255 / ((1u << bitDepth) - 1) : value);
+				pixel[0] = pixel[1] = pixel[2] = gray;
+				pixel[3] = int(raw16) == transparentGray ? 0 : 255;
+				break;
+			}
+			case 2:
+				pixel[0] = static_cast<uint8_t>(sample(first));
+				pixel[1] = static_cast<uint8_t>(sample(first + 1));
+				pixel[2] = static_cast<uint8_t>(sample(first + 2));
+				pixel[3] = 255;
+				break;
+			case 3:
+			{
+				unsigned index = sample(first);
+				if (index * 3 + 2 >= palette.size())
+				{
+					fail("palette index out of range");
+				}
+				pixel[0] = palette[index * 3];
+				pixel[1] = palette[index * 3 + 1];
+				pixel[2] = palette[index * 3 + 2];
+				pixel[3] = index < paletteAlpha.size() ? paletteAlpha[index] : 255;
+				break;
+			}
+			case 4:
+				pixel[0] = pixel[1] = pixel[2] = static_cast<uint8_t>(sample(first));
+				pixel[3] = static_cast<uint8_t>(sample(first + 1));
+				break;
+			default:
+				pixel[0] = static_cast<uint8_t>(sample(first));
+				pixel[1] = static_cast<uint8_t>(sample(first + 1));
+				pixel[2] = static_cast<uint8_t>(sample(first + 2));
+				pixel[3] = static_cast<uint8_t>(sample(first + 3));
+				break;
+			}
+		}
+	}
+	return image;
+}
+
+Image readPng(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		throw std::runtime_error("Could not open image " + path.string());
+	}
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	return decodePng(data.data(), data.size());
+}
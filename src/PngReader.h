@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// 8 bit RGBA pixels, rows top to bottom without padding
+struct Image
+{
+	unsigned width = 0;
+	unsigned height = 0;
+	std::vector<uint8_t> pixels;
+};
+
+// Decodes a PNG file into RGBA. Grayscale, RGB, palette and alpha variants with 8 bits per channel
+// (or fewer for grayscale and palettes) are supported, 16 bit channels are reduced to 8.
+// Interlaced images and other PNG features beyond that throw std::runtime_error, as do damaged files.
+Image decodePng(const uint8_t* data, size_t size);
+
+// Reads and decodes a PNG file. Throws std::runtime_error if it can't be read or decoded.
+Image readPng(const std::filesystem::path& path);
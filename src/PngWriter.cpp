@@ -0,0 +1,376 @@
+#include "PngWriter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+	const size_t WINDOW_SIZE = 32768;
+	const size_t HASH_BITS = 15;
+	const size_t MIN_MATCH = 3;
+	const size_t MAX_MATCH = 258;
+
+	// Candidates compared per position, trades ratio for speed
+	const unsigned MAX_CHAIN = 16;
+
+	// Positions inside longer matches are not added to the hash chains (flat backgrounds are long matches)
+	const size_t MAX_INSERT_LENGTH = 32;
+
+	const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	// Writes the bits of a deflate stream, least significant first
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<uint8_t>& out) : out{ out } {}
+
+		void write(uint32_t value, unsigned count)
+		{
+			buffer |= uint64_t(value) << bitCount;
+			bitCount += count;
+			while (bitCount >= 8)
+			{
+				out.push_back(static_cast<uint8_t>(buffer));
+				buffer >>= 8;
+				bitCount -= 8;
+			}
+		}
+
+		// Huffman codes are stored most significant bit first
+		void writeCode(uint32_t code, unsigned length)
+		{
+			uint32_t reversed = 0;
+			for (unsigned i = 0; i < length; i++)
+			{
+				reversed |= ((code >> i) & 1) << (length - 1 - i);
+			}
+			write(reversed, length);
+		}
+
+		void flush()
+		{
+			if (bitCount > 0)
+			{
+				out.push_back(static_cast<uint8_t>(buffer));
+			}
+			buffer = 0;
+			bitCount = 0;
+		}
+
+	private:
+		std::vector<uint8_t>& out;
+		uint64_t buffer = 0;
+		unsigned bitCount = 0;
+	};
+
+	void writeLiteral(BitWriter& bits, unsigned symbol)
+	{
+		if (symbol < 144)
+		{
+			bits.writeCode(0x30 + symbol, 8);
+		}
+		else if (symbol < 256)
+		{
+			bits.writeCode(0x190 + symbol - 144, 9);
+		}
+		else if (symbol < 280)
+		{
+			bits.writeCode(symbol - 256, 7);
+		}
+		else
+		{
+			bits.writeCode(0xc0 + symbol - 280, 8);
+		}
+	}
+
+	void writeMatch(BitWriter& bits, size_t length, size_t distance)
+	{
+		unsigned lengthCode = 28;
+		while (LENGTH_BASE[lengthCode] > length)
+		{
+			lengthCode--;
+		}
+		writeLiteral(bits, 257 + lengthCode);
+		bits.write(static_cast<uint32_t>(length - LENGTH_BASE[lengthCode]), LENGTH_EXTRA[lengthCode]);
+
+		unsigned distanceCode = 29;
+		while (DISTANCE_BASE[distanceCode] > distance)
+		{
+			distanceCode--;
+		}
+		bits.writeCode(distanceCode, 5);
+		bits.write(static_cast<uint32_t>(distance - DISTANCE_BASE[distanceCode]), DISTANCE_EXTRA[distanceCode]);
+	}
+
+	uint32_t hash3(const uint8_t* data)
+	{
+		uint32_t value = data[0] | data[1] << 8 | data[2] << 16;
+		return (value * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// Compresses data into a zlib stream, as a single block with the fixed codes
+	void deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+	{
+		// zlib header: deflate with a 32K window, no dictionary
+		out.push_back(0x78);
+		out.push_back(0x01);
+
+		BitWriter bits(out);
+		bits.write(1, 1); // final block
+		bits.write(1, 2); // fixed codes
+
+		std::vector<int32_t> head(size_t(1) << HASH_BITS, -1);
+		std::vector<int32_t> previous(WINDOW_SIZE, -1);
+
+		auto insert = [&](size_t position) {
+			uint32_t hash = hash3(data + position);
+			previous[position % WINDOW_SIZE] = head[hash];
+			head[hash] = static_cast<int32_t>(position);
+		};
+
+		size_t position = 0;
+		while (position < size)
+		{
+			size_t bestLength = 0;
+			size_t bestDistance = 0;
+
+			if (position + MIN_MATCH <= size)
+			{
+				size_t maxLength = std::min(MAX_MATCH, size - position);
+				int32_t candidate = head[hash3(data + position)];
+				for (unsigned chain = 0; chain < MAX_CHAIN && candidate >= 0; chain++)
+				{
+					size_t distance = position - candidate;
+					if (distance > WINDOW_SIZE)
+					{
+						break;
+					}
+
+					size_t length = 0;
+					while (length < maxLength && data[candidate + length] == data[position + length])
+					{
+						length++;
+					}
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = distance;
+						if (length == maxLength)
+						{
+							break;
+						}
+					}
+
+					int32_t next = previous[candidate % WINDOW_SIZE];
+					if (next >= candidate)
+					{
+						break;
+					}
+					candidate = next;
+				}
+			}
+
+			if (bestLength >= MIN_MATCH)
+			{
+				writeMatch(bits, bestLength, bestDistance);
+				if (bestLength > MAX_INSERT_LENGTH)
+				{
+					position += bestLength;
+					continue;
+				}
+
+				for (size_t end = position + bestLength; position < end; position++)
+				{
+					if (position + MIN_MATCH <= size)
+					{
+						insert(position);
+					}
+				}
+			}
+			else
+			{
+				writeLiteral(bits, data[position]);
+				if (position + MIN_MATCH <= size)
+				{
+					insert(position);
+				}
+				position++;
+			}
+		}
+
+		writeLiteral(bits, 256);
+		bits.flush();
+
+		// the sums can't overflow within 5552 bytes, so the modulo is only taken between blocks
+		uint32_t a = 1;
+		uint32_t b = 0;
+		for (size_t block = 0; block < size; block += 5552)
+		{
+			size_t end = std::min(size, block + 5552);
+			for (size_t i = block; i < end; i++)
+			{
+				a += data[i];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		uint32_t adler = (b << 16) | a;
+		for (int shift = 24; shift >= 0; shift -= 8)
+		{
+			out.push_back(static_cast<uint8_t>(adler >> shift));
+		}
+	}
+
+	uint32_t crc32(const uint8_t* data, size_t size)
+	{
+		static const auto table = []() {
+			std::vector<uint32_t> values(256);
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t value = i;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					value = (value & 1) ? 0xedb88320u ^ (value >> 1) : value >> 1;
+				}
+				values[i] = value;
+			}
+			return values;
+		}();
+
+		uint32_t crc = 0xffffffffu;
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		}
+		return crc ^ 0xffffffffu;
+	}
+
+	void writeBigEndian(std::vector<uint8_t>& out, uint32_t value)
+	{
+		for (int shift = 24; shift >= 0; shift -= 8)
+		{
+			out.push_back(static_cast<uint8_t>(value >> shift));
+		}
+	}
+
+	void writeChunk(std::vector<uint8_t>& out, const char type[4], const std::vector<uint8_t>& data)
+	{
+		writeBigEndian(out, static_cast<uint32_t>(data.size()));
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		writeBigEndian(out, crc32(&out[start], out.size() - start));
+	}
+
+	uint8_t paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = std::abs(p - a);
+		int pb = std::abs(p - b);
+		int pc = std::abs(p - c);
+		return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+	}
+
+	// Applies a PNG filter to a row of RGBA pixels, returns the sum of the residuals' magnitudes
+	template <typename Predict>
+	uint64_t filterRow(const uint8_t* row, const uint8_t* above, size_t stride, uint8_t* out, Predict predict)
+	{
+		// the first pixel has nothing on its left
+		uint32_t score = 0;
+		for (size_t x = 0; x < 4 && x < stride; x++)
+		{
+			uint8_t residual = static_cast<uint8_t>(row[x] - predict(0, above[x], 0));
+			out[x] = residual;
+			score += std::abs(static_cast<int8_t>(residual));
+		}
+
+		for (size_t x = 4; x < stride; x++)
+		{
+			uint8_t residual = static_cast<uint8_t>(row[x] - predict(row[x - 4], above[x], above[x - 4]));
+			out[x] = residual;
+			score += std::abs(static_cast<int8_t>(residual));
+		}
+		return score;
+	}
+
+	uint64_t filterRow(uint8_t filter, const uint8_t* row, const uint8_t* above, size_t stride, uint8_t* out)
+	{
+		switch (filter)
+		{
+		case 0: return filterRow(row, above, stride, out, [](int, int, int) { return 0; });
+		case 1: return filterRow(row, above, stride, out, [](int left, int, int) { return left; });
+		case 2: return filterRow(row, above, stride, out, [](int, int up, int) { return up; });
+		case 3: return filterRow(row, above, stride, out, [](int left, int up, int) { return (left + up) / 2; });
+		default: return filterRow(row, above, stride, out, [](int left, int up, int upLeft) { return paeth(left, up, upLeft); });
+		}
+	}
+}
+
+std::vector<uint8_t> encodePng(const uint8_t* rgba, unsigned width, unsigned height)
+{
+	const size_t stride = size_t(width) * 4;
+
+	// filter every row with each of the five filters, keep the one with the smallest residuals
+	std::vector<uint8_t> filtered((stride + 1) * height);
+	std::vector<uint8_t> candidate(stride);
+	std::vector<uint8_t> zeroRow(stride, 0);
+	for (unsigned y = 0; y < height; y++)
+	{
+		const uint8_t* row = rgba + y * stride;
+		const uint8_t* above = y > 0 ? row - stride : zeroRow.data();
+		uint8_t* out = &filtered[y * (stride + 1)];
+
+		uint64_t bestScore = UINT64_MAX;
+		for (uint8_t filter = 0; filter < 5; filter++)
+		{
+			uint64_t score = filterRow(filter, row, above, stride, candidate.data());
+			if (score < bestScore)
+			{
+				bestScore = score;
+				out[0] = filter;
+				std::memcpy(out + 1, candidate.data(), stride);
+			}
+		}
+	}
+
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+	std::vector<uint8_t> header;
+	writeBigEndian(header, width);
+	writeBigEndian(header, height);
+	header.push_back(8); // bits per channel
+	header.push_back(6); // RGBA
+	header.push_back(0); // deflate
+	header.push_back(0); // adaptive filtering
+	header.push_back(0); // not interlaced
+	writeChunk(png, "IHDR", header);
+
+	std::vector<uint8_t> compressed;
+	deflate(filtered.data(), filtered.size(), compressed);
+	writeChunk(png, "IDAT", compressed);
+	writeChunk(png, "IEND", {});
+	return png;
+}
+
+void writePng(const std::filesystem::path& path, const uint8_t* rgba, unsigned width, unsigned height)
+{
+	std::vector<uint8_t> png = encodePng(rgba, width, height);
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(png.data()), png.size());
+	if (!file)
+	{
+		throw std::runtime_error("Could not write image " + path.string());
+	}
+}
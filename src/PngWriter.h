@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Encodes 8 bit RGBA pixels (rows top to bottom, no padding) as a PNG file.
+// Rows use the filter that leaves the smallest residuals, compressed with LZ77 and the fixed deflate codes.
+std::vector<uint8_t> encodePng(const uint8_t* rgba, unsigned width, unsigned height);
+
+// Encodes and writes a PNG file. Throws std::runtime_error if it can't be written.
+void writePng(const std::filesystem::path& path, const uint8_t* rgba, unsigned width, unsigned height);
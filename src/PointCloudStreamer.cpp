@@ -0,0 +1,157 @@
+#include "PointCloudStreamer.h"
+#include "Frustum.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Weight of the newest value in the smoothed rates
+	const double SMOOTHING = 0.1;
+}
+
+PointCloudStreamer::PointCloudStreamer(std::shared_ptr<const PointOctree> octree, UploadFunction upload, const PointCloudStreamerOptions& options) :
+	octree{ std::move(octree) }, upload{ std::move(upload) }, options{ options }
+{
+	meshes.resize(this->octree->getNodes().size());
+	resident = ResidentNodes(meshes.size());
+}
+
+float PointCloudStreamer::getScreenSpacing(const PointNode& node, const glm::vec3& cameraPosition, float projectionScale) const
+{
+	// distance to the node's bounding sphere, nodes around the camera get their full spacing
+	glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+	float radius = glm::length(node.boundsMax - node.boundsMin) * 0.5f;
+	float distance = std::max(glm::length(cameraPosition - center) - radius, 1e-3f);
+	return node.spacing * projectionScale / distance;
+}
+
+void PointCloudStreamer::update(const glm::vec3& cameraPosition, const glm::mat4x4& viewProjection, float projectionScale, float deltaSeconds)
+{
+	auto start = Clock::now();
+	frame++;
+	stats.loadsThisFrame = 0;
+	stats.evictionsThisFrame = 0;
+	stats.visiblePoints = 0;
+	visible.clear();
+	requests.clear();
+	queue.clear();
+
+	// best first over the tree, the node whose points are furthest apart on screen next
+	const std::vector<PointNode>& nodes = octree->getNodes();
+	Frustum frustum(viewProjection);
+	auto byScreenSpacing = [](const Candidate& a, const Candidate& b) {
+		return a.spacing != b.spacing ? a.spacing < b.spacing : a.node > b.node;
+	};
+	auto push = [&](uint32_t index) {
+		const PointNode& node = nodes[index];
+		if (frustum.intersects(node.boundsMin, node.boundsMax))
+		{
+			queue.push_back({ index, getScreenSpacing(node, cameraPosition, projectionScale) });
+			std::push_heap(queue.begin(), queue.end(), byScreenSpacing);
+		}
+	};
+	if (!octree->empty())
+	{
+		push(octree->getRoot());
+	}
+
+	// nodes still loading count towards the budget, so the selection doesn't jump once they arrive
+	size_t selectedPoints = 0;
+	while (!queue.empty())
+	{
+		std::pop_heap(queue.begin(), queue.end(), byScreenSpacing);
+		Candidate candidate = queue.back();
+		queue.pop_back();
+
+		// what is left is finer than this node, so the budget is spent evenly over the view.
+		// The root's points are shuffled, so when they don't all fit the ones that do are still even.
+		const PointNode& node = nodes[candidate.node];
+		uint32_t pointCount = node.pointCount;
+		if (selectedPoints + pointCount > options.pointBudget)
+		{
+			if (candidate.node != octree->getRoot() || options.pointBudget == 0)
+			{
+				break;
+			}
+			pointCount = static_cast<uint32_t>(options.pointBudget);
+		}
+		selectedPoints += pointCount;
+
+		resident.markUsed(candidate.node, frame);
+		const MeshResourcePtr& mesh = meshes[candidate.node];
+		if (!mesh)
+		{
+			// its children only add to it, they wait until it is loaded
+			requests.push_back(candidate);
+			continue;
+		}
+
+		visible.push_back({ mesh.get(), pointCount });
+		stats.visiblePoints += pointCount;
+
+		if (candidate.spacing > options.maxPointSpacing)
+		{
+			for (uint32_t child : node.children)
+			{
+				if (child != POINT_NO_NODE)
+				{
+					push(child);
+				}
+			}
+		}
+	}
+	stats.selectSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	// the requests came out of the queue most coarse first, which is the order they are needed in
+	auto evict = [this](uint32_t index) {
+		meshes[index].reset();
+		stats.evictionsThisFrame++;
+	};
+	size_t loadedBytes = 0;
+	size_t pending = 0;
+	for (const Candidate& request : requests)
+	{
+		size_t bytes = size_t(nodes[request.node].pointCount) * sizeof(Vertex);
+		bool fits = loadedBytes == 0 || loadedBytes + bytes <= options.loadBytesPerFrame;
+		if (fits && resident.makeRoom(bytes, options.residentBudget, frame, evict) && load(request.node))
+		{
+			loadedBytes += bytes;
+		}
+		else
+		{
+			pending++;
+		}
+	}
+	stats.pendingNodes = pending;
+
+	if (deltaSeconds > 0)
+	{
+		stats.pointsPerSecond += (double(stats.visiblePoints) / deltaSeconds - stats.pointsPerSecond) * SMOOTHING;
+	}
+	stats.visibleNodes = visible.size();
+	stats.residentNodes = resident.getCount();
+	stats.residentBytes = resident.getBytes();
+}
+
+bool PointCloudStreamer::load(uint32_t index)
+{
+	const PointNode& node = octree->getNodes()[index];
+	MeshResourcePtr mesh = upload(octree->getPoints(node), node.pointCount);
+	if (!mesh)
+	{
+		return false;
+	}
+
+	mesh->boundsMin = node.boundsMin;
+	mesh->boundsMax = node.boundsMax;
+
+	meshes[index] = mesh;
+	resident.add(index, size_t(node.pointCount) * sizeof(Vertex), frame);
+	stats.loadsThisFrame++;
+	return true;
+}
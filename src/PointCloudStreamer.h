@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Assets.h"
+#include "PointOctree.h"
+#include "ResidentNodes.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+struct PointCloudStreamerOptions
+{
+	// Most points drawn in a frame
+	size_t pointBudget = 5 * 1000 * 1000;
+
+	// Most node data kept loaded at once (usually on the GPU)
+	size_t residentBudget = 256 * 1024 * 1024;
+
+	// Most node data loaded in a single update, keeps frame times steady
+	size_t loadBytesPerFrame = 16 * 1024 * 1024;
+
+	// Nodes are refined until their points project closer together than this many pixels
+	float maxPointSpacing = 1.5f;
+};
+
+struct PointCloudStreamerStats
+{
+	size_t visibleNodes = 0;
+	size_t visiblePoints = 0;
+	size_t residentNodes = 0;
+	size_t residentBytes = 0;
+
+	// nodes wanted by the current view that are not loaded yet
+	size_t pendingNodes = 0;
+
+	size_t loadsThisFrame = 0;
+	size_t evictionsThisFrame = 0;
+
+	// time taken by the selection of the last update
+	double selectSeconds = 0;
+
+	// points drawn per second, smoothed over recent updates
+	double pointsPerSecond = 0;
+};
+
+// A loaded node to draw, as a point list of its first pointCount points
+struct PointCloudDraw
+{
+	const MeshResource* mesh;
+	uint32_t pointCount;
+};
+
+// Picks the nodes of a point octree to draw for the current camera, and keeps them loaded.
+//
+// Nodes are visited most coarse on screen first: the ones whose points project furthest apart.
+// A node is drawn with its ancestors, so its children are only considered once it is loaded, and
+// refined while its spacing is larger than maxPointSpacing pixels and the point budget allows.
+// The budget is a hard cap: when even the root doesn't fit, only a prefix of its points is drawn.
+// Missing nodes are loaded through the upload function, most visible first and within the frame's
+// budget, and the least recently used ones are evicted once the resident budget is reached.
+// The octree itself stays in memory, only what is uploaded is streamed in and out.
+class PointCloudStreamer
+{
+public:
+	// Creates the resource for a loaded node, usually by uploading its points to the GPU.
+	// The pointer is only valid during the call.
+	typedef std::function<MeshResourcePtr(const Vertex* points, size_t count)> UploadFunction;
+
+	PointCloudStreamer(std::shared_ptr<const PointOctree> octree, UploadFunction upload, const PointCloudStreamerOptions& options = {});
+
+	// Selects, loads and evicts nodes for a view.
+	// projectionScale converts a size at distance 1 into pixels, see LodStreamer::getProjectionScale().
+	void update(const glm::vec3& cameraPosition, const glm::mat4x4& viewProjection, float projectionScale, float deltaSeconds);
+
+	// Returns the nodes to draw this frame. Valid until the next update.
+	const std::vector<PointCloudDraw>& getVisible() const { return visible; }
+
+	const PointCloudStreamerStats& getStats() const { return stats; }
+	const PointOctree& getOctree() const { return *octree; }
+
+	void setOptions(const PointCloudStreamerOptions& options) { this->options = options; }
+	const PointCloudStreamerOptions& getOptions() const { return options; }
+
+private:
+	struct Candidate
+	{
+		uint32_t node;
+		float spacing;
+	};
+
+	// Distance between the node's points on screen, in pixels
+	float getScreenSpacing(const PointNode& node, const glm::vec3& cameraPosition, float projectionScale) const;
+
+	bool load(uint32_t index);
+
+	std::shared_ptr<const PointOctree> octree;
+	std::vector<MeshResourcePtr> meshes;
+	ResidentNodes resident;
+
+	UploadFunction upload;
+	PointCloudStreamerOptions options;
+
+	std::vector<PointCloudDraw> visible;
+	std::vector<Candidate> queue;
+	std::vector<Candidate> requests;
+
+	uint64_t frame = 0;
+	PointCloudStreamerStats stats;
+};
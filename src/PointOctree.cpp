@@ -0,0 +1,263 @@
+#include "PointOctree.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Subtrees starting at this depth are built as separate tasks, up to 64 of them
+	const uint32_t PARALLEL_LEVEL = 2;
+
+	const unsigned MAX_GRID_RESOLUTION = 1024;
+
+	// Grid cells already taken by the node being sampled. Clearing only bumps the stamp.
+	class CellSet
+	{
+	public:
+		void reset(size_t expected)
+		{
+			size_t size = 16;
+			while (size < expected * 2)
+			{
+				size *= 2;
+			}
+			if (slots.size() < size)
+			{
+				slots.assign(size, 0);
+				stamp = 0;
+			}
+			mask = size - 1;
+
+			if (++stamp == 0)
+			{
+				std::fill(slots.begin(), slots.end(), 0);
+				stamp = 1;
+			}
+		}
+
+		// Returns true if the cell wasn't taken yet
+		bool insert(uint32_t key)
+		{
+			uint64_t entry = (uint64_t(stamp) << 32) | key;
+			size_t slot = (key * 0x9E3779B1u) & mask;
+			while ((slots[slot] >> 32) == stamp)
+			{
+				if (slots[slot] == entry)
+				{
+					return false;
+				}
+				slot = (slot + 1) & mask;
+			}
+			slots[slot] = entry;
+			return true;
+		}
+
+	private:
+		std::vector<uint64_t> slots;
+		size_t mask = 0;
+		uint32_t stamp = 0;
+	};
+
+	// A subtree left for the parallel pass, and where its root goes in its parent
+	struct Subtree
+	{
+		uint32_t parent;
+		unsigned slot;
+		uint64_t begin;
+		uint64_t end;
+		glm::vec3 boundsMin;
+		float size;
+		uint32_t level;
+	};
+
+	struct Builder
+	{
+		std::vector<Vertex>& points;
+		const PointOctreeOptions& options;
+		unsigned resolution;
+
+		// Builds the node of a cube and its descendants into nodes and returns its index.
+		// With subtrees given, children at PARALLEL_LEVEL are left for later instead.
+		uint32_t build(std::vector<PointNode>& nodes, CellSet& cells, uint64_t begin, uint64_t end,
+			const glm::vec3& boundsMin, float size, uint32_t level, std::vector<Subtree>* subtrees)
+		{
+			uint32_t index = static_cast<uint32_t>(nodes.size());
+			PointNode node;
+			node.boundsMin = boundsMin;
+			node.boundsMax = boundsMin + glm::vec3(size);
+			node.spacing = size / resolution;
+			node.level = level;
+			std::fill(std::begin(node.children), std::end(node.children), POINT_NO_NODE);
+			node.firstPoint = begin;
+			node.pointCount = static_cast<uint32_t>(end - begin);
+			nodes.push_back(node);
+
+			if (end - begin <= options.leafPoints || level >= options.maxDepth)
+			{
+				return index;
+			}
+
+			// the first point of every cell stays here, moved to the front of the range
+			uint64_t cellCount = uint64_t(resolution) * resolution * resolution;
+			cells.reset(static_cast<size_t>(std::min<uint64_t>(end - begin, cellCount)));
+			// from the stored cube, so the cells can be found again from the node alone
+			float cellScale = resolution / (node.boundsMax.x - node.boundsMin.x);
+			uint64_t kept = begin;
+			for (uint64_t i = begin; i < end; i++)
+			{
+				glm::vec3 cell = (points[i].position - boundsMin) * cellScale;
+				uint32_t x = std::min(static_cast<uint32_t>(std::max(cell.x, 0.0f)), resolution - 1);
+				uint32_t y = std::min(static_cast<uint32_t>(std::max(cell.y, 0.0f)), resolution - 1);
+				uint32_t z = std::min(static_cast<uint32_t>(std::max(cell.z, 0.0f)), resolution - 1);
+				if (cells.insert((x * resolution + y) * resolution + z))
+				{
+					std::swap(points[i], points[kept++]);
+				}
+			}
+			nodes[index].pointCount = static_cast<uint32_t>(kept - begin);
+
+			// the rest is split by octant, child (x << 2) | (y << 1) | z takes the high half of the set axes
+			float half = size * 0.5f;
+			glm::vec3 middle = boundsMin + glm::vec3(half);
+			auto first = points.begin();
+			uint64_t bounds[9];
+			bounds[0] = kept;
+			bounds[8] = end;
+			auto split = [&](uint64_t from, uint64_t to, int axis) {
+				return static_cast<uint64_t>(std::partition(first + from, first + to,
+					[&](const Vertex& point) { return point.position[axis] < middle[axis]; }) - first);
+			};
+			bounds[4] = split(bounds[0], bounds[8], 0);
+			bounds[2] = split(bounds[0], bounds[4], 1);
+			bounds[6] = split(bounds[4], bounds[8], 1);
+			for (unsigned i = 0; i < 8; i += 2)
+			{
+				bounds[i + 1] = split(bounds[i], bounds[i + 2], 2);
+			}
+
+			for (unsigned child = 0; child < 8; child++)
+			{
+				if (bounds[child] == bounds[child + 1])
+				{
+					continue;
+				}
+
+				glm::vec3 childMin = boundsMin + glm::vec3(float(child >> 2), float((child >> 1) & 1), float(child & 1)) * half;
+				if (subtrees != nullptr && level + 1 == PARALLEL_LEVEL)
+				{
+					subtrees->push_back({ index, child, bounds[child], bounds[child + 1], childMin, half, level + 1 });
+					continue;
+				}
+
+				uint32_t childIndex = build(nodes, cells, bounds[child], bounds[child + 1], childMin, half, level + 1, subtrees);
+				nodes[index].children[child] = childIndex;
+			}
+			return index;
+		}
+	};
+}
+
+PointOctree::PointOctree(std::vector<Vertex> source, const PointOctreeOptions& options, JobSystem* jobs) :
+	points{ std::move(source) }
+{
+	auto start = Clock::now();
+	stats.points = points.size();
+	if (points.empty())
+	{
+		return;
+	}
+
+	// the root is the cube around every point, so all nodes are cubes and their grids are even
+	glm::vec3 boundsMin = points[0].position;
+	glm::vec3 boundsMax = points[0].position;
+	for (const Vertex& point : points)
+	{
+		boundsMin = glm::min(boundsMin, point.position);
+		boundsMax = glm::max(boundsMax, point.position);
+	}
+
+	// a little larger, so rounding in the child cubes never leaves the furthest points outside
+	glm::vec3 extent = boundsMax - boundsMin;
+	float size = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f)) * (1.0f + 1e-5f);
+
+	Builder builder{ points, options, std::clamp(options.gridResolution, 1u, MAX_GRID_RESOLUTION) };
+
+	// the first levels here, then their subtrees in parallel, each into its own nodes
+	CellSet cells;
+	std::vector<Subtree> subtrees;
+	builder.build(nodes, cells, 0, points.size(), boundsMin, size, 0, jobs != nullptr ? &subtrees : nullptr);
+
+	// shuffled so a prefix of the root is still even, its cells were taken in file order (for scans, scan lines)
+	std::mt19937 random(1);
+	std::shuffle(points.begin(), points.begin() + nodes[0].pointCount, random);
+
+	// the subtrees own disjoint ranges of the points, so they reorder them without locks
+	std::vector<std::vector<PointNode>> subtreeNodes(subtrees.size());
+	if (!subtrees.empty())
+	{
+		jobs->parallelFor(subtrees.size(), [&](size_t i) {
+			const Subtree& subtree = subtrees[i];
+			CellSet subtreeCells;
+			builder.build(subtreeNodes[i], subtreeCells, subtree.begin, subtree.end, subtree.boundsMin, subtree.size, subtree.level, nullptr);
+		});
+	}
+
+	for (size_t i = 0; i < subtrees.size(); i++)
+	{
+		uint32_t offset = static_cast<uint32_t>(nodes.size());
+		for (PointNode& node : subtreeNodes[i])
+		{
+			for (uint32_t& child : node.children)
+			{
+				child = child != POINT_NO_NODE ? child + offset : POINT_NO_NODE;
+			}
+		}
+		nodes.insert(nodes.end(), subtreeNodes[i].begin(), subtreeNodes[i].end());
+		nodes[subtrees[i].parent].children[subtrees[i].slot] = offset;
+		subtreeNodes[i] = {};
+	}
+
+	stats.nodes = nodes.size();
+	for (const PointNode& node : nodes)
+	{
+		bool leaf = std::all_of(std::begin(node.children), std::end(node.children),
+			[](uint32_t child) { return child == POINT_NO_NODE; });
+		stats.leaves += leaf;
+		stats.depth = std::max(stats.depth, node.level + 1);
+		stats.largestNode = std::max<size_t>(stats.largestNode, node.pointCount);
+	}
+	stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::vector<Vertex> readPointCloud(const std::filesystem::path& path)
+{
+	MappedFile file;
+	if (!file.open(path))
+	{
+		throw std::runtime_error("Could not map point cloud " + path.string());
+	}
+
+	const char* text = reinterpret_cast<const char*>(file.data());
+	size_t positions, faces;
+	countObj(text, file.size(), positions, faces);
+
+	// a scan with faces can still be drawn as points, they are parsed and dropped
+	std::vector<Vertex> points(positions);
+	std::vector<unsigned> indices(faces * 3);
+	try
+	{
+		parseObj(text, file.size(), points.data(), points.size(), indices.data(), indices.size());
+	}
+	catch (const std::runtime_error& e)
+	{
+		throw std::runtime_error("Invalid point cloud " + path.string() + ": " + e.what());
+	}
+	return points;
+}
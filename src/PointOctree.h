@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "Assets.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/vec3.hpp>
+
+class JobSystem;
+
+// Marks an unused child slot
+const uint32_t POINT_NO_NODE = 0xFFFFFFFF;
+
+struct PointOctreeOptions
+{
+	// Nodes holding at most this many points are leaves
+	size_t leafPoints = 20000;
+
+	// Every inner node keeps one point per cell of a grid of this many cells per axis over its cube.
+	// The rest go down to its children, so every level doubles the density.
+	unsigned gridResolution = 128;
+
+	// Nodes this deep are leaves whatever their point count (eg. many copies of the same point)
+	unsigned maxDepth = 20;
+};
+
+struct PointNode
+{
+	// Cube of the node, the root cube contains every point
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	// Distance between the points the node keeps, in model units: its cube's size over the grid resolution
+	float spacing;
+
+	// Depth in the tree, the root is 0
+	uint32_t level;
+
+	uint32_t children[8];
+
+	// The node's points are points[firstPoint, firstPoint + pointCount)
+	uint64_t firstPoint;
+	uint32_t pointCount;
+};
+
+struct PointOctreeStats
+{
+	size_t points = 0;
+	size_t nodes = 0;
+	size_t leaves = 0;
+	unsigned depth = 0;
+
+	// Most points kept by a single node
+	size_t largestNode = 0;
+
+	double seconds = 0;
+
+	double getPointsPerSecond() const { return seconds > 0 ? points / seconds : 0; }
+};
+
+// A point cloud sorted into an octree for level of detail.
+//
+// Every point is stored exactly once. The root keeps an even subsample of the whole cloud, one
+// point per cell of a coarse grid, each child keeps a subsample at twice that density of what its
+// parent didn't take, and leaves keep the rest. Drawing a node together with all its ancestors
+// draws every point of its cube at the node's spacing, so a renderer only has to pick how deep to
+// go in each part of the view (see PointCloudStreamer). The root's points are also shuffled, so
+// any prefix of them is an even subsample too, for budgets smaller than the root.
+//
+// The points are reordered in place so every node's points are contiguous, in the same layout
+// as the GPU buffers. Subtrees below the first levels are built in parallel.
+class PointOctree
+{
+public:
+	PointOctree() = default;
+
+	// Sorts the points into a tree. Their normals are unused and left as they are.
+	PointOctree(std::vector<Vertex> points, const PointOctreeOptions& options = {}, JobSystem* jobs = nullptr);
+
+	const std::vector<PointNode>& getNodes() const { return nodes; }
+	const std::vector<Vertex>& getPoints() const { return points; }
+	const Vertex* getPoints(const PointNode& node) const { return points.data() + node.firstPoint; }
+
+	// The root is the first node, unless the cloud is empty and there are no nodes
+	uint32_t getRoot() const { return 0; }
+	bool empty() const { return nodes.empty(); }
+
+	const PointOctreeStats& getStats() const { return stats; }
+
+private:
+	std::vector<PointNode> nodes;
+	std::vector<Vertex> points;
+	PointOctreeStats stats;
+};
+
+// Reads the positions of an OBJ file as points, with the per vertex colors some scanners write
+// after them ("v x y z r g b"). Faces are ignored.
+// Throws std::runtime_error if the file can't be read.
+std::vector<Vertex> readPointCloud(const std::filesystem::path& path);
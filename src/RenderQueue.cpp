@@ -0,0 +1,115 @@
+#include "RenderQueue.h"
+#include "Frustum.h"
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+
+void RenderQueue::build(const Scene& scene, const glm::mat4x4& viewProjection, OcclusionCuller* occlusion)
+{
+	items.clear();
+	culledCount = 0;
+	occludedCount = 0;
+
+	Frustum frustum(viewProjection);
+
+	// reserve up front, growing one step at a time would leave the old blocks unused in the arena
+	items.reserve(scene.size());
+
+	for (auto& sceneObject : scene)
+	{
+		const MeshResource* mesh = sceneObject->mesh.get();
+		if (mesh == nullptr)
+		{
+			continue;
+		}
+
+		const glm::mat4x4& model = sceneObject->getModelMatrix();
+		if (!frustum.intersects(mesh->boundsMin, mesh->boundsMax, model))
+		{
+			culledCount++;
+			continue;
+		}
+
+		DrawItem item;
+		item.sortKey = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(mesh));
+		item.mesh = mesh;
+		item.model = &model;
+		items.push_back(item);
+	}
+
+	if (occlusion != nullptr)
+	{
+		cullOccluded(*occlusion, viewProjection);
+	}
+
+	std::sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) {
+		return a.sortKey < b.sortKey;
+	});
+}
+
+void RenderQueue::cullOccluded(OcclusionCuller& occlusion, const glm::mat4x4& viewProjection)
+{
+	occlusion.beginFrame(viewProjection);
+
+	// every object is projected once, to pick the occluders and to test it
+	FrameVector<ScreenBounds> bounds{ ArenaAllocator<ScreenBounds>(items.get_allocator()) };
+	bounds.resize(items.size());
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		glm::vec3 worldMin, worldMax;
+		transformBounds(items[i].mesh->boundsMin, items[i].mesh->boundsMax, *items[i].model, worldMin, worldMax);
+		bounds[i] = occlusion.projectBounds(worldMin, worldMax);
+	}
+
+	// the objects covering the most of the screen hide the most
+	const OcclusionOptions& options = occlusion.getOptions();
+	FrameVector<std::pair<float, size_t>> candidates{ ArenaAllocator<std::pair<float, size_t>>(items.get_allocator()) };
+	candidates.reserve(items.size());
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		float area = occlusion.getScreenArea(bounds[i]);
+		if (area >= options.minOccluderArea)
+		{
+			candidates.emplace_back(area, i);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b) {
+		return a.first > b.first;
+	});
+
+	size_t occluders = 0;
+	for (size_t i = 0; i < candidates.size() && occluders < options.maxOccluders; i++)
+	{
+		const DrawItem& item = items[candidates[i].second];
+		if (occlusion.addOccluder(*item.mesh, *item.model))
+		{
+			occluders++;
+		}
+	}
+	occlusion.buildHierarchy();
+
+	// keep the visible items in order
+	size_t kept = 0;
+	if (occluders > 0)
+	{
+		for (size_t i = 0; i < items.size(); i++)
+		{
+			if (occlusion.isVisible(bounds[i]))
+			{
+				items[kept++] = items[i];
+			}
+		}
+		occludedCount = items.size() - kept;
+		items.resize(kept);
+	}
+	occlusion.endFrame();
+}
+
+void RenderQueue::add(const MeshResource* mesh, const glm::mat4x4* model)
+{
+	DrawItem item;
+	item.sortKey = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(mesh));
+	item.mesh = mesh;
+	item.model = model;
+	items.push_back(item);
+}
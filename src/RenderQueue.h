@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Assets.h"
+#include "Scene.h"
+#include "FrameAllocator.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/mat4x4.hpp>
+
+class OcclusionCuller;
+
+// A single object to draw in the current frame
+struct DrawItem
+{
+	// Draws are sorted by this key, so objects sharing a mesh are drawn one after another
+	uint64_t sortKey;
+
+	const MeshResource* mesh;
+
+	// Points to the object's cached model matrix. Valid until the object is next modified.
+	const glm::mat4x4* model;
+};
+
+// Builds the list of objects to draw in a frame: objects without a mesh or outside
+// of the view are skipped, and the remaining ones are sorted to minimize state changes.
+// The list lives in a frame arena, so building it does not touch the heap once the arena is warm.
+// Pass a null arena to use the general heap instead.
+class RenderQueue
+{
+public:
+	explicit RenderQueue(LinearArena* arena) : items{ ArenaAllocator<DrawItem>(arena) } {}
+
+	// Fills the queue with the visible objects of a scene.
+	// With an occlusion culler, the largest objects on screen are drawn as occluders and objects hidden behind them are skipped.
+	void build(const Scene& scene, const glm::mat4x4& viewProjection, OcclusionCuller* occlusion = nullptr);
+
+	// Adds a mesh that was already found visible (eg. by LOD selection) after the built items.
+	// The matrix must stay valid until the queue is drawn.
+	void add(const MeshResource* mesh, const glm::mat4x4* model);
+
+	const FrameVector<DrawItem>& getItems() const { return items; }
+
+	// Number of objects rejected by the frustum test in the last build
+	size_t getCulledCount() const { return culledCount; }
+
+	// Number of objects in the view found hidden by the occlusion culler in the last build
+	size_t getOccludedCount() const { return occludedCount; }
+
+private:
+	void cullOccluded(OcclusionCuller& occlusion, const glm::mat4x4& viewProjection);
+
+	FrameVector<DrawItem> items;
+	size_t culledCount = 0;
+	size_t occludedCount = 0;
+};
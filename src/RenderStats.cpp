@@ -0,0 +1,222 @@
+#include "RenderStats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace
+{
+	const size_t COUNTER_COUNT = static_cast<size_t>(RenderCounter::Count);
+
+	typedef std::chrono::steady_clock Clock;
+
+	std::array<std::atomic<uint64_t>, COUNTER_COUNT> currentCounters = {};
+
+	// Frame bookkeeping and the history, a ring of the last frames
+	std::mutex historyMutex;
+	uint64_t frameIndex = 0;
+	Clock::time_point frameStart = Clock::now();
+	size_t historyLength = 600;
+	std::vector<FrameRenderStats> history;
+	size_t historyNext = 0;
+	FrameRenderStats lastFrame;
+
+	// Calls a function for every frame in the history, oldest first. The mutex must be held.
+	template <typename Function>
+	void forEachFrame(Function function)
+	{
+		size_t first = history.size() < historyLength ? 0 : historyNext;
+		for (size_t i = 0; i < history.size(); i++)
+		{
+			function(history[(first + i) % history.size()]);
+		}
+	}
+}
+
+const char* getRenderCounterName(RenderCounter counter)
+{
+	switch (counter)
+	{
+	case RenderCounter::Draws: return "draws";
+	case RenderCounter::Triangles: return "triangles";
+	case RenderCounter::Points: return "points";
+	case RenderCounter::StateChanges: return "state_changes";
+	case RenderCounter::ConstantBufferUpdates: return "constant_buffer_updates";
+	case RenderCounter::ConstantBufferBytes: return "constant_buffer_bytes";
+	case RenderCounter::BufferUploads: return "buffer_uploads";
+	case RenderCounter::BufferUploadBytes: return "buffer_upload_bytes";
+	case RenderCounter::ObjectsCulled: return "objects_culled";
+	case RenderCounter::ObjectsOccluded: return "objects_occluded";
+	default: return "unknown";
+	}
+}
+
+void RenderStats::add(RenderCounter counter, uint64_t value)
+{
+	currentCounters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t RenderStats::getCurrent(RenderCounter counter)
+{
+	return currentCounters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+void RenderStats::beginFrame()
+{
+	std::lock_guard<std::mutex> lock(historyMutex);
+	frameStart = Clock::now();
+}
+
+FrameRenderStats RenderStats::endFrame()
+{
+	std::lock_guard<std::mutex> lock(historyMutex);
+
+	FrameRenderStats stats;
+	stats.frame = frameIndex++;
+	stats.cpuSeconds = std::chrono::duration<double>(Clock::now() - frameStart).count();
+	for (size_t i = 0; i < COUNTER_COUNT; i++)
+	{
+		stats.counters[i] = currentCounters[i].exchange(0, std::memory_order_relaxed);
+	}
+
+	// grows until it holds historyLength frames, then the oldest is overwritten.
+	// Reserved at once, so finishing a frame doesn't allocate.
+	if (history.size() < historyLength)
+	{
+		history.reserve(historyLength);
+		history.push_back(stats);
+		historyNext = history.size() % historyLength;
+	}
+	else if (historyLength > 0)
+	{
+		history[historyNext] = stats;
+		historyNext = (historyNext + 1) % historyLength;
+	}
+
+	lastFrame = stats;
+	return stats;
+}
+
+FrameRenderStats RenderStats::getLastFrame()
+{
+	std::lock_guard<std::mutex> lock(historyMutex);
+	return lastFrame;
+}
+
+void RenderStats::setHistoryLength(size_t length)
+{
+	std::lock_guard<std::mutex> lock(historyMutex);
+
+	// keep the newest frames, oldest first
+	std::vector<FrameRenderStats> frames;
+	forEachFrame([&](const FrameRenderStats& stats) { frames.push_back(stats); });
+	if (frames.size() > length)
+	{
+		frames.erase(frames.begin(), frames.end() - length);
+	}
+
+	history = std::move(frames);
+	historyLength = length;
+	historyNext = length > 0 ? history.size() % length : 0;
+}
+
+std::vector<FrameRenderStats> RenderStats::getHistory()
+{
+	std::lock_guard<std::mutex> lock(historyMutex);
+
+	std::vector<FrameRenderStats> result;
+	result.reserve(history.size());
+	forEachFrame([&](const FrameRenderStats& stats) { result.push_back(stats); });
+	return result;
+}
+
+FrameRenderStats RenderStats::getAverage(size_t frames)
+{
+	std::vector<FrameRenderStats> all = getHistory();
+	size_t count = std::min(frames, all.size());
+
+	FrameRenderStats average;
+	if (count == 0)
+	{
+		return average;
+	}
+
+	for (size_t i = all.size() - count; i < all.size(); i++)
+	{
+		average.cpuSeconds += all[i].cpuSeconds;
+		for (size_t c = 0; c < COUNTER_COUNT; c++)
+		{
+			average.counters[c] += all[i].counters[c];
+		}
+	}
+
+	average.frame = all.back().frame;
+	average.cpuSeconds /= double(count);
+	for (auto& counter : average.counters)
+	{
+		counter /= count;
+	}
+	return average;
+}
+
+void RenderStats::reset()
+{
+	std::lock_guard<std::mutex> lock(historyMutex);
+	for (auto& counter : currentCounters)
+	{
+		counter.store(0, std::memory_order_relaxed);
+	}
+	history.clear();
+	historyNext = 0;
+	frameIndex = 0;
+	frameStart = Clock::now();
+	lastFrame = FrameRenderStats();
+}
+
+void RenderStats::writeCsv(std::ostream& os)
+{
+	writeCsvHeader(os);
+	for (const FrameRenderStats& stats : getHistory())
+	{
+		writeCsvRow(os, stats);
+	}
+}
+
+void RenderStats::writeJson(std::ostream& os)
+{
+	std::vector<FrameRenderStats> frames = getHistory();
+
+	os << "[";
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		const FrameRenderStats& stats = frames[i];
+		os << (i == 0 ? "\n" : ",\n") << "  {\"frame\": " << stats.frame << ", \"cpu_ms\": " << stats.cpuSeconds * 1000.0;
+		for (size_t c = 0; c < COUNTER_COUNT; c++)
+		{
+			os << ", \"" << getRenderCounterName(static_cast<RenderCounter>(c)) << "\": " << stats.counters[c];
+		}
+		os << "}";
+	}
+	os << "\n]\n";
+}
+
+void RenderStats::writeCsvHeader(std::ostream& os)
+{
+	os << "frame,cpu_ms";
+	for (size_t i = 0; i < COUNTER_COUNT; i++)
+	{
+		os << "," << getRenderCounterName(static_cast<RenderCounter>(i));
+	}
+	os << "\n";
+}
+
+void RenderStats::writeCsvRow(std::ostream& os, const FrameRenderStats& stats)
+{
+	os << stats.frame << "," << stats.cpuSeconds * 1000.0;
+	for (uint64_t counter : stats.counters)
+	{
+		os << "," << counter;
+	}
+	os << "\n";
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Work counted during a frame
+enum class RenderCounter
+{
+	// Draw calls and the triangles and points they submitted
+	Draws,
+	Triangles,
+	Points,
+
+	// Pipeline state set on the context (shaders, buffers, textures, samplers)
+	StateChanges,
+
+	// Constant buffer updates and the bytes written to them
+	ConstantBufferUpdates,
+	ConstantBufferBytes,
+
+	// Vertex, index and texture data sent to the GPU (creations and updates)
+	BufferUploads,
+	BufferUploadBytes,
+
+	// Scene objects skipped by the frustum test and by the occlusion culler
+	ObjectsCulled,
+	ObjectsOccluded,
+
+	Count
+};
+
+// Returns a short lowercase name for the counter, used as column and key names
+const char* getRenderCounterName(RenderCounter counter);
+
+// Counters of a single finished frame
+struct FrameRenderStats
+{
+	uint64_t frame = 0;
+
+	// Time between beginFrame() and endFrame()
+	double cpuSeconds = 0;
+
+	std::array<uint64_t, static_cast<size_t>(RenderCounter::Count)> counters = {};
+
+	uint64_t get(RenderCounter counter) const { return counters[static_cast<size_t>(counter)]; }
+};
+
+// Global per frame render counters.
+// The renderer and the GPU interface add to the counters as they work, and endFrame() moves them
+// into a rolling history of the last frames, which can be queried or written as CSV or JSON.
+// Work done between frames (eg. loading) is counted in the next frame.
+// add() is thread safe and lock-free; the frame methods are expected from one thread.
+class RenderStats
+{
+public:
+	// Adds to a counter of the current frame
+	static void add(RenderCounter counter, uint64_t value = 1);
+
+	// Returns a counter of the frame in progress
+	static uint64_t getCurrent(RenderCounter counter);
+
+	// Starts timing a frame
+	static void beginFrame();
+
+	// Finishes the frame: resets the counters, stores them in the history and returns them
+	static FrameRenderStats endFrame();
+
+	// Returns the last frame finished by endFrame()
+	static FrameRenderStats getLastFrame();
+
+	// Number of frames kept in the history (600 by default). Older frames are dropped.
+	static void setHistoryLength(size_t length);
+
+	// Returns the frames in the history, oldest first
+	static std::vector<FrameRenderStats> getHistory();
+
+	// Average of the last frames of the history (all of them by default)
+	static FrameRenderStats getAverage(size_t frames = SIZE_MAX);
+
+	// Clears the counters, the history and the frame index
+	static void reset();
+
+	// Writes the history as CSV, one row per frame
+	static void writeCsv(std::ostream& os);
+
+	// Writes the history as JSON: an array of frames with one key per counter
+	static void writeJson(std::ostream& os);
+
+	// Writes the column names matching writeCsvRow()
+	static void writeCsvHeader(std::ostream& os);
+
+	// Writes a CSV row with the counters of a frame
+	static void writeCsvRow(std::ostream& os, const FrameRenderStats& stats);
+};
@@ -1,6 +1,12 @@
 #include "Renderer.h"
+#include "MultiViewQueue.h"
+#include "RenderQueue.h"
+#include "RenderStats.h"
 
-#include <iostream>
+#include "Logger.h"
+
+#include <algorithm>
+#include <stdexcept>
 
 #include <glm/glm.hpp>
 
@@ -27,19 +33,28 @@ Renderer::Renderer(xwin::Window& window)
 	resourceManager->initialize(dx11.get());
 
 	inputManager = std::make_unique<InputManager>();
+	animationSystem = std::make_unique<AnimationSystem>();
 
 	// Initialize Shaders
 	pixelShader = loadPixelShader(dx11->getDevice(), "SimplePixelShader.hlsl");
+	pointPixelShader = loadPixelShader(dx11->getDevice(), "PointPixelShader.hlsl");
 	vertexShader = loadVertexShader(dx11->getDevice(), "SimpleVertexShader.hlsl");
 
 	// Initialize Constant Buffer
 	constantBuffer = dx11->createConstantBuffer<ConstantBufferData>(ConstantBufferData_BLOCKSIZE);
 
-	// Initialize camera
-	camera = std::make_unique<Camera>();
-	camera->setFov(45.0f);
-	camera->setAspectRatio(width, height);
-	camera->setClipRange(0.1f, 50.0f);
+	// Objects are drawn with a 1x1 white texture until one is set
+	const uint8_t white[4] = { 255, 255, 255, 255 };
+	defaultTexture = dx11->createTexture(white, 1, 1, true);
+	texture = defaultTexture;
+
+	// Initialize the main camera, drawn over the whole window
+	RenderView view;
+	view.camera = std::make_unique<Camera>();
+	view.camera->setFov(45.0f);
+	view.camera->setAspectRatio(width, height);
+	view.camera->setClipRange(0.1f, 50.0f);
+	views.push_back(std::move(view));
 }
 
 Renderer::~Renderer()
@@ -55,7 +70,7 @@ void Renderer::resize(unsigned width, unsigned height)
 {
 	if (width == 0 || height == 0)
 	{
-		std::cout << "Ignoring invalid resize request [" << width << ", " << height << "]" << std::endl;
+		LOG_WARNING("Ignoring invalid resize request [{}, {}]", width, height);
 		return;
 	}
 
@@ -63,7 +78,54 @@ void Renderer::resize(unsigned width, unsigned height)
 	this->height = height;
 
 	dx11->resize(width, height);
-	camera->setAspectRatio(width, height);
+	for (RenderView& view : views)
+	{
+		updateAspectRatio(view);
+	}
+}
+
+Camera* Renderer::addView(float x, float y, float width, float height)
+{
+	if (views.size() >= MultiViewQueue::MAX_VIEWS)
+	{
+		LOG_ERROR("Can't render more than {} views", MultiViewQueue::MAX_VIEWS);
+		throw std::runtime_error("Too many views");
+	}
+
+	// starts where the main camera is, with the same lens
+	const Camera* main = getCamera();
+	RenderView view;
+	view.camera = std::make_unique<Camera>();
+	view.camera->setFov(main->getFov());
+	view.camera->setClipRange(main->getNearZ(), main->getFarZ());
+	view.camera->setPosition(main->getPosition());
+	view.camera->setRotation(main->getRotation());
+	views.push_back(std::move(view));
+	setViewport(views.size() - 1, x, y, width, height);
+	return views.back().camera.get();
+}
+
+void Renderer::setViewport(size_t view, float x, float y, float width, float height)
+{
+	RenderView& renderView = views[view];
+	renderView.x = x;
+	renderView.y = y;
+	renderView.width = width;
+	renderView.height = height;
+	updateAspectRatio(renderView);
+}
+
+void Renderer::clearViews()
+{
+	views.resize(1);
+	setViewport(0, 0.0f, 0.0f, 1.0f, 1.0f);
+}
+
+void Renderer::updateAspectRatio(RenderView& view)
+{
+	unsigned viewWidth = std::max(1u, unsigned(view.width * width));
+	unsigned viewHeight = std::max(1u, unsigned(view.height * height));
+	view.camera->setAspectRatio(viewWidth, viewHeight);
 }
 
 void Renderer::handleEvent(const xwin::Event& event)
@@ -79,7 +141,7 @@ void Renderer::handleEvent(const xwin::Event& event)
 		xwin::FocusData data = event.data.focus;
 		if (!data.focused)
 		{
-			std::cout << "Window unfocused" << std::endl;
+			LOG_DEBUG("Window unfocused");
 			inputManager->notifyLostFocus();
 		}
 	}
@@ -100,55 +162,220 @@ void Renderer::handleEvent(const xwin::Event& event)
 	}
 }
 
-void Renderer::render()
+void Renderer::render(float deltaSeconds)
 {
+	// Transient data of the previous frames in flight stays valid, the oldest is reused
+	frameArena.beginFrame();
+	RenderStats::beginFrame();
+
+	// Advance animations before anything reads the transforms or bounds, then upload the skinned vertices
+	animationSystem->update(deltaSeconds, &JobSystem::getDefault());
+	for (const auto& instance : animationSystem->getSkinnedInstances())
+	{
+		MeshResource& target = *instance->target;
+		if (target.primitiveBuffers == nullptr)
+		{
+			resourceManager->createDynamicMesh(target);
+		}
+		else
+		{
+			resourceManager->updateDynamicMesh(target);
+		}
+	}
+
 	// Clear background
 	dx11->clearView({ 0.0f, 0.0f, 0.0f, 1.0f });
 
 	auto context = dx11->getContext();
-	auto viewProjectionMatrix = camera->getViewProjectionMatrix();
+	auto viewProjectionMatrix = getCamera()->getViewProjectionMatrix();
 
 	// Render the scene
 	if (scene != nullptr)
 	{
-		for (auto& sceneObject : *scene)
+		// LOD nodes and point cloud nodes are culled and selected for the main camera, and placed in world space
+		static const glm::mat4x4 identity(1.0f);
+		float projectionScale = LodStreamer::getProjectionScale(getCamera()->getFov(), unsigned(height * views[0].height));
+		if (lodModel != nullptr)
+		{
+			lodModel->update(getCamera()->getPosition(), viewProjectionMatrix, projectionScale, deltaSeconds);
+		}
+		if (pointCloud != nullptr)
+		{
+			pointCloud->update(getCamera()->getPosition(), viewProjectionMatrix, projectionScale, deltaSeconds);
+		}
+
+		// Set shaders. These are shared by every object.
+		context->IASetInputLayout(vertexShader->inputLayout.Get());
+		context->VSSetShader(vertexShader->shader.Get(), nullptr, 0);
+		context->PSSetShader(pixelShader->shader.Get(), nullptr, 0);
+
+		// Assign constant buffer. Buffer goes to register 0 and stays bound while it is updated.
+		context->VSSetConstantBuffers(0, 1, constantBuffer->getBufferPtr());
+
+		// Texture and sampler go to register 0 of the pixel shader
+		context->PSSetShaderResources(0, 1, texture->getViewPtr());
+		context->PSSetSamplers(0, 1, dx11->getSamplerStatePtr());
+
+		// counted locally and added once, rather than an atomic add per draw
+		DrawState state;
+		state.stateChanges = 6;
+
+		if (views.size() == 1)
+		{
+			// Collect the visible objects, sorted so objects sharing a mesh are drawn together
+			RenderQueue queue(&frameArena.current());
+			queue.build(*scene, viewProjectionMatrix, occlusionCulling ? &occlusionCuller : nullptr);
+			RenderStats::add(RenderCounter::ObjectsCulled, queue.getCulledCount());
+			RenderStats::add(RenderCounter::ObjectsOccluded, queue.getOccludedCount());
+
+			if (lodModel != nullptr)
+			{
+				for (const MeshResource* mesh : lodModel->getVisible())
+				{
+					queue.add(mesh, &identity);
+				}
+			}
+
+			const RenderView& renderView = views[0];
+			dx11->setViewport(renderView.x * width, renderView.y * height, renderView.width * width, renderView.height * height);
+			constantBufferData.viewProjection = viewProjectionMatrix;
+			for (const DrawItem& item : queue.getItems())
+			{
+				drawItem(item, state);
+			}
+
+			drawPointCloud(state);
+		}
+		else
 		{
-			MeshResourcePtr mesh = sceneObject->mesh;
-			if (mesh == nullptr) {
-				continue;
+			// A single traversal culls the objects for every view, the occlusion culler only works with one camera
+			glm::mat4x4 viewProjections[MultiViewQueue::MAX_VIEWS];
+			for (size_t view = 0; view < views.size(); view++)
+			{
+				viewProjections[view] = views[view].camera->getViewProjectionMatrix();
+			}
+
+			MultiViewQueue queue(&frameArena.current());
+			queue.build(*scene, viewProjections, views.size());
+
+			for (size_t view = 0; view < views.size(); view++)
+			{
+				const RenderView& renderView = views[view];
+				dx11->setViewport(renderView.x * width, renderView.y * height, renderView.width * width, renderView.height * height);
+				constantBufferData.viewProjection = viewProjections[view];
+				state.stateChanges++;
+				RenderStats::add(RenderCounter::ObjectsCulled, queue.getCulledCount(view));
+
+				// the views draw from the same sorted items, meshes stay bound from one view to the next
+				const uint32_t* indices = queue.getViewItems(view);
+				for (size_t i = 0; i < queue.getViewItemCount(view); i++)
+				{
+					drawItem(queue.getItems()[indices[i]].draw, state);
+				}
+
+				// the LOD and point cloud nodes were selected for the main camera only, every view draws them
+				if (lodModel != nullptr)
+				{
+					for (const MeshResource* mesh : lodModel->getVisible())
+					{
+						drawItem({ 0, mesh, &identity }, state);
+					}
+				}
+
+				drawPointCloud(state);
 			}
+		}
+		dx11->setViewport(0.0f, 0.0f, float(width), float(height));
+
+		RenderStats::add(RenderCounter::Draws, state.draws);
+		RenderStats::add(RenderCounter::Triangles, state.triangles);
+		RenderStats::add(RenderCounter::Points, state.points);
+		RenderStats::add(RenderCounter::StateChanges, state.stateChanges);
+		RenderStats::add(RenderCounter::ConstantBufferUpdates, state.constantBufferUpdates);
+		RenderStats::add(RenderCounter::ConstantBufferBytes, state.constantBufferUpdates * constantBuffer->sizeOf());
+	}
+
+	// Finished rendering, present results
+	dx11->present(vsync);
+	RenderStats::endFrame();
+}
+
+void Renderer::drawItem(const DrawItem& item, DrawState& state)
+{
+	auto context = dx11->getContext();
 
-			void* rawBuffer = mesh->primitiveBuffers.get();
-			D3D11PrimitiveBuffers* buffers = static_cast<D3D11PrimitiveBuffers*>(rawBuffer);
-			auto vertexBuffer = buffers->vertexBuffer;
-			auto indexBuffer = buffers->indexBuffer;
+	// Input assembler stage, only when the mesh changes
+	// Set the vertex information and indices
+	if (item.mesh != state.boundMesh)
+	{
+		void* rawBuffer = item.mesh->primitiveBuffers.get();
+		D3D11PrimitiveBuffers* buffers = static_cast<D3D11PrimitiveBuffers*>(rawBuffer);
+		const VertexBuffer* vertexBuffer = buffers->vertexBuffer.get();
+		state.indexBuffer = buffers->indexBuffer.get();
+		state.boundMesh = item.mesh;
 
-			// Input assembler stage
-			// Set the topology type, vertex information, and the input layout the shaders will use
+		// streamed meshes have no buffers until their first batch is loaded
+		if (state.indexBuffer != nullptr)
+		{
 			context->IASetVertexBuffers(0, 1,
 				vertexBuffer->getBufferPtr(),
 				vertexBuffer->getStridePtr(),
 				vertexBuffer->getOffsetPtr());
-			context->IASetIndexBuffer(indexBuffer->get(), indexBuffer->getFormat(), 0);
+			context->IASetIndexBuffer(state.indexBuffer->get(), state.indexBuffer->getFormat(), 0);
+			state.stateChanges += 2;
+		}
+	}
 
-			// Set shaders
-			context->IASetInputLayout(vertexShader->inputLayout.Get());
-			context->VSSetShader(vertexShader->shader.Get(), nullptr, 0);
-			context->PSSetShader(pixelShader->shader.Get(), nullptr, 0);
+	if (state.indexBuffer == nullptr)
+	{
+		return;
+	}
 
-			// Assign matrices to constant buffer
-			constantBufferData.model = sceneObject->getModelMatrix();
-			constantBufferData.viewProjection = viewProjectionMatrix;
+	// Assign matrices to constant buffer and update it
+	constantBufferData.model = *item.model;
+	constantBuffer->apply(constantBufferData);
+	state.constantBufferUpdates++;
 
-			// update and assign constant buffer. Buffer goes to register 0.
-			constantBuffer->apply(constantBufferData);
-			context->VSSetConstantBuffers(0, 1, constantBuffer->getBufferPtr());
+	// Render the assets/shaders/triangle.
+	context->DrawIndexed(state.indexBuffer->size(), 0, 0);
+	state.draws++;
+	state.triangles += state.indexBuffer->size() / 3;
+}
 
-			// Render the assets/shaders/triangle.
-			context->DrawIndexed(indexBuffer->size(), 0, 0);
-		}
+void Renderer::drawPointCloud(DrawState& state)
+{
+	if (pointCloud == nullptr || pointCloud->getVisible().empty())
+	{
+		return;
 	}
 
-	// Finished rendering, present results
-	dx11->present(vsync);
+	// the nodes are in world space and share the constant buffer, only their vertex buffers change
+	auto context = dx11->getContext();
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+	context->PSSetShader(pointPixelShader->shader.Get(), nullptr, 0);
+	constantBufferData.model = glm::mat4x4(1.0f);
+	constantBuffer->apply(constantBufferData);
+	state.constantBufferUpdates++;
+	state.stateChanges += 2;
+
+	// a node can be drawn only in part, when the point budget is smaller than the root
+	for (const PointCloudDraw& draw : pointCloud->getVisible())
+	{
+		D3D11PrimitiveBuffers* buffers = static_cast<D3D11PrimitiveBuffers*>(draw.mesh->primitiveBuffers.get());
+		const VertexBuffer* vertexBuffer = buffers->vertexBuffer.get();
+		context->IASetVertexBuffers(0, 1,
+			vertexBuffer->getBufferPtr(),
+			vertexBuffer->getStridePtr(),
+			vertexBuffer->getOffsetPtr());
+		context->Draw(draw.pointCount, 0);
+		state.stateChanges++;
+		state.draws++;
+		state.points += draw.pointCount;
+	}
+
+	// the next meshes bind their own buffers
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->PSSetShader(pixelShader->shader.Get(), nullptr, 0);
+	state.boundMesh = nullptr;
+	state.stateChanges += 2;
 }
@@ -16,6 +16,12 @@
 #include "ResourceManager.h"
 #include "InputManager.h"
 #include "Camera.h"
+#include "FrameAllocator.h"
+#include "LodStreamer.h"
+#include "PointCloudStreamer.h"
+#include "AnimationSystem.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -29,6 +35,16 @@ struct ConstantBufferData
 
 const size_t ConstantBufferData_BLOCKSIZE = 128;
 
+// A camera drawn into a rectangle of the window, given in fractions of the window's size (0 to 1)
+struct RenderView
+{
+	std::unique_ptr<Camera> camera;
+	float x = 0;
+	float y = 0;
+	float width = 1;
+	float height = 1;
+};
+
 // Main class used to link with the graphics runtime as well as manage
 // and render a scene. Also contains pointers to various subsystems
 // like the resource manager and input manager.
@@ -43,48 +59,123 @@ public:
 	// Set the scene that the renderer will render
 	void setScene(ScenePtr scene);
 
+	// Set an out-of-core model drawn along with the scene. Its nodes are streamed for the main camera every frame.
+	void setLodModel(std::shared_ptr<LodStreamer> lodModel) { this->lodModel = lodModel; }
+	LodStreamer* getLodModel() const { return lodModel.get(); }
+
+	// Set a point cloud drawn along with the scene. Its octree nodes are selected for the main camera every frame.
+	void setPointCloud(std::shared_ptr<PointCloudStreamer> pointCloud) { this->pointCloud = pointCloud; }
+	PointCloudStreamer* getPointCloud() const { return pointCloud.get(); }
+
+	// Set the texture applied to every object, projected along the world axes as meshes have no texture coordinates.
+	// Null goes back to plain white.
+	void setTexture(TexturePtr texture) { this->texture = texture != nullptr ? texture : defaultTexture; }
+
 	// Sets the size of the renderer. 
 	void resize(unsigned width, unsigned height);
 
 	// Enable or disable vsync
 	void setVsync(bool vsync) { this->vsync = vsync; }
 
+	// Enable or disable culling objects hidden behind others on the CPU (enabled by default)
+	void setOcclusionCulling(bool enabled) { this->occlusionCulling = enabled; }
+
+	// Occluders drawn, objects rejected and time taken by the occlusion pass of the last frame
+	const OcclusionStats& getOcclusionStats() const { return occlusionCuller.getStats(); }
+
 	// handles an XWindow event. The main message loop is not handled by this class.
 	// This class does not handle the following events. These must be handled separately:
 	// - Close Event
 	void handleEvent(const xwin::Event& event);
 
-	Camera* getCamera() const { return camera.get(); }
-	ScenePtr getScene() const { return scene; }
+	// The main camera, of view 0. Input moves it, and LOD models are streamed for it.
+	Camera* getCamera() const { return views[0].camera.get(); }
+
+	// Adds a camera drawn into a rectangle of the window (in fractions of its size) and returns it.
+	// It starts as a copy of the main camera. With more than one view, the objects are culled for all
+	// of them in a single pass (see MultiViewQueue) and occlusion culling is skipped.
+	// The LOD model and point cloud are still selected once, for the main camera, and every view draws
+	// that selection: the streamers' budgets are per update, so what is outside the main view is missing.
+	Camera* addView(float x, float y, float width, float height);
+
+	// Moves a view to another rectangle of the window. The main view covers the whole window by default.
+	void setViewport(size_t view, float x, float y, float width, float height);
+
+	// Removes every view but the main one, which goes back to covering the whole window
+	void clearViews();
+
+	size_t getViewCount() const { return views.size(); }
+	Camera* getCamera(size_t view) const { return views[view].camera.get(); }
+
+	const ScenePtr& getScene() const { return scene; }
 	ResourceManager* getResourceManager() { return resourceManager.get();  }
 	InputManager* getInputManager() { return inputManager.get(); }
 
-	// Perform a render of the current scene
-	void render();
+	// Animations are advanced at the start of every render. Skinned instances get dynamic
+	// vertex buffers the first time they are drawn and are uploaded every frame.
+	AnimationSystem* getAnimationSystem() { return animationSystem.get(); }
+
+	// Perform a render of the current scene. Animations and LOD streaming advance by the given frame time,
+	// the same one given to the update, so replayed sessions render the same frames.
+	void render(float deltaSeconds);
 
 	unsigned getWidth() const { return width; }
 	unsigned getHeight() const { return height; }
 	bool getVsync() const { return vsync; }
 
 private:
+	// What the draws of a frame have bound so far, and their counts for the render stats
+	struct DrawState
+	{
+		const MeshResource* boundMesh = nullptr;
+		const IndexBuffer* indexBuffer = nullptr;
+		uint64_t draws = 0;
+		uint64_t triangles = 0;
+		uint64_t points = 0;
+		uint64_t stateChanges = 0;
+		uint64_t constantBufferUpdates = 0;
+	};
+
+	// Binds the item's mesh if it isn't already, updates the constant buffer and draws it
+	void drawItem(const DrawItem& item, DrawState& state);
+
+	// Draws the visible nodes of the point cloud as point lists, then restores the triangle state
+	void drawPointCloud(DrawState& state);
+
+	void updateAspectRatio(RenderView& view);
+
 	std::unique_ptr<DX11Interface> dx11;
 	std::unique_ptr<ResourceManager> resourceManager;
 	std::unique_ptr<InputManager> inputManager;
+	std::unique_ptr<AnimationSystem> animationSystem;
 
-	std::unique_ptr<Camera> camera;
+	// Cameras and the part of the window each one is drawn into, the main camera first
+	std::vector<RenderView> views;
 
 	VertexShaderPtr vertexShader = nullptr;
 	PixelShaderPtr pixelShader = nullptr;
+	PixelShaderPtr pointPixelShader = nullptr;
+
+	TexturePtr texture;
+	TexturePtr defaultTexture;
 
 	HWND hwnd;
 	unsigned width;
 	unsigned height;
 	bool windowed = true;
 	bool vsync = true;
+	bool occlusionCulling = true;
 
 	// Stores what we're drawing
 	ScenePtr scene;
+	std::shared_ptr<LodStreamer> lodModel;
+	std::shared_ptr<PointCloudStreamer> pointCloud;
 
 	ConstantBufferPtr<ConstantBufferData> constantBuffer;
 	ConstantBufferData constantBufferData;
+
+	// Memory for data that only lives during a frame (like the list of objects to draw)
+	FrameArena frameArena;
+
+	OcclusionCuller occlusionCuller;
 };
\ No newline at end of file
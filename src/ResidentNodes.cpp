@@ -0,0 +1,54 @@
+#include "ResidentNodes.h"
+
+#include <algorithm>
+
+void ResidentNodes::add(uint32_t node, size_t nodeBytes, uint64_t frame)
+{
+	resident.push_back({ node, nodeBytes });
+	lastUsed[node] = frame;
+	bytes += nodeBytes;
+}
+
+void ResidentNodes::remove(uint32_t node)
+{
+	auto it = std::find_if(resident.begin(), resident.end(), [&](const Entry& entry) { return entry.node == node; });
+	if (it != resident.end())
+	{
+		bytes -= it->bytes;
+		*it = resident.back();
+		resident.pop_back();
+	}
+}
+
+bool ResidentNodes::makeRoom(size_t needed, size_t budget, uint64_t frame, const std::function<void(uint32_t)>& evict)
+{
+	if (bytes + needed <= budget)
+	{
+		return true;
+	}
+
+	// least recently used first, never what the current view uses
+	candidates.clear();
+	for (const Entry& entry : resident)
+	{
+		if (lastUsed[entry.node] < frame)
+		{
+			candidates.push_back(entry.node);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+		return lastUsed[a] < lastUsed[b];
+	});
+
+	for (uint32_t node : candidates)
+	{
+		if (bytes + needed <= budget)
+		{
+			break;
+		}
+		remove(node);
+		evict(node);
+	}
+
+	return bytes + needed <= budget;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// The loaded nodes of a streamed tree (see LodStreamer and PointCloudStreamer), with the last update
+// each node was used in, to evict the least recently used ones when a new node doesn't fit.
+class ResidentNodes
+{
+public:
+	explicit ResidentNodes(size_t nodeCount = 0) : lastUsed(nodeCount, 0) {}
+
+	// Records that an update used the node, loaded or not
+	void markUsed(uint32_t node, uint64_t frame) { lastUsed[node] = frame; }
+	uint64_t getLastUsed(uint32_t node) const { return lastUsed[node]; }
+
+	// Adds a node that was just loaded, and the bytes it keeps loaded
+	void add(uint32_t node, size_t bytes, uint64_t frame);
+
+	// Removes a node from the loaded ones
+	void remove(uint32_t node);
+
+	// Removes loaded nodes until more bytes fit in the budget, least recently used first and never
+	// one used in the current frame. evict is called with every node removed, to release it.
+	// Returns false if they still don't fit.
+	bool makeRoom(size_t bytes, size_t budget, uint64_t frame, const std::function<void(uint32_t)>& evict);
+
+	size_t getBytes() const { return bytes; }
+	size_t getCount() const { return resident.size(); }
+
+private:
+	struct Entry
+	{
+		uint32_t node;
+		size_t bytes;
+	};
+
+	std::vector<uint64_t> lastUsed;
+	std::vector<Entry> resident;
+	std::vector<uint32_t> candidates;
+	size_t bytes = 0;
+};
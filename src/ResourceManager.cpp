@@ -1,9 +1,14 @@
 #include "ResourceManager.h"
+#include "AssetCooker.h"
+#include "GltfLoader.h"
+#include "Logger.h"
+#include "MeshCodec.h"
+#include "ObjLoader.h"
+#include "ScanImport.h"
+#include "SceneFile.h"
 
-#include <iostream>
 #include <filesystem>
 #include <fstream>
-#include <strstream>
 
 #define GLM_FORCE_LEFT_HANDED
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -11,17 +16,74 @@
 
 using namespace std;
 
+// Uploads the batches of a streamed model into growable GPU buffers
+class D3D11MeshStreamSink : public MeshStreamSink
+{
+public:
+	D3D11MeshStreamSink(DX11Interface* dx11) :
+		vertexBuffer(dx11->getDevice(), dx11->getContext(), D3D11_BIND_VERTEX_BUFFER, 1024 * 1024),
+		indexBuffer(dx11->getDevice(), dx11->getContext(), D3D11_BIND_INDEX_BUFFER, 1024 * 1024) {}
+
+	void appendVertices(const Vertex* vertices, size_t count) override
+	{
+		vertexBuffer.append(vertices, static_cast<unsigned>(count * sizeof(Vertex)));
+		vertexCount += static_cast<unsigned>(count);
+	}
+
+	void updateVertices(size_t first, const Vertex* vertices, size_t count) override
+	{
+		vertexBuffer.update(static_cast<unsigned>(first * sizeof(Vertex)), vertices, static_cast<unsigned>(count * sizeof(Vertex)));
+	}
+
+	void appendIndices(const unsigned* indices, size_t count) override
+	{
+		indexBuffer.append(indices, static_cast<unsigned>(count * sizeof(unsigned)));
+		indexCount += static_cast<unsigned>(count);
+	}
+
+	// Points the mesh buffers at what was uploaded so far, so it can be drawn
+	void publish(D3D11PrimitiveBuffers& buffers)
+	{
+		if (indexCount == publishedIndexCount)
+		{
+			return;
+		}
+
+		// the buffers are replaced when they grow, so the views are recreated every time
+		buffers.vertexBuffer = std::make_shared<VertexBuffer>(vertexBuffer.get(), vertexCount, static_cast<unsigned>(sizeof(Vertex)));
+		buffers.indexBuffer = std::make_shared<IndexBuffer>(indexBuffer.get(), indexCount);
+		publishedIndexCount = indexCount;
+	}
+
+private:
+	GrowableBuffer vertexBuffer;
+	GrowableBuffer indexBuffer;
+	unsigned vertexCount = 0;
+	unsigned indexCount = 0;
+	unsigned publishedIndexCount = 0;
+};
+
+struct ResourceManager::StreamingModel
+{
+	MeshResourcePtr resource;
+	std::shared_ptr<D3D11PrimitiveBuffers> buffers;
+	std::unique_ptr<ObjStreamLoader> loader;
+	std::unique_ptr<D3D11MeshStreamSink> sink;
+};
+
+ResourceManager::ResourceManager() = default;
+
+ResourceManager::~ResourceManager() = default;
+
 void ResourceManager::initialize(DX11Interface* dx11)
 {
 	this->dx11 = dx11;
+	this->textureCache = std::make_unique<TextureCache>(filesystem::current_path() / "texturecache");
+	this->uploader = std::make_unique<D3D11GeometryUploader>(dx11->getDevice(), dx11->getContext());
 }
 
-MeshResourcePtr ResourceManager::loadModel(const std::wstring& relativePath)
+std::filesystem::path ResourceManager::getModelPath(const std::wstring& relativePath) const
 {
-	// todo: CACHE
-	// note: this assumes DX11, which means we negate the Z access and read faces backwards.
-	// OBJ files assume right hand coordinate systems looking down negative Z.
-
 	auto path = filesystem::current_path();
 	path.append("assets\\models");
 	path.append(relativePath);
@@ -29,74 +91,295 @@ MeshResourcePtr ResourceManager::loadModel(const std::wstring& relativePath)
 	if (!filesystem::exists(path))
 	{
 		std::string msg("Could not find model file " + path.string());
-		std::cout << msg << endl;
+		LOG_ERROR("{}", msg);
 		throw std::exception(msg.c_str());
 	}
 
-	ifstream f(path);
+	return path;
+}
 
-	// store the information we're reading
+MeshResourcePtr ResourceManager::loadModel(const std::wstring& relativePath)
+{
+	return loadModel(relativePath, meshResidency);
+}
+
+MeshResourcePtr ResourceManager::loadModel(const std::wstring& relativePath, MeshResidency residency)
+{
+	// todo: CACHE
+
+	// cooked models are already welded, with unit normals, and load the fastest
+	if (!cookedDirectory.empty())
+	{
+		auto cookedPath = cookedDirectory / getCookedModelPath(relativePath);
+		if (filesystem::exists(cookedPath))
+		{
+			return loadMeshFile(cookedPath, *uploader, residency, &JobSystem::getDefault());
+		}
+	}
+
+	auto path = getModelPath(relativePath);
+
+	if (path.extension() != ".stl" && path.extension() != ".ply")
+	{
+		// parsed or decoded straight into the staging memory of the upload
+		return loadMeshFile(path, *uploader, residency, &JobSystem::getDefault());
+	}
+
+	// scans are welded into vectors first, their vertex count is only known at the end
 	vector<Vertex> vertices;
 	vector<unsigned> indices;
+	ScanImportOptions options;
+	options.jobs = &JobSystem::getDefault();
+	ScanImportStats stats = importScan(path, vertices, indices, options);
+
+	LOG_INFO("Imported {}: {} triangles at {}K triangles/s, welded {} vertices into {} ({}% fewer)",
+		path.filename(), stats.triangles, unsigned(stats.getTrianglesPerSecond() / 1000),
+		stats.sourceVertices, stats.vertices, unsigned(stats.getVertexReduction() * 100));
+
+	// Create the resource
+	MeshResourcePtr resource(new MeshResource());
+	resource->primitiveBuffers = uploader->upload(vertices.data(), vertices.size(), indices.data(), indices.size());
+	resource->vertices = std::move(vertices);
+	resource->indices = std::move(indices);
+	resource->computeBounds();
+	resource->setResidency(residency);
+	resource->updateMemoryStats();
+
+	return resource;
+}
 
-	string line;
-	while (getline(f, line))
+std::vector<SceneObjectPtr> ResourceManager::loadGltf(const std::wstring& relativePath, Scene& scene)
+{
+	auto path = getModelPath(relativePath);
+
+	GltfFile file(path);
+
+	// a GPU mesh per primitive, shared by every node using it
+	std::vector<std::vector<MeshResourcePtr>> meshes;
+	for (const GltfMesh& mesh : file.getMeshes())
 	{
-		strstream s;
-		s << line;
+		meshes.emplace_back();
+		for (const GltfPrimitive& primitive : mesh.primitives)
+		{
+			auto buffers = std::make_shared<D3D11PrimitiveBuffers>();
+			buffers->vertexBuffer = dx11->createVertexBuffer(primitive.vertices, static_cast<unsigned>(primitive.vertexCount), sizeof(Vertex));
+			buffers->indexBuffer = dx11->createIndexBuffer(primitive.indices, static_cast<unsigned>(primitive.indexCount));
 
-		string firstChar;
-		s >> firstChar;
+			MeshResourcePtr resource = std::make_shared<MeshResource>();
+			resource->primitiveBuffers = buffers;
+			resource->boundsMin = primitive.boundsMin;
+			resource->boundsMax = primitive.boundsMax;
+			resource->setResidency(MeshResidency::None);
+			meshes.back().push_back(resource);
+		}
+	}
 
-		if (firstChar == "v")
+	// files without nodes still show their meshes, as they are
+	std::vector<GltfNode> nodes = file.getNodes();
+	if (nodes.empty())
+	{
+		for (size_t i = 0; i < meshes.size(); i++)
 		{
-			float x, y, z;
-			s >> x >> y >> z;
-			vertices.push_back(Vertex({ x, y, -z }, { 0.8, 0.8, 0.8 }));
+			GltfNode node;
+			node.mesh = static_cast<int>(i);
+			nodes.push_back(node);
 		}
-		else if (firstChar == "f")
+	}
+
+	std::vector<SceneObjectPtr> objects;
+	for (const GltfNode& node : nodes)
+	{
+		for (const MeshResourcePtr& mesh : meshes[node.mesh])
 		{
-			// obj are counter clockwise, make clockwise and make them 0 indexed
-			unsigned p1, p2, p3;
-			//s >> p3 >> p2 >> p1;
-			s >> p3 >> p2 >> p1;
-			p1 -= 1;
-			p2 -= 1;
-			p3 -= 1;
-
-			// calculate the normal, and add it to the normal of each vertex. 
-			// We normalize in the end
-			glm::vec3 v1 = vertices[p2].position - vertices[p1].position;
-			glm::vec3 v2 = vertices[p3].position - vertices[p1].position;
-			glm::vec3 normal = glm::normalize(glm::cross(v1, v2));
-
-			vertices[p1].normal += normal;
-			vertices[p2].normal += normal;
-			vertices[p3].normal += normal;
-
-			indices.push_back(p1);
-			indices.push_back(p2);
-			indices.push_back(p3);
+			auto object = scene.createObject(mesh);
+			object->setPosition(node.position);
+			object->setRotation(node.rotation);
+			object->setScale(node.scale.x, node.scale.y, node.scale.z);
+			objects.push_back(object);
 		}
 	}
 
-	// Create primitive buffers that will be used to render the mesh
-	// todo: don't hardcode to dx11
+	auto& stats = file.getStats();
+	LOG_INFO("Loaded glTF: {} objects, {} KB uploaded from the file, {} KB converted", objects.size(),
+		(stats.mappedVertexBytes + stats.mappedIndexBytes) / 1024, (stats.convertedVertexBytes + stats.convertedIndexBytes) / 1024);
+
+	return objects;
+}
+
+size_t ResourceManager::loadScene(const std::wstring& relativePath, Scene& scene)
+{
+	auto path = getModelPath(relativePath);
+
+	SceneFile file(path);
+	file.instantiate(scene, [&](const std::string& name) {
+		return loadModel(std::wstring(name.begin(), name.end()));
+	});
+
+	LOG_INFO("Loaded scene {}: {} objects using {} meshes", path.filename(), file.getObjectCount(), file.getMeshCount());
+	return file.getObjectCount();
+}
+
+void ResourceManager::createMesh(MeshResource& mesh)
+{
 	auto buffers = std::make_shared<D3D11PrimitiveBuffers>();
-	buffers->vertexBuffer = dx11->createVertexBuffer(vertices);
-	buffers->indexBuffer = dx11->createIndexBuffer(indices);
+	buffers->vertexBuffer = dx11->createVertexBuffer(mesh.vertices);
+	buffers->indexBuffer = dx11->createIndexBuffer(mesh.indices);
+	mesh.primitiveBuffers = buffers;
+	mesh.setResidency(meshResidency);
+}
+
+void ResourceManager::createDynamicMesh(MeshResource& mesh)
+{
+	auto buffers = std::make_shared<D3D11PrimitiveBuffers>();
+	buffers->vertexBuffer = dx11->createDynamicVertexBuffer(static_cast<unsigned>(mesh.vertices.size()), sizeof(Vertex));
+	buffers->indexBuffer = dx11->createIndexBuffer(mesh.indices);
+	mesh.primitiveBuffers = buffers;
+
+	updateDynamicMesh(mesh);
+}
 
-	// make vertex normals into unit vectors
-	for (auto& vertex : vertices)
+void ResourceManager::updateDynamicMesh(const MeshResource& mesh)
+{
+	auto buffers = static_cast<D3D11PrimitiveBuffers*>(mesh.primitiveBuffers.get());
+	dx11->updateDynamicVertexBuffer(*buffers->vertexBuffer, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+}
+
+void ResourceManager::createEditableMesh(MeshResource& mesh)
+{
+	auto buffers = std::make_shared<D3D11PrimitiveBuffers>();
+	buffers->vertexBuffer = dx11->createVertexBuffer(mesh.vertices);
+	buffers->indexBuffer = dx11->createIndexBuffer(mesh.indices);
+	mesh.primitiveBuffers = buffers;
+	mesh.setResidency(MeshResidency::Full);
+}
+
+void ResourceManager::uploadMeshRanges(const MeshResource& mesh, const std::vector<VertexRange>& ranges)
+{
+	auto buffers = static_cast<D3D11PrimitiveBuffers*>(mesh.primitiveBuffers.get());
+	for (const VertexRange& range : ranges)
 	{
-		vertex.normal = glm::normalize(vertex.normal);
+		dx11->updateVertexBufferRange(*buffers->vertexBuffer, &mesh.vertices[range.first], range.first * sizeof(Vertex), range.count * sizeof(Vertex));
 	}
+}
 
-	// Create the resource
-	MeshResourcePtr resource(new MeshResource());
-	resource->vertices = std::move(vertices);
-	resource->indices = std::move(indices);
-	resource->primitiveBuffers = buffers;
+MeshResourcePtr ResourceManager::loadModelStreaming(const std::wstring& relativePath, const ObjStreamOptions& options)
+{
+	auto path = getModelPath(relativePath);
+
+	auto model = std::make_unique<StreamingModel>();
+	model->loader = std::make_unique<ObjStreamLoader>(path, options);
+	model->sink = std::make_unique<D3D11MeshStreamSink>(dx11);
+	model->buffers = std::make_shared<D3D11PrimitiveBuffers>();
 
+	// Nothing is drawn until the first batch arrives
+	model->resource = std::make_shared<MeshResource>();
+	model->resource->primitiveBuffers = model->buffers;
+	model->resource->setResidency(MeshResidency::None);
+
+	MeshResourcePtr resource = model->resource;
+	streamingModels.push_back(std::move(model));
 	return resource;
-}
\ No newline at end of file
+}
+
+void ResourceManager::updateStreaming()
+{
+	for (auto it = streamingModels.begin(); it != streamingModels.end();)
+	{
+		StreamingModel& model = **it;
+		bool more = model.loader->step(*model.sink);
+
+		model.sink->publish(*model.buffers);
+		model.resource->boundsMin = model.loader->getBoundsMin();
+		model.resource->boundsMax = model.loader->getBoundsMax();
+
+		if (!more)
+		{
+			auto& stats = model.loader->getStats();
+			LOG_INFO("Streamed model: {} vertices, {} triangles, {} KB peak loader memory",
+				stats.vertices, stats.indices / 3, stats.peakMemory / 1024);
+			it = streamingModels.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+std::shared_ptr<LodStreamer> ResourceManager::loadLodModel(const std::wstring& relativePath, const LodStreamerOptions& options)
+{
+	auto path = getModelPath(relativePath);
+
+	DX11Interface* dx11 = this->dx11;
+	auto upload = [dx11](const Vertex* vertices, size_t vertexCount, const unsigned* indices, size_t indexCount) {
+		auto buffers = std::make_shared<D3D11PrimitiveBuffers>();
+		buffers->vertexBuffer = dx11->createVertexBuffer(vertices, static_cast<unsigned>(vertexCount), sizeof(Vertex));
+		buffers->indexBuffer = dx11->createIndexBuffer(indices, static_cast<unsigned>(indexCount));
+
+		MeshResourcePtr resource = std::make_shared<MeshResource>();
+		resource->primitiveBuffers = buffers;
+		resource->setResidency(MeshResidency::None);
+		return resource;
+	};
+
+	return std::make_shared<LodStreamer>(path, upload, options);
+}
+
+std::shared_ptr<PointCloudStreamer> ResourceManager::loadPointCloud(const std::wstring& relativePath,
+	const PointOctreeOptions& octreeOptions, const PointCloudStreamerOptions& options)
+{
+	auto path = getModelPath(relativePath);
+	auto octree = std::make_shared<PointOctree>(readPointCloud(path), octreeOptions, &JobSystem::getDefault());
+
+	auto& stats = octree->getStats();
+	LOG_INFO("Loaded point cloud {}: {} points in {} nodes, {} levels, built at {}M points/s",
+		path.filename(), stats.points, stats.nodes, stats.depth, unsigned(stats.getPointsPerSecond() / 1000000));
+
+	// points have no indices, the renderer draws their vertex buffers as point lists
+	DX11Interface* dx11 = this->dx11;
+	auto upload = [dx11](const Vertex* points, size_t count) {
+		auto buffers = std::make_shared<D3D11PrimitiveBuffers>();
+		buffers->vertexBuffer = dx11->createVertexBuffer(points, static_cast<unsigned>(count), sizeof(Vertex));
+
+		MeshResourcePtr resource = std::make_shared<MeshResource>();
+		resource->primitiveBuffers = buffers;
+		resource->setResidency(MeshResidency::None);
+		return resource;
+	};
+
+	return std::make_shared<PointCloudStreamer>(octree, upload, options);
+}
+
+TexturePtr ResourceManager::loadTexture(const std::wstring& relativePath, const TextureSettings& settings)
+{
+	auto path = filesystem::current_path();
+	path.append("assets\\textures");
+	path.append(relativePath);
+
+	if (!filesystem::exists(path))
+	{
+		std::string msg("Could not find texture file " + path.string());
+		LOG_ERROR("{}", msg);
+		throw std::exception(msg.c_str());
+	}
+
+	TextureStats stats;
+	CompressedTexture texture = textureCache->getOrCompress(path, settings, &JobSystem::getDefault(), &stats);
+	TexturePtr result = dx11->createTexture(texture);
+
+	static const char* FORMAT_NAMES[] = { "BC1", "BC3", "BC5", "BC7" };
+	if (stats.cacheHit)
+	{
+		LOG_INFO("Loaded texture {}: {}x{} {}, {} mips, {} KB on the GPU instead of {} KB (from cache)",
+			path.filename(), texture.width, texture.height, FORMAT_NAMES[int(texture.format)], texture.levels.size(),
+			texture.data.size() / 1024, texture.getUncompressedBytes() / 1024);
+	}
+	else
+	{
+		LOG_INFO("Loaded texture {}: {}x{} {}, {} mips, {} KB on the GPU instead of {} KB, encoded at {}M texels/s",
+			path.filename(), texture.width, texture.height, FORMAT_NAMES[int(texture.format)], texture.levels.size(),
+			texture.data.size() / 1024, texture.getUncompressedBytes() / 1024, unsigned(stats.getEncodeTexelsPerSecond() / 1000000));
+	}
+
+	return result;
+}
@@ -3,9 +3,17 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <filesystem>
 
 #include "Assets.h"
 #include "DX11Interface.h"
+#include "GeometryUpload.h"
+#include "ObjStreamLoader.h"
+#include "LodStreamer.h"
+#include "MeshEditor.h"
+#include "PointCloudStreamer.h"
+#include "Scene.h"
+#include "TextureCache.h"
 
 
 // Used to load assets for the engine.
@@ -13,9 +21,89 @@
 class ResourceManager
 {
 public:
+	ResourceManager();
+	~ResourceManager();
+
 	void initialize(DX11Interface* dx11);
+
+	// Loads an OBJ file, a binary STL or PLY file (welded into shared vertices),
+	// or a compressed .mvmesh file made by ModelViewerMeshEncode.
+	// OBJ and .mvmesh files are read straight into staging memory (see GeometryUploader).
 	MeshResourcePtr loadModel(const std::wstring& relativePath);
 
+	// Same, keeping the given part of the CPU data once uploaded instead of the default one
+	MeshResourcePtr loadModel(const std::wstring& relativePath, MeshResidency residency);
+
+	// Sets what the meshes loaded by loadModel() and loadScene(), or made by createMesh(), keep of their
+	// CPU data after upload. Full by default. Dynamic meshes always keep everything.
+	void setMeshResidency(MeshResidency residency) { meshResidency = residency; }
+	MeshResidency getMeshResidency() const { return meshResidency; }
+
+	// Sets where loadModel() looks for models cooked by ModelViewerAssetCook (see AssetCooker.h) before the
+	// source files. Empty, the default, always loads the sources.
+	void setCookedDirectory(const std::filesystem::path& directory) { cookedDirectory = directory; }
+
+	// Imports the meshes and nodes of a binary glTF file (.glb) into a scene, one object per node and
+	// primitive, and returns the new objects. Buffer views already in the engine's layout are uploaded
+	// straight from the mapped file. The meshes keep no CPU copy of their vertices and indices.
+	std::vector<SceneObjectPtr> loadGltf(const std::wstring& relativePath, Scene& scene);
+
+	// Adds the objects of a binary scene file (.mvscene, see SceneFile.h) to a scene and returns how many.
+	// The file is mapped and its objects created in one block; each mesh it names is loaded once.
+	size_t loadScene(const std::wstring& relativePath, Scene& scene);
+
+	// Creates the buffers of a mesh built in code from its CPU vertices and indices, then drops what
+	// the mesh residency doesn't keep
+	void createMesh(MeshResource& mesh);
+
+	// Creates buffers for a mesh whose vertices change every frame (eg. the target of a skinned instance).
+	// The indices are fixed, the vertices are uploaded by updateDynamicMesh().
+	void createDynamicMesh(MeshResource& mesh);
+
+	// Uploads the CPU vertices of a mesh made by createDynamicMesh()
+	void updateDynamicMesh(const MeshResource& mesh);
+
+	// Creates the buffers of a mesh whose vertices are edited in place by a MeshEditor.
+	// The mesh keeps its full CPU data whatever the mesh residency.
+	void createEditableMesh(MeshResource& mesh);
+
+	// Uploads ranges of the CPU vertices of a mesh made by createEditableMesh(), eg. the ones returned
+	// by MeshEditor::commit()
+	void uploadMeshRanges(const MeshResource& mesh, const std::vector<VertexRange>& ranges);
+
+	// Starts loading a model progressively, for files too large to load at once.
+	// The returned mesh is empty at first and fills up as updateStreaming() is called.
+	// Its CPU vertices and indices are never filled, the data only lives on the GPU.
+	MeshResourcePtr loadModelStreaming(const std::wstring& relativePath, const ObjStreamOptions& options = {});
+
+	// Loads the next batch of every model being streamed. Call once per frame.
+	void updateStreaming();
+
+	// Returns true while any model is still being streamed
+	bool isStreaming() const { return !streamingModels.empty(); }
+
+	// Opens an out-of-core LOD file built by ModelViewerLodBuild.
+	// Nodes are uploaded straight from the mapped file as the camera needs them.
+	std::shared_ptr<LodStreamer> loadLodModel(const std::wstring& relativePath, const LodStreamerOptions& options = {});
+
+	// Loads the points of an OBJ file from assets\\models (eg. a LiDAR scan) and sorts them into an octree.
+	// Nodes are uploaded as point lists as the camera needs them.
+	std::shared_ptr<PointCloudStreamer> loadPointCloud(const std::wstring& relativePath,
+		const PointOctreeOptions& octreeOptions = {}, const PointCloudStreamerOptions& options = {});
+
+	// Loads a PNG texture from assets\\textures, generating its mips and block compressing it.
+	// Compressed textures are cached in the texturecache folder, so each one is compressed once.
+	TexturePtr loadTexture(const std::wstring& relativePath, const TextureSettings& settings = {});
+
 private:
+	struct StreamingModel;
+
+	std::filesystem::path getModelPath(const std::wstring& relativePath) const;
+
 	DX11Interface* dx11;
+	MeshResidency meshResidency = MeshResidency::Full;
+	std::filesystem::path cookedDirectory;
+	std::vector<std::unique_ptr<StreamingModel>> streamingModels;
+	std::unique_ptr<TextureCache> textureCache;
+	std::unique_ptr<GeometryUploader> uploader;
 };
@@ -0,0 +1,752 @@
+#include "ScanImport.h"
+#include "MappedFile.h"
+#include "ObjLoader.h"
+#include "VertexWelder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	const size_t STL_HEADER_SIZE = 84;
+	const size_t STL_TRIANGLE_SIZE = 50;
+
+	// Triangles or vertices decoded per task
+	const size_t RECORDS_PER_TASK = 16 * 1024;
+
+	// Color of vertices when the file has none, the same as OBJ files get
+	const glm::vec3 DEFAULT_COLOR = { 0.8f, 0.8f, 0.8f };
+
+	typedef std::chrono::steady_clock Clock;
+
+	double secondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	uint32_t readU32(const unsigned char* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	glm::vec3 readStlVector(const unsigned char* data)
+	{
+		float values[3];
+		memcpy(values, data, sizeof(values));
+
+		// left handed
+		return { values[0], values[1], -values[2] };
+	}
+
+	template <typename Task>
+	void runBatch(JobSystem* jobs, size_t count, const Task& task)
+	{
+		if (jobs && count > 1)
+		{
+			jobs->parallelFor(count, task);
+		}
+		else
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				task(i);
+			}
+		}
+	}
+
+	// Decodes fixed size records a batch at a time, releasing the pages of each batch once it is done
+	template <typename Decode>
+	void decodeRecords(const MappedFile& file, size_t offset, size_t count, size_t recordSize, const ScanImportOptions& options,
+		const Decode& decode)
+	{
+		size_t batchRecords = std::max<size_t>(RECORDS_PER_TASK, options.batchBytes / recordSize);
+		for (size_t first = 0; first < count; first += batchRecords)
+		{
+			size_t batchCount = std::min(batchRecords, count - first);
+			size_t batchOffset = offset + first * recordSize;
+			file.prefetch(batchOffset + batchCount * recordSize, batchRecords * recordSize);
+
+			size_t tasks = (batchCount + RECORDS_PER_TASK - 1) / RECORDS_PER_TASK;
+			runBatch(options.jobs, tasks, [&](size_t task) {
+				size_t begin = first + task * RECORDS_PER_TASK;
+				size_t end = std::min(first + batchCount, begin + RECORDS_PER_TASK);
+				for (size_t i = begin; i < end; i++)
+				{
+					decode(i, file.data() + offset + i * recordSize);
+				}
+			});
+
+			file.release(batchOffset, batchCount * recordSize);
+		}
+	}
+
+	// Adds the normal of every triangle to its vertices and makes them unit vectors, like parseObj() does
+	void computeNormals(std::vector<Vertex>& vertices, const std::vector<unsigned>& indices)
+	{
+		for (auto& vertex : vertices)
+		{
+			vertex.normal = { 0, 0, 0 };
+		}
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			Vertex& v1 = vertices[indices[i]];
+			Vertex& v2 = vertices[indices[i + 1]];
+			Vertex& v3 = vertices[indices[i + 2]];
+
+			// slivers left after welding have no direction
+			glm::vec3 cross = glm::cross(v2.position - v1.position, v3.position - v1.position);
+			if (glm::dot(cross, cross) > 0)
+			{
+				glm::vec3 normal = computeFaceNormal(v1.position, v2.position, v3.position);
+				v1.normal += normal;
+				v2.normal += normal;
+				v3.normal += normal;
+			}
+		}
+
+		for (auto& vertex : vertices)
+		{
+			float length = glm::length(vertex.normal);
+			vertex.normal = length > 0 ? vertex.normal / length : glm::vec3(0, 1, 0);
+		}
+	}
+
+	// Points the indices at the welded vertices, and drops the triangles that collapsed
+	void remapTriangles(std::vector<unsigned>& indices, const std::vector<unsigned>& remap, ScanImportStats& stats)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			unsigned a = remap[indices[i]];
+			unsigned b = remap[indices[i + 1]];
+			unsigned c = remap[indices[i + 2]];
+			if (a == b || b == c || a == c)
+			{
+				stats.degenerateTriangles++;
+				continue;
+			}
+			indices[kept++] = a;
+			indices[kept++] = b;
+			indices[kept++] = c;
+		}
+		indices.resize(kept);
+	}
+
+	enum class PlyType
+	{
+		Int8,
+		UInt8,
+		Int16,
+		UInt16,
+		Int32,
+		UInt32,
+		Float32,
+		Float64
+	};
+
+	struct PlyProperty
+	{
+		std::string name;
+		PlyType type = PlyType::Float32;
+
+		// lists store a count of countType, then that many values of type
+		bool list = false;
+		PlyType countType = PlyType::UInt8;
+	};
+
+	struct PlyElement
+	{
+		std::string name;
+		uint64_t count = 0;
+		std::vector<PlyProperty> properties;
+	};
+
+	PlyType parsePlyType(const std::string& name)
+	{
+		if (name == "char" || name == "int8") return PlyType::Int8;
+		if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+		if (name == "short" || name == "int16") return PlyType::Int16;
+		if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+		if (name == "int" || name == "int32") return PlyType::Int32;
+		if (name == "uint" || name == "uint32") return PlyType::UInt32;
+		if (name == "float" || name == "float32") return PlyType::Float32;
+		if (name == "double" || name == "float64") return PlyType::Float64;
+		throw std::runtime_error("Unknown PLY property type " + name);
+	}
+
+	size_t getPlyTypeSize(PlyType type)
+	{
+		switch (type)
+		{
+		case PlyType::Int8:
+		case PlyType::UInt8:
+			return 1;
+		case PlyType::Int16:
+		case PlyType::UInt16:
+			return 2;
+		case PlyType::Int32:
+		case PlyType::UInt32:
+		case PlyType::Float32:
+			return 4;
+		default:
+			return 8;
+		}
+	}
+
+	double readPlyValue(const unsigned char* data, PlyType type, bool bigEndian)
+	{
+		unsigned char bytes[8];
+		size_t size = getPlyTypeSize(type);
+		if (bigEndian)
+		{
+			std::reverse_copy(data, data + size, bytes);
+		}
+		else
+		{
+			memcpy(bytes, data, size);
+		}
+
+		switch (type)
+		{
+		case PlyType::Int8: { int8_t value; memcpy(&value, bytes, size); return value; }
+		case PlyType::UInt8: { uint8_t value; memcpy(&value, bytes, size); return value; }
+		case PlyType::Int16: { int16_t value; memcpy(&value, bytes, size); return value; }
+		case PlyType::UInt16: { uint16_t value; memcpy(&value, bytes, size); return value; }
+		case PlyType::Int32: { int32_t value; memcpy(&value, bytes, size); return value; }
+		case PlyType::UInt32: { uint32_t value; memcpy(&value, bytes, size); return value; }
+		case PlyType::Float32: { float value; memcpy(&value, bytes, size); return value; }
+		default: { double value; memcpy(&value, bytes, size); return value; }
+		}
+	}
+
+	// Reads the text header, returns the offset of the binary data
+	size_t parsePlyHeader(const MappedFile& file, const std::string& pathName, std::vector<PlyElement>& elements, bool& bigEndian)
+	{
+		const char* text = reinterpret_cast<const char*>(file.data());
+		// headers are small, don't read through a whole binary file looking for one
+		const char* end = text + std::min<size_t>(file.size(), 1024 * 1024);
+		const char* marker = "end_header";
+		const char* headerEnd = std::search(text, end, marker, marker + strlen(marker));
+		if (file.size() < 4 || memcmp(text, "ply", 3) != 0 || headerEnd == end)
+		{
+			throw std::runtime_error("Not a PLY file " + pathName);
+		}
+
+		// the binary data starts after the line ending of end_header
+		const char* dataStart = std::find(headerEnd, end, '\n');
+		if (dataStart == end)
+		{
+			throw std::runtime_error("Truncated PLY header in " + pathName);
+		}
+
+		std::istringstream header(std::string(text, headerEnd));
+		std::string line;
+		bool hasFormat = false;
+		while (std::getline(header, line))
+		{
+			std::istringstream words(line);
+			std::string keyword;
+			words >> keyword;
+
+			if (keyword == "format")
+			{
+				std::string format;
+				words >> format;
+				if (format == "ascii")
+				{
+					throw std::runtime_error("ASCII PLY files are not supported, convert " + pathName + " to binary");
+				}
+				if (format != "binary_little_endian" && format != "binary_big_endian")
+				{
+					throw std::runtime_error("Unknown PLY format " + format + " in " + pathName);
+				}
+				bigEndian = format == "binary_big_endian";
+				hasFormat = true;
+			}
+			else if (keyword == "element")
+			{
+				PlyElement element;
+				words >> element.name >> element.count;
+				if (!words)
+				{
+					throw std::runtime_error("Broken PLY element in " + pathName);
+				}
+				elements.push_back(element);
+			}
+			else if (keyword == "property")
+			{
+				if (elements.empty())
+				{
+					throw std::runtime_error("PLY property outside of an element in " + pathName);
+				}
+
+				PlyProperty property;
+				std::string type;
+				words >> type;
+				if (type == "list")
+				{
+					std::string countType, itemType;
+					words >> countType >> itemType;
+					property.list = true;
+					property.countType = parsePlyType(countType);
+					property.type = parsePlyType(itemType);
+				}
+				else
+				{
+					property.type = parsePlyType(type);
+				}
+				words >> property.name;
+				elements.back().properties.push_back(property);
+			}
+		}
+
+		if (!hasFormat)
+		{
+			throw std::runtime_error("PLY file without a format " + pathName);
+		}
+
+		return size_t(dataStart + 1 - text);
+	}
+
+	// Walks one record of an element with list properties, returns the offset after it
+	template <typename Visit>
+	size_t walkPlyRecord(const MappedFile& file, size_t offset, const PlyElement& element, bool bigEndian, const std::string& pathName,
+		const Visit& visit)
+	{
+		for (size_t index = 0; index < element.properties.size(); index++)
+		{
+			const PlyProperty& property = element.properties[index];
+			size_t count = 1;
+			if (property.list)
+			{
+				size_t countSize = getPlyTypeSize(property.countType);
+				if (offset + countSize > file.size())
+				{
+					throw std::runtime_error("Truncated PLY file " + pathName);
+				}
+				double listCount = readPlyValue(file.data() + offset, property.countType, bigEndian);
+				if (listCount < 0)
+				{
+					throw std::runtime_error("Negative PLY list size in " + pathName);
+				}
+				count = size_t(listCount);
+				offset += countSize;
+			}
+
+			size_t bytes = count * getPlyTypeSize(property.type);
+			if (bytes > file.size() - std::min(offset, file.size()))
+			{
+				throw std::runtime_error("Truncated PLY file " + pathName);
+			}
+			visit(index, file.data() + offset, count);
+			offset += bytes;
+		}
+		return offset;
+	}
+}
+
+ScanImportStats importStl(const std::filesystem::path& path, std::vector<Vertex>& vertices, std::vector<unsigned>& indices,
+	const ScanImportOptions& options)
+{
+	auto start = Clock::now();
+	ScanImportStats stats;
+
+	MappedFile file;
+	if (!file.open(path))
+	{
+		throw std::runtime_error("Could not open STL file " + path.string());
+	}
+
+	size_t size = file.size();
+	if (size < STL_HEADER_SIZE)
+	{
+		throw std::runtime_error("Not a binary STL file " + path.string());
+	}
+
+	uint64_t triangleCount = readU32(file.data() + 80);
+	uint64_t expectedSize = STL_HEADER_SIZE + triangleCount * STL_TRIANGLE_SIZE;
+	if (size != expectedSize)
+	{
+		// binary files may start with "solid" too, only the size tells them apart
+		if (memcmp(file.data(), "solid", 5) == 0)
+		{
+			throw std::runtime_error("ASCII STL files are not supported, convert " + path.string() + " to binary");
+		}
+		if (size < expectedSize)
+		{
+			throw std::runtime_error("Truncated STL file " + path.string());
+		}
+	}
+
+	// every triangle has its own corners, flipped to clockwise
+	std::vector<glm::vec3> corners(size_t(triangleCount * 3));
+	decodeRecords(file, STL_HEADER_SIZE, size_t(triangleCount), STL_TRIANGLE_SIZE, options, [&](size_t triangle, const unsigned char* record) {
+		glm::vec3* corner = &corners[triangle * 3];
+		corner[0] = readStlVector(record + 12);
+		corner[1] = readStlVector(record + 36);
+		corner[2] = readStlVector(record + 24);
+	});
+	stats.bytesRead = expectedSize;
+	stats.triangles = triangleCount;
+	stats.sourceVertices = corners.size();
+
+	indices.resize(corners.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		indices[i] = static_cast<unsigned>(i);
+	}
+
+	if (options.weld)
+	{
+		auto weldStart = Clock::now();
+		WeldResult weld;
+		weldPositions(corners.data(), corners.size(), options.weldEpsilon, weld, options.jobs);
+
+		vertices.resize(weld.representatives.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			vertices[i] = Vertex(corners[weld.representatives[i]], DEFAULT_COLOR);
+		}
+		remapTriangles(indices, weld.remap, stats);
+		stats.weldSeconds = secondsSince(weldStart);
+	}
+	else
+	{
+		vertices.resize(corners.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			vertices[i] = Vertex(corners[i], DEFAULT_COLOR);
+		}
+	}
+
+	computeNormals(vertices, indices);
+	stats.vertices = vertices.size();
+	stats.readSeconds = secondsSince(start) - stats.weldSeconds;
+	return stats;
+}
+
+ScanImportStats importPly(const std::filesystem::path& path, std::vector<Vertex>& vertices, std::vector<unsigned>& indices,
+	const ScanImportOptions& options)
+{
+	auto start = Clock::now();
+	ScanImportStats stats;
+	std::string pathName = path.string();
+
+	MappedFile file;
+	if (!file.open(path))
+	{
+		throw std::runtime_error("Could not open PLY file " + pathName);
+	}
+
+	std::vector<PlyElement> elements;
+	bool bigEndian = false;
+	size_t offset = parsePlyHeader(file, pathName, elements, bigEndian);
+
+	bool hasVertices = false;
+	bool hasNormals = false;
+	vertices.clear();
+	indices.clear();
+	for (const PlyElement& element : elements)
+	{
+		bool fixedSize = true;
+		size_t recordSize = 0;
+		for (const PlyProperty& property : element.properties)
+		{
+			fixedSize = fixedSize && !property.list;
+			recordSize += getPlyTypeSize(property.type);
+		}
+
+		if (element.name == "vertex" && !hasVertices)
+		{
+			if (!fixedSize)
+			{
+				throw std::runtime_error("PLY vertices with list properties are not supported in " + pathName);
+			}
+			if (element.count > (file.size() - offset) / std::max<size_t>(recordSize, 1) || element.count > UINT32_MAX)
+			{
+				throw std::runtime_error("Truncated PLY file " + pathName);
+			}
+
+			// offsets of the attributes we know, -1 when missing
+			const char* names[9] = { "x", "y", "z", "nx", "ny", "nz", "red", "green", "blue" };
+			int offsets[9];
+			PlyType types[9];
+			std::fill(offsets, offsets + 9, -1);
+			std::fill(types, types + 9, PlyType::Float32);
+			size_t propertyOffset = 0;
+			for (const PlyProperty& property : element.properties)
+			{
+				for (size_t i = 0; i < 9; i++)
+				{
+					if (property.name == names[i])
+					{
+						offsets[i] = int(propertyOffset);
+						types[i] = property.type;
+					}
+				}
+				propertyOffset += getPlyTypeSize(property.type);
+			}
+			if (offsets[0] < 0 || offsets[1] < 0 || offsets[2] < 0)
+			{
+				throw std::runtime_error("PLY vertices without positions in " + pathName);
+			}
+			hasNormals = offsets[3] >= 0 && offsets[4] >= 0 && offsets[5] >= 0;
+			bool hasColors = offsets[6] >= 0 && offsets[7] >= 0 && offsets[8] >= 0;
+
+			vertices.resize(size_t(element.count));
+			decodeRecords(file, offset, vertices.size(), recordSize, options, [&](size_t index, const unsigned char* record) {
+				auto read = [&](size_t attribute) { return float(readPlyValue(record + offsets[attribute], types[attribute], bigEndian)); };
+
+				Vertex& vertex = vertices[index];
+				vertex.position = { read(0), read(1), -read(2) };
+				if (hasNormals)
+				{
+					vertex.normal = { read(3), read(4), -read(5) };
+				}
+				if (hasColors)
+				{
+					// integer colors are 0-255, floating point ones 0-1
+					float scale = types[6] == PlyType::Float32 || types[6] == PlyType::Float64 ? 1.0f : 1.0f / 255.0f;
+					vertex.color = glm::vec3(read(6), read(7), read(8)) * scale;
+				}
+				else
+				{
+					vertex.color = DEFAULT_COLOR;
+				}
+			});
+			offset += vertices.size() * recordSize;
+			hasVertices = true;
+		}
+		else if (element.name == "face")
+		{
+			size_t listIndex = element.properties.size();
+			for (size_t i = 0; i < element.properties.size(); i++)
+			{
+				const PlyProperty& property = element.properties[i];
+				if (property.list && (property.name == "vertex_indices" || property.name == "vertex_index"))
+				{
+					listIndex = i;
+				}
+			}
+			if (listIndex == element.properties.size())
+			{
+				throw std::runtime_error("PLY faces without vertex_indices in " + pathName);
+			}
+			PlyType indexType = element.properties[listIndex].type;
+			size_t indexSize = getPlyTypeSize(indexType);
+
+			// faces vary in size, so they are walked in order
+			size_t released = offset;
+			std::vector<unsigned> polygon;
+			for (uint64_t face = 0; face < element.count; face++)
+			{
+				offset = walkPlyRecord(file, offset, element, bigEndian, pathName, [&](size_t property, const unsigned char* data, size_t count) {
+					if (property != listIndex)
+					{
+						return;
+					}
+
+					polygon.resize(count);
+					for (size_t i = 0; i < count; i++)
+					{
+						double index = readPlyValue(data + i * indexSize, indexType, bigEndian);
+						if (index < 0 || index >= double(vertices.size()))
+						{
+							throw std::runtime_error("PLY face references a missing vertex in " + pathName);
+						}
+						polygon[i] = unsigned(index);
+					}
+				});
+
+				// a fan for polygons, flipped to clockwise
+				for (size_t i = 2; i < polygon.size(); i++)
+				{
+					indices.push_back(polygon[0]);
+					indices.push_back(polygon[i]);
+					indices.push_back(polygon[i - 1]);
+					stats.triangles++;
+				}
+				polygon.clear();
+
+				if (offset - released >= options.batchBytes)
+				{
+					file.release(released, offset - released);
+					released = offset;
+				}
+			}
+			file.release(released, offset - released);
+		}
+		else if (fixedSize)
+		{
+			if (element.count > (file.size() - offset) / std::max<size_t>(recordSize, 1))
+			{
+				throw std::runtime_error("Truncated PLY file " + pathName);
+			}
+			offset += size_t(element.count) * recordSize;
+		}
+		else
+		{
+			for (uint64_t record = 0; record < element.count; record++)
+			{
+				offset = walkPlyRecord(file, offset, element, bigEndian, pathName, [](size_t, const unsigned char*, size_t) {});
+			}
+		}
+	}
+
+	if (!hasVertices)
+	{
+		throw std::runtime_error("PLY file without vertices " + pathName);
+	}
+	stats.bytesRead = offset;
+	stats.sourceVertices = vertices.size();
+
+	if (options.weld)
+	{
+		auto weldStart = Clock::now();
+		std::vector<glm::vec3> positions(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			positions[i] = vertices[i].position;
+		}
+
+		WeldResult weld;
+		weldPositions(positions.data(), positions.size(), options.weldEpsilon, weld, options.jobs);
+
+		// representatives come in increasing order, so this compacts in place
+		for (size_t i = 0; i < weld.representatives.size(); i++)
+		{
+			vertices[i] = vertices[weld.representatives[i]];
+		}
+		vertices.resize(weld.representatives.size());
+		remapTriangles(indices, weld.remap, stats);
+		stats.weldSeconds = secondsSince(weldStart);
+	}
+
+	if (hasNormals)
+	{
+		for (auto& vertex : vertices)
+		{
+			float length = glm::length(vertex.normal);
+			vertex.normal = length > 0 ? vertex.normal / length : glm::vec3(0, 1, 0);
+		}
+	}
+	else
+	{
+		computeNormals(vertices, indices);
+	}
+
+	stats.vertices = vertices.size();
+	stats.readSeconds = secondsSince(start) - stats.weldSeconds;
+	return stats;
+}
+
+ScanImportStats importScan(const std::filesystem::path& path, std::vector<Vertex>& vertices, std::vector<unsigned>& indices,
+	const ScanImportOptions& options)
+{
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(tolower(c)); });
+
+	if (extension == ".stl")
+	{
+		return importStl(path, vertices, indices, options);
+	}
+	if (extension == ".ply")
+	{
+		return importPly(path, vertices, indices, options);
+	}
+	throw std::runtime_error("Not an STL or PLY file " + path.string());
+}
+
+void writeStl(const std::filesystem::path& path, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices)
+{
+	std::vector<unsigned char> data(STL_HEADER_SIZE + indices.size() / 3 * STL_TRIANGLE_SIZE, 0);
+	const char* header = "ModelViewer binary STL";
+	memcpy(data.data(), header, strlen(header));
+	uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	memcpy(data.data() + 80, &triangleCount, sizeof(triangleCount));
+
+	// right handed, counter clockwise
+	auto writeVector = [](unsigned char* target, const glm::vec3& value) {
+		float values[3] = { value.x, value.y, -value.z };
+		memcpy(target, values, sizeof(values));
+	};
+
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		unsigned char* record = data.data() + STL_HEADER_SIZE + triangle * STL_TRIANGLE_SIZE;
+		const glm::vec3& p1 = vertices[indices[triangle * 3]].position;
+		const glm::vec3& p2 = vertices[indices[triangle * 3 + 1]].position;
+		const glm::vec3& p3 = vertices[indices[triangle * 3 + 2]].position;
+
+		glm::vec3 cross = glm::cross(p2 - p1, p3 - p1);
+		writeVector(record, glm::dot(cross, cross) > 0 ? computeFaceNormal(p1, p2, p3) : glm::vec3(0, 0, 0));
+		writeVector(record + 12, p1);
+		writeVector(record + 24, p3);
+		writeVector(record + 36, p2);
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	if (!file)
+	{
+		throw std::runtime_error("Could not write STL file " + path.string());
+	}
+}
+
+void writePly(const std::filesystem::path& path, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices)
+{
+	std::ostringstream header;
+	header << "ply\n"
+		<< "format binary_little_endian 1.0\n"
+		<< "comment ModelViewer\n"
+		<< "element vertex " << vertices.size() << "\n"
+		<< "property float x\nproperty float y\nproperty float z\n"
+		<< "property float nx\nproperty float ny\nproperty float nz\n"
+		<< "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+		<< "element face " << indices.size() / 3 << "\n"
+		<< "property list uchar int vertex_indices\n"
+		<< "end_header\n";
+	std::string text = header.str();
+
+	const size_t vertexSize = 6 * sizeof(float) + 3;
+	const size_t faceSize = 1 + 3 * sizeof(int32_t);
+	std::vector<unsigned char> data(text.size() + vertices.size() * vertexSize + indices.size() / 3 * faceSize);
+	memcpy(data.data(), text.data(), text.size());
+
+	// right handed, counter clockwise
+	unsigned char* target = data.data() + text.size();
+	for (const Vertex& vertex : vertices)
+	{
+		float values[6] = { vertex.position.x, vertex.position.y, -vertex.position.z, vertex.normal.x, vertex.normal.y, -vertex.normal.z };
+		memcpy(target, values, sizeof(values));
+		target += sizeof(values);
+
+		glm::vec3 color = glm::clamp(vertex.color, 0.0f, 1.0f) * 255.0f + 0.5f;
+		*target++ = static_cast<unsigned char>(color.x);
+		*target++ = static_cast<unsigned char>(color.y);
+		*target++ = static_cast<unsigned char>(color.z);
+	}
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		int32_t face[3] = { int32_t(indices[i]), int32_t(indices[i + 2]), int32_t(indices[i + 1]) };
+		*target++ = 3;
+		memcpy(target, face, sizeof(face));
+		target += sizeof(face);
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	if (!file)
+	{
+		throw std::runtime_error("Could not write PLY file " + path.string());
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "Assets.h"
+#include "JobSystem.h"
+
+// Import of binary STL and PLY files, what scanning and CAD tools export.
+//
+// Both are read through a memory mapping a batch at a time, and the pages of every decoded batch are
+// released again, so the file itself never has to be resident at once. Positions are converted to
+// the engine's conventions like parseObj() does (Z is negated, triangles flipped to clockwise).
+//
+// STL stores three separate corners per triangle, so the corners are welded into shared vertices with
+// weldPositions(). PLY faces already share vertices, but scanners often duplicate them along the seams
+// of their patches, so they go through the same welding.
+
+struct ScanImportOptions
+{
+	// Positions closer than this, in model units, become one vertex. 0 only welds identical positions.
+	float weldEpsilon = 1e-5f;
+
+	// When false, STL triangles keep their own three vertices and PLY vertices are kept as they are
+	bool weld = true;
+
+	// Bytes of the file decoded before their pages are released
+	size_t batchBytes = 16 * 1024 * 1024;
+
+	// Decoding and welding are spread across this job system when set
+	JobSystem* jobs = nullptr;
+};
+
+struct ScanImportStats
+{
+	uint64_t bytesRead = 0;
+
+	// Triangles in the file, polygons count as the triangles of their fan
+	uint64_t triangles = 0;
+
+	// Vertices before and after welding
+	uint64_t sourceVertices = 0;
+	uint64_t vertices = 0;
+
+	// Triangles whose corners were welded together, these are dropped
+	uint64_t degenerateTriangles = 0;
+
+	double readSeconds = 0;
+	double weldSeconds = 0;
+
+	double getTrianglesPerSecond() const
+	{
+		double seconds = readSeconds + weldSeconds;
+		return seconds > 0 ? double(triangles) / seconds : 0;
+	}
+
+	// Fraction of the source vertices removed by welding
+	double getVertexReduction() const
+	{
+		return sourceVertices > 0 ? 1.0 - double(vertices) / double(sourceVertices) : 0;
+	}
+};
+
+// Reads a binary STL file. Facet normals are ignored, vertex normals are computed from the welded triangles.
+// Throws std::runtime_error if the file can't be read, is ASCII, or is truncated.
+ScanImportStats importStl(const std::filesystem::path& path, std::vector<Vertex>& vertices, std::vector<unsigned>& indices,
+	const ScanImportOptions& options = {});
+
+// Reads a binary PLY file (little or big endian) with a vertex element (x, y, z, and optionally nx, ny, nz and
+// red, green, blue) and a face element with a vertex_indices list. Other elements and properties are skipped.
+// Vertex normals are computed when the file has none.
+// Throws std::runtime_error if the file can't be read, is ASCII, or references vertices that don't exist.
+ScanImportStats importPly(const std::filesystem::path& path, std::vector<Vertex>& vertices, std::vector<unsigned>& indices,
+	const ScanImportOptions& options = {});
+
+// Calls importStl() or importPly() depending on the extension
+ScanImportStats importScan(const std::filesystem::path& path, std::vector<Vertex>& vertices, std::vector<unsigned>& indices,
+	const ScanImportOptions& options = {});
+
+// Writes a mesh (in the engine's left handed convention) as a binary STL file, in the right handed
+// convention other tools expect
+void writeStl(const std::filesystem::path& path, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices);
+
+// Writes a mesh as a binary little endian PLY file with positions, normals and colors, in the right handed
+// convention other tools expect
+void writePly(const std::filesystem::path& path, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices);
@@ -12,9 +12,29 @@ SceneObjectPtr Scene::createObject(const MeshResourcePtr& mesh)
 	}
 
 	this->objects.push_back(newObject);
+	listMemory.set(this->objects.capacity() * sizeof(SceneObjectPtr));
 	return newObject;
 }
 
+SceneObject* Scene::createObjects(size_t count)
+{
+	if (count == 0)
+	{
+		return nullptr;
+	}
+
+	// every object shares the block's reference count instead of having its own allocation
+	std::shared_ptr<SceneObject[]> block(new SceneObject[count]);
+
+	this->objects.reserve(this->objects.size() + count);
+	for (size_t i = 0; i < count; i++)
+	{
+		this->objects.push_back(SceneObjectPtr(block, &block[i]));
+	}
+	listMemory.set(this->objects.capacity() * sizeof(SceneObjectPtr));
+	return block.get();
+}
+
 void SceneObject::setPosition(const glm::vec3& position)
 {
 	worldPosition = position;
@@ -39,6 +59,20 @@ void SceneObject::setRotation(const glm::vec3& eulerAngles)
 	dirty = true;
 }
 
+void SceneObject::setRotation(const glm::quat& rotation)
+{
+	this->rotation = rotation;
+	dirty = true;
+}
+
+void SceneObject::setTransform(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	worldPosition = position;
+	this->rotation = rotation;
+	scaling = scale;
+	dirty = true;
+}
+
 void SceneObject::addRotation(const glm::vec3& eulerAngles)
 {
 	auto rotation = glm::quat(glm::radians(eulerAngles));
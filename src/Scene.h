@@ -26,6 +26,11 @@ public:
 	// Todo: Allow a <T> param to specify a class type. Make MeshResourcePtr optional.
 	SceneObjectPtr createObject(const MeshResourcePtr& mesh);
 
+	// Creates many objects at once, in a single allocation shared by all of them, and returns the first.
+	// They are contiguous: fill them in through the returned pointer, from index 0 to count - 1.
+	// The block is freed once the last of them is released.
+	SceneObject* createObjects(size_t count);
+
 	// Returns iterator to iterate over the list of registered objects.
 	std::vector<SceneObjectPtr>::const_iterator begin() const
 	{ 
@@ -36,9 +41,15 @@ public:
 	{
 		return this->objects.end();
 	}
+
+	// Returns the number of registered objects
+	size_t size() const { return this->objects.size(); }
 private:
 	// list of stored scene objects
 	std::vector<SceneObjectPtr> objects;
+
+	// memory used by the object list (the objects track themselves)
+	TrackedMemory listMemory{ MemoryTag::SceneObject };
 };
 
 // Represents an object in a scene. Must be created via Scene::createObject.
@@ -82,6 +93,12 @@ public:
 		this->setRotation({ x, y, z });
 	}
 
+	// Sets the rotation from a unit quaternion
+	void setRotation(const glm::quat& rotation);
+
+	// Sets the position, rotation and scaling at once
+	void setTransform(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
 	// Further rotates this object by an additional amount.
 	// If the object hasn't been rotated yet, it is equal to setRotation().
 	void addRotation(const glm::vec3& eulerAngles);
@@ -136,4 +153,6 @@ private:
 	glm::vec3 worldPosition = { 0, 0, 0 };
 	glm::vec3 scaling = { 1, 1, 1 };
 	glm::quat rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
+
+	TrackedMemory memory{ MemoryTag::SceneObject, sizeof(SceneObject) };
 };
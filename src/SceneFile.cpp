@@ -0,0 +1,180 @@
+#include "SceneFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+uint32_t SceneFileWriter::addMesh(const std::string& name)
+{
+	auto found = meshIndices.find(name);
+	if (found != meshIndices.end())
+	{
+		return found->second;
+	}
+
+	SceneFileMesh mesh;
+	mesh.nameOffset = static_cast<uint32_t>(names.size());
+	mesh.nameLength = static_cast<uint32_t>(name.size());
+	names += name;
+
+	uint32_t index = static_cast<uint32_t>(meshes.size());
+	meshes.push_back(mesh);
+	meshIndices.emplace(name, index);
+	return index;
+}
+
+uint32_t SceneFileWriter::addObject(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale,
+	uint32_t mesh, uint32_t parent)
+{
+	if (mesh != SCENE_NO_INDEX && mesh >= meshes.size())
+	{
+		throw std::runtime_error("Scene object uses a mesh that wasn't added");
+	}
+	if (parent != SCENE_NO_INDEX && parent >= objects.size())
+	{
+		throw std::runtime_error("Scene object's parent must be added before it");
+	}
+
+	glm::vec3 worldPosition = position;
+	glm::quat worldRotation = rotation;
+	glm::vec3 worldScale = scale;
+	if (parent != SCENE_NO_INDEX)
+	{
+		// the parent is already in world space
+		const SceneFileObject& p = objects[parent];
+		glm::quat parentRotation(p.rotation[3], p.rotation[0], p.rotation[1], p.rotation[2]);
+		worldPosition = p.position + parentRotation * (p.scale * position);
+		worldRotation = parentRotation * rotation;
+		worldScale = p.scale * scale;
+	}
+
+	SceneFileObject object;
+	object.position = worldPosition;
+	object.rotation[0] = worldRotation.x;
+	object.rotation[1] = worldRotation.y;
+	object.rotation[2] = worldRotation.z;
+	object.rotation[3] = worldRotation.w;
+	object.scale = worldScale;
+	object.mesh = mesh;
+	object.parent = parent;
+
+	objects.push_back(object);
+	return static_cast<uint32_t>(objects.size() - 1);
+}
+
+void SceneFileWriter::write(const std::filesystem::path& path) const
+{
+	SceneFileHeader header;
+	std::memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+	header.version = SCENE_FILE_VERSION;
+	header.objectCount = static_cast<uint32_t>(objects.size());
+	header.meshCount = static_cast<uint32_t>(meshes.size());
+	header.objectOffset = sizeof(SceneFileHeader);
+	header.meshOffset = header.objectOffset + objects.size() * sizeof(SceneFileObject);
+	header.namesOffset = header.meshOffset + meshes.size() * sizeof(SceneFileMesh);
+	header.namesBytes = names.size();
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		throw std::runtime_error("Could not create scene file " + path.string());
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(objects.data()), objects.size() * sizeof(SceneFileObject));
+	file.write(reinterpret_cast<const char*>(meshes.data()), meshes.size() * sizeof(SceneFileMesh));
+	file.write(names.data(), names.size());
+	if (!file)
+	{
+		throw std::runtime_error("Could not write scene file " + path.string());
+	}
+}
+
+SceneFile::SceneFile(const std::filesystem::path& path)
+{
+	if (!file.open(path) || file.size() < sizeof(SceneFileHeader))
+	{
+		throw std::runtime_error("Could not read scene file " + path.string());
+	}
+
+	header = reinterpret_cast<const SceneFileHeader*>(file.data());
+	if (std::memcmp(header->magic, SCENE_FILE_MAGIC, sizeof(header->magic)) != 0 || header->version != SCENE_FILE_VERSION)
+	{
+		throw std::runtime_error("Not a supported scene file " + path.string());
+	}
+
+	// every table must lie inside the file, aligned for its records
+	uint64_t size = file.size();
+	bool valid = header->objectOffset % alignof(SceneFileObject) == 0
+		&& header->meshOffset % alignof(SceneFileMesh) == 0
+		&& header->objectOffset <= size && uint64_t(header->objectCount) * sizeof(SceneFileObject) <= size - header->objectOffset
+		&& header->meshOffset <= size && uint64_t(header->meshCount) * sizeof(SceneFileMesh) <= size - header->meshOffset
+		&& header->namesOffset <= size && header->namesBytes <= size - header->namesOffset;
+	if (!valid)
+	{
+		throw std::runtime_error("Scene file is truncated or corrupt " + path.string());
+	}
+
+	objects = reinterpret_cast<const SceneFileObject*>(file.data() + header->objectOffset);
+	meshes = reinterpret_cast<const SceneFileMesh*>(file.data() + header->meshOffset);
+	names = reinterpret_cast<const char*>(file.data() + header->namesOffset);
+
+	for (uint32_t i = 0; i < header->meshCount; i++)
+	{
+		if (meshes[i].nameOffset > header->namesBytes || meshes[i].nameLength > header->namesBytes - meshes[i].nameOffset)
+		{
+			throw std::runtime_error("Scene file has a mesh name outside of its names " + path.string());
+		}
+	}
+
+	// checked here, so instantiating can't fail halfway
+	for (uint32_t i = 0; i < header->objectCount; i++)
+	{
+		if ((objects[i].mesh != SCENE_NO_INDEX && objects[i].mesh >= header->meshCount)
+			|| (objects[i].parent != SCENE_NO_INDEX && objects[i].parent >= i))
+		{
+			throw std::runtime_error("Scene file has an object with an invalid mesh or parent " + path.string());
+		}
+	}
+}
+
+std::string SceneFile::getMeshName(uint32_t mesh) const
+{
+	return std::string(names + meshes[mesh].nameOffset, meshes[mesh].nameLength);
+}
+
+SceneObject* SceneFile::instantiate(Scene& scene, const std::vector<MeshResourcePtr>& meshResources) const
+{
+	if (meshResources.size() < header->meshCount)
+	{
+		throw std::runtime_error("Scene file needs more meshes than were given");
+	}
+
+	uint32_t count = header->objectCount;
+	SceneObject* created = scene.createObjects(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const SceneFileObject& source = objects[i];
+		SceneObject& object = created[i];
+
+		if (source.mesh != SCENE_NO_INDEX)
+		{
+			object.mesh = meshResources[source.mesh];
+		}
+
+		glm::quat rotation(source.rotation[3], source.rotation[0], source.rotation[1], source.rotation[2]);
+		object.setTransform(source.position, rotation, source.scale);
+	}
+	return created;
+}
+
+SceneObject* SceneFile::instantiate(Scene& scene, const std::function<MeshResourcePtr(const std::string& name)>& loadMesh) const
+{
+	std::vector<MeshResourcePtr> meshResources;
+	meshResources.reserve(header->meshCount);
+	for (uint32_t i = 0; i < header->meshCount; i++)
+	{
+		meshResources.push_back(loadMesh(getMeshName(i)));
+	}
+	return instantiate(scene, meshResources);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Scene.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/vec3.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+// Layout of the binary scene files (.mvscene) written by SceneFileWriter and read by SceneFile.
+//
+// The object table is an array of fixed size records in the layout they are used in, so a loaded
+// file is mapped and its objects copied straight into the scene, without parsing anything.
+// Meshes are referenced by index into a table of unique names (paths under assets/models), so
+// a mesh used by many objects is loaded once.
+//
+//   SceneFileHeader | SceneFileObject[objectCount] | SceneFileMesh[meshCount] | names
+
+const char SCENE_FILE_MAGIC[4] = { 'M', 'V', 'S', 'C' };
+const uint32_t SCENE_FILE_VERSION = 1;
+
+// Marks an object without a mesh or without a parent
+const uint32_t SCENE_NO_INDEX = 0xFFFFFFFF;
+
+struct SceneFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t objectCount;
+	uint32_t meshCount;
+	uint64_t objectOffset;
+	uint64_t meshOffset;
+	uint64_t namesOffset;
+	uint64_t namesBytes;
+};
+
+struct SceneFileMesh
+{
+	uint32_t nameOffset;
+	uint32_t nameLength;
+};
+
+// An object with its transform in world space, resolved through its parents by the writer.
+// Parents come before their children; the parent is kept so tools can rebuild the hierarchy.
+struct SceneFileObject
+{
+	glm::vec3 position;
+
+	// Unit quaternion as x, y, z, w
+	float rotation[4];
+
+	glm::vec3 scale;
+	uint32_t mesh;
+	uint32_t parent;
+};
+
+static_assert(sizeof(SceneFileObject) == 48, "Scene files store SceneFileObject directly");
+
+// Builds a scene file. Objects are given in their parent's space and written in world space.
+class SceneFileWriter
+{
+public:
+	// Returns the index of a mesh, adding it the first time a name is seen
+	uint32_t addMesh(const std::string& name);
+
+	// Adds an object and returns its index, to be used as the parent of later objects.
+	// Pass SCENE_NO_INDEX for no mesh or no parent. The parent must already be added.
+	// Parents with a non uniform scale are approximated: children are scaled along their own axes.
+	uint32_t addObject(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale,
+		uint32_t mesh = SCENE_NO_INDEX, uint32_t parent = SCENE_NO_INDEX);
+
+	size_t getObjectCount() const { return objects.size(); }
+	size_t getMeshCount() const { return meshes.size(); }
+
+	// Writes the file. Throws std::runtime_error if it can't be written.
+	void write(const std::filesystem::path& path) const;
+
+private:
+	std::vector<SceneFileObject> objects;
+	std::vector<SceneFileMesh> meshes;
+	std::string names;
+	std::unordered_map<std::string, uint32_t> meshIndices;
+};
+
+// A scene file mapped into memory
+class SceneFile
+{
+public:
+	// Maps a file and checks its tables. Throws std::runtime_error if it can't be read or is corrupt.
+	explicit SceneFile(const std::filesystem::path& path);
+
+	uint32_t getObjectCount() const { return header->objectCount; }
+	uint32_t getMeshCount() const { return header->meshCount; }
+
+	// Objects as stored in the file, parents before children
+	const SceneFileObject* getObjects() const { return objects; }
+
+	std::string getMeshName(uint32_t mesh) const;
+
+	// Creates every object in the scene in one block, with meshes[i] for the objects using mesh i.
+	// Returns the first of the new objects.
+	SceneObject* instantiate(Scene& scene, const std::vector<MeshResourcePtr>& meshes) const;
+
+	// Same, loading each mesh once by name
+	SceneObject* instantiate(Scene& scene, const std::function<MeshResourcePtr(const std::string& name)>& loadMesh) const;
+
+private:
+	MappedFile file;
+	const SceneFileHeader* header = nullptr;
+	const SceneFileObject* objects = nullptr;
+	const SceneFileMesh* meshes = nullptr;
+	const char* names = nullptr;
+};
@@ -0,0 +1,257 @@
+#include "ShaderCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const char ENTRY_MAGIC[4] = { 'M', 'V', 'S', 'C' };
+	const uint32_t ENTRY_VERSION = 1;
+
+	// Header written in front of the bytecode of every cache entry
+	struct EntryHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t keyHigh;
+		uint64_t keyLow;
+		uint64_t size;
+		uint64_t checksum;
+	};
+
+	bool readFile(const fs::path& path, std::string& text)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+
+		std::ostringstream contents;
+		contents << file.rdbuf();
+		text = contents.str();
+		return true;
+	}
+
+	// Returns the file named by an #include directive on this line, or an empty string
+	std::string parseInclude(const std::string& line)
+	{
+		size_t pos = line.find_first_not_of(" \t");
+		if (pos == std::string::npos || line[pos] != '#')
+		{
+			return "";
+		}
+
+		pos = line.find_first_not_of(" \t", pos + 1);
+		if (pos == std::string::npos || line.compare(pos, 7, "include") != 0)
+		{
+			return "";
+		}
+
+		size_t open = line.find_first_of("\"<", pos + 7);
+		if (open == std::string::npos)
+		{
+			return "";
+		}
+
+		char closing = line[open] == '"' ? '"' : '>';
+		size_t close = line.find(closing, open + 1);
+		if (close == std::string::npos)
+		{
+			return "";
+		}
+
+		return line.substr(open + 1, close - open - 1);
+	}
+
+	void collectRecursive(const fs::path& path, std::set<fs::path>& visited, std::vector<ShaderSourceFile>& sources)
+	{
+		fs::path normalized = path.lexically_normal();
+		if (!visited.insert(normalized).second)
+		{
+			return;
+		}
+
+		ShaderSourceFile source;
+		source.path = normalized;
+		if (!readFile(normalized, source.text))
+		{
+			return;
+		}
+
+		// keep a copy, the vector may reallocate while recursing
+		std::string text = source.text;
+		sources.push_back(std::move(source));
+
+		std::istringstream lines(text);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			std::string include = parseInclude(line);
+			if (!include.empty())
+			{
+				collectRecursive(normalized.parent_path() / include, visited, sources);
+			}
+		}
+	}
+
+	// Returns a name no other thread or process will pick for its temporary file
+	std::string uniqueSuffix()
+	{
+		static std::atomic<uint64_t> counter{ 0 };
+
+		Hasher hasher;
+		hasher.updateValue(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+		hasher.updateValue(std::hash<std::thread::id>()(std::this_thread::get_id()));
+		hasher.updateValue(counter.fetch_add(1));
+		hasher.updateValue(&counter); // differs between processes with address randomization
+		return hasher.finish().toHex().substr(0, 16);
+	}
+}
+
+std::vector<ShaderSourceFile> collectShaderSources(const std::filesystem::path& path)
+{
+	std::set<fs::path> visited;
+	std::vector<ShaderSourceFile> sources;
+	collectRecursive(path, visited, sources);
+	return sources;
+}
+
+ContentHash computeShaderKey(const ShaderCompileRequest& request, const std::vector<ShaderSourceFile>& sources)
+{
+	Hasher hasher;
+	hasher.update(std::string("shader-cache-v1"));
+
+	// file names but not full paths, so moving the project keeps the cache valid
+	for (auto& source : sources)
+	{
+		hasher.update(source.path.filename().generic_string());
+		hasher.update(source.text);
+	}
+
+	hasher.update(request.entryPoint);
+	hasher.update(request.target);
+	hasher.updateValue(request.flags);
+	hasher.update(request.compilerId);
+	return hasher.finish();
+}
+
+ShaderCache::ShaderCache(const std::filesystem::path& directory) : directory{ directory }
+{
+}
+
+std::filesystem::path ShaderCache::getEntryPath(const ContentHash& key) const
+{
+	return directory / (key.toHex() + ".cso");
+}
+
+bool ShaderCache::load(const ContentHash& key, std::vector<char>& bytecode) const
+{
+	fs::path path = getEntryPath(key);
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	EntryHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+	{
+		return false;
+	}
+
+	if (std::memcmp(header.magic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC)) != 0 || header.version != ENTRY_VERSION
+		|| header.keyHigh != key.high || header.keyLow != key.low)
+	{
+		return false;
+	}
+
+	// a truncated or corrupted entry must not make us allocate whatever size it claims
+	std::error_code error;
+	uintmax_t fileSize = fs::file_size(path, error);
+	if (error || header.size > fileSize - sizeof(header))
+	{
+		return false;
+	}
+
+	std::vector<char> data(static_cast<size_t>(header.size));
+	if (!file.read(data.data(), data.size()))
+	{
+		return false;
+	}
+
+	if (hash64(data.data(), data.size()) != header.checksum)
+	{
+		return false;
+	}
+
+	bytecode = std::move(data);
+	return true;
+}
+
+void ShaderCache::store(const ContentHash& key, const std::vector<char>& bytecode) const
+{
+	std::error_code error;
+	fs::create_directories(directory, error);
+
+	fs::path finalPath = getEntryPath(key);
+	fs::path tempPath = finalPath;
+	tempPath += ".tmp" + uniqueSuffix();
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return;
+		}
+
+		EntryHeader header;
+		std::memcpy(header.magic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+		header.version = ENTRY_VERSION;
+		header.keyHigh = key.high;
+		header.keyLow = key.low;
+		header.size = bytecode.size();
+		header.checksum = hash64(bytecode.data(), bytecode.size());
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(bytecode.data(), bytecode.size());
+		if (!file)
+		{
+			file.close();
+			fs::remove(tempPath, error);
+			return;
+		}
+	}
+
+	// Atomic replace. If another process won the race the entry holds the same bytecode,
+	// so losing (eg. the file is open on windows) is fine.
+	fs::rename(tempPath, finalPath, error);
+	if (error)
+	{
+		fs::remove(tempPath, error);
+	}
+}
+
+std::vector<char> ShaderCache::getOrCompile(const ShaderCompileRequest& request, const Compiler& compiler)
+{
+	auto sources = collectShaderSources(request.path);
+	ContentHash key = computeShaderKey(request, sources);
+
+	std::vector<char> bytecode;
+	if (load(key, bytecode))
+	{
+		hits++;
+		return bytecode;
+	}
+
+	misses++;
+	bytecode = compiler(request);
+	store(key, bytecode);
+	return bytecode;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Hash.h"
+
+// A shader source file read from disk
+struct ShaderSourceFile
+{
+	std::filesystem::path path;
+	std::string text;
+};
+
+// Everything that determines the bytecode of a compiled shader
+struct ShaderCompileRequest
+{
+	std::filesystem::path path;
+	std::string entryPoint = "main";
+	std::string target;
+	unsigned flags = 0;
+
+	// Identifies the compiler (eg. its version), so upgrading it invalidates the cache
+	std::string compilerId;
+};
+
+// Reads a shader and, recursively, every file it includes with #include "file" or #include <file>.
+// Includes are resolved relative to the including file, like D3D_COMPILE_STANDARD_FILE_INCLUDE.
+// The main file comes first, followed by the includes in the order they were found, each listed once.
+// Includes that cannot be found are skipped, the compiler reports them.
+std::vector<ShaderSourceFile> collectShaderSources(const std::filesystem::path& path);
+
+// Returns the cache key of a request: a hash of the main source, all resolved includes,
+// the entry point, target profile, compile flags and compiler id.
+ContentHash computeShaderKey(const ShaderCompileRequest& request, const std::vector<ShaderSourceFile>& sources);
+
+// Content addressed on-disk cache of compiled shader bytecode.
+// Entries are written to a temporary file and renamed into place, so several processes may
+// share the directory: readers see either no entry or a complete one. Entries carry a checksum
+// and damaged ones are treated as missing.
+class ShaderCache
+{
+public:
+	// Turns a request into bytecode. Throws on compile errors.
+	typedef std::function<std::vector<char>(const ShaderCompileRequest&)> Compiler;
+
+	explicit ShaderCache(const std::filesystem::path& directory);
+
+	// Returns the bytecode for a request, from the cache if the sources and settings are unchanged,
+	// otherwise by calling the compiler and storing the result.
+	std::vector<char> getOrCompile(const ShaderCompileRequest& request, const Compiler& compiler);
+
+	// Reads an entry. Returns false if it doesn't exist or is damaged.
+	bool load(const ContentHash& key, std::vector<char>& bytecode) const;
+
+	// Writes an entry atomically. Failures are ignored, the cache is only an optimization.
+	void store(const ContentHash& key, const std::vector<char>& bytecode) const;
+
+	// Returns the file an entry is stored in
+	std::filesystem::path getEntryPath(const ContentHash& key) const;
+
+	size_t getHitCount() const { return hits; }
+	size_t getMissCount() const { return misses; }
+
+private:
+	std::filesystem::path directory;
+
+	std::atomic<size_t> hits{ 0 };
+	std::atomic<size_t> misses{ 0 };
+};
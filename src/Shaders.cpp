@@ -1,7 +1,9 @@
 #include "Shaders.h"
+#include "ShaderCache.h"
+#include "Logger.h"
 
-#include <iostream>
 #include <filesystem>
+#include <cstring>
 
 using namespace std;
 using Microsoft::WRL::ComPtr;
@@ -21,31 +23,54 @@ ComPtr<ID3DBlob> loadShader(const std::string& relativePath, const char* target,
 	if (!filesystem::exists(path))
 	{
 		std::string msg("Could not find shader file " + path.string());
-		std::cout << msg << endl;
+		LOG_ERROR("{}", msg);
 		throw std::exception(msg.c_str());
 	}
 
-	cout << "Compiling Shader " << relativePath << endl;
-
+	// Compiled bytecode is cached in the working directory, keyed by the sources and compile settings
+	static ShaderCache cache(filesystem::current_path() / "shadercache");
+
+	ShaderCompileRequest request;
+	request.path = path;
+	request.entryPoint = entryPoint;
+	request.target = target;
+	request.flags = compileFlags;
+	request.compilerId = "d3dcompiler_" + std::to_string(D3D_COMPILER_VERSION);
+
+	auto bytecode = cache.getOrCompile(request, [&](const ShaderCompileRequest& request) {
+		LOG_INFO("Compiling Shader {}", relativePath);
+
+		ComPtr<ID3DBlob> compiledShader;
+		ComPtr<ID3DBlob> errors;
+		HRESULT result = D3DCompileFromFile(
+			request.path.wstring().c_str(),
+			nullptr,
+			D3D_COMPILE_STANDARD_FILE_INCLUDE,
+			request.entryPoint.c_str(),
+			request.target.c_str(),
+			request.flags,
+			0,
+			compiledShader.GetAddressOf(),
+			errors.GetAddressOf());
+
+		if (FAILED(result))
+		{
+			const char* errorString = static_cast<const char*>(errors->GetBufferPointer());
+			LOG_ERROR("{}: {}", relativePath, errorString);
+			throw std::exception(errorString);
+		}
+
+		const char* data = static_cast<const char*>(compiledShader->GetBufferPointer());
+		return std::vector<char>(data, data + compiledShader->GetBufferSize());
+	});
+
+	// Wrap the bytecode in a blob, which is what the shader creation functions expect
 	ComPtr<ID3DBlob> compiledShader;
-	ComPtr<ID3DBlob> errors;
-	HRESULT result = D3DCompileFromFile(
-		path.wstring().c_str(),
-		nullptr,
-		D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		entryPoint,
-		target,
-		compileFlags,
-		0,
-		compiledShader.GetAddressOf(),
-		errors.GetAddressOf());
-
-	if (FAILED(result))
+	if (FAILED(D3DCreateBlob(bytecode.size(), compiledShader.GetAddressOf())))
 	{
-		const char* errorString = static_cast<const char*>(errors->GetBufferPointer());
-		std::cerr << "ERROR: " << relativePath << ": " << errorString << std::endl;
-		throw std::exception(errorString);
+		throw std::exception("Could not allocate shader blob");
 	}
+	std::memcpy(compiledShader->GetBufferPointer(), bytecode.data(), bytecode.size());
 
 	return compiledShader;
 }
@@ -54,6 +79,7 @@ VertexShaderPtr loadVertexShader(ID3D11Device* device, const std::string& relati
 {
 	VertexShaderPtr shader(new VertexShader());
 	shader->shaderBuffer = loadShader(relativePath, "vs_5_0", entryPoint.c_str());
+	shader->blobMemory.set(shader->shaderBuffer->GetBufferSize());
 
 	HRESULT result;
 	// todo: do something with result
@@ -91,6 +117,7 @@ PixelShaderPtr loadPixelShader(ID3D11Device* device, const std::string& relative
 {
 	PixelShaderPtr shader(new PixelShader());
 	shader->shaderBuffer = loadShader(relativePath, "ps_5_0", entryPoint.c_str());
+	shader->blobMemory.set(shader->shaderBuffer->GetBufferSize());
 
 	HRESULT result = device->CreatePixelShader(
 		shader->shaderBuffer->GetBufferPointer(),
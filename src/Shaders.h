@@ -7,6 +7,8 @@
 #include <string>
 #include <memory>
 
+#include "MemoryStats.h"
+
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
 #pragma comment(lib, "dxguid.lib")
@@ -19,12 +21,16 @@ struct VertexShader
 	ComPtr<ID3D11VertexShader> shader;
 	ComPtr<ID3DBlob> shaderBuffer;
 	ComPtr<ID3D11InputLayout> inputLayout;
+
+	TrackedMemory blobMemory{ MemoryTag::ShaderBlob };
 };
 
 struct PixelShader
 {
 	ComPtr<ID3D11PixelShader> shader;
 	ComPtr<ID3DBlob> shaderBuffer;
+
+	TrackedMemory blobMemory{ MemoryTag::ShaderBlob };
 };
 
 
@@ -0,0 +1,147 @@
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	uint32_t packColor(const glm::vec4& color)
+	{
+		auto channel = [](float value) {
+			return static_cast<uint32_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+		};
+		return channel(color.x) | channel(color.y) << 8 | channel(color.z) << 16 | channel(color.w) << 24;
+	}
+
+	// Twice the signed area of a, b, p. Positive when the three are clockwise on screen (y down).
+	float edge(float ax, float ay, float bx, float by, float px, float py)
+	{
+		return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+	}
+}
+
+SoftwareRasterizer::SoftwareRasterizer(unsigned width, unsigned height) :
+	width{ width }, height{ height }, color(size_t(width) * height), depth(size_t(width) * height)
+{
+	clear({ 0, 0, 0, 1 });
+}
+
+void SoftwareRasterizer::clear(const glm::vec4& clearColor)
+{
+	color.assign(size_t(width) * height, packColor(clearColor));
+	depth.assign(size_t(width) * height, 1.0f);
+	drawnTriangles = 0;
+}
+
+void SoftwareRasterizer::setLightDirection(const glm::vec3& direction)
+{
+	lightDirection = glm::normalize(direction);
+}
+
+void SoftwareRasterizer::draw(const MeshResource& mesh, const glm::mat4x4& model, const glm::mat4x4& viewProjection)
+{
+	glm::mat4x4 modelViewProjection = viewProjection * model;
+	glm::vec3 toLight = -lightDirection;
+
+	// transform and light every vertex once
+	screenVertices.resize(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		const Vertex& vertex = mesh.vertices[i];
+		glm::vec4 clip = modelViewProjection * glm::vec4(vertex.position, 1.0f);
+		ScreenVertex& screen = screenVertices[i];
+
+		screen.visible = clip.w > 1e-6f && clip.z >= 0.0f;
+		float inverseW = screen.visible ? 1.0f / clip.w : 0.0f;
+		screen.x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+		screen.y = (0.5f - clip.y * inverseW * 0.5f) * height;
+		screen.z = clip.z * inverseW;
+
+		glm::vec4 normal = model * glm::vec4(vertex.normal, 0.0f);
+		float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+		float lambert = length > 0 ? (normal.x * toLight.x + normal.y * toLight.y + normal.z * toLight.z) / length : 0.0f;
+		screen.intensity = ambient + (1.0f - ambient) * std::max(lambert, 0.0f);
+	}
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		const ScreenVertex& a = screenVertices[mesh.indices[i]];
+		const ScreenVertex& b = screenVertices[mesh.indices[i + 1]];
+		const ScreenVertex& c = screenVertices[mesh.indices[i + 2]];
+		if (a.visible && b.visible && c.visible)
+		{
+			drawTriangle(a, b, c);
+		}
+	}
+}
+
+void SoftwareRasterizer::drawTriangle(const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c)
+{
+	// back faces (counter clockwise) and degenerate triangles are culled
+	float area = edge(a.x, a.y, b.x, b.y, c.x, c.y);
+	if (area <= 0)
+	{
+		return;
+	}
+
+	int minX = std::max(static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))), 0);
+	int maxX = std::min(static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))), static_cast<int>(width) - 1);
+	int minY = std::max(static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))), 0);
+	int maxY = std::min(static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))), static_cast<int>(height) - 1);
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+
+	// edge functions at the first pixel center, stepped per pixel
+	float inverseArea = 1.0f / area;
+	float startX = minX + 0.5f;
+	float startY = minY + 0.5f;
+	float rowA = edge(b.x, b.y, c.x, c.y, startX, startY);
+	float rowB = edge(c.x, c.y, a.x, a.y, startX, startY);
+	float rowC = edge(a.x, a.y, b.x, b.y, startX, startY);
+	float stepXA = -(c.y - b.y), stepYA = c.x - b.x;
+	float stepXB = -(a.y - c.y), stepYB = a.x - c.x;
+	float stepXC = -(b.y - a.y), stepYC = b.x - a.x;
+
+	bool covered = false;
+	for (int y = minY; y <= maxY; y++)
+	{
+		float weightA = rowA;
+		float weightB = rowB;
+		float weightC = rowC;
+		size_t offset = size_t(y) * width;
+
+		for (int x = minX; x <= maxX; x++)
+		{
+			if (weightA >= 0 && weightB >= 0 && weightC >= 0)
+			{
+				float u = weightA * inverseArea;
+				float v = weightB * inverseArea;
+				float w = weightC * inverseArea;
+				float z = u * a.z + v * b.z + w * c.z;
+
+				if (z < depth[offset + x])
+				{
+					depth[offset + x] = z;
+					float intensity = u * a.intensity + v * b.intensity + w * c.intensity;
+					color[offset + x] = packColor(glm::vec4(surfaceColor * intensity, 1.0f));
+					covered = true;
+				}
+			}
+
+			weightA += stepXA;
+			weightB += stepXB;
+			weightC += stepXC;
+		}
+
+		rowA += stepYA;
+		rowB += stepYB;
+		rowC += stepYC;
+	}
+
+	if (covered)
+	{
+		drawnTriangles++;
+	}
+}
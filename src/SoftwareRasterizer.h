@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Assets.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+// Draws meshes into an RGBA image on the CPU, for rendering without a GPU (eg. thumbnails on servers).
+// Follows the viewer's conventions: clockwise front faces, depth from 0 (near) to 1 (far).
+// Shading is a single directional light plus ambient, evaluated per vertex.
+class SoftwareRasterizer
+{
+public:
+	SoftwareRasterizer(unsigned width, unsigned height);
+
+	// Fills the image with a color (RGBA, 0..1) and resets the depth
+	void clear(const glm::vec4& color);
+
+	// Sets the direction the light travels in, in world space
+	void setLightDirection(const glm::vec3& direction);
+
+	// Draws the CPU vertices and indices of a mesh. Triangles crossing the near plane are skipped.
+	void draw(const MeshResource& mesh, const glm::mat4x4& model, const glm::mat4x4& viewProjection);
+
+	unsigned getWidth() const { return width; }
+	unsigned getHeight() const { return height; }
+
+	// Pixels as 8 bit RGBA, rows top to bottom
+	const uint8_t* getPixels() const { return reinterpret_cast<const uint8_t*>(color.data()); }
+
+	// Moves the image out, the rasterizer must be cleared before drawing again
+	std::vector<uint32_t> takePixels() { return std::move(color); }
+
+	// Triangles that covered at least one pixel since the last clear
+	size_t getDrawnTriangles() const { return drawnTriangles; }
+
+private:
+	struct ScreenVertex
+	{
+		float x;
+		float y;
+		float z;
+		float intensity;
+		bool visible;
+	};
+
+	void drawTriangle(const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c);
+
+	unsigned width;
+	unsigned height;
+	std::vector<uint32_t> color;
+	std::vector<float> depth;
+
+	glm::vec3 lightDirection = { 0.0f, -0.5f, 1.0f };
+	glm::vec3 surfaceColor = { 0.8f, 0.78f, 0.76f };
+	float ambient = 0.2f;
+
+	// transformed vertices of the mesh being drawn, kept to avoid reallocating
+	std::vector<ScreenVertex> screenVertices;
+
+	size_t drawnTriangles = 0;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Fixed size lock-free ring buffer for a single producer thread and a single consumer thread.
+// push() may only be called by the producer and pop() only by the consumer.
+// Capacity must be a power of two; one slot is never used to tell full and empty apart.
+template <typename T, size_t Capacity>
+class SpscRing
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+	// Adds an item. Returns false (and drops the item) if the ring is full.
+	bool push(const T& item)
+	{
+		size_t head = this->head.load(std::memory_order_relaxed);
+		size_t next = (head + 1) & MASK;
+		if (next == cachedTail)
+		{
+			// refresh our view of the consumer before giving up
+			cachedTail = this->tail.load(std::memory_order_acquire);
+			if (next == cachedTail)
+			{
+				return false;
+			}
+		}
+
+		items[head] = item;
+		this->head.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// Returns the slot the next item goes into, or null if the ring is full. Fill it, then call publish().
+	// Lets the producer build large items in place instead of copying them in.
+	T* acquire()
+	{
+		size_t head = this->head.load(std::memory_order_relaxed);
+		size_t next = (head + 1) & MASK;
+		if (next == cachedTail)
+		{
+			cachedTail = this->tail.load(std::memory_order_acquire);
+			if (next == cachedTail)
+			{
+				return nullptr;
+			}
+		}
+		return &items[head];
+	}
+
+	// Makes the item filled after acquire() visible to the consumer
+	void publish()
+	{
+		size_t head = this->head.load(std::memory_order_relaxed);
+		this->head.store((head + 1) & MASK, std::memory_order_release);
+	}
+
+	// Removes the oldest item into the given reference. Returns false if the ring is empty.
+	bool pop(T& item)
+	{
+		size_t tail = this->tail.load(std::memory_order_relaxed);
+		if (tail == cachedHead)
+		{
+			cachedHead = this->head.load(std::memory_order_acquire);
+			if (tail == cachedHead)
+			{
+				return false;
+			}
+		}
+
+		item = items[tail];
+		this->tail.store((tail + 1) & MASK, std::memory_order_release);
+		return true;
+	}
+
+	// Returns true if there is nothing to pop. Only exact when called from the consumer.
+	bool empty() const
+	{
+		return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+	}
+
+	// Maximum number of items the ring can hold at once
+	static constexpr size_t capacity() { return Capacity - 1; }
+
+private:
+	static const size_t MASK = Capacity - 1;
+
+	// Producer and consumer data are kept on separate cache lines to avoid false sharing
+	alignas(64) std::atomic<size_t> head{ 0 };
+	size_t cachedTail = 0;
+
+	alignas(64) std::atomic<size_t> tail{ 0 };
+	size_t cachedHead = 0;
+
+	alignas(64) std::array<T, Capacity> items;
+};
@@ -0,0 +1,198 @@
+#include "StressScene.h"
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace
+{
+	const float PI = 3.14159265358979f;
+
+	// Animated objects pick one of these, so clips are shared like the meshes
+	const unsigned CLIP_VARIANTS = 4;
+	const float CLIP_SECONDS = 4.0f;
+
+	// A full turn around y while bobbing, around the origin. Played with each object's position as the offset.
+	std::shared_ptr<const SampledClip> createSpinClip(unsigned variant, float scale)
+	{
+		AnimationClip clip;
+		clip.duration = CLIP_SECONDS;
+
+		TransformTrack track;
+		for (int key = 0; key <= 8; key++)
+		{
+			float time = CLIP_SECONDS * key / 8.0f;
+			float angle = 2.0f * PI * key / 8.0f;
+			track.positions.push_back({ time, glm::vec3(0.0f, 0.25f * std::sin(angle * 2.0f + variant), 0.0f) });
+			track.rotations.push_back({ time, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)) });
+		}
+		track.scales.push_back({ 0.0f, glm::vec3(scale) });
+		clip.tracks.push_back(track);
+
+		return std::make_shared<const SampledClip>(clip);
+	}
+}
+
+MeshResourcePtr generateStressMesh(unsigned detail, unsigned variant)
+{
+	detail = std::max(detail, 3u);
+
+	// a few bumps whose count and phase depend on the variant
+	float lobes = float(2 + variant % 5);
+	float phase = float(variant) * 0.7f;
+	float height = 0.1f + 0.05f * float(variant % 3);
+
+	MeshResourcePtr mesh(new MeshResource());
+	mesh->vertices.reserve(size_t(detail + 1) * (detail + 1));
+	for (unsigned ring = 0; ring <= detail; ring++)
+	{
+		float theta = PI * ring / detail;
+		for (unsigned segment = 0; segment <= detail; segment++)
+		{
+			float phi = 2.0f * PI * segment / detail;
+			float radius = 0.5f * (1.0f + height * std::sin(lobes * phi + phase) * std::sin(theta));
+
+			Vertex vertex;
+			vertex.position = radius * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			vertex.color = glm::vec3(0.5f) + 0.5f * glm::vec3(std::cos(phase), std::cos(phase + 2.0f), std::cos(phase + 4.0f));
+			mesh->vertices.push_back(vertex);
+		}
+	}
+
+	// clockwise seen from outside. The triangles touching the poles are degenerate and skipped.
+	mesh->indices.reserve(size_t(detail) * detail * 6);
+	unsigned row = detail + 1;
+	auto addTriangle = [&](unsigned a, unsigned b, unsigned c) {
+		glm::vec3 edges = glm::cross(mesh->vertices[b].position - mesh->vertices[a].position, mesh->vertices[c].position - mesh->vertices[a].position);
+		if (glm::dot(edges, edges) < 1e-12f)
+		{
+			return;
+		}
+
+		glm::vec3 normal = computeFaceNormal(mesh->vertices[a].position, mesh->vertices[b].position, mesh->vertices[c].position);
+		mesh->vertices[a].normal += normal;
+		mesh->vertices[b].normal += normal;
+		mesh->vertices[c].normal += normal;
+		mesh->indices.insert(mesh->indices.end(), { a, b, c });
+	};
+	for (unsigned ring = 0; ring < detail; ring++)
+	{
+		for (unsigned segment = 0; segment < detail; segment++)
+		{
+			unsigned i0 = ring * row + segment;
+			unsigned i1 = i0 + 1;
+			unsigned i2 = i0 + row;
+			unsigned i3 = i2 + 1;
+			addTriangle(i0, i1, i3);
+			addTriangle(i0, i3, i2);
+		}
+	}
+
+	normalizeVertexNormals(mesh->vertices);
+	mesh->computeBounds();
+	mesh->updateMemoryStats();
+	return mesh;
+}
+
+StressScene generateStressScene(Scene& scene, const StressSceneOptions& options, AnimationSystem* animation)
+{
+	StressScene result;
+	if (options.objects == 0)
+	{
+		return result;
+	}
+
+	std::mt19937 random(options.seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+
+	size_t sharedMeshes = std::max<size_t>(options.sharedMeshes, 1);
+	for (size_t i = 0; i < sharedMeshes; i++)
+	{
+		result.meshes.push_back(generateStressMesh(options.meshDetail, static_cast<unsigned>(i)));
+	}
+	if (animation != nullptr && options.animatedShare > 0)
+	{
+		for (unsigned i = 0; i < CLIP_VARIANTS; i++)
+		{
+			result.clips.push_back(createSpinClip(i, options.spacing));
+		}
+	}
+
+	// each layer is a square wall facing the view
+	unsigned layers = std::max(options.depthLayers, 1u);
+	size_t perLayer = (options.objects + layers - 1) / layers;
+	size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(perLayer))));
+	float width = side * options.spacing;
+
+	std::vector<glm::vec3> clusterCenters;
+	if (options.layout == StressLayout::Clusters)
+	{
+		for (size_t i = 0; i < std::max<size_t>(options.clusters, 1); i++)
+		{
+			clusterCenters.push_back(glm::vec3(unit(random) * width, unit(random) * width, unit(random) * layers * options.spacing));
+		}
+	}
+	std::normal_distribution<float> spread(0.0f, options.clusterRadius);
+
+	size_t first = scene.size();
+	SceneObject* objects = scene.createObjects(options.objects);
+	result.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+	result.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+	for (size_t i = 0; i < options.objects; i++)
+	{
+		SceneObject& object = objects[i];
+
+		glm::vec3 position;
+		if (options.layout == StressLayout::Grid)
+		{
+			size_t layer = i / perLayer;
+			size_t cell = i % perLayer;
+			position = glm::vec3(float(cell % side), float(cell / side), float(layer)) * options.spacing;
+		}
+		else
+		{
+			const glm::vec3& center = clusterCenters[i % clusterCenters.size()];
+			position = center + glm::vec3(spread(random), spread(random), spread(random));
+		}
+		result.boundsMin = glm::min(result.boundsMin, position);
+		result.boundsMax = glm::max(result.boundsMax, position);
+
+		if (unit(random) < options.uniqueShare)
+		{
+			result.meshes.push_back(generateStressMesh(options.meshDetail, static_cast<unsigned>(result.meshes.size())));
+			object.mesh = result.meshes.back();
+		}
+		else
+		{
+			object.mesh = result.meshes[i % sharedMeshes];
+		}
+
+		// large enough to overlap their neighbours a little, so the layers hide each other
+		float size = options.spacing * (0.8f + 0.6f * unit(random));
+		glm::quat rotation = glm::angleAxis(angle(random), glm::normalize(glm::vec3(unit(random), 1.0f, unit(random))));
+
+		if (!result.clips.empty() && unit(random) < options.animatedShare)
+		{
+			// the clip takes over the rotation and scale
+			object.setTransform(position, glm::quat(1, 0, 0, 0), glm::vec3(options.spacing));
+			float speed = 0.5f + unit(random);
+			animation->play(*(scene.begin() + (first + i)), result.clips[i % result.clips.size()], speed, true, position);
+			result.animatedObjects++;
+		}
+		else
+		{
+			object.setTransform(position, rotation, glm::vec3(size));
+		}
+	}
+
+	// frame the whole extent of the first layer
+	glm::vec3 center = (result.boundsMin + result.boundsMax) * 0.5f;
+	float extent = std::max(result.boundsMax.x - result.boundsMin.x, result.boundsMax.y - result.boundsMin.y) + 2.0f * options.spacing;
+	float distance = extent * 0.5f / std::tan(glm::radians(22.5f));
+	result.viewPosition = glm::vec3(center.x, center.y, result.boundsMin.z - options.spacing - distance);
+	result.viewDistance = result.boundsMax.z + options.spacing - result.viewPosition.z;
+	return result;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Animation.h"
+#include "AnimationSystem.h"
+#include "Assets.h"
+#include "Scene.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/vec3.hpp>
+
+enum class StressLayout
+{
+	// Walls of objects on a regular grid, one behind the other along z
+	Grid,
+
+	// Objects spread around random centers, dense in places and empty in others
+	Clusters
+};
+
+// Parameters of a procedural scene for measuring how the engine scales with the number of objects
+struct StressSceneOptions
+{
+	size_t objects = 10000;
+	StressLayout layout = StressLayout::Grid;
+
+	// Meshes shared by most objects, assigned in turn so every one is instanced many times
+	size_t sharedMeshes = 8;
+
+	// Share of the objects (0 to 1) that get a mesh of their own
+	float uniqueShare = 0.01f;
+
+	// Rings and segments of each generated mesh, which has (detail + 1)^2 vertices
+	unsigned meshDetail = 8;
+
+	// Share of the objects (0 to 1) that spin and bob with one of a few shared clips
+	float animatedShare = 0.1f;
+
+	// Layers the objects are split into along z. Seen from the suggested view, each pixel is covered about this many times.
+	unsigned depthLayers = 4;
+
+	// Distance between neighbouring objects in a layer, and between layers
+	float spacing = 2.0f;
+
+	// For StressLayout::Clusters, how many clusters and how far their objects spread (standard deviation)
+	size_t clusters = 64;
+	float clusterRadius = 6.0f;
+
+	// The same options and seed always give the same scene
+	unsigned seed = 1;
+};
+
+// What generateStressScene() made, besides the objects
+struct StressScene
+{
+	// Shared meshes first, then the unique ones. CPU data only, create their buffers to draw them.
+	std::vector<MeshResourcePtr> meshes;
+
+	// Clips played by the animated objects
+	std::vector<std::shared_ptr<const SampledClip>> clips;
+
+	size_t animatedObjects = 0;
+
+	// Bounds of the object positions
+	glm::vec3 boundsMin = { 0, 0, 0 };
+	glm::vec3 boundsMax = { 0, 0, 0 };
+
+	// A camera here looking down +z with a 45 degree field of view sees every layer behind the first,
+	// up to viewDistance away
+	glm::vec3 viewPosition = { 0, 0, 0 };
+	float viewDistance = 1.0f;
+};
+
+// A closed, lumpy sphere of radius about 0.5. Each variant has a different shape.
+MeshResourcePtr generateStressMesh(unsigned detail, unsigned variant);
+
+// Adds the objects of a stress scene to a scene, created in a single block.
+// With an animation system, the animated share of them is played with the returned clips.
+StressScene generateStressScene(Scene& scene, const StressSceneOptions& options, AnimationSystem* animation = nullptr);
@@ -0,0 +1,306 @@
+#include "TextureCache.h"
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const char ENTRY_MAGIC[4] = { 'M', 'V', 'T', 'C' };
+	const uint32_t ENTRY_VERSION = 2;
+
+	// Bump when the mip filters or encoders change their output, so old entries are rebuilt
+	const uint32_t ENCODER_VERSION = 1;
+
+	typedef std::chrono::steady_clock Clock;
+
+	// Header written in front of every cache entry, followed by the levels and the blocks
+	struct EntryHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t keyHigh;
+		uint64_t keyLow;
+		uint32_t format;
+		uint32_t srgb;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+		uint32_t reserved;
+		uint64_t size;
+		uint64_t checksum;
+	};
+
+	struct EntryLevel
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	// Checksum of an entry: the header fields describing the texture, the levels and the blocks
+	uint64_t computeEntryChecksum(const EntryHeader& header, const EntryLevel* levels, const uint8_t* data)
+	{
+		Hasher checksum;
+		checksum.updateValue(header.format);
+		checksum.updateValue(header.srgb);
+		checksum.updateValue(header.width);
+		checksum.updateValue(header.height);
+		checksum.updateValue(header.levelCount);
+		checksum.update(levels, header.levelCount * sizeof(EntryLevel));
+		checksum.update(data, static_cast<size_t>(header.size));
+		return checksum.finish().low;
+	}
+
+	double secondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	// Returns a name no other thread or process will pick for its temporary file
+	std::string uniqueSuffix()
+	{
+		static std::atomic<uint64_t> counter{ 0 };
+
+		Hasher hasher;
+		hasher.updateValue(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+		hasher.updateValue(std::hash<std::thread::id>()(std::this_thread::get_id()));
+		hasher.updateValue(counter.fetch_add(1));
+		hasher.updateValue(&counter);
+		return hasher.finish().toHex().substr(0, 16);
+	}
+}
+
+CompressedTexture compressTexture(const Image& image, const TextureSettings& settings, JobSystem* jobs, TextureStats* stats)
+{
+	auto start = Clock::now();
+	std::vector<Image> levels;
+	if (settings.mips)
+	{
+		MipOptions options;
+		options.filter = settings.filter;
+		options.srgb = settings.srgb;
+		levels = generateMipChain(image, options, jobs);
+	}
+	else
+	{
+		levels.push_back(image);
+	}
+	double mipSeconds = secondsSince(start);
+
+	CompressedTexture texture;
+	texture.format = settings.format;
+	texture.srgb = settings.srgb;
+	texture.width = image.width;
+	texture.height = image.height;
+	for (const Image& level : levels)
+	{
+		TextureLevel entry;
+		entry.width = level.width;
+		entry.height = level.height;
+		entry.offset = texture.data.size();
+		entry.size = getCompressedSize(settings.format, level.width, level.height);
+		texture.levels.push_back(entry);
+		texture.data.resize(entry.offset + entry.size);
+	}
+
+	start = Clock::now();
+	uint64_t texels = 0;
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		const Image& level = levels[i];
+		compressImage(settings.format, level.pixels.data(), level.width, level.height, &texture.data[texture.levels[i].offset], jobs);
+		texels += uint64_t(level.width) * level.height;
+	}
+
+	if (stats)
+	{
+		stats->texels = texels;
+		stats->mipSeconds = mipSeconds;
+		stats->encodeSeconds = secondsSince(start);
+	}
+	return texture;
+}
+
+TextureCache::TextureCache(const std::filesystem::path& directory) : directory{ directory }
+{
+}
+
+ContentHash TextureCache::computeKey(const std::vector<uint8_t>& source, const TextureSettings& settings)
+{
+	Hasher hasher;
+	hasher.update(std::string("texture-cache-v1"));
+	hasher.updateValue(ENCODER_VERSION);
+	hasher.update(source.data(), source.size());
+	hasher.updateValue(uint32_t(settings.format));
+	hasher.updateValue(uint32_t(settings.srgb));
+	hasher.updateValue(uint32_t(settings.filter));
+	hasher.updateValue(uint32_t(settings.mips));
+	return hasher.finish();
+}
+
+std::filesystem::path TextureCache::getEntryPath(const ContentHash& key) const
+{
+	return directory / (key.toHex() + ".mvtex");
+}
+
+CompressedTexture TextureCache::getOrCompress(const std::filesystem::path& imagePath, const TextureSettings& settings,
+	JobSystem* jobs, TextureStats* stats)
+{
+	std::ifstream file(imagePath, std::ios::binary);
+	if (!file)
+	{
+		throw std::runtime_error("Could not open image " + imagePath.string());
+	}
+	std::vector<uint8_t> source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	ContentHash key = computeKey(source, settings);
+	CompressedTexture texture;
+	if (load(key, texture))
+	{
+		hits++;
+		if (stats)
+		{
+			*stats = TextureStats();
+			stats->cacheHit = true;
+		}
+		return texture;
+	}
+
+	misses++;
+	auto start = Clock::now();
+	Image image = decodePng(source.data(), source.size());
+	double decodeSeconds = secondsSince(start);
+
+	texture = compressTexture(image, settings, jobs, stats);
+	if (stats)
+	{
+		stats->decodeSeconds = decodeSeconds;
+		stats->cacheHit = false;
+	}
+	store(key, texture);
+	return texture;
+}
+
+bool TextureCache::load(const ContentHash& key, CompressedTexture& texture) const
+{
+	fs::path path = getEntryPath(key);
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
+
+	EntryHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+	{
+		return false;
+	}
+
+	if (std::memcmp(header.magic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC)) != 0 || header.version != ENTRY_VERSION
+		|| header.keyHigh != key.high || header.keyLow != key.low || header.format > uint32_t(BlockFormat::BC7)
+		|| header.levelCount == 0 || header.levelCount > 32)
+	{
+		return false;
+	}
+
+	// a truncated or corrupted entry must not make us allocate whatever size it claims
+	std::error_code error;
+	uintmax_t fileSize = fs::file_size(path, error);
+	uint64_t levelBytes = uint64_t(header.levelCount) * sizeof(EntryLevel);
+	if (error || fileSize < sizeof(header) + levelBytes || header.size > fileSize - sizeof(header) - levelBytes)
+	{
+		return false;
+	}
+
+	std::vector<EntryLevel> levels(header.levelCount);
+	std::vector<uint8_t> data(static_cast<size_t>(header.size));
+	if (!file.read(reinterpret_cast<char*>(levels.data()), levels.size() * sizeof(EntryLevel))
+		|| !file.read(reinterpret_cast<char*>(data.data()), data.size()))
+	{
+		return false;
+	}
+
+	if (computeEntryChecksum(header, levels.data(), data.data()) != header.checksum)
+	{
+		return false;
+	}
+
+	texture.format = BlockFormat(header.format);
+	texture.srgb = header.srgb != 0;
+	texture.width = header.width;
+	texture.height = header.height;
+	texture.levels.clear();
+	for (const EntryLevel& level : levels)
+	{
+		// createTexture reads the blocks of each level by its size, it must match the format
+		if (level.offset > data.size() || level.size > data.size() - level.offset
+			|| level.size != getCompressedSize(texture.format, level.width, level.height))
+		{
+			return false;
+		}
+		texture.levels.push_back({ level.width, level.height, size_t(level.offset), size_t(level.size) });
+	}
+	texture.data = std::move(data);
+	return true;
+}
+
+void TextureCache::store(const ContentHash& key, const CompressedTexture& texture) const
+{
+	std::error_code error;
+	fs::create_directories(directory, error);
+
+	fs::path finalPath = getEntryPath(key);
+	fs::path tempPath = finalPath;
+	tempPath += ".tmp" + uniqueSuffix();
+
+	std::vector<EntryLevel> levels;
+	for (const TextureLevel& level : texture.levels)
+	{
+		levels.push_back({ level.width, level.height, level.offset, level.size });
+	}
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return;
+		}
+
+		EntryHeader header = {};
+		std::memcpy(header.magic, ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+		header.version = ENTRY_VERSION;
+		header.keyHigh = key.high;
+		header.keyLow = key.low;
+		header.format = uint32_t(texture.format);
+		header.srgb = texture.srgb ? 1 : 0;
+		header.width = texture.width;
+		header.height = texture.height;
+		header.levelCount = static_cast<uint32_t>(levels.size());
+		header.size = texture.data.size();
+		header.checksum = computeEntryChecksum(header, levels.data(), texture.data.data());
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(EntryLevel));
+		file.write(reinterpret_cast<const char*>(texture.data.data()), texture.data.size());
+		if (!file)
+		{
+			file.close();
+			fs::remove(tempPath, error);
+			return;
+		}
+	}
+
+	// Atomic replace. If another process won the race the entry holds the same blocks.
+	fs::rename(tempPath, finalPath, error);
+	if (error)
+	{
+		fs::remove(tempPath, error);
+	}
+}
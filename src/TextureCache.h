@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "Hash.h"
+#include "JobSystem.h"
+#include "MipChain.h"
+#include "PngReader.h"
+
+// Everything that determines the compressed texture besides the image
+struct TextureSettings
+{
+	BlockFormat format = BlockFormat::BC7;
+
+	// Color data: mips are filtered in linear light and the GPU decodes the texels to linear.
+	// Turn off for normal maps (BC5) and other data.
+	bool srgb = true;
+
+	MipFilter filter = MipFilter::Kaiser;
+	bool mips = true;
+};
+
+struct TextureLevel
+{
+	unsigned width = 0;
+	unsigned height = 0;
+
+	// Where the blocks of the level are in CompressedTexture::data
+	size_t offset = 0;
+	size_t size = 0;
+};
+
+// A block compressed texture with its mip chain, ready to upload
+struct CompressedTexture
+{
+	BlockFormat format = BlockFormat::BC7;
+	bool srgb = true;
+	unsigned width = 0;
+	unsigned height = 0;
+	std::vector<TextureLevel> levels;
+	std::vector<uint8_t> data;
+
+	// Bytes the same levels take as uncompressed RGBA8
+	uint64_t getUncompressedBytes() const
+	{
+		uint64_t bytes = 0;
+		for (const TextureLevel& level : levels)
+		{
+			bytes += uint64_t(level.width) * level.height * 4;
+		}
+		return bytes;
+	}
+};
+
+struct TextureStats
+{
+	// Texels of every level that were compressed, 0 on a cache hit
+	uint64_t texels = 0;
+
+	double decodeSeconds = 0;
+	double mipSeconds = 0;
+	double encodeSeconds = 0;
+
+	bool cacheHit = false;
+
+	double getEncodeTexelsPerSecond() const
+	{
+		return encodeSeconds > 0 ? double(texels) / encodeSeconds : 0;
+	}
+};
+
+// Generates the mips of an image (when enabled) and compresses every level, on the job system when given
+CompressedTexture compressTexture(const Image& image, const TextureSettings& settings, JobSystem* jobs = nullptr,
+	TextureStats* stats = nullptr);
+
+// Content addressed on-disk cache of compressed textures, so every image is compressed once.
+// Entries are keyed by the bytes of the source file and the settings, not by its path or date,
+// so copies of the same texture share an entry and edits invalidate it.
+// Entries are written to a temporary file and renamed into place and carry a checksum, like the
+// shader cache, so several processes may share the directory.
+class TextureCache
+{
+public:
+	explicit TextureCache(const std::filesystem::path& directory);
+
+	// Returns the compressed texture of a PNG file, from the cache when it was compressed before.
+	// Throws std::runtime_error if the file can't be read or decoded.
+	CompressedTexture getOrCompress(const std::filesystem::path& imagePath, const TextureSettings& settings,
+		JobSystem* jobs = nullptr, TextureStats* stats = nullptr);
+
+	// Returns the cache key of a source file's contents with the settings
+	static ContentHash computeKey(const std::vector<uint8_t>& source, const TextureSettings& settings);
+
+	// Reads an entry. Returns false if it doesn't exist or is damaged.
+	bool load(const ContentHash& key, CompressedTexture& texture) const;
+
+	// Writes an entry atomically. Failures are ignored, the cache is only an optimization.
+	void store(const ContentHash& key, const CompressedTexture& texture) const;
+
+	std::filesystem::path getEntryPath(const ContentHash& key) const;
+
+	size_t getHitCount() const { return hits; }
+	size_t getMissCount() const { return misses; }
+
+private:
+	std::filesystem::path directory;
+
+	std::atomic<size_t> hits{ 0 };
+	std::atomic<size_t> misses{ 0 };
+};
@@ -0,0 +1,397 @@
+#include "ThumbnailPipeline.h"
+#include "Camera.h"
+#include "MeshCodec.h"
+#include "ObjLoader.h"
+#include "PngWriter.h"
+#include "ScanImport.h"
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+	const size_t STAGE_COUNT = static_cast<size_t>(ThumbnailStage::Count);
+
+	struct ModelJob
+	{
+		std::filesystem::path path;
+		MeshResourcePtr mesh;
+		glm::vec3 center = { 0, 0, 0 };
+		float radius = 0;
+
+		// views not encoded yet, the mesh is released when it reaches 0
+		size_t remainingViews = 0;
+		bool failed = false;
+	};
+
+	struct Task
+	{
+		ThumbnailStage stage;
+		std::shared_ptr<ModelJob> model;
+		size_t view = 0;
+		std::vector<uint32_t> pixels;
+	};
+
+	MeshResourcePtr loadMesh(const std::filesystem::path& path)
+	{
+		auto mesh = std::make_shared<MeshResource>();
+		if (path.extension() == ".mvmesh")
+		{
+			// the pipeline already keeps every thread busy, decode on this one
+			readMeshFile(path, mesh->vertices, mesh->indices);
+		}
+		else if (path.extension() == ".stl" || path.extension() == ".ply")
+		{
+			importScan(path, mesh->vertices, mesh->indices);
+		}
+		else
+		{
+			std::ifstream file(path);
+			if (!file)
+			{
+				throw std::runtime_error("Could not open model " + path.string());
+			}
+			parseObj(file, mesh->vertices, mesh->indices);
+		}
+		return mesh;
+	}
+
+	void optimizeMesh(ModelJob& model)
+	{
+		MeshResource& mesh = *model.mesh;
+		normalizeVertexNormals(mesh.vertices);
+
+		// triangles repeating a vertex cover no pixels
+		size_t kept = 0;
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			unsigned a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+			if (a != b && b != c && a != c)
+			{
+				mesh.indices[kept++] = a;
+				mesh.indices[kept++] = b;
+				mesh.indices[kept++] = c;
+			}
+		}
+		mesh.indices.resize(kept);
+		mesh.indices.shrink_to_fit();
+		mesh.computeBounds();
+		mesh.updateMemoryStats();
+
+		model.center = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+		model.radius = std::max(glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f, 1e-4f);
+	}
+
+	void renderView(SoftwareRasterizer& rasterizer, const ModelJob& model, const ThumbnailView& view, const ThumbnailOptions& options)
+	{
+		Camera camera;
+		camera.setFov(options.fov);
+		camera.setAspectRatio(options.width, options.height);
+		camera.setRotation(view.pitch, view.yaw, 0.0f);
+
+		// back off until the bounding sphere fits the narrower side of the view
+		float halfFov = glm::radians(options.fov) * 0.5f;
+		float aspect = float(options.width) / float(options.height);
+		float narrowHalfFov = aspect < 1.0f ? std::atan(std::tan(halfFov) * aspect) : halfFov;
+		float distance = model.radius / std::sin(narrowHalfFov) * 1.05f;
+
+		camera.setPosition(model.center - camera.getForward() * distance);
+		camera.setClipRange(std::max(distance - model.radius * 1.1f, distance * 0.01f), distance + model.radius * 1.1f);
+
+		// key light from above and to the left of the camera
+		rasterizer.setLightDirection(camera.getForward() - camera.getUp() * 0.7f + camera.getRight() * 0.4f);
+		rasterizer.clear(options.background);
+		rasterizer.draw(*model.mesh, glm::mat4x4(1.0f), camera.getViewProjectionMatrix());
+	}
+}
+
+std::vector<ThumbnailView> parseThumbnailViews(const std::string& list)
+{
+	std::vector<ThumbnailView> views;
+	size_t start = 0;
+	while (start <= list.size())
+	{
+		size_t end = list.find(',', start);
+		if (end == std::string::npos)
+		{
+			end = list.size();
+		}
+		std::string name = list.substr(start, end - start);
+		start = end + 1;
+
+		if (name.empty())
+		{
+			continue;
+		}
+		else if (name == "front")
+		{
+			views.push_back({ name, 0.0f, 0.0f });
+		}
+		else if (name == "back")
+		{
+			views.push_back({ name, 180.0f, 0.0f });
+		}
+		else if (name == "left")
+		{
+			views.push_back({ name, 90.0f, 0.0f });
+		}
+		else if (name == "right")
+		{
+			views.push_back({ name, -90.0f, 0.0f });
+		}
+		else if (name == "top")
+		{
+			views.push_back({ name, 0.0f, 89.0f });
+		}
+		else if (name == "three-quarter")
+		{
+			views.push_back({ name, -35.0f, 25.0f });
+		}
+		else if (name.compare(0, 10, "turntable:") == 0)
+		{
+			int count = std::atoi(name.c_str() + 10);
+			if (count <= 0)
+			{
+				throw std::runtime_error("Invalid turntable view count in " + name);
+			}
+			for (int i = 0; i < count; i++)
+			{
+				views.push_back({ "turntable" + std::to_string(i), 360.0f * i / count, 20.0f });
+			}
+		}
+		else
+		{
+			throw std::runtime_error("Unknown thumbnail view " + name);
+		}
+	}
+	return views;
+}
+
+const char* getThumbnailStageName(ThumbnailStage stage)
+{
+	switch (stage)
+	{
+	case ThumbnailStage::Load: return "load";
+	case ThumbnailStage::Optimize: return "optimize";
+	case ThumbnailStage::Rasterize: return "rasterize";
+	case ThumbnailStage::Encode: return "encode";
+	default: return "unknown";
+	}
+}
+
+ThumbnailPipeline::ThumbnailPipeline(const ThumbnailOptions& options) : options{ options }
+{
+	if (this->options.threads == 0)
+	{
+		this->options.threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	if (this->options.modelsInFlight == 0)
+	{
+		this->options.modelsInFlight = size_t(this->options.threads) * 2;
+	}
+}
+
+ThumbnailStats ThumbnailPipeline::run(const std::vector<std::filesystem::path>& models, std::ostream* log)
+{
+	ThumbnailStats stats;
+	stats.models = models.size();
+	stats.threads = options.threads;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<Task> queues[STAGE_COUNT];
+	size_t nextModel = 0;
+	size_t loadedModels = 0;
+	size_t finishedModels = 0;
+
+	// called with the lock held
+	auto finishModel = [&](ModelJob& model) {
+		if (model.failed)
+		{
+			stats.failedModels++;
+		}
+		model.mesh.reset();
+		loadedModels--;
+		finishedModels++;
+	};
+
+	auto fail = [&](ModelJob& model, const std::exception& error) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (log)
+		{
+			*log << model.path.string() << ": " << error.what() << std::endl;
+		}
+		model.failed = true;
+	};
+
+	auto worker = [&]() {
+		SoftwareRasterizer rasterizer(options.width, options.height);
+		double stageSeconds[STAGE_COUNT] = {};
+
+		while (true)
+		{
+			Task task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				bool found = false;
+				changed.wait(lock, [&]() {
+					if (finishedModels == models.size())
+					{
+						return true;
+					}
+
+					// the latest stage first, so images leave and memory is released early
+					for (size_t stage = STAGE_COUNT; stage-- > static_cast<size_t>(ThumbnailStage::Optimize);)
+					{
+						if (!queues[stage].empty())
+						{
+							task = std::move(queues[stage].front());
+							queues[stage].pop_front();
+							found = true;
+							return true;
+						}
+					}
+
+					if (nextModel < models.size() && loadedModels < options.modelsInFlight)
+					{
+						task.stage = ThumbnailStage::Load;
+						task.model = std::make_shared<ModelJob>();
+						task.model->path = models[nextModel++];
+						loadedModels++;
+						found = true;
+						return true;
+					}
+					return false;
+				});
+
+				if (!found)
+				{
+					break;
+				}
+			}
+
+			ModelJob& model = *task.model;
+			auto start = std::chrono::steady_clock::now();
+			std::vector<Task> next;
+			bool modelDone = false;
+
+			try
+			{
+				switch (task.stage)
+				{
+				case ThumbnailStage::Load:
+					model.mesh = loadMesh(model.path);
+					next.push_back({ ThumbnailStage::Optimize, task.model, 0, {} });
+					break;
+
+				case ThumbnailStage::Optimize:
+					optimizeMesh(model);
+					model.remainingViews = options.views.size();
+					for (size_t view = 0; view < options.views.size(); view++)
+					{
+						next.push_back({ ThumbnailStage::Rasterize, task.model, view, {} });
+					}
+					modelDone = options.views.empty();
+					break;
+
+				case ThumbnailStage::Rasterize:
+					renderView(rasterizer, model, options.views[task.view], options);
+					next.push_back({ ThumbnailStage::Encode, task.model, task.view, rasterizer.takePixels() });
+					break;
+
+				case ThumbnailStage::Encode:
+				{
+					std::vector<uint8_t> png = encodePng(reinterpret_cast<const uint8_t*>(task.pixels.data()), options.width, options.height);
+					if (options.writeFiles)
+					{
+						auto path = options.outputDirectory / (model.path.stem().string() + "_" + options.views[task.view].name + ".png");
+						std::ofstream file(path, std::ios::binary);
+						file.write(reinterpret_cast<const char*>(png.data()), png.size());
+						if (!file)
+						{
+							throw std::runtime_error("Could not write image " + path.string());
+						}
+					}
+
+					std::lock_guard<std::mutex> lock(mutex);
+					stats.images++;
+					stats.imageBytes += png.size();
+					break;
+				}
+
+				default:
+					break;
+				}
+			}
+			catch (const std::exception& error)
+			{
+				fail(model, error);
+
+				// the model's other views are dropped, except those already queued
+				if (task.stage == ThumbnailStage::Load || task.stage == ThumbnailStage::Optimize)
+				{
+					modelDone = true;
+					next.clear();
+				}
+			}
+
+			stageSeconds[static_cast<size_t>(task.stage)] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (Task& nextTask : next)
+				{
+					queues[static_cast<size_t>(nextTask.stage)].push_back(std::move(nextTask));
+				}
+
+				if (task.stage == ThumbnailStage::Rasterize && next.empty())
+				{
+					// failed view, it won't reach the encode stage
+					modelDone = --model.remainingViews == 0;
+				}
+				else if (task.stage == ThumbnailStage::Encode)
+				{
+					modelDone = --model.remainingViews == 0;
+				}
+
+				if (modelDone)
+				{
+					finishModel(model);
+				}
+			}
+			changed.notify_all();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t stage = 0; stage < STAGE_COUNT; stage++)
+		{
+			stats.stageSeconds[stage] += stageSeconds[stage];
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (unsigned i = 1; i < options.threads; i++)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return stats;
+}
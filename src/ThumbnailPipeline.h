@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/vec4.hpp>
+
+// A camera preset, the camera orbits the model's bounding sphere looking at its center
+struct ThumbnailView
+{
+	// Appended to the model's name for the image file
+	std::string name;
+
+	// Degrees. Yaw 0 looks down +z (the viewer's default), positive pitch looks down.
+	float yaw = 0;
+	float pitch = 0;
+};
+
+// Parses a comma separated list of presets: front, back, left, right, top, three-quarter,
+// and turntable:N for N views around the model.
+// Throws std::runtime_error on an unknown preset.
+std::vector<ThumbnailView> parseThumbnailViews(const std::string& list);
+
+enum class ThumbnailStage
+{
+	// read and parse the model file
+	Load,
+	// prepare the mesh for drawing (unit normals, degenerate triangles, bounds)
+	Optimize,
+	// draw a view
+	Rasterize,
+	// compress a view to PNG and write it
+	Encode,
+	Count
+};
+
+const char* getThumbnailStageName(ThumbnailStage stage);
+
+struct ThumbnailOptions
+{
+	unsigned width = 256;
+	unsigned height = 256;
+	float fov = 35.0f;
+	glm::vec4 background = { 0.16f, 0.16f, 0.18f, 1.0f };
+
+	std::vector<ThumbnailView> views = { { "three-quarter", -35.0f, 25.0f } };
+
+	// Images are written as <output>/<model name>_<view name>.png
+	std::filesystem::path outputDirectory = ".";
+
+	// Encode images without writing them, for measuring
+	bool writeFiles = true;
+
+	// Worker threads, 0 for one per hardware thread
+	unsigned threads = 0;
+
+	// Models loaded at once, bounds memory. 0 for twice the thread count.
+	size_t modelsInFlight = 0;
+};
+
+struct ThumbnailStats
+{
+	size_t models = 0;
+	size_t failedModels = 0;
+	size_t images = 0;
+	uint64_t imageBytes = 0;
+	unsigned threads = 0;
+	double seconds = 0;
+
+	// Thread time spent in each stage
+	double stageSeconds[static_cast<size_t>(ThumbnailStage::Count)] = {};
+
+	double getImagesPerSecond() const { return seconds > 0 ? images / seconds : 0; }
+
+	// Share of the available thread time spent in a stage, the rest was idle
+	double getUtilization(ThumbnailStage stage) const
+	{
+		return seconds > 0 && threads > 0 ? stageSeconds[static_cast<size_t>(stage)] / (seconds * threads) : 0;
+	}
+};
+
+// Renders thumbnails of many models on the CPU, without a window or GPU.
+//
+// Every model goes through load, optimize, rasterize (once per view) and encode (once per view).
+// The stages of different models run at the same time on a pool of threads: a free thread takes
+// the task of the latest stage available, so finished work leaves the pipeline as soon as
+// possible, and only starts loading a new model while fewer than modelsInFlight are loaded.
+class ThumbnailPipeline
+{
+public:
+	explicit ThumbnailPipeline(const ThumbnailOptions& options);
+
+	// Renders every view of every model (OBJ or .mvmesh). A model that fails to load is reported
+	// to the log and counted, the others still run.
+	ThumbnailStats run(const std::vector<std::filesystem::path>& models, std::ostream* log = nullptr);
+
+private:
+	ThumbnailOptions options;
+};
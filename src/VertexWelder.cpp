@@ -0,0 +1,321 @@
+#include "VertexWelder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace
+{
+	// Positions handled per task in the passes over the input
+	const size_t CHUNK_SIZE = 64 * 1024;
+
+	const unsigned BUCKET_BITS = 12;
+	const size_t BUCKET_COUNT = size_t(1) << BUCKET_BITS;
+
+	// Cell coordinates are packed 21 bits per axis into a single key
+	const int64_t CELL_LIMIT = (int64_t(1) << 21) - 2;
+
+	// Size of a cell in epsilons
+	const float CELL_EPSILONS = 4.0f;
+
+	struct Entry
+	{
+		uint64_t key;
+		uint32_t index;
+
+		bool operator<(const Entry& other) const
+		{
+			return key != other.key ? key < other.key : index < other.index;
+		}
+	};
+
+	// A position that starts a group, cells may hold several
+	struct Cell
+	{
+		uint64_t key;
+		uint32_t representative;
+	};
+
+	uint64_t packCell(int64_t x, int64_t y, int64_t z)
+	{
+		return uint64_t(x) | (uint64_t(y) << 21) | (uint64_t(z) << 42);
+	}
+
+	size_t getBucket(uint64_t key)
+	{
+		return static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> (64 - BUCKET_BITS));
+	}
+
+	template <typename Task>
+	void runBatch(JobSystem* jobs, size_t count, const Task& task)
+	{
+		if (jobs && count > 1)
+		{
+			jobs->parallelFor(count, task);
+		}
+		else
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				task(i);
+			}
+		}
+	}
+}
+
+void weldPositions(const glm::vec3* positions, size_t count, float epsilon, WeldResult& result, JobSystem* jobs)
+{
+	result.remap.assign(count, 0);
+	result.representatives.clear();
+	if (count == 0)
+	{
+		return;
+	}
+	if (count > UINT32_MAX)
+	{
+		throw std::runtime_error("Too many vertices to weld");
+	}
+
+	const size_t chunkCount = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+	// Bounds, so cell coordinates start at 0
+	std::vector<glm::vec3> chunkMin(chunkCount), chunkMax(chunkCount);
+	runBatch(jobs, chunkCount, [&](size_t chunk) {
+		size_t end = std::min(count, (chunk + 1) * CHUNK_SIZE);
+		glm::vec3 low = positions[chunk * CHUNK_SIZE];
+		glm::vec3 high = low;
+		for (size_t i = chunk * CHUNK_SIZE + 1; i < end; i++)
+		{
+			low = glm::min(low, positions[i]);
+			high = glm::max(high, positions[i]);
+		}
+		chunkMin[chunk] = low;
+		chunkMax[chunk] = high;
+	});
+	glm::vec3 boundsMin = chunkMin[0];
+	glm::vec3 boundsMax = chunkMax[0];
+	for (size_t chunk = 1; chunk < chunkCount; chunk++)
+	{
+		boundsMin = glm::min(boundsMin, chunkMin[chunk]);
+		boundsMax = glm::max(boundsMax, chunkMax[chunk]);
+	}
+
+	// Cells span a few epsilons, so most positions are far enough from the border that no neighbouring
+	// cell needs to be searched. They can't be smaller than what the key can address over the bounds.
+	glm::vec3 extents = boundsMax - boundsMin;
+	float largestExtent = std::max(extents.x, std::max(extents.y, extents.z));
+	float cellSize = std::max(epsilon * CELL_EPSILONS, largestExtent / float(CELL_LIMIT));
+	if (!(cellSize > 0))
+	{
+		// every position is the same
+		cellSize = 1.0f;
+	}
+	float inverseCellSize = 1.0f / cellSize;
+
+	auto getCell = [&](const glm::vec3& position) {
+		glm::vec3 cell = (position - boundsMin) * inverseCellSize;
+		return packCell(std::min<int64_t>(int64_t(cell.x), CELL_LIMIT), std::min<int64_t>(int64_t(cell.y), CELL_LIMIT),
+			std::min<int64_t>(int64_t(cell.z), CELL_LIMIT));
+	};
+
+	// Partition the positions into buckets by cell: count, prefix sum, scatter.
+	// Scattering chunk by chunk keeps every bucket in input order.
+	std::vector<size_t> counts(chunkCount * BUCKET_COUNT, 0);
+	std::vector<uint64_t> keys(count);
+	runBatch(jobs, chunkCount, [&](size_t chunk) {
+		size_t* chunkCounts = &counts[chunk * BUCKET_COUNT];
+		size_t end = std::min(count, (chunk + 1) * CHUNK_SIZE);
+		for (size_t i = chunk * CHUNK_SIZE; i < end; i++)
+		{
+			keys[i] = getCell(positions[i]);
+			chunkCounts[getBucket(keys[i])]++;
+		}
+	});
+
+	std::vector<size_t> bucketStart(BUCKET_COUNT + 1, 0);
+	size_t offset = 0;
+	for (size_t bucket = 0; bucket < BUCKET_COUNT; bucket++)
+	{
+		bucketStart[bucket] = offset;
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+		{
+			size_t chunkCountInBucket = counts[chunk * BUCKET_COUNT + bucket];
+			counts[chunk * BUCKET_COUNT + bucket] = offset;
+			offset += chunkCountInBucket;
+		}
+	}
+	bucketStart[BUCKET_COUNT] = offset;
+
+	std::vector<Entry> entries(count);
+	runBatch(jobs, chunkCount, [&](size_t chunk) {
+		size_t* cursors = &counts[chunk * BUCKET_COUNT];
+		size_t end = std::min(count, (chunk + 1) * CHUNK_SIZE);
+		for (size_t i = chunk * CHUNK_SIZE; i < end; i++)
+		{
+			entries[cursors[getBucket(keys[i])]++] = { keys[i], static_cast<uint32_t>(i) };
+		}
+	});
+	keys.clear();
+	keys.shrink_to_fit();
+
+	// Within each bucket, group the positions of a cell behind the first one they are close to
+	float epsilonSquared = epsilon * epsilon;
+	std::vector<uint32_t> representative(count);
+	// the groups of a bucket start where its positions do
+	std::vector<Cell> cells(count);
+	std::vector<size_t> cellCounts(BUCKET_COUNT);
+	runBatch(jobs, BUCKET_COUNT, [&](size_t bucket) {
+		Entry* begin = entries.data() + bucketStart[bucket];
+		Entry* end = entries.data() + bucketStart[bucket + 1];
+		std::sort(begin, end);
+
+		Cell* bucketCells = cells.data() + bucketStart[bucket];
+		size_t groups = 0;
+		for (Entry* run = begin; run != end;)
+		{
+			size_t firstGroup = groups;
+			Entry* runEnd = run;
+			for (; runEnd != end && runEnd->key == run->key; runEnd++)
+			{
+				const glm::vec3& position = positions[runEnd->index];
+				uint32_t match = runEnd->index;
+				for (size_t group = firstGroup; group < groups; group++)
+				{
+					glm::vec3 difference = positions[bucketCells[group].representative] - position;
+					if (glm::dot(difference, difference) <= epsilonSquared)
+					{
+						match = bucketCells[group].representative;
+						break;
+					}
+				}
+				if (match == runEnd->index)
+				{
+					bucketCells[groups++] = { run->key, match };
+				}
+				representative[runEnd->index] = match;
+			}
+			run = runEnd;
+		}
+		cellCounts[bucket] = groups;
+	});
+	entries.clear();
+	entries.shrink_to_fit();
+
+	// Weld groups into a group of a neighbouring cell that is close enough, the smallest index wins.
+	// Only the sides a group is within epsilon of need to be searched.
+	// Targets always have smaller indices, so following them always ends.
+	std::vector<uint32_t> target(representative);
+	if (epsilon > 0)
+	{
+		// a little slack for the rounding of the cell coordinates
+		float reach = epsilon * inverseCellSize * 1.001f;
+
+		runBatch(jobs, BUCKET_COUNT, [&](size_t bucket) {
+			const Cell* bucketCells = cells.data() + bucketStart[bucket];
+			for (size_t group = 0; group < cellCounts[bucket]; group++)
+			{
+				const Cell& cell = bucketCells[group];
+				int64_t coordinates[3] = { int64_t(cell.key & 0x1fffff), int64_t((cell.key >> 21) & 0x1fffff), int64_t(cell.key >> 42) };
+				const glm::vec3& position = positions[cell.representative];
+				glm::vec3 local = (position - boundsMin) * inverseCellSize;
+
+				// per axis, the neighbouring cell to search: -1, 1, or 0 for none
+				int64_t sides[3];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float offset = local[axis] - float(coordinates[axis]);
+					sides[axis] = offset < reach && coordinates[axis] > 0 ? -1 : (offset > 1.0f - reach ? 1 : 0);
+				}
+
+				uint32_t best = cell.representative;
+				for (int64_t dz = 0; dz <= (sides[2] != 0); dz++)
+				{
+					for (int64_t dy = 0; dy <= (sides[1] != 0); dy++)
+					{
+						for (int64_t dx = 0; dx <= (sides[0] != 0); dx++)
+						{
+							if ((dx | dy | dz) == 0)
+							{
+								continue;
+							}
+
+							uint64_t key = packCell(coordinates[0] + dx * sides[0], coordinates[1] + dy * sides[1], coordinates[2] + dz * sides[2]);
+							size_t neighbourBucket = getBucket(key);
+							const Cell* neighbours = cells.data() + bucketStart[neighbourBucket];
+							const Cell* neighboursEnd = neighbours + cellCounts[neighbourBucket];
+							const Cell* it = std::lower_bound(neighbours, neighboursEnd, key,
+								[](const Cell& other, uint64_t value) { return other.key < value; });
+							for (; it != neighboursEnd && it->key == key; it++)
+							{
+								if (it->representative < best)
+								{
+									glm::vec3 difference = positions[it->representative] - position;
+									if (glm::dot(difference, difference) <= epsilonSquared)
+									{
+										best = it->representative;
+									}
+								}
+							}
+						}
+					}
+				}
+				target[cell.representative] = best;
+			}
+		});
+	}
+
+	// Number the output vertices in input order
+	std::vector<uint32_t> groupOf(count);
+	std::vector<size_t> newVertices(chunkCount, 0);
+	runBatch(jobs, chunkCount, [&](size_t chunk) {
+		size_t end = std::min(count, (chunk + 1) * CHUNK_SIZE);
+		size_t created = 0;
+		for (size_t i = chunk * CHUNK_SIZE; i < end; i++)
+		{
+			uint32_t group = representative[i];
+			while (target[group] != group)
+			{
+				group = target[group];
+			}
+			groupOf[i] = group;
+			created += group == i;
+		}
+		newVertices[chunk] = created;
+	});
+
+	size_t outputCount = 0;
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		size_t created = newVertices[chunk];
+		newVertices[chunk] = outputCount;
+		outputCount += created;
+	}
+
+	result.representatives.resize(outputCount);
+	runBatch(jobs, chunkCount, [&](size_t chunk) {
+		size_t end = std::min(count, (chunk + 1) * CHUNK_SIZE);
+		unsigned next = static_cast<unsigned>(newVertices[chunk]);
+		for (size_t i = chunk * CHUNK_SIZE; i < end; i++)
+		{
+			if (groupOf[i] == i)
+			{
+				result.representatives[next] = static_cast<unsigned>(i);
+				result.remap[i] = next++;
+			}
+		}
+	});
+
+	// groups always start at their first position, which now has its number
+	runBatch(jobs, chunkCount, [&](size_t chunk) {
+		size_t end = std::min(count, (chunk + 1) * CHUNK_SIZE);
+		for (size_t i = chunk * CHUNK_SIZE; i < end; i++)
+		{
+			result.remap[i] = result.remap[groupOf[i]];
+		}
+	});
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "JobSystem.h"
+
+#define GLM_FORCE_LEFT_HANDED
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/vec3.hpp>
+
+struct WeldResult
+{
+	// For every input position, the output vertex it became
+	std::vector<unsigned> remap;
+
+	// For every output vertex, the input position it was taken from
+	std::vector<unsigned> representatives;
+};
+
+// Merges positions closer than epsilon, using a spatial hash grid with cells a few epsilons wide.
+//
+// A position joins the first group of its cell whose position is within epsilon, and a group also joins
+// a group of a neighbouring cell within epsilon, so close positions on both sides of a cell border still
+// merge. Groups take the position that comes first in the input, and output vertices keep the order of
+// their first appearance, so the result doesn't depend on the number of threads.
+// An epsilon of 0 only welds identical positions.
+//
+// The grid is sorted into buckets by cell, and the buckets are processed in parallel on the job system.
+void weldPositions(const glm::vec3* positions, size_t count, float epsilon, WeldResult& result, JobSystem* jobs = nullptr);
@@ -0,0 +1,84 @@
+#include "ViewerController.h"
+#include "Hash.h"
+
+#include <glm/glm.hpp>
+
+void ViewerController::update(Camera& camera, Scene& scene, const InputManager& input, float deltaSeconds)
+{
+	// determine the direction we want to move the camera
+	glm::vec3 cameraMove(0.0f, 0.0f, 0.0f);
+	if (input.isDown(xwin::Key::Q))
+		cameraMove += camera.getUp();
+	if (input.isDown(xwin::Key::E))
+		cameraMove += camera.getUp() * -1.0f;
+	if (input.isDown(xwin::Key::W))
+		cameraMove += camera.getForward();
+	if (input.isDown(xwin::Key::A))
+		cameraMove += camera.getRight() * -1.0f;
+	if (input.isDown(xwin::Key::S))
+		cameraMove += camera.getForward() * -1.0f;
+	if (input.isDown(xwin::Key::D))
+		cameraMove += camera.getRight();
+
+	// If we're moving the camera, scale it to the velocity
+	if (cameraMove != glm::vec3(0, 0, 0))
+	{
+		float moveDistance = cameraVelocity * deltaSeconds;
+
+		glm::vec3 moveBy = glm::normalize(cameraMove) * moveDistance;
+		camera.move(moveBy);
+	}
+
+	// Rotate the camera if we need to
+	if (input.isDown(xwin::MouseInput::Right))
+	{
+		float sensitivity = cameraSensitivity * deltaSeconds;
+		float deltaX = input.getAxis(InputAxis::MOUSE_X) * sensitivity;
+		float deltaY = input.getAxis(InputAxis::MOUSE_Y) * sensitivity;
+
+		cameraYaw += deltaX;
+		cameraPitch = glm::clamp(cameraPitch + deltaY, -90.0f, 90.0f);
+
+		// wrap left/right to 0-360
+		if (cameraYaw > 360)
+		{
+			cameraYaw = glm::mod(cameraYaw, 360.0f);
+		}
+		else if (cameraYaw < 0)
+		{
+			cameraYaw = cameraYaw + 360.0f * (1 + cameraYaw / -360.0f);
+		}
+
+		camera.setRotation(cameraPitch, cameraYaw, 0);
+	}
+
+	// Rotate the object if the left mouse button is being held down
+	if (input.isDown(xwin::MouseInput::Left) && scene.size() > 0)
+	{
+		auto& object = *scene.begin();
+
+		float sensitivity = objectSensitivity * deltaSeconds;
+		float deltaX = input.getAxis(InputAxis::MOUSE_X) * sensitivity;
+		float deltaY = input.getAxis(InputAxis::MOUSE_Y) * sensitivity;
+
+		if (deltaX)
+		{
+			object->addRotation(0, -deltaX, 0);
+		}
+		if (deltaY)
+		{
+			object->rotateAround(camera.getRight(), -deltaY);
+		}
+	}
+}
+
+uint64_t hashTransforms(Camera& camera, const Scene& scene)
+{
+	Hasher hasher;
+	hasher.updateValue(camera.getModelMatrix());
+	for (auto& object : scene)
+	{
+		hasher.updateValue(object->getModelMatrix());
+	}
+	return hasher.finish().low;
+}
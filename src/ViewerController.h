@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Camera.h"
+#include "InputManager.h"
+#include "Scene.h"
+
+// The update step of the viewer: flies the camera with WASD/QE and the right mouse button,
+// and turns the first object of the scene with the left mouse button.
+// It only reads the input state and the frame time it is given, so replaying the same input
+// with the same frame times (see InputRecording.h) gives the same transforms.
+class ViewerController
+{
+public:
+	void update(Camera& camera, Scene& scene, const InputManager& input, float deltaSeconds);
+
+	// Units per second
+	float cameraVelocity = 5.0f;
+
+	// Degrees per pixel of mouse movement and second
+	float cameraSensitivity = 8.0f;
+	float objectSensitivity = 15.0f;
+
+private:
+	// camera pitch and yaw as euler angles stored here
+	// because quaternions to euler conversions have errors.
+	// using a stored euler value and figuring it out from there is easier.
+	float cameraPitch = 0.0f;
+	float cameraYaw = 0.0f;
+};
+
+// Returns a hash of the camera and object transforms, to check that two replays ended in the same place
+uint64_t hashTransforms(Camera& camera, const Scene& scene);
@@ -1,13 +1,19 @@
 #include "CrossWindow/CrossWindow.h"
 
 #include <iostream>
+#include <filesystem>
+#include <fstream>
 #include <chrono>
+#include <cmath>
+#include <string>
 #include "Logger.h"
 #include "Renderer.h"
+#include "RenderStats.h"
+#include "StressScene.h"
+#include "InputRecording.h"
+#include "ViewerController.h"
 
-void performUpdate(Renderer& renderer, float fDelta);
-
-ScenePtr createScene(ResourceManager* resourceManager)
+ScenePtr createScene(ResourceManager* resourceManager, const std::wstring& streamedModel, const std::wstring& extraModel)
 {
 	auto teapotMesh = resourceManager->loadModel(L"teapot.obj");
 
@@ -16,14 +22,222 @@ ScenePtr createScene(ResourceManager* resourceManager)
 	teapot->setPosition(0.0f, -0.3f, 2.5f);
 	teapot->setScale(0.3f);
 
+	// large models show up progressively while the viewer stays responsive
+	if (!streamedModel.empty())
+	{
+		auto streamedMesh = resourceManager->loadModelStreaming(streamedModel);
+		auto streamed = scene->createObject(streamedMesh);
+		streamed->setPosition(1.5f, -0.3f, 2.5f);
+		streamed->setScale(0.3f);
+	}
+
+	if (!extraModel.empty())
+	{
+		auto extra = scene->createObject(resourceManager->loadModel(extraModel));
+		extra->setPosition(-1.5f, -0.3f, 2.5f);
+		extra->setScale(0.3f);
+	}
+
 	return scene;
 }
 
+// A full turn around y over four seconds while bobbing up and down, around where createScene() places the teapot
+std::shared_ptr<const SampledClip> createTeapotClip()
+{
+	AnimationClip clip;
+	clip.duration = 4.0f;
+
+	TransformTrack track;
+	for (int key = 0; key <= 8; key++)
+	{
+		float time = clip.duration * key / 8.0f;
+		float angle = glm::radians(45.0f * key);
+		track.positions.push_back({ time, glm::vec3(0.0f, -0.3f + 0.1f * std::sin(angle * 2.0f), 2.5f) });
+		track.rotations.push_back({ time, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)) });
+	}
+	track.scales.push_back({ 0.0f, glm::vec3(0.3f) });
+	clip.tracks.push_back(track);
+
+	return std::make_shared<const SampledClip>(clip);
+}
+
 void xmain(int argc, const char** argv)
 {
 	// todo: consider global error handling but....the problem is that then visual studio doesn't report where the exception came from
 	// consider Debug > Windows > Exceptions Settings > Break When Thrown > All C++ Exceptions but it might also report those we are not interested in
 
+	// --memory-log <path> writes the memory stats of every frame as CSV
+	// --model <file> adds a model from assets/models next to the teapot (OBJ, STL, PLY or .mvmesh)
+	// --stream <model> adds a model from assets/models that is loaded progressively
+	// --lod <file> adds an out-of-core LOD model from assets/models (see ModelViewerLodBuild)
+	// --points <file> adds the points of an OBJ file from assets/models as a point cloud (eg. a LiDAR scan without faces)
+	// --point-budget <count> most points of the point cloud drawn in a frame (default 5 million)
+	// --gltf <file> imports the meshes and nodes of a .glb file from assets/models into the scene
+	// --scene <file> adds the objects of a binary .mvscene file from assets/models
+	// --occlusion-log <path> writes the occlusion culling stats of every frame as CSV
+	// --render-stats <path> writes the draws, triangles, state changes and uploads of every frame as CSV,
+	//   or the last 600 frames as JSON at exit when the path ends in .json
+	// --no-occlusion draws every object in the view, even when hidden behind others
+	// --texture <file> applies a PNG from assets/textures to the scene, compressed to BC7 and cached
+	// --log <path> also appends the log to a file
+	// --record <path> records the input and frame times of the session
+	// --replay <path> plays a recorded session back instead of the live input, as fast as it renders, then exits
+	// --fixed-step <seconds> replays every frame with this frame time instead of the recorded one
+	// --animate spins and bobs the teapot with a keyframe animation
+	// --residency <full|positions|compressed|none> sets what loaded meshes keep of their CPU data after upload
+	// --cooked <dir> loads models from the output of ModelViewerAssetCook when it has them
+	// --views <count> splits the window into a grid of views, each camera turned further around from the main one
+	// --stress <count> adds a procedural scene of this many objects (see StressScene.h) and moves the camera to see it
+	// --stress-layout <grid|clusters> lays the stress scene out in walls (the default) or random clusters
+	std::ofstream memoryLog;
+	std::ofstream occlusionLog;
+	std::ofstream renderStatsLog;
+	std::string renderStatsJson;
+	std::ofstream recordFile;
+	std::ifstream replayFile;
+	InputReplayOptions replayOptions;
+	std::wstring extraModel;
+	std::wstring streamedModel;
+	std::wstring lodModel;
+	std::wstring pointCloudFile;
+	PointCloudStreamerOptions pointCloudOptions;
+	std::wstring gltfModel;
+	std::wstring sceneFile;
+	std::wstring textureFile;
+	StressSceneOptions stressOptions;
+	stressOptions.objects = 0;
+	MeshResidency residency = MeshResidency::Full;
+	std::filesystem::path cookedDirectory;
+	unsigned viewCount = 1;
+	bool animate = false;
+	bool occlusion = true;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--animate")
+		{
+			animate = true;
+			continue;
+		}
+		if (std::string(argv[i]) == "--no-occlusion")
+		{
+			occlusion = false;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			break;
+		}
+
+		if (std::string(argv[i]) == "--log")
+		{
+			LoggerOptions options;
+			options.file = argv[i + 1];
+			Logger::start(options);
+		}
+		else if (std::string(argv[i]) == "--memory-log")
+		{
+			memoryLog.open(argv[i + 1]);
+			MemoryStats::writeCsvHeader(memoryLog);
+		}
+		else if (std::string(argv[i]) == "--occlusion-log")
+		{
+			occlusionLog.open(argv[i + 1]);
+			occlusionLog << "frame,occluders,occluder_triangles,tested,occluded,rejected_percent,rasterize_ms,test_ms" << std::endl;
+		}
+		else if (std::string(argv[i]) == "--render-stats")
+		{
+			std::filesystem::path path = argv[i + 1];
+			if (path.extension() == ".json")
+			{
+				renderStatsJson = argv[i + 1];
+			}
+			else
+			{
+				renderStatsLog.open(path);
+				RenderStats::writeCsvHeader(renderStatsLog);
+			}
+		}
+		else if (std::string(argv[i]) == "--record")
+		{
+			recordFile.open(argv[i + 1], std::ios::binary);
+		}
+		else if (std::string(argv[i]) == "--replay")
+		{
+			replayFile.open(argv[i + 1], std::ios::binary);
+			if (!replayFile)
+			{
+				LOG_ERROR("Could not open input recording {}", argv[i + 1]);
+				return;
+			}
+		}
+		else if (std::string(argv[i]) == "--fixed-step")
+		{
+			replayOptions.fixedDeltaSeconds = std::stof(argv[i + 1]);
+		}
+		else if (std::string(argv[i]) == "--model")
+		{
+			std::string name = argv[i + 1];
+			extraModel = std::wstring(name.begin(), name.end());
+		}
+		else if (std::string(argv[i]) == "--stream")
+		{
+			std::string name = argv[i + 1];
+			streamedModel = std::wstring(name.begin(), name.end());
+		}
+		else if (std::string(argv[i]) == "--lod")
+		{
+			std::string name = argv[i + 1];
+			lodModel = std::wstring(name.begin(), name.end());
+		}
+		else if (std::string(argv[i]) == "--points")
+		{
+			std::string name = argv[i + 1];
+			pointCloudFile = std::wstring(name.begin(), name.end());
+		}
+		else if (std::string(argv[i]) == "--point-budget")
+		{
+			pointCloudOptions.pointBudget = std::stoul(argv[i + 1]);
+		}
+		else if (std::string(argv[i]) == "--gltf")
+		{
+			std::string name = argv[i + 1];
+			gltfModel = std::wstring(name.begin(), name.end());
+		}
+		else if (std::string(argv[i]) == "--scene")
+		{
+			std::string name = argv[i + 1];
+			sceneFile = std::wstring(name.begin(), name.end());
+		}
+		else if (std::string(argv[i]) == "--residency")
+		{
+			std::string name = argv[i + 1];
+			residency = name == "positions" ? MeshResidency::Positions
+				: name == "compressed" ? MeshResidency::Compressed
+				: name == "none" ? MeshResidency::None : MeshResidency::Full;
+		}
+		else if (std::string(argv[i]) == "--cooked")
+		{
+			cookedDirectory = argv[i + 1];
+		}
+		else if (std::string(argv[i]) == "--views")
+		{
+			viewCount = std::stoul(argv[i + 1]);
+		}
+		else if (std::string(argv[i]) == "--stress")
+		{
+			stressOptions.objects = std::stoul(argv[i + 1]);
+		}
+		else if (std::string(argv[i]) == "--stress-layout")
+		{
+			stressOptions.layout = std::string(argv[i + 1]) == "clusters" ? StressLayout::Clusters : StressLayout::Grid;
+		}
+		else if (std::string(argv[i]) == "--texture")
+		{
+			std::string name = argv[i + 1];
+			textureFile = std::wstring(name.begin(), name.end());
+		}
+	}
+
 	xwin::WindowDesc windowDesc;
 	windowDesc.name = "Test";
 	windowDesc.title = "My Title";
@@ -36,13 +250,85 @@ void xmain(int argc, const char** argv)
 
 	if (!window.create(windowDesc, eventQueue))
 	{
-		std::cout << "Failed to create window. Exiting..." << std::endl;
+		LOG_ERROR("Failed to create window. Exiting...");
 		return;
 	}
 
 	// Create renderer and scene based on window
 	Renderer renderer(window);
-	renderer.setScene(createScene(renderer.getResourceManager()));
+	renderer.setOcclusionCulling(occlusion);
+	renderer.getResourceManager()->setMeshResidency(residency);
+	renderer.getResourceManager()->setCookedDirectory(cookedDirectory);
+	renderer.setScene(createScene(renderer.getResourceManager(), streamedModel, extraModel));
+	if (!lodModel.empty())
+	{
+		renderer.setLodModel(renderer.getResourceManager()->loadLodModel(lodModel));
+	}
+	if (!pointCloudFile.empty())
+	{
+		renderer.setPointCloud(renderer.getResourceManager()->loadPointCloud(pointCloudFile, {}, pointCloudOptions));
+	}
+	if (!gltfModel.empty())
+	{
+		renderer.getResourceManager()->loadGltf(gltfModel, *renderer.getScene());
+	}
+	if (!sceneFile.empty())
+	{
+		renderer.getResourceManager()->loadScene(sceneFile, *renderer.getScene());
+	}
+	if (stressOptions.objects > 0)
+	{
+		StressScene stress = generateStressScene(*renderer.getScene(), stressOptions, renderer.getAnimationSystem());
+		for (const MeshResourcePtr& mesh : stress.meshes)
+		{
+			renderer.getResourceManager()->createMesh(*mesh);
+		}
+
+		Camera* camera = renderer.getCamera();
+		camera->setPosition(stress.viewPosition);
+		camera->setClipRange(0.1f, stress.viewDistance);
+		LOG_INFO("Stress scene: {} objects, {} meshes, {} animated", stressOptions.objects, stress.meshes.size(), stress.animatedObjects);
+	}
+	if (!textureFile.empty())
+	{
+		renderer.setTexture(renderer.getResourceManager()->loadTexture(textureFile));
+	}
+	if (viewCount > 1)
+	{
+		unsigned columns = unsigned(std::ceil(std::sqrt(float(viewCount))));
+		unsigned rows = (viewCount + columns - 1) / columns;
+		for (unsigned view = 0; view < viewCount; view++)
+		{
+			float x = float(view % columns) / columns;
+			float y = float(view / columns) / rows;
+			if (view == 0)
+			{
+				renderer.setViewport(0, x, y, 1.0f / columns, 1.0f / rows);
+			}
+			else
+			{
+				renderer.addView(x, y, 1.0f / columns, 1.0f / rows);
+			}
+		}
+	}
+	if (animate)
+	{
+		renderer.getAnimationSystem()->play(*renderer.getScene()->begin(), createTeapotClip());
+	}
+
+	std::unique_ptr<InputRecorder> recorder;
+	if (recordFile.is_open())
+	{
+		recorder = std::make_unique<InputRecorder>(recordFile);
+	}
+	std::unique_ptr<InputReplayer> replayer;
+	if (replayFile.is_open())
+	{
+		replayer = std::make_unique<InputReplayer>(replayFile, replayOptions);
+	}
+	std::vector<InputEvent> appliedEvents;
+
+	ViewerController controller;
 
 	// store for frame counting and limiting fps
 	auto previousTime = std::chrono::high_resolution_clock::now();
@@ -56,11 +342,10 @@ void xmain(int argc, const char** argv)
 		bool shouldRender = true;
 		eventQueue.update();
 
-		// Handle window events
+		// Handle window events. Input is timestamped and queued here, and applied by the update.
 		while (!eventQueue.empty())
 		{
 			const xwin::Event& event = eventQueue.front();
-			renderer.handleEvent(event);
 
 			if (event.type == xwin::EventType::Close)
 			{
@@ -68,8 +353,9 @@ void xmain(int argc, const char** argv)
 				isRunning = false;
 				break;
 			}
-			else
+			else if (replayer == nullptr || event.type == xwin::EventType::Resize)
 			{
+				// a replay ignores the live input
 				renderer.handleEvent(event);
 			}
 
@@ -81,106 +367,99 @@ void xmain(int argc, const char** argv)
 		auto newTime = std::chrono::high_resolution_clock::now();
 		float elapsed = std::chrono::duration<float>(newTime - previousTime).count();
 		float minElapsed = 1.0f / maxFps;
-		if (elapsed < minElapsed)
+		if (elapsed < minElapsed && replayer == nullptr)
 		{
 			continue; // wait some more
 		}
 
 		previousTime = newTime;
+		MemoryStats::beginFrame();
 
-		// perform update step
-		performUpdate(renderer, elapsed);
-		input->notifyUpdateFinished(); // todo: consolidate
-
-		// Render view
-		if (shouldRender)
+		// a replay queues the recorded input of the frame and takes its recorded time
+		if (replayer != nullptr && !replayer->nextFrame(*input, elapsed))
 		{
-			renderer.render();
+			LOG_INFO("Replayed {} frames, transform hash {}", replayer->getFrameCount(),
+				hashTransforms(*renderer.getCamera(), *renderer.getScene()));
+			window.close();
+			break;
 		}
-	}
-}
 
-// camera pitch and yaw as euler angles stored here
-// because quaternions to euler conversions have errors.
-// using a stored euler value and figuring it out from there is easier.
-float cameraPitch;
-float cameraYaw;
-
-void performUpdate(Renderer& renderer, float fDelta)
-{
-	auto camera = renderer.getCamera();
-	auto input = renderer.getInputManager();
-
-	float cameraVelocity = 5.0f;
-	float cameraSensitivity = 8.0f;
-
-	// determine the direction we want to move the camera
-	glm::vec3 cameraMove(0.0f, 0.0f, 0.0f);
-	if (input->isDown(xwin::Key::Q))
-		cameraMove += camera->getUp();
-	if (input->isDown(xwin::Key::E))
-		cameraMove += camera->getUp() * -1.0f;
-	if (input->isDown(xwin::Key::W))
-		cameraMove += camera->getForward();
-	if (input->isDown(xwin::Key::A))
-		cameraMove += camera->getRight() * -1.0f;
-	if (input->isDown(xwin::Key::S))
-		cameraMove += camera->getForward() * -1.0f;
-	if (input->isDown(xwin::Key::D))
-		cameraMove += camera->getRight();
-
-	// If we're moving the camera, scale it to the velocity
-	if (cameraMove != glm::vec3(0, 0, 0))
-	{
-		float moveDistance = cameraVelocity * fDelta;
+		// apply the input that arrived since the last update
+		appliedEvents.clear();
+		input->processEvents(&appliedEvents);
+		if (recorder != nullptr)
+		{
+			recorder->writeFrame(elapsed, appliedEvents);
+		}
 
-		glm::vec3 moveBy = glm::normalize(cameraMove) * moveDistance;
-		camera->move(moveBy);
-	}
+		// load the next batch of any model still streaming in
+		renderer.getResourceManager()->updateStreaming();
 
-	// Rotate the camera if we need to
-	if (input->isDown(xwin::MouseInput::Right))
-	{
-		auto camera = renderer.getCamera();
+		// perform update step
+		controller.update(*renderer.getCamera(), *renderer.getScene(), *input, elapsed);
+		input->notifyUpdateFinished(); // todo: consolidate
 
-		float sensitivity = cameraSensitivity * fDelta;
-		float deltaX = input->getAxis(InputAxis::MOUSE_X) * sensitivity;
-		float deltaY = input->getAxis(InputAxis::MOUSE_Y) * sensitivity;
+		// the other views follow the main camera, each turned a step further around
+		for (size_t view = 1; view < renderer.getViewCount(); view++)
+		{
+			Camera* camera = renderer.getCamera(view);
+			glm::vec3 rotation = renderer.getCamera()->getRotation();
+			camera->setPosition(renderer.getCamera()->getPosition());
+			camera->setRotation(rotation.x, rotation.y + 360.0f * view / renderer.getViewCount(), rotation.z);
+		}
 
-		cameraYaw += deltaX;
-		cameraPitch = glm::clamp(cameraPitch + deltaY, -90.0f, 90.0f);
+		// Render view
+		if (shouldRender)
+		{
+			renderer.render(elapsed);
+			if (renderStatsLog.is_open())
+			{
+				RenderStats::writeCsvRow(renderStatsLog, RenderStats::getLastFrame());
+			}
+		}
 
-		// wrap left/right to 0-360
-		if (cameraYaw > 360)
+		MemoryStats::endFrame();
+		if (memoryLog.is_open())
 		{
-			cameraYaw = glm::mod(cameraYaw, 360.0f);
+			MemoryStats::writeCsvRow(memoryLog);
 		}
-		else if (cameraYaw < 0)
+		if (occlusionLog.is_open())
 		{
-			cameraYaw = cameraYaw + 360.0f * (1 + cameraYaw / -360.0f);
+			auto& stats = renderer.getOcclusionStats();
+			occlusionLog << MemoryStats::getLastFrame().frame << "," << stats.occluders << "," << stats.occluderTriangles << ","
+				<< stats.tested << "," << stats.occluded << "," << stats.getRejectedShare() * 100.0 << ","
+				<< stats.rasterizeSeconds * 1000.0 << "," << stats.testSeconds * 1000.0 << "\n";
 		}
-
-		camera->setRotation(cameraPitch, cameraYaw, 0);
 	}
 
-	// Rotate the object if the left mouse button is being held down
-	if (input->isDown(xwin::MouseInput::Left))
+	if (renderer.getLodModel() != nullptr)
 	{
-		auto scene = renderer.getScene();
-		
-		auto object = *scene->begin();
+		auto& stats = renderer.getLodModel()->getStats();
+		LOG_INFO("LOD streaming: {} MB resident in {} nodes, {} MB process RSS, {} MB loaded, {} MB per unit travelled",
+			stats.residentBytes / (1024 * 1024), stats.residentNodes, stats.processResidentBytes / (1024 * 1024),
+			stats.loadedBytesTotal / (1024 * 1024), stats.bytesPerDistance / (1024 * 1024));
+	}
 
-		float sensitivity = 15.0f * fDelta;
-		float deltaX = input->getAxis(InputAxis::MOUSE_X) * sensitivity;
-		float deltaY = input->getAxis(InputAxis::MOUSE_Y) * sensitivity;
+	if (renderer.getPointCloud() != nullptr)
+	{
+		auto& stats = renderer.getPointCloud()->getStats();
+		LOG_INFO("Point cloud: {} points drawn in {} nodes, {}M points/s, {} MB resident in {} nodes, selected in {} ms",
+			stats.visiblePoints, stats.visibleNodes, unsigned(stats.pointsPerSecond / 1000000),
+			stats.residentBytes / (1024 * 1024), stats.residentNodes, stats.selectSeconds * 1000.0);
+	}
 
-		if (deltaX)
-		{
-			object->addRotation(0, -deltaX, 0);
-		}
-		if (deltaY)
-		{
-			object->rotateAround(camera->getRight(), -deltaY);
-		}
+	if (!renderStatsJson.empty())
+	{
+		std::ofstream file(renderStatsJson);
+		RenderStats::writeJson(file);
 	}
-}
\ No newline at end of file
+
+	auto average = RenderStats::getAverage();
+	LOG_INFO("Average frame: {} draws, {} triangles, {} points, {} state changes, {} KB uploaded, {} ms CPU",
+		average.get(RenderCounter::Draws), average.get(RenderCounter::Triangles), average.get(RenderCounter::Points),
+		average.get(RenderCounter::StateChanges), average.get(RenderCounter::BufferUploadBytes) / 1024, average.cpuSeconds * 1000.0);
+
+	// the dump goes straight to the console, after everything logged before it
+	Logger::flush();
+	MemoryStats::dump(std::cout);
+}
@@ -0,0 +1,89 @@
+// Preprocesses an OBJ file into an out-of-core LOD file that the viewer streams with --lod.
+
+#include "LodBuilder.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void printUsage()
+{
+	cout << "Usage: ModelViewerLodBuild <input.obj> <output.mvlod> [options]\n"
+		<< "  --leaf-triangles N  triangles per leaf chunk (default 65536)\n"
+		<< "  --cluster N         simplification grid cells per axis of a node (default 64)\n"
+		<< "  --memory MB         memory used while building (default 512)\n"
+		<< "  --temp DIR          directory for temporary files (default system temp)\n";
+}
+
+int main(int argc, char** argv)
+{
+	LodBuildOptions options;
+	vector<string> paths;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--help" || arg == "-h")
+		{
+			printUsage();
+			return 0;
+		}
+		else if (arg == "--leaf-triangles" && hasValue)
+		{
+			options.leafTriangles = strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--cluster" && hasValue)
+		{
+			options.clusterResolution = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+		}
+		else if (arg == "--memory" && hasValue)
+		{
+			options.memoryLimit = strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+		}
+		else if (arg == "--temp" && hasValue)
+		{
+			options.tempDirectory = argv[++i];
+		}
+		else if (arg.size() > 1 && arg[0] == '-')
+		{
+			cerr << "Unknown argument " << arg << endl;
+			printUsage();
+			return 1;
+		}
+		else
+		{
+			paths.push_back(arg);
+		}
+	}
+
+	if (paths.size() != 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	try
+	{
+		auto start = chrono::steady_clock::now();
+		LodBuildStats stats = buildLodFile(paths[0], paths[1], options);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		cout << "Source:  " << stats.sourceVertices << " vertices, " << stats.sourceTriangles << " triangles\n"
+			<< "Tree:    " << stats.nodes << " nodes, " << stats.leaves << " leaves, " << stats.levels << " levels\n"
+			<< "Output:  " << stats.outputBytes / (1024 * 1024) << " MB in " << seconds << " s" << endl;
+	}
+	catch (const std::exception& e)
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+// Compresses an OBJ file into a .mvmesh file, which the viewer loads like any other model.
+
+#include "MeshCodec.h"
+#include "ObjLoader.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void printUsage()
+{
+	cout << "Usage: ModelViewerMeshEncode <input.obj> <output.mvmesh> [options]\n"
+		<< "  --position-bits N   bits per position axis, 1 to 16 (default 16)\n";
+}
+
+int main(int argc, char** argv)
+{
+	MeshCodecOptions options;
+	vector<string> paths;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--help" || arg == "-h")
+		{
+			printUsage();
+			return 0;
+		}
+		else if (arg == "--position-bits" && hasValue)
+		{
+			options.positionBits = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+		}
+		else if (arg.size() > 1 && arg[0] == '-')
+		{
+			cerr << "Unknown argument " << arg << endl;
+			printUsage();
+			return 1;
+		}
+		else
+		{
+			paths.push_back(arg);
+		}
+	}
+
+	if (paths.size() != 2)
+	{
+		printUsage();
+		return 1;
+	}
+
+	try
+	{
+		ifstream input(paths[0]);
+		if (!input)
+		{
+			throw std::runtime_error("Could not open " + paths[0]);
+		}
+
+		vector<Vertex> vertices;
+		vector<unsigned> indices;
+		parseObj(input, vertices, indices);
+		normalizeVertexNormals(vertices);
+
+		auto start = chrono::steady_clock::now();
+		writeMeshFile(paths[1], vertices, indices, options);
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		// time a decode too, it's what the viewer pays on every load
+		start = chrono::steady_clock::now();
+		vector<Vertex> decodedVertices;
+		vector<unsigned> decodedIndices;
+		readMeshFile(paths[1], decodedVertices, decodedIndices, &JobSystem::getDefault());
+		double decodeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		double rawBytes = double(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned));
+		double encodedBytes = double(filesystem::file_size(paths[1]));
+
+		cout << "Source:  " << vertices.size() << " vertices, " << indices.size() / 3 << " triangles\n"
+			<< "Output:  " << encodedBytes / 1024 << " KB, " << rawBytes / encodedBytes << "x smaller, encoded in " << seconds << " s\n"
+			<< "Decode:  " << decodeSeconds * 1000 << " ms, " << rawBytes / decodeSeconds / (1024 * 1024) << " MB/s" << endl;
+	}
+	catch (const std::exception& e)
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,154 @@
+// Plays a session recorded with the viewer's --record through the viewer's update without a window,
+// and prints where the camera and the object ended up. Runs on any machine, so replays can be compared
+// across builds: the same recording must always give the same transform hash.
+
+#include "Camera.h"
+#include "InputManager.h"
+#include "InputRecording.h"
+#include "Scene.h"
+#include "ViewerController.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+	struct ReplayResult
+	{
+		size_t frames = 0;
+		double simulatedSeconds = 0;
+		uint64_t hash = 0;
+		glm::vec3 cameraPosition;
+		glm::vec3 cameraRotation;
+		glm::vec3 objectRotation;
+	};
+
+	// The camera and the teapot as the viewer sets them up, without meshes
+	ReplayResult replay(const string& path, const InputReplayOptions& options)
+	{
+		ifstream file(path, ios::binary);
+		if (!file)
+		{
+			throw std::runtime_error("Could not open " + path);
+		}
+		InputReplayer replayer(file, options);
+
+		Camera camera;
+		camera.setFov(45.0f);
+		camera.setAspectRatio(1280u, 720u);
+		camera.setClipRange(0.1f, 50.0f);
+
+		Scene scene;
+		auto teapot = scene.createObject(nullptr);
+		teapot->setPosition(0.0f, -0.3f, 2.5f);
+		teapot->setScale(0.3f);
+
+		InputManager input;
+		ViewerController controller;
+		ReplayResult result;
+
+		float deltaSeconds = 0;
+		while (replayer.nextFrame(input, deltaSeconds))
+		{
+			input.processEvents();
+			controller.update(camera, scene, input, deltaSeconds);
+			input.notifyUpdateFinished();
+			result.simulatedSeconds += deltaSeconds;
+		}
+
+		result.frames = replayer.getFrameCount();
+		result.hash = hashTransforms(camera, scene);
+		result.cameraPosition = camera.getPosition();
+		result.cameraRotation = camera.getRotation();
+		result.objectRotation = teapot->getRotation();
+		return result;
+	}
+
+	ostream& operator <<(ostream& os, const glm::vec3& v)
+	{
+		return os << v.x << ", " << v.y << ", " << v.z;
+	}
+}
+
+void printUsage()
+{
+	cout << "Usage: ModelViewerReplay <session> [options]\n"
+		<< "  --fixed-step SECONDS  use this frame time instead of the recorded ones\n"
+		<< "  --runs N              replay N times and check every run ends the same (default 2)\n";
+}
+
+int main(int argc, char** argv)
+{
+	InputReplayOptions options;
+	unsigned runs = 2;
+	vector<string> paths;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--help" || arg == "-h")
+		{
+			printUsage();
+			return 0;
+		}
+		else if (arg == "--fixed-step" && hasValue)
+		{
+			options.fixedDeltaSeconds = strtof(argv[++i], nullptr);
+		}
+		else if (arg == "--runs" && hasValue)
+		{
+			runs = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+		}
+		else if (arg.size() > 1 && arg[0] == '-')
+		{
+			cerr << "Unknown argument " << arg << endl;
+			printUsage();
+			return 1;
+		}
+		else
+		{
+			paths.push_back(arg);
+		}
+	}
+
+	if (paths.size() != 1 || runs == 0)
+	{
+		printUsage();
+		return 1;
+	}
+
+	try
+	{
+		auto start = chrono::steady_clock::now();
+		ReplayResult first = replay(paths[0], options);
+		bool deterministic = true;
+		for (unsigned run = 1; run < runs; run++)
+		{
+			deterministic = deterministic && replay(paths[0], options).hash == first.hash;
+		}
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		cout << "Frames:          " << first.frames << " (" << first.simulatedSeconds << " s of session)\n"
+			<< "Camera position: " << first.cameraPosition << "\n"
+			<< "Camera rotation: " << first.cameraRotation << "\n"
+			<< "Object rotation: " << first.objectRotation << "\n"
+			<< "Transform hash:  " << hex << first.hash << dec << "\n"
+			<< "Runs:            " << runs << " in " << seconds << " s, " << (deterministic ? "identical" : "DIFFERENT") << "\n";
+
+		return deterministic ? 0 : 1;
+	}
+	catch (const std::exception& e)
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+}
@@ -0,0 +1,126 @@
+// Renders thumbnail or turntable images of many models on the CPU, for machines without a GPU.
+
+#include "ThumbnailPipeline.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void printUsage()
+{
+	cout << "Usage: ModelViewerThumbnails [options] <model>...\n"
+		<< "  --list FILE         read model paths from a file, one per line\n"
+		<< "  --views LIST        comma separated presets: front, back, left, right, top,\n"
+		<< "                      three-quarter, turntable:N (default three-quarter)\n"
+		<< "  --size N            image width and height in pixels (default 256)\n"
+		<< "  --output DIR        directory for the images (default current)\n"
+		<< "  --threads N         worker threads (default one per hardware thread)\n"
+		<< "  --in-flight N       models loaded at once (default twice the threads)\n";
+}
+
+int main(int argc, char** argv)
+{
+	ThumbnailOptions options;
+	vector<filesystem::path> models;
+
+	try
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (arg == "--help" || arg == "-h")
+			{
+				printUsage();
+				return 0;
+			}
+			else if (arg == "--list" && hasValue)
+			{
+				ifstream list(argv[++i]);
+				if (!list)
+				{
+					throw std::runtime_error(string("Could not open list ") + argv[i]);
+				}
+				for (string line; getline(list, line);)
+				{
+					if (!line.empty() && line.back() == '\r')
+					{
+						line.pop_back();
+					}
+					if (!line.empty())
+					{
+						models.push_back(line);
+					}
+				}
+			}
+			else if (arg == "--views" && hasValue)
+			{
+				options.views = parseThumbnailViews(argv[++i]);
+			}
+			else if (arg == "--size" && hasValue)
+			{
+				options.width = options.height = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+			}
+			else if (arg == "--output" && hasValue)
+			{
+				options.outputDirectory = argv[++i];
+			}
+			else if (arg == "--threads" && hasValue)
+			{
+				options.threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+			}
+			else if (arg == "--in-flight" && hasValue)
+			{
+				options.modelsInFlight = strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg.size() > 1 && arg[0] == '-')
+			{
+				cerr << "Unknown argument " << arg << endl;
+				printUsage();
+				return 1;
+			}
+			else
+			{
+				models.push_back(arg);
+			}
+		}
+
+		if (models.empty() || options.width == 0)
+		{
+			printUsage();
+			return 1;
+		}
+
+		filesystem::create_directories(options.outputDirectory);
+
+		ThumbnailPipeline pipeline(options);
+		ThumbnailStats stats = pipeline.run(models, &cerr);
+
+		cout << "Models:  " << stats.models << " (" << stats.failedModels << " failed)\n"
+			<< "Images:  " << stats.images << " in " << stats.seconds << " s, " << stats.getImagesPerSecond() << " images/s, "
+			<< stats.imageBytes / 1024 << " KB\n"
+			<< "Threads: " << stats.threads << "\n";
+		for (size_t stage = 0; stage < static_cast<size_t>(ThumbnailStage::Count); stage++)
+		{
+			auto value = static_cast<ThumbnailStage>(stage);
+			cout << "  " << left << setw(10) << getThumbnailStageName(value) << right << fixed << setprecision(1)
+				<< setw(6) << stats.getUtilization(value) * 100 << "% busy, " << setprecision(3) << stats.stageSeconds[stage] << " s\n";
+		}
+		cout.flush();
+
+		return stats.failedModels == 0 ? 0 : 1;
+	}
+	catch (const std::exception& e)
+	{
+		cerr << e.what() << endl;
+		return 1;
+	}
+}